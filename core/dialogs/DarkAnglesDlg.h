@@ -34,23 +34,12 @@
 
 #include "libs/globals.h"
 #include "libs/globals_qt.h"
+#include "libs/spurions.h"
 #include "tlibs/file/prop.h"
 
 #include "ui/ui_darkangles.h"
 
 
-template<class T = double>
-struct DarkAngle
-{
-	T dAngleStart;
-	T dAngleEnd;
-	T dAngleOffs;
-
-	int iCentreOn;    // 0=mono, 1=sample, 2=ana
-	int iRelativeTo;  // 0=crystal angle, 1=in axis, 2=out axis
-};
-
-
 class DarkAnglesDlg : public QDialog, Ui::DarkAnglesDlg
 { Q_OBJECT
 protected:
@@ -33,6 +33,7 @@
 #include "tlibs/time/stopwatch.h"
 #include "libs/qt/qthelper.h"
 #include <chrono>
+#include <sstream>
 #include <iostream>
 
 using t_real = t_real_glob;
@@ -167,6 +168,21 @@ void NetCacheDlg::UpdateAll(const t_mapCacheVal& map)
 }
 
 
+void NetCacheDlg::UpdateStats(const NetCacheStats& stats)
+{
+	std::ostringstream ostr;
+	ostr.precision(g_iPrecGfx);
+
+	ostr << "Updates: " << stats.iReceived
+		<< ", dropped: " << stats.iDropped
+		<< ", batches: " << stats.iBatches
+		<< ", latency: " << stats.dLatency*t_real(1e3) << " ms"
+		<< " (max: " << stats.dMaxLatency*t_real(1e3) << " ms).";
+
+	labelStats->setText(ostr.str().c_str());
+}
+
+
 void NetCacheDlg::UpdateAge(int iRow)
 {
 	tableCache->setSortingEnabled(0);
@@ -201,6 +217,7 @@ void NetCacheDlg::ClearAll()
 {
 	tableCache->clearContents();
 	tableCache->setRowCount(0);
+	labelStats->setText("");
 }
 
 
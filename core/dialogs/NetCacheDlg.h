@@ -61,6 +61,26 @@ struct CacheVal
 typedef std::map<std::string, CacheVal> t_mapCacheVal;
 
 
+/**
+ * counters of the update coalescer between the network cache and the views
+ */
+struct NetCacheStats
+{
+	// key updates received from the instrument
+	std::size_t iReceived = 0;
+
+	// updates superseded by newer values before they reached the views
+	std::size_t iDropped = 0;
+
+	// batches passed on to the views
+	std::size_t iBatches = 0;
+
+	// time between the reception of the oldest update in a batch and its delivery [s]
+	t_real_glob dLatency = t_real_glob(0);
+	t_real_glob dMaxLatency = t_real_glob(0);
+};
+
+
 class NetCacheDlg : public QDialog, Ui::NetCacheDlg
 { Q_OBJECT
 protected:
@@ -87,6 +107,7 @@ public slots:
 	void ClearAll();
 	void UpdateValue(const std::string& strKey, const CacheVal& val);
 	void UpdateAll(const t_mapCacheVal& map);
+	void UpdateStats(const NetCacheStats& stats);
 };
 
 #endif
@@ -146,6 +146,9 @@ PowderDlg::PowderDlg(QWidget* pParent, QSettings* pSett)
 	QObject::connect(btnSyncKi, &QToolButton::clicked, this, &PowderDlg::SetExtKi);
 	QObject::connect(btnSyncKf, &QToolButton::clicked, this, &PowderDlg::SetExtKf);
 
+	// results of the calculation thread
+	QObject::connect(this, &PowderDlg::peaksCalculated, this, &PowderDlg::ApplyPeaks, Qt::QueuedConnection);
+
 	m_bDontCalc = 0;
 	RepopulateSpaceGroups();
 	CalcPeaks();
@@ -159,6 +162,7 @@ PowderDlg::PowderDlg(QWidget* pParent, QSettings* pSett)
 
 PowderDlg::~PowderDlg()
 {
+	m_workerPeaks.Stop(true);
 	ClearPlots();
 	setAcceptDrops(0);
 	m_bDontCalc = 1;
@@ -208,34 +212,34 @@ void PowderDlg::PlotPowderLines(const std::vector<const PowderLine*>& vecLines)
 
 	m_vecTT.reserve(GFX_NUM_POINTS);
 	m_vecTTx.reserve(GFX_NUM_POINTS);
-	m_vecInt.reserve(GFX_NUM_POINTS);
-	m_vecIntx.reserve(GFX_NUM_POINTS);
 
 	// --------------------------------------------------------------------
 	// neutron and x-ray plots
-	for(std::size_t iPt=0; iPt<GFX_NUM_POINTS; ++iPt)
-	{
-		const t_real dTT = (dMinTT + (dMaxTT - dMinTT)/t_real(GFX_NUM_POINTS)*t_real(iPt));
+	std::vector<t_real> vecPeakX, vecPeakInt, vecPeakIntX;
+	vecPeakX.reserve(vecLines.size());
+	vecPeakInt.reserve(vecLines.size());
+	vecPeakIntX.reserve(vecLines.size());
 
-		t_real dInt = 0., dIntX = 0.;
-		for(const PowderLine *pLine : vecLines)
-		{
-			const t_real dPeakX = pLine->dAngle;
+	for(const PowderLine *pLine : vecLines)
+	{
+		vecPeakX.push_back(tl::r2d(pLine->dAngle));
+		vecPeakInt.push_back(pLine->dIn < 0. ? 1. : pLine->dIn);
+		vecPeakIntX.push_back(pLine->dIx < 0. ? 1. : pLine->dIx);
+	}
 
-			t_real dPeakInt = pLine->dIn;
-			t_real dPeakIntX = pLine->dIx;
-			if(dPeakInt < 0.) dPeakInt = 1.;
-			if(dPeakIntX < 0.) dPeakIntX = 1.;
+	// each line only contributes to the points near its centre
+	constexpr t_real dSig = 0.25;
+	tl::powder_profile<t_real>(vecPeakX, vecPeakInt, dSig,
+		tl::r2d(dMinTT), tl::r2d(dMaxTT), GFX_NUM_POINTS, m_vecInt);
+	tl::powder_profile<t_real>(vecPeakX, vecPeakIntX, dSig,
+		tl::r2d(dMinTT), tl::r2d(dMaxTT), GFX_NUM_POINTS, m_vecIntx);
 
-			constexpr t_real dSig = 0.25;
-			dInt += tl::gauss_model<t_real>(tl::r2d(dTT), tl::r2d(dPeakX), dSig, dPeakInt, 0.);
-			dIntX += tl::gauss_model<t_real>(tl::r2d(dTT), tl::r2d(dPeakX), dSig, dPeakIntX, 0.);
-		}
+	for(std::size_t iPt=0; iPt<GFX_NUM_POINTS; ++iPt)
+	{
+		const t_real dTT = (dMinTT + (dMaxTT - dMinTT)/t_real(GFX_NUM_POINTS)*t_real(iPt));
 
 		m_vecTT.push_back(tl::r2d(dTT));
 		m_vecTTx.push_back(tl::r2d(dTT));
-		m_vecInt.push_back(dInt);
-		m_vecIntx.push_back(dIntX);
 	}
 
 	if(m_plotwrapN)
@@ -340,277 +344,278 @@ void PowderDlg::ClearPlots()
 }
 
 
-void PowderDlg::CalcPeaks()
+/**
+ * calculates the powder lines, runs in a worker thread
+ */
+static std::shared_ptr<PowderLinesResult> calc_powder_lines(
+	const tl::Lattice<t_real>& lattice, const xtl::SpaceGroup<t_real>* pSpaceGroup,
+	const std::vector<xtl::AtomPos<t_real>>& vecAtomPos,
+	t_real dLam, int iOrder, bool bWantUniquePeaks,
+	const std::atomic<bool>& atStop)
 {
-	try
+	std::shared_ptr<PowderLinesResult> pResult = std::make_shared<PowderLinesResult>();
+
+	const tl::Lattice<t_real> recip = lattice.GetRecip();
+	const t_mat matA = lattice.GetBaseMatrixCov();
+
+
+	// ----------------------------------------------------------------------------
+	// structure factor stuff
+	std::shared_ptr<const xtl::ScatlenList<t_real>> lstsl = xtl::ScatlenList<t_real>::GetInstance();
+	std::shared_ptr<const xtl::FormfactList<t_real>> lstff = xtl::FormfactList<t_real>::GetInstance();
+
+	std::vector<std::string> vecElems;
+	std::vector<t_vec> vecAllAtoms, vecAllAtomsFrac;
+	std::vector<std::complex<t_real>> vecScatlens;
+	std::vector<std::size_t> vecAllAtomTypes;
+	std::vector<t_real> vecFormfacts;
+	std::vector<const xtl::FormfactList<t_real>::elem_type*> vecElemFormfacts;
+
+	const std::vector<t_mat>* pvecSymTrafos = nullptr;
+	if(pSpaceGroup)
+		pvecSymTrafos = &pSpaceGroup->GetTrafos();
+
+	if(pvecSymTrafos && pvecSymTrafos->size() && g_bHasFormfacts &&
+		g_bHasScatlens && vecAtomPos.size())
 	{
-		if(m_bDontCalc) return;
-		const bool bWantUniquePeaks = checkUniquePeaks->isChecked();
+		std::vector<t_vec> vecAtoms;
+		std::vector<std::string> vecNames;
+		for(std::size_t iAtom=0; iAtom<vecAtomPos.size(); ++iAtom)
+		{
+			vecAtoms.push_back(vecAtomPos[iAtom].vecPos);
+			vecNames.push_back(vecAtomPos[iAtom].strAtomName);
+		}
 
-		const t_real dA = editA->text().toDouble();
-		const t_real dB = editB->text().toDouble();
-		const t_real dC = editC->text().toDouble();
-		const t_real dAlpha = tl::d2r(editAlpha->text().toDouble());
-		const t_real dBeta = tl::d2r(editBeta->text().toDouble());
-		const t_real dGamma = tl::d2r(editGamma->text().toDouble());
+		std::tie(vecElems, vecAllAtoms, vecAllAtomsFrac, vecAllAtomTypes) =
+		tl::generate_all_atoms<t_mat, t_vec, std::vector>
+			(*pvecSymTrafos, vecAtoms, &vecNames, matA, g_dEps);
 
-		if(dA<=0. || dB<=0. || dC<=0. || dAlpha<=0. || dBeta<=0. || dGamma<=0.)
-			throw tl::Err("Invalid lattice definition.");
+		for(const std::string& strElem : vecElems)
+		{
+			const xtl::ScatlenList<t_real>::elem_type* pElem = lstsl->Find(strElem);
+			vecScatlens.push_back(pElem ? pElem->GetCoherent() : std::complex<t_real>(0.,0.));
+			if(!pElem)
+				tl::log_err("Element \"", strElem, "\" not found in scattering length table.",
+					" Using b=0.");
+
+			vecElemFormfacts.push_back(lstff->Find(strElem));
+			if(!*vecElemFormfacts.rbegin())
+				tl::log_err("Cannot get form factor for \"", strElem, "\".");
+		}
+	}
+	// ----------------------------------------------------------------------------
 
-		const t_real dLam = spinLam->value();
-		const int iOrder = spinOrder->value();
-		//tl::log_debug("Lambda = ", dLam, ", order = ", iOrder);
 
-		tl::Lattice<t_real> lattice(dA, dB, dC, dAlpha, dBeta, dGamma);
-		tl::Lattice<t_real> recip = lattice.GetRecip();
+	// symmetry-unique reflections and their multiplicities
+	tl::PowderPattern<t_real> powder;
+	powder.SetRecipLattice(recip);
+	powder.SetWavelength(dLam);
+	if(pvecSymTrafos)
+		powder.SetSymOps(*pvecSymTrafos, g_dEps);
+	if(pSpaceGroup)
+	{
+		powder.SetReflectionCondition([pSpaceGroup](int ih, int ik, int il) -> bool
+		{
+			return pSpaceGroup->HasReflection(ih, ik, il);
+		});
+	}
 
-		const t_mat matA = lattice.GetBaseMatrixCov();
-		//const t_mat matB = recip.GetBaseMatrixCov();
+	const std::vector<tl::PowderReflex<t_real>> vecReflexes = powder.CalcReflexes(iOrder);
+	if(atStop.load())
+		return nullptr;
 
-		const xtl::SpaceGroup<t_real>* pSpaceGroup = GetCurSpaceGroup();
+	// neutron structure factors of all unique reflections in one batch
+	std::vector<std::complex<t_real>> vecStructFacts;
+	if(vecScatlens.size())
+	{
+		std::vector<std::array<int, 3>> vecHKL;
+		vecHKL.reserve(vecReflexes.size());
+		for(const tl::PowderReflex<t_real>& refl : vecReflexes)
+			vecHKL.push_back({{ refl.h, refl.k, refl.l }});
+
+		tl::StructFactBatch<t_real> structfacts(vecAllAtomsFrac, vecScatlens);
+		structfacts.SetSymOps(*pvecSymTrafos, g_dEps);
+		structfacts.SetNumThreads(get_max_threads());
+		vecStructFacts = structfacts.Calc(vecHKL, &atStop);
+		if(atStop.load())
+			return nullptr;
+	}
+
+
+	// lines with the same angle and structure factor are merged
+	std::map<std::string, PowderLine> mapPeaks;
+
+	for(std::size_t iRefl=0; iRefl<vecReflexes.size(); ++iRefl)
+	{
+		if(atStop.load())
+			return nullptr;
+
+		const tl::PowderReflex<t_real>& refl = vecReflexes[iRefl];
+		const int ih = refl.h, ik = refl.k, il = refl.l;
+		const t_real dQ = refl.dG;
+		const t_real dAngle = refl.dTwoTheta;
 
+		t_real dF = -1., dI = -1.;
+		t_real dFx = -1., dIx = -1.;
 
 		// ----------------------------------------------------------------------------
 		// structure factor stuff
-		std::shared_ptr<const xtl::ScatlenList<t_real>> lstsl = xtl::ScatlenList<t_real>::GetInstance();
-		std::shared_ptr<const xtl::FormfactList<t_real>> lstff = xtl::FormfactList<t_real>::GetInstance();
+		if(vecScatlens.size())
+		{
+			const std::complex<t_real>& cF = vecStructFacts[iRefl];
+			t_real dFsq = (std::conj(cF)*cF).real();
+			dF = std::sqrt(dFsq);
+			tl::set_eps_0(dF, g_dEps);
 
-		std::vector<std::string> vecElems;
-		std::vector<t_vec> vecAllAtoms, vecAllAtomsFrac;
-		std::vector<std::complex<t_real>> vecScatlens;
-		std::vector<std::size_t> vecAllAtomTypes;
-		std::vector<t_real> vecFormfacts;
+			t_real dLor = tl::lorentz_factor(dAngle);
+			dI = dFsq*dLor;
+		}
 
-		const std::vector<t_mat>* pvecSymTrafos = nullptr;
-		if(pSpaceGroup)
-			pvecSymTrafos = &pSpaceGroup->GetTrafos();
 
-		if(pvecSymTrafos && pvecSymTrafos->size() && g_bHasFormfacts &&
-			g_bHasScatlens && m_vecAtoms.size())
+		vecFormfacts.clear();
+		if(g_bHasFormfacts)
 		{
-			std::vector<t_vec> vecAtoms;
-			std::vector<std::string> vecNames;
-			for(std::size_t iAtom=0; iAtom<m_vecAtoms.size(); ++iAtom)
+			for(std::size_t iAtom=0; iAtom<vecAllAtoms.size(); ++iAtom)
 			{
-				vecAtoms.push_back(m_vecAtoms[iAtom].vecPos);
-				vecNames.push_back(m_vecAtoms[iAtom].strAtomName);
-			}
+				const xtl::FormfactList<t_real>::elem_type* pElemff = vecElemFormfacts[iAtom];
 
-			std::tie(vecElems, vecAllAtoms, vecAllAtomsFrac, vecAllAtomTypes) =
-			tl::generate_all_atoms<t_mat, t_vec, std::vector>
-				(*pvecSymTrafos, vecAtoms, &vecNames, matA, g_dEps);
+				if(pElemff == nullptr)
+				{
+					vecFormfacts.clear();
+					break;
+				}
 
-			for(const std::string& strElem : vecElems)
-			{
-				const xtl::ScatlenList<t_real>::elem_type* pElem = lstsl->Find(strElem);
-				vecScatlens.push_back(pElem ? pElem->GetCoherent() : std::complex<t_real>(0.,0.));
-				if(!pElem)
-					tl::log_err("Element \"", strElem, "\" not found in scattering length table.",
-						" Using b=0.");
+				t_real dFF = pElemff->GetFormfactTab(dQ);
+				vecFormfacts.push_back(dFF);
 			}
 		}
-		// ----------------------------------------------------------------------------
-
-
-		std::map<std::string, PowderLine> mapPeaks;
-		tl::Powder<int, t_real> powder;
-		powder.SetRecipLattice(&recip);
 
-		for(int ih=iOrder; ih>=-iOrder; --ih)
-			for(int ik=iOrder; ik>=-iOrder; --ik)
-				for(int il=iOrder; il>=-iOrder; --il)
-				{
-					if(ih==0 && ik==0 && il==0) continue;
-					if(pSpaceGroup && !pSpaceGroup->HasReflection(ih, ik, il))
-						continue;
+		if(vecFormfacts.size())
+		{
+			const t_vec vecBragg = recip.GetPos(ih, ik, il);
+			std::complex<t_real> cFx =
+				tl::structfact<t_real, t_real, t_vec, std::vector>
+					(vecAllAtoms, vecBragg, vecFormfacts);
 
+			t_real dFxsq = (std::conj(cFx)*cFx).real();
+			dFx = std::sqrt(dFxsq);
+			tl::set_eps_0(dFx, g_dEps);
 
-					t_vec vecBragg = recip.GetPos(ih, ik, il);
-					t_real dQ = ublas::norm_2(vecBragg);
-					if(tl::is_nan_or_inf<t_real>(dQ)) continue;
+			t_real dLor = tl::lorentz_factor(dAngle)*tl::lorentz_pol_factor(dAngle);
+			dIx = dFxsq*dLor;
+		}
+		// ----------------------------------------------------------------------------
 
-					t_real dAngle = 0;
-					try
-					{
-						dAngle = tl::bragg_recip_twotheta(dQ/angs, dLam*angs, t_real(1.)) / tl::get_one_radian<t_real>();
-						if(tl::is_nan_or_inf<t_real>(dAngle)) continue;
-					}
-					catch(const std::exception&)
-					{
-						continue;
-					}
 
-					//std::cout << "Q = " << dQ << ", angle = " << (dAngle/M_PI*180.) << std::endl;
+		// using angle and F as hash for the map
+		std::ostringstream ostrAngle;
+		ostrAngle.precision(g_iPrec);
+		ostrAngle << tl::r2d(dAngle) << " " << dF;
+		const std::string strAngle = ostrAngle.str();
 
+		std::ostringstream ostrPeak;
+		for(const std::array<int, 3>& hkl : refl.vecEquiv)
+		{
+			if(ostrPeak.tellp() > 0)
+				ostrPeak << ", ";
+			ostrPeak << "(" << hkl[0] << hkl[1] << hkl[2] << ")";
 
-					t_vec vechkl = tl::make_vec({t_real(ih), t_real(ik), t_real(il)});
-					t_real dF = -1., dI = -1.;
-					t_real dFx = -1., dIx = -1.;
+			// only show the representative of the symmetry-equivalent reflections
+			if(bWantUniquePeaks)
+				break;
+		}
 
-					// ----------------------------------------------------------------------------
-					// structure factor stuff
-					if(vecScatlens.size())
-					{
-						std::complex<t_real> cF =
-							tl::structfact<t_real, std::complex<t_real>, t_vec, std::vector>
-								(vecAllAtoms, vecBragg, vecScatlens);
-						t_real dFsq = (std::conj(cF)*cF).real();
-						dF = std::sqrt(dFsq);
-						tl::set_eps_0(dF, g_dEps);
+		// accidentally coinciding lines are merged
+		PowderLine& line = mapPeaks[strAngle];
+		if(line.strPeaks.length() == 0)
+			line.strPeaks = ostrPeak.str();
+		else if(!bWantUniquePeaks)
+			line.strPeaks += ", " + ostrPeak.str();
+
+		line.dAngle = dAngle;
+		line.dQ = dQ;
+		line.iMult += refl.iMult;
+
+		line.h = ih;
+		line.k = ik;
+		line.l = il;
+
+		line.dFn = dF;
+		line.dIn = dI;
+		line.dFx = dFx;
+		line.dIx = dIx;
+	}
 
-						t_real dLor = tl::lorentz_factor(dAngle);
-						dI = dFsq*dLor;
-					}
 
+	std::vector<PowderLine>& vecPowderLines = pResult->vecLines;
+	vecPowderLines.reserve(mapPeaks.size());
 
+	for(auto& pair : mapPeaks)
+	{
+		PowderLine& line = pair.second;
+		line.strAngle = tl::var_to_str<t_real>(tl::r2d(line.dAngle), g_iPrec);
+		line.strQ = tl::var_to_str<t_real>(line.dQ, g_iPrec);
 
-					vecFormfacts.clear();
-					if(g_bHasFormfacts)
-					{
-						for(std::size_t iAtom=0; iAtom<vecAllAtoms.size(); ++iAtom)
-						{
-							//const t_vec& vecAtom = vecAllAtoms[iAtom];
-							const xtl::FormfactList<t_real>::elem_type* pElemff = lstff->Find(vecElems[iAtom]);
-
-							if(pElemff == nullptr)
-							{
-								tl::log_err("Cannot get form factor for \"", vecElems[iAtom], "\".");
-								vecFormfacts.clear();
-								break;
-							}
-
-							t_real dFF = pElemff->GetFormfact(dQ);
-							vecFormfacts.push_back(dFF);
-						}
-					}
-
-					if(vecFormfacts.size())
-					{
-						std::complex<t_real> cFx =
-							tl::structfact<t_real, t_real, t_vec, std::vector>
-								(vecAllAtoms, vecBragg, vecFormfacts);
-
-						t_real dFxsq = (std::conj(cFx)*cFx).real();
-						dFx = std::sqrt(dFxsq);
-						tl::set_eps_0(dFx, g_dEps);
-
-						t_real dLor = tl::lorentz_factor(dAngle)*tl::lorentz_pol_factor(dAngle);
-						dIx = dFxsq*dLor;
-					}
-					// ----------------------------------------------------------------------------
-
-
-					bool bHasPeak = 0;
-					if(bWantUniquePeaks)
-						bHasPeak = powder.HasUniquePeak(ih, ik, il, dF);
-					powder.AddPeak(ih, ik, il, dF);
-					if(bHasPeak)
-						continue;
-
-
-					// using angle and F as hash for the set
-					std::ostringstream ostrAngle;
-					ostrAngle.precision(g_iPrec);
-					ostrAngle << tl::r2d(dAngle) << " " << dF;
-					std::string strAngle = ostrAngle.str();
-					//std::cout << strAngle << std::endl;
-
-					std::ostringstream ostrPeak;
-					ostrPeak << "(" << /*std::abs*/(ih) << /*std::abs*/(ik) << /*std::abs*/(il) << ")";
-
-					if(mapPeaks[ostrAngle.str()].strPeaks.length()!=0)
-						mapPeaks[strAngle].strPeaks += ", ";
-
-					mapPeaks[strAngle].strPeaks += ostrPeak.str();
-					mapPeaks[strAngle].dAngle = dAngle;
-					mapPeaks[strAngle].dQ = dQ;
-
-					mapPeaks[strAngle].h = /*std::abs*/(ih);
-					mapPeaks[strAngle].k = /*std::abs*/(ik);
-					mapPeaks[strAngle].l = /*std::abs*/(il);
-
-					mapPeaks[strAngle].dFn = dF;
-					mapPeaks[strAngle].dIn = dI;
-					mapPeaks[strAngle].dFx = dFx;
-					mapPeaks[strAngle].dIx = dIx;
-				}
+		line.dIn *= t_real(line.iMult);
+		line.dIx *= t_real(line.iMult);
 
-		//std::cout << powder << std::endl;
-		std::vector<const PowderLine*> vecPowderLines;
-		//std::cout << "number of peaks: " << mapPeaks.size() << std::endl;
-		vecPowderLines.reserve(mapPeaks.size());
+		vecPowderLines.emplace_back(std::move(line));
+	}
 
+	std::sort(vecPowderLines.begin(), vecPowderLines.end(),
+		[](const PowderLine& line1, const PowderLine& line2) -> bool
+			{ return line1.dAngle < line2.dAngle; });
 
-		for(auto& pair : mapPeaks)
-		{
-			pair.second.strAngle = tl::var_to_str<t_real>(tl::r2d(pair.second.dAngle), g_iPrec);
-			pair.second.strQ = tl::var_to_str<t_real>(pair.second.dQ, g_iPrec);
-			pair.second.iMult = powder.GetMultiplicity(pair.second.h, pair.second.k, pair.second.l, pair.second.dFn);
+	return pResult;
+}
 
-			pair.second.dIn *= t_real(pair.second.iMult);
-			pair.second.dIx *= t_real(pair.second.iMult);
 
-			vecPowderLines.push_back(&pair.second);
-		}
+void PowderDlg::CalcPeaks()
+{
+	try
+	{
+		if(m_bDontCalc) return;
+		const bool bWantUniquePeaks = checkUniquePeaks->isChecked();
 
+		const t_real dA = editA->text().toDouble();
+		const t_real dB = editB->text().toDouble();
+		const t_real dC = editC->text().toDouble();
+		const t_real dAlpha = tl::d2r(editAlpha->text().toDouble());
+		const t_real dBeta = tl::d2r(editBeta->text().toDouble());
+		const t_real dGamma = tl::d2r(editGamma->text().toDouble());
 
-		std::sort(vecPowderLines.begin(), vecPowderLines.end(),
-			[](const PowderLine* pLine1, const PowderLine* pLine2) -> bool
-				{ return pLine1->dAngle < pLine2->dAngle; });
+		if(dA<=0. || dB<=0. || dC<=0. || dAlpha<=0. || dBeta<=0. || dGamma<=0.)
+			throw tl::Err("Invalid lattice definition.");
 
+		const t_real dLam = spinLam->value();
+		const int iOrder = spinOrder->value();
+		//tl::log_debug("Lambda = ", dLam, ", order = ", iOrder);
 
-		const bool bSortTable = tablePowderLines->isSortingEnabled();
-		tablePowderLines->setSortingEnabled(0);
+		const tl::Lattice<t_real> lattice(dA, dB, dC, dAlpha, dBeta, dGamma);
+		const xtl::SpaceGroup<t_real>* pSpaceGroup = GetCurSpaceGroup();
 
-		const int iNumRows = vecPowderLines.size();
-		tablePowderLines->setRowCount(iNumRows);
+		labelStatus->setText("Calculating...");
 
-		for(int iRow=0; iRow<iNumRows; ++iRow)
+		// cancels a running calculation and discards its results
+		m_workerPeaks.Start([lattice, pSpaceGroup, vecAtoms=m_vecAtoms,
+			dLam, iOrder, bWantUniquePeaks](const std::atomic<bool>& atStop)
+			-> std::shared_ptr<PowderLinesResult>
 		{
-			for(int iCol=0; iCol<8; ++iCol)
+			std::shared_ptr<PowderLinesResult> pResult;
+			try
 			{
-				if(!tablePowderLines->item(iRow, iCol))
-				{
-					if(iCol == TABLE_PEAK)
-						tablePowderLines->setItem(iRow, iCol, new QTableWidgetItem());
-					else if(iCol == TABLE_MULT)
-						tablePowderLines->setItem(iRow, iCol, new QTableWidgetItemWrapper<unsigned int>());
-					else
-						tablePowderLines->setItem(iRow, iCol, new QTableWidgetItemWrapper<t_real>());
-				}
+				pResult = calc_powder_lines(lattice, pSpaceGroup, vecAtoms,
+					dLam, iOrder, bWantUniquePeaks, atStop);
+			}
+			catch(const std::exception& ex)
+			{
+				pResult = std::make_shared<PowderLinesResult>();
+				pResult->strError = ex.what();
 			}
 
-			std::string strMult = tl::var_to_str(vecPowderLines[iRow]->iMult, g_iPrec);
-			std::string strFn, strIn, strFx, strIx;
-			if(vecPowderLines[iRow]->dFn >= 0.)
-				strFn = tl::var_to_str(vecPowderLines[iRow]->dFn, g_iPrec);
-			if(vecPowderLines[iRow]->dIn >= 0.)
-				strIn = tl::var_to_str(vecPowderLines[iRow]->dIn, g_iPrec);
-			if(vecPowderLines[iRow]->dFx >= 0.)
-				strFx = tl::var_to_str(vecPowderLines[iRow]->dFx, g_iPrec);
-			if(vecPowderLines[iRow]->dIx >= 0.)
-				strIx = tl::var_to_str(vecPowderLines[iRow]->dIx, g_iPrec);
-
-			tablePowderLines->item(iRow, TABLE_PEAK)->setText(vecPowderLines[iRow]->strPeaks.c_str());
-			dynamic_cast<QTableWidgetItemWrapper<t_real>*>(tablePowderLines->item(iRow, TABLE_ANGLE))->
-				SetValue(vecPowderLines[iRow]->dAngle, vecPowderLines[iRow]->strAngle);
-			dynamic_cast<QTableWidgetItemWrapper<t_real>*>(tablePowderLines->item(iRow, TABLE_Q))->
-				SetValue(vecPowderLines[iRow]->dQ, vecPowderLines[iRow]->strQ);
-			dynamic_cast<QTableWidgetItemWrapper<unsigned int>*>(tablePowderLines->item(iRow, TABLE_MULT))->
-				SetValue(vecPowderLines[iRow]->iMult, strMult);
-			dynamic_cast<QTableWidgetItemWrapper<t_real>*>(tablePowderLines->item(iRow, TABLE_FN))->
-				SetValue(vecPowderLines[iRow]->dFn, strFn);
-			dynamic_cast<QTableWidgetItemWrapper<t_real>*>(tablePowderLines->item(iRow, TABLE_IN))->
-				SetValue(vecPowderLines[iRow]->dIn, strIn);
-			dynamic_cast<QTableWidgetItemWrapper<t_real>*>(tablePowderLines->item(iRow, TABLE_FX))->
-				SetValue(vecPowderLines[iRow]->dFx, strFx);
-			dynamic_cast<QTableWidgetItemWrapper<t_real>*>(tablePowderLines->item(iRow, TABLE_IX))->
-				SetValue(vecPowderLines[iRow]->dIx, strIx);
-		}
-
-		tablePowderLines->setSortingEnabled(bSortTable);
-		PlotPowderLines(vecPowderLines);
-		labelStatus->setText("OK.");
+			return pResult;
+		},
+		[this]() { emit peaksCalculated(); });
 	}
 	catch(const std::exception& ex)
 	{
@@ -621,6 +626,85 @@ void PowderDlg::CalcPeaks()
 }
 
 
+/**
+ * shows the results of the worker thread
+ */
+void PowderDlg::ApplyPeaks()
+{
+	// no results or results of an outdated calculation?
+	std::shared_ptr<PowderLinesResult> pResult = m_workerPeaks.TakeResult();
+	if(!pResult)
+		return;
+
+	if(pResult->strError != "")
+	{
+		//labelStatus->setText(QString("Error: ") + pResult->strError.c_str());
+		labelStatus->setText("Error.");
+		tl::log_err("Cannot calculate powder peaks: ", pResult->strError);
+		return;
+	}
+
+	std::vector<const PowderLine*> vecPowderLines;
+	vecPowderLines.reserve(pResult->vecLines.size());
+	for(const PowderLine& line : pResult->vecLines)
+		vecPowderLines.push_back(&line);
+
+
+	const bool bSortTable = tablePowderLines->isSortingEnabled();
+	tablePowderLines->setSortingEnabled(0);
+
+	const int iNumRows = vecPowderLines.size();
+	tablePowderLines->setRowCount(iNumRows);
+
+	for(int iRow=0; iRow<iNumRows; ++iRow)
+	{
+		for(int iCol=0; iCol<8; ++iCol)
+		{
+			if(!tablePowderLines->item(iRow, iCol))
+			{
+				if(iCol == TABLE_PEAK)
+					tablePowderLines->setItem(iRow, iCol, new QTableWidgetItem());
+				else if(iCol == TABLE_MULT)
+					tablePowderLines->setItem(iRow, iCol, new QTableWidgetItemWrapper<unsigned int>());
+				else
+					tablePowderLines->setItem(iRow, iCol, new QTableWidgetItemWrapper<t_real>());
+			}
+		}
+
+		std::string strMult = tl::var_to_str(vecPowderLines[iRow]->iMult, g_iPrec);
+		std::string strFn, strIn, strFx, strIx;
+		if(vecPowderLines[iRow]->dFn >= 0.)
+			strFn = tl::var_to_str(vecPowderLines[iRow]->dFn, g_iPrec);
+		if(vecPowderLines[iRow]->dIn >= 0.)
+			strIn = tl::var_to_str(vecPowderLines[iRow]->dIn, g_iPrec);
+		if(vecPowderLines[iRow]->dFx >= 0.)
+			strFx = tl::var_to_str(vecPowderLines[iRow]->dFx, g_iPrec);
+		if(vecPowderLines[iRow]->dIx >= 0.)
+			strIx = tl::var_to_str(vecPowderLines[iRow]->dIx, g_iPrec);
+
+		tablePowderLines->item(iRow, TABLE_PEAK)->setText(vecPowderLines[iRow]->strPeaks.c_str());
+		dynamic_cast<QTableWidgetItemWrapper<t_real>*>(tablePowderLines->item(iRow, TABLE_ANGLE))->
+			SetValue(vecPowderLines[iRow]->dAngle, vecPowderLines[iRow]->strAngle);
+		dynamic_cast<QTableWidgetItemWrapper<t_real>*>(tablePowderLines->item(iRow, TABLE_Q))->
+			SetValue(vecPowderLines[iRow]->dQ, vecPowderLines[iRow]->strQ);
+		dynamic_cast<QTableWidgetItemWrapper<unsigned int>*>(tablePowderLines->item(iRow, TABLE_MULT))->
+			SetValue(vecPowderLines[iRow]->iMult, strMult);
+		dynamic_cast<QTableWidgetItemWrapper<t_real>*>(tablePowderLines->item(iRow, TABLE_FN))->
+			SetValue(vecPowderLines[iRow]->dFn, strFn);
+		dynamic_cast<QTableWidgetItemWrapper<t_real>*>(tablePowderLines->item(iRow, TABLE_IN))->
+			SetValue(vecPowderLines[iRow]->dIn, strIn);
+		dynamic_cast<QTableWidgetItemWrapper<t_real>*>(tablePowderLines->item(iRow, TABLE_FX))->
+			SetValue(vecPowderLines[iRow]->dFx, strFx);
+		dynamic_cast<QTableWidgetItemWrapper<t_real>*>(tablePowderLines->item(iRow, TABLE_IX))->
+			SetValue(vecPowderLines[iRow]->dIx, strIx);
+	}
+
+	tablePowderLines->setSortingEnabled(bSortTable);
+	PlotPowderLines(vecPowderLines);
+	labelStatus->setText("OK.");
+}
+
+
 const xtl::SpaceGroup<t_real>* PowderDlg::GetCurSpaceGroup() const
 {
 	xtl::SpaceGroup<t_real>* pSpaceGroup = nullptr;
@@ -45,6 +45,7 @@
 #include "libs/qt/qwthelper.h"
 #include "libs/globals.h"
 #include "libs/globals_qt.h"
+#include "libs/worker.h"
 #include "tlibs/file/prop.h"
 #include "AtomsDlg.h"
 #include "RecipParamDlg.h"
@@ -71,6 +72,16 @@ struct PowderLine
 };
 
 
+/**
+ * powder lines calculated by the worker thread
+ */
+struct PowderLinesResult
+{
+	std::vector<PowderLine> vecLines;
+	std::string strError;
+};
+
+
 class PowderDlg : public QDialog, Ui::PowderDlg
 { Q_OBJECT
 	protected:
@@ -100,6 +111,9 @@ class PowderDlg : public QDialog, Ui::PowderDlg
 		t_real_glob m_dExtKi = 0.;
 		t_real_glob m_dExtKf = 0.;
 
+		// calculation thread
+		CancellableWorker<PowderLinesResult> m_workerPeaks;
+
 	public:
 		PowderDlg(QWidget* pParent=0, QSettings* pSett=0);
 		virtual ~PowderDlg();
@@ -110,6 +124,7 @@ class PowderDlg : public QDialog, Ui::PowderDlg
 
 	protected slots:
 		void CalcPeaks();
+		void ApplyPeaks();
 
 		void CheckCrystalType();
 		void SpaceGroupChanged();
@@ -133,6 +148,9 @@ class PowderDlg : public QDialog, Ui::PowderDlg
 	public slots:
 		void paramsChanged(const RecipParams& parms);
 
+	signals:
+		void peaksCalculated();
+
 	protected:
 		virtual void showEvent(QShowEvent *pEvt) override;
 		virtual void accept() override;
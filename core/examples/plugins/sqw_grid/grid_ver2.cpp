@@ -101,6 +101,16 @@ SqwMod::~SqwMod()
 
 std::tuple<std::vector<t_real>, std::vector<t_real>>
 	SqwMod::disp(t_real dh, t_real dk, t_real dl) const
+{
+	return disp_vecs(dh, dk, dl);
+}
+
+
+/**
+ * dispersion branches with non-zero weight, writing into the given buffers
+ */
+std::size_t SqwMod::disp_into(t_real dh, t_real dk, t_real dl,
+	t_real *pE, t_real *pW, std::size_t iMaxBranches) const
 {
 	/**
 	 * calculate file index based on coordinates
@@ -134,13 +144,13 @@ std::tuple<std::vector<t_real>, std::vector<t_real>>
 	if(!fileDat.exists())
 	{
 		tl::log_err("Grid data file \"", m_strDataFile, "\" does not exist.");
-		return std::make_tuple(std::vector<t_real>(), std::vector<t_real>());
+		return 0;
 	}
 
 	if(!fileDat.open(QIODevice::ReadOnly))
 	{
 		tl::log_err("Data file \"", m_strDataFile, "\" cannot be opened.");
-		return std::make_tuple(std::vector<t_real>(), std::vector<t_real>());
+		return 0;
 	}
 
 
@@ -153,7 +163,7 @@ std::tuple<std::vector<t_real>, std::vector<t_real>>
 	if(!pMemIdx)
 	{
 		tl::log_err("Grid data file \"", m_strDataFile, "\" cannot be mapped.");
-		return std::make_tuple(std::vector<t_real>(), std::vector<t_real>());
+		return 0;
 	}
 
 	std::size_t dat_file_offs = *((std::size_t*)pMemIdx);
@@ -168,7 +178,7 @@ std::tuple<std::vector<t_real>, std::vector<t_real>>
 	if(!pMemDat)
 	{
 		tl::log_err("Grid data file \"", m_strDataFile, "\" cannot be mapped (1).");
-		return std::make_tuple(std::vector<t_real>(), std::vector<t_real>());
+		return 0;
 	}
 
 	// number of dispersion branches and weights
@@ -182,17 +192,21 @@ std::tuple<std::vector<t_real>, std::vector<t_real>>
 	if(!pMemDat)
 	{
 		tl::log_err("Grid data file \"", m_strDataFile, "\" cannot be mapped (2).");
-		return std::make_tuple(std::vector<t_real>(), std::vector<t_real>());
+		return 0;
 	}
 
 
-	std::vector<t_real> vecE, vecw;
+	std::size_t iNumNonZero = 0;
 	for(unsigned int iBranch=0; iBranch<iNumBranches; ++iBranch)
 	{
 		if(!tl::float_equal(pBranches[iBranch*2 + 1], t_real(0)))
 		{
-			vecE.push_back(pBranches[iBranch*2 + 0]);	// energy
-			vecw.push_back(pBranches[iBranch*2 + 1]);	// weight
+			if(iNumNonZero < iMaxBranches)
+			{
+				pE[iNumNonZero] = pBranches[iBranch*2 + 0];	// energy
+				pW[iNumNonZero] = pBranches[iBranch*2 + 1];	// weight
+			}
+			++iNumNonZero;
 		}
 	}
 
@@ -201,7 +215,7 @@ std::tuple<std::vector<t_real>, std::vector<t_real>>
 	// ------------------------------------------------------------------------
 
 
-	return std::make_tuple(vecE, vecw);
+	return iNumNonZero;
 }
 
 
@@ -210,16 +224,16 @@ std::tuple<std::vector<t_real>, std::vector<t_real>>
  */
 t_real SqwMod::operator()(t_real dh, t_real dk, t_real dl, t_real dE) const
 {
-	std::vector<t_real> vecE, vecW;
-	std::tie(vecE, vecW) = disp(dh, dk, dl);
+	SqwDispBuf buf;
+	const std::size_t iNumBranches = fill_disp(dh, dk, dl, buf);
 
 	t_real dInc=0, dS_p=0, dS_m=0;
 	if(!tl::float_equal(m_dIncAmp, t_real(0)))
 		dInc = tl::gauss_model(dE, t_real(0), m_dIncSigma, m_dIncAmp, t_real(0));
 
 	t_real dS = 0;
-	for(std::size_t iE=0; iE<vecE.size(); ++iE)
-		dS += tl::gauss_model(dE, vecE[iE], m_dSigma, vecW[iE], t_real(0));
+	for(std::size_t iE=0; iE<iNumBranches; ++iE)
+		dS += tl::gauss_model(dE, buf.E(iE), m_dSigma, buf.W(iE), t_real(0));
 
 	return m_dS0*dS * tl::bose_cutoff(dE, m_dT, m_dcut) + dInc;
 }
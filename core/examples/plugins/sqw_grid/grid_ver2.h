@@ -54,6 +54,8 @@ class SqwMod : public SqwBase
 
 		virtual std::tuple<std::vector<t_real>, std::vector<t_real>>
 			disp(t_real dh, t_real dk, t_real dl) const override;
+		virtual std::size_t disp_into(t_real dh, t_real dk, t_real dl,
+			t_real *pE, t_real *pW, std::size_t iMaxBranches) const override;
 		virtual t_real operator()(t_real dh, t_real dk, t_real dl, t_real dE) const override;
 
 		virtual std::vector<t_var> GetVars() const override;
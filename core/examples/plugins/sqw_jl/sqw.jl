@@ -134,6 +134,29 @@ function TakinSqw(h::Float64, k::Float64, l::Float64, E::Float64)::Float64
 end
 
 
+#
+# called for a batch of Monte-Carlo points instead of TakinSqw (optional),
+# the arrays share Takin's buffers: S has to be filled in place, h, k, l and E must not be modified.
+# the loop can use Julia's threads, e.g. by starting Takin with JULIA_NUM_THREADS=4
+#
+function TakinSqw_batch!(S::Vector{Float64}, h::Vector{Float64}, k::Vector{Float64},
+	l::Vector{Float64}, E::Vector{Float64})
+	Threads.@threads for i in eachindex(S)
+		q = sqrt((h[i] - g_G[1])^2 + (k[i] - g_G[2])^2 + (l[i] - g_G[3])^2)
+		E_peak = disp_ferro(q, g_D, g_offs)
+
+		S_p = gauss(E[i], E_peak, g_sig, g_S0)
+		S_m = gauss(E[i], -E_peak, g_sig, g_S0)
+		incoh = gauss(E[i], 0.0, g_inc_sig, g_inc_amp)
+
+		b = 1.0
+		#b = bose_cutoff(E[i], g_T, g_bose_cut)
+		S[i] = (S_p + S_m)*b + incoh
+	end
+	return nothing
+end
+
+
 #
 # background function, called for every nominal (Q, E) point (optional)
 #
@@ -47,6 +47,20 @@ SqwMod::~SqwMod()
 std::tuple<std::vector<t_real>, std::vector<t_real>>
 	SqwMod::disp(t_real dh, t_real dk, t_real dl) const
 {
+	return disp_vecs(dh, dk, dl);
+}
+
+
+/**
+ * dispersion relation, writing at most iMaxBranches branches into pE and pW,
+ * returns the total number of branches
+ */
+std::size_t SqwMod::disp_into(t_real dh, t_real dk, t_real dl,
+	t_real *pE, t_real *pW, std::size_t iMaxBranches) const
+{
+	if(iMaxBranches < 2)
+		return 2;
+
 	t_real dEp = 0;		// energy (boson creation)
 	t_real dwp = 1;		// spectral weight (boson creation)
 	t_real dEm = -dEp;	// energy (boson annihilation)
@@ -54,8 +68,9 @@ std::tuple<std::vector<t_real>, std::vector<t_real>>
 
 	// TODO: calculate dispersion relation
 
-	return std::make_tuple(std::vector<t_real>({dEp, dEm}),
-		std::vector<t_real>({dwp, dwm}));
+	pE[0] = dEp; pW[0] = dwp;
+	pE[1] = dEm; pW[1] = dwm;
+	return 2;
 }
 
 
@@ -63,18 +78,18 @@ t_real SqwMod::operator()(t_real dh, t_real dk, t_real dl, t_real dE) const
 {
 	t_real dcut = t_real(0.02);
 
-	std::vector<t_real> vecE, vecW;
-	std::tie(vecE, vecW) = disp(dh, dk, dl);
+	SqwDispBuf buf;
+	const std::size_t iNumBranches = fill_disp(dh, dk, dl, buf);
 
 	t_real dInc=0, dS_p=0, dS_m=0;
 	if(!tl::float_equal(m_dIncAmp, t_real(0)))
 		dInc = tl::gauss_model(dE, t_real(0), m_dIncSigma, m_dIncAmp, t_real(0));
 
 	t_real dS = 0;
-	for(std::size_t iE=0; iE<vecE.size(); ++iE)
+	for(std::size_t iE=0; iE<iNumBranches; ++iE)
 	{
-		if(!tl::float_equal(vecW[iE], t_real(0)))
-			dS += tl::gauss_model(dE, vecE[iE], m_dSigma[0], vecW[iE], t_real(0));
+		if(!tl::float_equal(buf.W(iE), t_real(0)))
+			dS += tl::gauss_model(dE, buf.E(iE), m_dSigma[0], buf.W(iE), t_real(0));
 	}
 
 	return m_dS0*dS * tl::bose_cutoff(dE, m_dT, dcut) + dInc;
@@ -188,3 +203,20 @@ std::shared_ptr<SqwBase> sqw_construct(const std::string& strCfgFile)
 // exports from so file
 BOOST_DLL_ALIAS(sqw_info, takin_sqw_info);
 BOOST_DLL_ALIAS(sqw_construct, takin_sqw);
+
+
+// ----------------------------------------------------------------------------
+// versioned C interface, which is preferred by newer Takin versions
+// and does not need to be recompiled for each Takin version
+
+#include "tools/monteconvo/sqw_plugin_adapter.h"
+
+extern "C" BOOST_SYMBOL_EXPORT const takin_sqw_interface* takin_sqw_plugin()
+{
+	// SqwMod has no mutable state, so its instances can be shared between threads
+	static const takin_sqw_interface plugin = SqwPluginAdapter<SqwMod>::make_plugin(
+		pcModIdent, pcModName, pcModHelp,
+		TAKIN_SQW_CAP_THREADSAFE | TAKIN_SQW_CAP_BACKGROUND);
+
+	return &plugin;
+}
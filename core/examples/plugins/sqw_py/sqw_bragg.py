@@ -109,6 +109,21 @@ def TakinSqw(h, k, l, E):
 	except ZeroDivisionError:
 		return 0.
 
+
+#
+# vectorised S(Q,E) function, called with numpy arrays for a batch of Monte-Carlo points (optional)
+# if it is defined, it is used instead of TakinSqw, the arrays must not be modified
+#
+def TakinSqwBatch(h, k, l, E):
+	S_E = gauss(E, 0, g_sig_E, g_amp)
+	S_q = np.zeros(len(E))
+
+	for G in g_Gs:
+		q_len = np.sqrt((h - G[0])**2. + (k - G[1])**2. + (l - G[2])**2.)
+		S_q += gauss(q_len, 0, g_sig_q, g_amp)
+
+	return S_q * S_E
+
 # -----------------------------------------------------------------------------
 
 
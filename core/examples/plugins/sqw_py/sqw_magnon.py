@@ -77,6 +77,15 @@ def bose_cutoff(E, T, Ecut=0.02):
 
 	return b
 
+# vectorised Bose factor with cutoff for numpy arrays of energies
+def bose_cutoff_vec(E, T, Ecut=0.02):
+	Ecut = abs(Ecut)
+	sign = np.where(E >= 0., 1., -1.)
+	E_cut = np.where(np.abs(E) < Ecut, sign*Ecut, E)
+
+	n = 1./(np.exp(np.abs(E_cut)/(kB*T)) - 1.)
+	return n + (E_cut >= 0.)
+
 # -----------------------------------------------------------------------------
 
 
@@ -153,6 +162,27 @@ def TakinSqw(h, k, l, E):
 		return 0.
 
 
+#
+# vectorised S(Q,E) function, called with numpy arrays for a batch of Monte-Carlo points (optional)
+# if it is defined, it is used instead of TakinSqw, the arrays must not be modified
+#
+def TakinSqwBatch(h, k, l, E):
+	q = np.sqrt((h - g_G[0])**2. + (k - g_G[1])**2. + (l - g_G[2])**2.)
+
+	if g_disp == 0:
+		E_peak = disp_ferro(q, g_D, g_offs)
+	elif g_disp == 1:
+		E_peak = disp_antiferro(q, g_D, g_offs)
+	else:
+		return np.zeros(len(E))
+
+	S_p = gauss(E, E_peak, g_sig, g_S0)
+	S_m = gauss(E, -E_peak, g_sig, g_S0)
+	incoh = gauss(E, 0., g_inc_sig, g_inc_amp)
+
+	return (S_p + S_m)*bose_cutoff_vec(E, g_T, g_bose_cut) + incoh
+
+
 #
 # background function, called for every nominal (Q, E), not convoluted (optional)
 #
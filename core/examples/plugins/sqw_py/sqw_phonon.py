@@ -78,6 +78,12 @@ def gauss(x, x0, sig, amp):
 	return amp * np.exp(-0.5*((x-x0)/sig)**2.) / norm
 
 
+# vectorised Bose factor for numpy arrays of energies
+def bose_vec(E, T):
+	n = 1./(np.exp(np.abs(E)/(kB*T)) - 1.)
+	return n + (E >= 0.)
+
+
 #
 # peak shape of a damped harmonic oscillator
 # see: B. Fak, B. Dorner, Physica B 234-236 (1997) pp. 1107-1108
@@ -159,6 +165,21 @@ def TakinSqw(h, k, l, E):
 		return 0.
 
 
+#
+# vectorised S(Q,E) function, called with numpy arrays for a batch of Monte-Carlo points (optional)
+# if it is defined, it is used instead of TakinSqw, the arrays must not be modified
+#
+def TakinSqwBatch(h, k, l, E):
+	q = np.sqrt((h - g_G[0])**2. + (k - g_G[1])**2. + (l - g_G[2])**2.)
+	E_peak = disp_phonon(q, g_amp, g_freq, g_offs)
+
+	S = np.abs(bose_vec(E, g_T)*g_S0/(E_peak*np.pi) *
+		(g_HWHM/((E-E_peak)**2. + g_HWHM**2.) - g_HWHM/((E+E_peak)**2. + g_HWHM**2.)))
+	incoh = gauss(E, 0., g_inc_sig, g_inc_amp)
+
+	return S + incoh
+
+
 #
 # background function, called for every nominal (Q, E), not convoluted (optional)
 #
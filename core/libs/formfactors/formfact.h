@@ -33,16 +33,62 @@
 #include <vector>
 #include <complex>
 #include <mutex>
+#include <algorithm>
+#include <functional>
+#include <memory>
 #include <boost/optional.hpp>
 
 #include "tlibs/helper/array.h"
 #include "tlibs/phys/atoms.h"
 #include "tlibs/phys/mag.h"
+#include "tlibs/log/log.h"
 
 
 namespace xtl {
 
 
+/**
+ * sorted name index for the element look-ups in the tables
+ */
+template<class t_elem>
+class ElemIndex
+{
+	protected:
+		std::vector<std::pair<std::string, const t_elem*>> m_vecIdx;
+
+	public:
+		/**
+		 * add elements, the elements must not be moved afterwards;
+		 * for equal names, the element added first is found
+		 */
+		void Add(const std::vector<t_elem>& vecElems)
+		{
+			for(const t_elem& elem : vecElems)
+			{
+				const std::string& strName = elem.GetAtomIdent();
+				auto iter = std::lower_bound(m_vecIdx.begin(), m_vecIdx.end(), strName,
+					[](const std::pair<std::string, const t_elem*>& pair, const std::string& str) -> bool
+					{ return pair.first < str; });
+
+				if(iter == m_vecIdx.end() || iter->first != strName)
+					m_vecIdx.insert(iter, std::make_pair(strName, &elem));
+			}
+		}
+
+		const t_elem* Find(const std::string& strName) const
+		{
+			auto iter = std::lower_bound(m_vecIdx.begin(), m_vecIdx.end(), strName,
+				[](const std::pair<std::string, const t_elem*>& pair, const std::string& str) -> bool
+				{ return pair.first < str; });
+
+			if(iter == m_vecIdx.end() || iter->first != strName)
+				return nullptr;
+			return iter->second;
+		}
+};
+
+
+
 template<typename T=double>
 class PeriodicElement
 {
@@ -97,7 +143,10 @@ class PeriodicSystem
 		PeriodicSystem(const std::string& strFile, const std::string& strXmlRoot="");
 
 	protected:
+		template<class t_prop> void Load(const t_prop& xml, const std::string& strXmlRoot);
+
 		std::vector<elem_type> s_vecAtoms;
+		ElemIndex<elem_type> m_index;
 		std::string s_strSrc, s_strSrcUrl;
 
 	public:
@@ -118,6 +167,126 @@ class PeriodicSystem
 // ----------------------------------------------------------------------------
 
 
+/**
+ * tabulated form factor on a uniform |Q| grid with cubic Hermite interpolation
+ *
+ * The form factors are even functions of Q, so the derivatives at the nodes
+ * are given by fourth-order central differences also at Q = 0.
+ * The grid is refined until the interpolation error, checked against the
+ * exact function at the centres and quarter points of all intervals,
+ * is below the requested tolerance. Beyond the table, the exact function is used.
+ */
+template<typename T=double>
+class FormfactTable
+{
+	public:
+		using t_func = std::function<T(T)>;
+
+	protected:
+		t_func m_func;
+		T m_dQMax = 0, m_dStep = 1, m_dStepInv = 1;
+		std::vector<T> m_vecF, m_vecD;		// values and derivatives (times step) at the nodes
+		T m_dMaxErr = 0;
+
+	protected:
+		void Tabulate(std::size_t iNumIntervals)
+		{
+			m_dStep = m_dQMax / T(iNumIntervals);
+			m_dStepInv = T(1) / m_dStep;
+
+			// two additional nodes on each side for the derivatives
+			std::vector<T> vecF(iNumIntervals + 5);
+			for(std::size_t i=0; i<vecF.size(); ++i)
+				vecF[i] = m_func(std::abs((T(i)-T(2)) * m_dStep));
+
+			m_vecF.resize(iNumIntervals + 1);
+			m_vecD.resize(iNumIntervals + 1);
+			for(std::size_t i=0; i<=iNumIntervals; ++i)
+			{
+				m_vecF[i] = vecF[i+2];
+				m_vecD[i] = (vecF[i] - T(8)*vecF[i+1] + T(8)*vecF[i+3] - vecF[i+4]) / T(12);
+			}
+		}
+
+		T Interp(std::size_t i, T t) const
+		{
+			const T t2 = t*t, t3 = t2*t;
+			const T h00 = T(2)*t3 - T(3)*t2 + T(1);
+			const T h10 = t3 - T(2)*t2 + t;
+			const T h01 = -T(2)*t3 + T(3)*t2;
+			const T h11 = t3 - t2;
+
+			return h00*m_vecF[i] + h10*m_vecD[i] + h01*m_vecF[i+1] + h11*m_vecD[i+1];
+		}
+
+		T CheckError() const
+		{
+			T dMaxErr = 0;
+			for(std::size_t i=0; i+1<m_vecF.size(); ++i)
+			{
+				for(T t : { T(0.25), T(0.5), T(0.75) })
+				{
+					const T dQ = (T(i) + t) * m_dStep;
+					dMaxErr = std::max(dMaxErr, std::abs(Interp(i, t) - m_func(dQ)));
+				}
+			}
+			return dMaxErr;
+		}
+
+	public:
+		/**
+		 * @param func exact form factor as a function of |Q|
+		 * @param dQMax table range in 1/A
+		 * @param dTol absolute tolerance, relative to max(1, |f(0)|)
+		 */
+		FormfactTable(const t_func& func, T dQMax = T(25), T dTol = T(1e-6),
+			std::size_t iMaxIntervals = 1<<16)
+			: m_func(func), m_dQMax(dQMax)
+		{
+			const T dTolAbs = dTol * std::max(T(1), std::abs(m_func(T(0))));
+
+			for(std::size_t iNumIntervals = 256; ; iNumIntervals *= 2)
+			{
+				Tabulate(iNumIntervals);
+				m_dMaxErr = CheckError();
+
+				if(m_dMaxErr <= dTolAbs)
+					break;
+				if(iNumIntervals*2 > iMaxIntervals)
+				{
+					tl::log_warn("Form factor table does not reach the requested tolerance, ",
+						"max. error: ", m_dMaxErr, ".");
+					break;
+				}
+			}
+		}
+
+		T operator()(T dQ) const
+		{
+			dQ = std::abs(dQ);
+			if(dQ >= m_dQMax)
+				return m_func(dQ);
+
+			const T dIdx = dQ * m_dStepInv;
+			const std::size_t i = std::size_t(dIdx);
+			return Interp(i, dIdx - T(i));
+		}
+
+		/**
+		 * form factors for many |Q| values
+		 */
+		void operator()(const T* pQ, T* pF, std::size_t iNum) const
+		{
+			for(std::size_t i=0; i<iNum; ++i)
+				pF[i] = (*this)(pQ[i]);
+		}
+
+		T GetMaxError() const { return m_dMaxErr; }
+		T GetQMax() const { return m_dQMax; }
+		std::size_t GetNumNodes() const { return m_vecF.size(); }
+};
+
+
 
 template<typename T=double>
 class Formfact
@@ -134,6 +303,9 @@ class Formfact
 		std::vector<T> b;
 		T c;
 
+		// tabulation, created on first use
+		mutable std::shared_ptr<const FormfactTable<T>> m_pTab;
+
 	public:
 		const std::string& GetAtomIdent() const { return strAtom; }
 
@@ -141,6 +313,30 @@ class Formfact
 		{
 			return tl::formfact<T, std::vector>(G, a, b, c);
 		}
+
+		/**
+		 * tabulated form factor, see FormfactTable
+		 */
+		const FormfactTable<T>& GetTable() const
+		{
+			std::shared_ptr<const FormfactTable<T>> pTab = std::atomic_load(&m_pTab);
+			if(!pTab)
+			{
+				// concurrent first calls may both tabulate, the results are equal
+				pTab = std::make_shared<FormfactTable<T>>(
+					[a=a, b=b, c=c](T G) -> T { return tl::formfact<T, std::vector>(G, a, b, c); });
+				std::atomic_store(&m_pTab, pTab);
+			}
+			return *pTab;
+		}
+
+		T GetFormfactTab(T G) const { return GetTable()(G); }
+
+		void GetFormfactsTab(const std::vector<T>& vecG, std::vector<T>& vecF) const
+		{
+			vecF.resize(vecG.size());
+			GetTable()(vecG.data(), vecF.data(), vecG.size());
+		}
 };
 
 template<typename T/*=double*/>
@@ -160,7 +356,10 @@ class FormfactList
 		FormfactList(const std::string& strFile, const std::string& strXmlRoot="");
 
 	protected:
+		template<class t_prop> void Load(const t_prop& xml, const std::string& strXmlRoot);
+
 		std::vector<elem_type> s_vecAtoms, s_vecIons;
+		ElemIndex<elem_type> m_index;
 		std::string s_strSrc, s_strSrcUrl;
 
 	public:
@@ -199,9 +398,59 @@ class MagFormfact
 		std::vector<T> A2, a2;
 		std::vector<T> A4, a4;
 
+		// tabulations of <j0> and <j2>, created on first use
+		mutable std::shared_ptr<const FormfactTable<T>> m_pTabJ0, m_pTabJ2;
+
+		const FormfactTable<T>& GetTable(std::shared_ptr<const FormfactTable<T>>& pTabCache,
+			const std::vector<T>& A, const std::vector<T>& a, bool bJ2) const
+		{
+			std::shared_ptr<const FormfactTable<T>> pTab = std::atomic_load(&pTabCache);
+			if(!pTab)
+			{
+				pTab = std::make_shared<FormfactTable<T>>([A, a, bJ2](T Q) -> T
+				{
+					return bJ2 ? tl::j2_avg<T, std::vector>(Q, A, a) : tl::j0_avg<T, std::vector>(Q, A, a);
+				});
+				std::atomic_store(&pTabCache, pTab);
+			}
+			return *pTab;
+		}
+
 	public:
 		const std::string& GetAtomIdent() const { return strAtom; }
 
+		const FormfactTable<T>& GetTableJ0() const { return GetTable(m_pTabJ0, A0, a0, false); }
+		const FormfactTable<T>& GetTableJ2() const { return GetTable(m_pTabJ2, A2, a2, true); }
+
+		/**
+		 * tabulated form factors, the same combinations of <j0> and <j2>
+		 * as in tl::mag_formfact_d and tl::mag_formfact_f
+		 */
+		T GetFormfactTab(T Q, T g=2) const
+		{
+			return GetTableJ0()(Q) + (T(1)-T(2)/g)*GetTableJ2()(Q);
+		}
+
+		T GetFormfactTab(T Q, T L, T S, T J) const
+		{
+			T gL = T(0.5) + (L*(L+T(1)) - S*(S+T(1))) / (T(2)*J*(J+T(1)));
+			T gS = T(1) + (S*(S+T(1)) - L*(L+T(1))) / (J * (J+T(1)));
+
+			T j0 = GetTableJ0()(Q), j2 = GetTableJ2()(Q);
+			return (gS*j0 + gL*(j0+j2)) / (gL + gS);
+		}
+
+		void GetFormfactsTab(const std::vector<T>& vecQ, std::vector<T>& vecF, T g=2) const
+		{
+			const FormfactTable<T>& tabJ0 = GetTableJ0();
+			const FormfactTable<T>& tabJ2 = GetTableJ2();
+			const T dJ2Fact = T(1) - T(2)/g;
+
+			vecF.resize(vecQ.size());
+			for(std::size_t i=0; i<vecQ.size(); ++i)
+				vecF[i] = tabJ0(vecQ[i]) + dJ2Fact*tabJ2(vecQ[i]);
+		}
+
 		T GetFormfact(T Q, T g=2) const
 		{
 			T F;
@@ -239,7 +488,10 @@ class MagFormfactList
 		MagFormfactList(const std::string& strFile, const std::string& strXmlRoot="");
 
 	protected:
+		template<class t_prop> void Load(const t_prop& xml, const std::string& strXmlRoot);
+
 		std::vector<elem_type> s_vecAtoms;
+		ElemIndex<elem_type> m_index;
 		std::string s_strSrc, s_strSrcUrl;
 
 	public:
@@ -319,7 +571,10 @@ class ScatlenList
 		ScatlenList(const std::string& strFile, const std::string& strXmlRoot="");
 
 	protected:
+		template<class t_prop> void Load(const t_prop& xml, const std::string& strXmlRoot);
+
 		std::vector<elem_type> s_vecElems, s_vecIsotopes;
+		ElemIndex<elem_type> m_index;
 		std::string s_strSrc, s_strSrcUrl;
 
 	public:
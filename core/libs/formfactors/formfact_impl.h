@@ -36,6 +36,7 @@
 #include "tlibs/file/prop.h"
 #include "tlibs/string/string.h"
 #include "libs/globals.h"
+#include "libs/tabimage.h"
 
 
 namespace xtl {
@@ -46,14 +47,18 @@ template<typename T> std::mutex PeriodicSystem<T>::s_mutex;
 template<typename T>
 PeriodicSystem<T>::PeriodicSystem(const std::string& strFile, const std::string& strXmlRoot)
 {
-	std::string strTabFile = find_resource(strFile);
-	tl::log_debug("Loading periodic table from file \"", strTabFile, "\".");
+	load_table(strFile, "periodic table",
+		[this, &strXmlRoot](const auto& xml) { this->Load(xml, strXmlRoot); });
+
+	m_index.Add(s_vecAtoms);
+}
 
-	tl::Prop<std::string> xml;
-	if(!xml.Load(strTabFile.c_str(), tl::PropType::XML))
-		return;
 
-	const std::size_t iNumDat = xml.Query<std::size_t>(strXmlRoot + "/pte/num_elems", 0);
+template<typename T>
+template<class t_prop>
+void PeriodicSystem<T>::Load(const t_prop& xml, const std::string& strXmlRoot)
+{
+	const std::size_t iNumDat = xml.template Query<std::size_t>(strXmlRoot + "/pte/num_elems", 0);
 	if(!iNumDat)
 	{
 		tl::log_err("No data in periodic table of elements.");
@@ -65,33 +70,33 @@ PeriodicSystem<T>::PeriodicSystem(const std::string& strFile, const std::string&
 		elem_type elem;
 		std::string strAtom = "pte/elem_" + tl::var_to_str(iElem);
 
-		elem.strAtom = xml.Query<std::string>(strXmlRoot + "/" + strAtom + "/name", "");
+		elem.strAtom = xml.template Query<std::string>(strXmlRoot + "/" + strAtom + "/name", "");
 		if(elem.strAtom == "")
 			continue;
 
-		elem.iNr = xml.Query<int>(strXmlRoot + "/" + strAtom + "/num", -1.);
-		elem.iPeriod = xml.Query<int>(strXmlRoot + "/" + strAtom + "/period", -1.);
-		elem.iGroup = xml.Query<int>(strXmlRoot + "/" + strAtom + "/group", -1.);
+		elem.iNr = xml.template Query<int>(strXmlRoot + "/" + strAtom + "/num", -1.);
+		elem.iPeriod = xml.template Query<int>(strXmlRoot + "/" + strAtom + "/period", -1.);
+		elem.iGroup = xml.template Query<int>(strXmlRoot + "/" + strAtom + "/group", -1.);
 
-		elem.strOrbitals = xml.Query<std::string>(strXmlRoot + "/" + strAtom + "/orbitals", "");
-		elem.strBlock = xml.Query<std::string>(strXmlRoot + "/" + strAtom + "/block", "");
+		elem.strOrbitals = xml.template Query<std::string>(strXmlRoot + "/" + strAtom + "/orbitals", "");
+		elem.strBlock = xml.template Query<std::string>(strXmlRoot + "/" + strAtom + "/block", "");
 
-		elem.dMass = xml.Query<value_type>(strXmlRoot + "/" + strAtom + "/m", -1.);
+		elem.dMass = xml.template Query<value_type>(strXmlRoot + "/" + strAtom + "/m", -1.);
 
-		elem.dRadCov = xml.Query<value_type>(strXmlRoot + "/" + strAtom + "/r_cov", -1.);
-		elem.dRadVdW = xml.Query<value_type>(strXmlRoot + "/" + strAtom + "/r_vdW", -1.);
+		elem.dRadCov = xml.template Query<value_type>(strXmlRoot + "/" + strAtom + "/r_cov", -1.);
+		elem.dRadVdW = xml.template Query<value_type>(strXmlRoot + "/" + strAtom + "/r_vdW", -1.);
 
-		elem.dEIon = xml.Query<value_type>(strXmlRoot + "/" + strAtom + "/E_ion", -1.);
-		elem.dEAffin = xml.Query<value_type>(strXmlRoot + "/" + strAtom + "/E_affin", -1.);
+		elem.dEIon = xml.template Query<value_type>(strXmlRoot + "/" + strAtom + "/E_ion", -1.);
+		elem.dEAffin = xml.template Query<value_type>(strXmlRoot + "/" + strAtom + "/E_affin", -1.);
 
-		elem.dTMelt = xml.Query<value_type>(strXmlRoot + "/" + strAtom + "/T_melt", -1.);
-		elem.dTBoil = xml.Query<value_type>(strXmlRoot + "/" + strAtom + "/T_boil", -1.);
+		elem.dTMelt = xml.template Query<value_type>(strXmlRoot + "/" + strAtom + "/T_melt", -1.);
+		elem.dTBoil = xml.template Query<value_type>(strXmlRoot + "/" + strAtom + "/T_boil", -1.);
 
 		s_vecAtoms.push_back(std::move(elem));
 	}
 
-	s_strSrc = xml.Query<std::string>(strXmlRoot + "/pte/source", "");
-	s_strSrcUrl = xml.Query<std::string>(strXmlRoot + "/pte/source_url", "");
+	s_strSrc = xml.template Query<std::string>(strXmlRoot + "/pte/source", "");
+	s_strSrcUrl = xml.template Query<std::string>(strXmlRoot + "/pte/source_url", "");
 }
 
 template<typename T> PeriodicSystem<T>::~PeriodicSystem() {}
@@ -114,19 +119,7 @@ std::shared_ptr<const PeriodicSystem<T>> PeriodicSystem<T>::GetInstance(const ch
 template<typename T>
 const typename PeriodicSystem<T>::elem_type* PeriodicSystem<T>::Find(const std::string& strElem) const
 {
-	typedef typename decltype(s_vecAtoms)::const_iterator t_iter;
-
-	// elements
-	t_iter iter = std::find_if(s_vecAtoms.begin(), s_vecAtoms.end(),
-		[&strElem](const elem_type& elem)->bool
-		{
-			//std::cout << elem.GetAtomIdent() << std::endl;
-			return elem.GetAtomIdent() == strElem;
-		});
-	if(iter != s_vecAtoms.end())
-		return &*iter;
-
-	return nullptr;
+	return m_index.Find(strElem);
 }
 
 
@@ -145,14 +138,19 @@ std::mutex FormfactList<T>::s_mutex;
 template<typename T>
 FormfactList<T>::FormfactList(const std::string& strFile, const std::string& strXmlRoot)
 {
-	std::string strTabFile = find_resource(strFile);
-	tl::log_debug("Loading atomic form factors from file \"", strTabFile, "\".");
+	load_table(strFile, "atomic form factors",
+		[this, &strXmlRoot](const auto& xml) { this->Load(xml, strXmlRoot); });
+
+	m_index.Add(s_vecAtoms);
+	m_index.Add(s_vecIons);
+}
 
-	tl::Prop<std::string> xml;
-	if(!xml.Load(strTabFile.c_str(), tl::PropType::XML))
-		return;
 
-	const std::size_t iNumDat = xml.Query<std::size_t>(strXmlRoot + "/ffacts/num_atoms", 0);
+template<typename T>
+template<class t_prop>
+void FormfactList<T>::Load(const t_prop& xml, const std::string& strXmlRoot)
+{
+	const std::size_t iNumDat = xml.template Query<std::size_t>(strXmlRoot + "/ffacts/num_atoms", 0);
 	if(!iNumDat)
 	{
 		tl::log_err("No data in atomic form factor list.");
@@ -165,12 +163,12 @@ FormfactList<T>::FormfactList(const std::string& strFile, const std::string& str
 		elem_type ffact;
 		std::string strAtom = "ffacts/atom_" + tl::var_to_str(iSf);
 
-		ffact.strAtom = xml.Query<std::string>(strXmlRoot + "/" +strAtom + "/name", "");
+		ffact.strAtom = xml.template Query<std::string>(strXmlRoot + "/" +strAtom + "/name", "");
 		tl::get_tokens<value_type, std::string, std::vector<value_type>>
-			(xml.Query<std::string>(strXmlRoot + "/" + strAtom + "/a", ""), " \t", ffact.a);
+			(xml.template Query<std::string>(strXmlRoot + "/" + strAtom + "/a", ""), " \t", ffact.a);
 		tl::get_tokens<value_type, std::string, std::vector<value_type>>
-			(xml.Query<std::string>(strXmlRoot + "/" + strAtom + "/b", ""), " \t", ffact.b);
-		ffact.c = xml.Query<value_type>(strXmlRoot + "/" + strAtom + "/c", 0.);
+			(xml.template Query<std::string>(strXmlRoot + "/" + strAtom + "/b", ""), " \t", ffact.b);
+		ffact.c = xml.template Query<value_type>(strXmlRoot + "/" + strAtom + "/c", 0.);
 
 		if(!bIonStart && ffact.strAtom.find_first_of("+-") != std::string::npos)
 			bIonStart = true;
@@ -181,8 +179,8 @@ FormfactList<T>::FormfactList(const std::string& strFile, const std::string& str
 			s_vecIons.push_back(std::move(ffact));
 	}
 
-	s_strSrc = xml.Query<std::string>(strXmlRoot + "/ffacts/source", "");
-	s_strSrcUrl = xml.Query<std::string>(strXmlRoot + "/ffacts/source_url", "");
+	s_strSrc = xml.template Query<std::string>(strXmlRoot + "/ffacts/source", "");
+	s_strSrcUrl = xml.template Query<std::string>(strXmlRoot + "/ffacts/source_url", "");
 }
 
 template<typename T>
@@ -207,29 +205,7 @@ std::shared_ptr<const FormfactList<T>> FormfactList<T>::GetInstance(const char*
 template<typename T>
 const typename FormfactList<T>::elem_type* FormfactList<T>::Find(const std::string& strElem) const
 {
-	typedef typename decltype(s_vecAtoms)::const_iterator t_iter;
-
-	// atoms
-	t_iter iter = std::find_if(s_vecAtoms.begin(), s_vecAtoms.end(),
-		[&strElem](const elem_type& elem)->bool
-		{
-			//std::cout << elem.GetAtomIdent() << std::endl;
-			return elem.GetAtomIdent() == strElem;
-		});
-	if(iter != s_vecAtoms.end())
-		return &*iter;
-
-	// ions
-	iter = std::find_if(s_vecIons.begin(), s_vecIons.end(),
-		[&strElem](const elem_type& elem)->bool
-		{
-			//std::cout << elem.GetAtomIdent() << std::endl;
-			return elem.GetAtomIdent() == strElem;
-		});
-	if(iter != s_vecIons.end())
-		return &*iter;
-
-	return nullptr;
+	return m_index.Find(strElem);
 }
 
 
@@ -248,14 +224,16 @@ std::mutex MagFormfactList<T>::s_mutex;
 template<typename T>
 MagFormfactList<T>::MagFormfactList(const std::string& strFile, const std::string& strXmlRoot)
 {
-	std::string strTabFile = find_resource(strFile);
-	tl::log_debug("Loading magnetic form factors from file \"", strTabFile, "\".");
+	load_table<true>(strFile, "magnetic form factors",
+		[this, &strXmlRoot](const auto& xml) { this->Load(xml, strXmlRoot); });
+}
 
-	tl::Prop<std::string, true> xml;
-	if(!xml.Load(strTabFile.c_str(), tl::PropType::XML))
-		return;
 
-	const std::size_t iNumDat = xml.Query<std::size_t>(strXmlRoot + "/magffacts/num_atoms", 0);
+template<typename T>
+template<class t_prop>
+void MagFormfactList<T>::Load(const t_prop& xml, const std::string& strXmlRoot)
+{
+	const std::size_t iNumDat = xml.template Query<std::size_t>(strXmlRoot + "/magffacts/num_atoms", 0);
 	if(!iNumDat)
 	{
 		tl::log_err("No data in magnetic form factor list.");
@@ -267,21 +245,24 @@ MagFormfactList<T>::MagFormfactList(const std::string& strFile, const std::strin
 		elem_type ffact;
 		std::string strAtom = "magffacts/j0/atom_" + tl::var_to_str(iSf);
 
-		std::string strvecA = xml.Query<std::string>(strXmlRoot + "/" + strAtom + "/A");
-		std::string strveca = xml.Query<std::string>(strXmlRoot + "/" + strAtom + "/a");
+		std::string strvecA = xml.template Query<std::string>(strXmlRoot + "/" + strAtom + "/A");
+		std::string strveca = xml.template Query<std::string>(strXmlRoot + "/" + strAtom + "/a");
 
 		tl::get_tokens<value_type>(strvecA, std::string(";"), ffact.A0);
 		tl::get_tokens<value_type>(strveca, std::string(";"), ffact.a0);
 
-		ffact.strAtom = xml.Query<std::string>(strXmlRoot + "/" + strAtom + "/name", "");
+		ffact.strAtom = xml.template Query<std::string>(strXmlRoot + "/" + strAtom + "/name", "");
 
 		s_vecAtoms.push_back(std::move(ffact));
 	}
 
+	// the elements are not moved anymore, index them for the look-ups below
+	m_index.Add(s_vecAtoms);
+
 	for(std::size_t iSf=0; iSf<iNumDat; ++iSf)
 	{
 		std::string strAtom = "magffacts/j2/atom_" + tl::var_to_str(iSf);
-		std::string strAtomName = xml.Query<std::string>(strXmlRoot + "/" + strAtom + "/name", "");
+		std::string strAtomName = xml.template Query<std::string>(strXmlRoot + "/" + strAtom + "/name", "");
 
 		MagFormfactList<T>::elem_type* pElem =
 			const_cast<MagFormfactList<T>::elem_type*>(Find(strAtomName));
@@ -291,15 +272,15 @@ MagFormfactList<T>::MagFormfactList(const std::string& strFile, const std::strin
 			continue;
 		}
 
-		std::string strvecA = xml.Query<std::string>(strXmlRoot + "/" + strAtom + "/A");
-		std::string strveca = xml.Query<std::string>(strXmlRoot + "/" + strAtom + "/a");
+		std::string strvecA = xml.template Query<std::string>(strXmlRoot + "/" + strAtom + "/A");
+		std::string strveca = xml.template Query<std::string>(strXmlRoot + "/" + strAtom + "/a");
 
 		tl::get_tokens<value_type>(strvecA, std::string(";"), pElem->A2);
 		tl::get_tokens<value_type>(strveca, std::string(";"), pElem->a2);
 	}
 
-	s_strSrc = xml.Query<std::string>(strXmlRoot + "/magffacts/source", "");
-	s_strSrcUrl = xml.Query<std::string>(strXmlRoot + "/magffacts/source_url", "");
+	s_strSrc = xml.template Query<std::string>(strXmlRoot + "/magffacts/source", "");
+	s_strSrcUrl = xml.template Query<std::string>(strXmlRoot + "/magffacts/source_url", "");
 }
 
 template<typename T>
@@ -324,17 +305,7 @@ std::shared_ptr<const MagFormfactList<T>> MagFormfactList<T>::GetInstance(const
 template<typename T>
 const typename MagFormfactList<T>::elem_type* MagFormfactList<T>::Find(const std::string& strElem) const
 {
-	typedef typename decltype(s_vecAtoms)::const_iterator t_iter;
-
-	t_iter iter = std::find_if(s_vecAtoms.begin(), s_vecAtoms.end(),
-		[&strElem](const elem_type& elem) -> bool
-		{
-			return elem.GetAtomIdent() == strElem;
-		});
-	if(iter != s_vecAtoms.end())
-		return &*iter;
-
-	return nullptr;
+	return m_index.Find(strElem);
 }
 
 
@@ -352,14 +323,19 @@ std::mutex ScatlenList<T>::s_mutex;
 template<typename T>
 ScatlenList<T>::ScatlenList(const std::string& strFile, const std::string& strXmlRoot)
 {
-	std::string strTabFile = find_resource(strFile);
-	tl::log_debug("Loading neutron scattering lengths from file \"", strTabFile, "\".");
+	load_table(strFile, "neutron scattering lengths",
+		[this, &strXmlRoot](const auto& xml) { this->Load(xml, strXmlRoot); });
+
+	m_index.Add(s_vecElems);
+	m_index.Add(s_vecIsotopes);
+}
 
-	tl::Prop<std::string> xml;
-	if(!xml.Load(strTabFile.c_str(), tl::PropType::XML))
-		return;
 
-	const std::size_t iNumDat = xml.Query<std::size_t>(strXmlRoot + "/scatlens/num_atoms", 0);
+template<typename T>
+template<class t_prop>
+void ScatlenList<T>::Load(const t_prop& xml, const std::string& strXmlRoot)
+{
+	const std::size_t iNumDat = xml.template Query<std::size_t>(strXmlRoot + "/scatlens/num_atoms", 0);
 	if(!iNumDat)
 	{
 		tl::log_err("No data in scattering length list.");
@@ -371,23 +347,23 @@ ScatlenList<T>::ScatlenList(const std::string& strFile, const std::string& strXm
 		ScatlenList<T>::elem_type slen;
 		std::string strAtom = "scatlens/atom_" + tl::var_to_str(iSl);
 
-		slen.strAtom = xml.Query<std::string>(strXmlRoot + "/" + strAtom + "/name", "");
-		slen.coh = xml.Query<ScatlenList<T>::value_type>(strXmlRoot + "/" + strAtom + "/coh", 0.);
-		slen.incoh = xml.Query<ScatlenList<T>::value_type>(strXmlRoot + "/" + strAtom + "/incoh", 0.);
+		slen.strAtom = xml.template Query<std::string>(strXmlRoot + "/" + strAtom + "/name", "");
+		slen.coh = xml.template Query<ScatlenList<T>::value_type>(strXmlRoot + "/" + strAtom + "/coh", 0.);
+		slen.incoh = xml.template Query<ScatlenList<T>::value_type>(strXmlRoot + "/" + strAtom + "/incoh", 0.);
 
 		if(xml.Exists((strAtom + "/xsec_coh").c_str()))
-			slen.xsec_coh = xml.Query<ScatlenList<T>::value_type>(strXmlRoot + "/" + strAtom + "/xsec_coh", 0.);
+			slen.xsec_coh = xml.template Query<ScatlenList<T>::value_type>(strXmlRoot + "/" + strAtom + "/xsec_coh", 0.);
 		else
 			slen.xsec_coh = (slen.coh*std::conj(slen.coh)).real()*T(4)*tl::get_pi<T>();
 
 		if(xml.Exists((strAtom + "/xsec_incoh").c_str()))
-			slen.xsec_incoh = xml.Query<ScatlenList<T>::value_type>(strXmlRoot + "/" + strAtom + "/xsec_incoh", 0.);
+			slen.xsec_incoh = xml.template Query<ScatlenList<T>::value_type>(strXmlRoot + "/" + strAtom + "/xsec_incoh", 0.);
 		else
 			slen.xsec_incoh = (slen.incoh*std::conj(slen.incoh)).real()*T(4)*tl::get_pi<T>();
 
 		if(xml.Exists((strAtom + "/xsec_scat").c_str()))
 		{
-			slen.xsec_scat = xml.Query<ScatlenList<T>::value_type>(strXmlRoot + "/" + strAtom + "/xsec_scat", 0.);
+			slen.xsec_scat = xml.template Query<ScatlenList<T>::value_type>(strXmlRoot + "/" + strAtom + "/xsec_scat", 0.);
 			//tl::log_debug("Total scattering xsec exists for: ", slen.strAtom, ".");
 		}
 		else
@@ -395,11 +371,11 @@ ScatlenList<T>::ScatlenList(const std::string& strFile, const std::string& strXm
 			slen.xsec_scat = slen.xsec_coh + slen.xsec_incoh;
 		}
 
-		slen.xsec_abs = xml.Query<ScatlenList<T>::value_type>(strXmlRoot + "/" + strAtom + "/xsec_absorp", 0.);
+		slen.xsec_abs = xml.template Query<ScatlenList<T>::value_type>(strXmlRoot + "/" + strAtom + "/xsec_absorp", 0.);
 
 
-		slen.abund = xml.QueryOpt<ScatlenList<T>::real_type>(strXmlRoot + "/" + strAtom + "/abund");
-		slen.hl = xml.QueryOpt<ScatlenList<T>::real_type>(strXmlRoot + "/" + strAtom + "/hl");
+		slen.abund = xml.template QueryOpt<ScatlenList<T>::real_type>(strXmlRoot + "/" + strAtom + "/abund");
+		slen.hl = xml.template QueryOpt<ScatlenList<T>::real_type>(strXmlRoot + "/" + strAtom + "/hl");
 
 		if(std::isdigit(slen.strAtom[0]))
 			s_vecIsotopes.push_back(std::move(slen));	// pure isotopes
@@ -425,8 +401,8 @@ ScatlenList<T>::ScatlenList(const std::string& strFile, const std::string& strXm
 		iterElem->m_vecIsotopes.push_back(&isotope);
 	}
 
-	s_strSrc = xml.Query<std::string>(strXmlRoot + "/scatlens/source", "");
-	s_strSrcUrl = xml.Query<std::string>(strXmlRoot + "/scatlens/source_url", "");
+	s_strSrc = xml.template Query<std::string>(strXmlRoot + "/scatlens/source", "");
+	s_strSrcUrl = xml.template Query<std::string>(strXmlRoot + "/scatlens/source_url", "");
 
 #ifndef NDEBUG
 	// testing scattering lengths
@@ -485,29 +461,7 @@ std::shared_ptr<const ScatlenList<T>> ScatlenList<T>::GetInstance(const char* pc
 template<typename T>
 const typename ScatlenList<T>::elem_type* ScatlenList<T>::Find(const std::string& strElem) const
 {
-	typedef typename decltype(s_vecElems)::const_iterator t_iter;
-
-	// elements
-	t_iter iter = std::find_if(s_vecElems.begin(), s_vecElems.end(),
-		[&strElem](const elem_type& elem)->bool
-		{
-			//std::cout << elem.GetAtomIdent() << std::endl;
-			return elem.GetAtomIdent() == strElem;
-		});
-	if(iter != s_vecElems.end())
-		return &*iter;
-
-	// isotopes
-	iter = std::find_if(s_vecIsotopes.begin(), s_vecIsotopes.end(),
-		[&strElem](const elem_type& elem)->bool
-		{
-			//std::cout << elem.GetAtomIdent() << std::endl;
-			return elem.GetAtomIdent() == strElem;
-		});
-	if(iter != s_vecIsotopes.end())
-		return &*iter;
-
-	return nullptr;
+	return m_index.Find(strElem);
 }
 
 }
@@ -32,7 +32,9 @@
 #include "tlibs/math/linalg.h"
 #include "tlibs/math/geo2.h"
 #include "tlibs/phys/lattice.h"
+#include "tlibs/phys/atoms.h"
 
+#include "libs/globals.h"
 #include "spacegroup.h"
 #include "../formfactors/formfact.h"
 
@@ -97,6 +99,9 @@ struct LatticeCommon
 	std::vector<std::complex<t_real>> vecScatlens;
 	std::vector<AtomPosAux<t_real>> vecAllAtomPosAux;
 
+	// batch structure factor calculation for integer reflections
+	std::shared_ptr<tl::StructFactBatch<t_real>> pStructFacts;
+
 	std::vector<t_vec> vecAtomsSC;
 	std::vector<std::size_t> vecIdxSC;
 	std::vector<std::string> vecNamesSC;
@@ -163,6 +168,10 @@ struct LatticeCommon
 					tl::log_err("Element \"", strElem, "\" not found in scattering length table.",
 						" Using b = 0.");
 			}
+
+			pStructFacts = std::make_shared<tl::StructFactBatch<t_real>>(vecAllAtomsFrac, vecScatlens);
+			pStructFacts->SetSymOps(*pvecSymTrafos, g_dEps);
+			pStructFacts->SetNumThreads(get_max_threads());
 		}
 	}
 
@@ -373,7 +382,7 @@ struct LatticeCommon
 	}
 
 
-	bool CanCalcStructFact() const { return vecScatlens.size() != 0; }
+	bool CanCalcStructFact() const { return vecScatlens.size() != 0 && pStructFacts; }
 
 
 	std::tuple<std::complex<t_real>, t_real, t_real> GetStructFact(const t_vec& vecPeak) const
@@ -386,6 +395,31 @@ struct LatticeCommon
 
 		return std::make_tuple(cF, dF, dFsq);
 	}
+
+
+	/**
+	 * structure factor of an integer reflection
+	 */
+	std::tuple<std::complex<t_real>, t_real, t_real> GetStructFact(int ih, int ik, int il) const
+	{
+		std::complex<t_real> cF = pStructFacts->Calc(t_real(ih), t_real(ik), t_real(il));
+		t_real dFsq = (std::conj(cF)*cF).real();
+		t_real dF = std::sqrt(dFsq);
+
+		return std::make_tuple(cF, dF, dFsq);
+	}
+
+
+	/**
+	 * structure factors of many integer reflections,
+	 * symmetry-equivalent reflections are only calculated once
+	 * @param pStop optional cancellation flag, an empty vector is returned if it is set
+	 */
+	std::vector<std::complex<t_real>> GetStructFacts(const std::vector<std::array<int, 3>>& vecHKL,
+		const std::atomic<bool>* pStop = nullptr) const
+	{
+		return pStructFacts->Calc(vecHKL, pStop);
+	}
 };
 
 }
@@ -34,6 +34,8 @@
 #include <iomanip>
 #include <algorithm>
 #include <iterator>
+#include <vector>
+#include <cmath>
 #include "tlibs/math/linalg.h"
 #include "tlibs/phys/atoms.h"
 #include "tlibs/string/string.h"
@@ -460,5 +462,157 @@ std::pair<bool, std::size_t> is_reflection_allowed(int h, int k, int l, const t_
 	return std::make_pair(true, vecTrafos.size());
 }
 
+
+/**
+ * symmetry trafos precompiled into integer rotations and rational translations
+ * for allocation-free reflection condition checks, see is_reflection_allowed
+ */
+class ReflectionConditions
+{
+public:
+	// translations are stored in units of 1/TRANS_DENOM
+	static constexpr int TRANS_DENOM = 24;
+
+protected:
+	struct SymOp
+	{
+		// transposed rotation part
+		int rot[9];
+
+		// translation part in units of 1/TRANS_DENOM
+		int trans[3];
+
+		// index of the trafo in the original list
+		std::size_t idx;
+	};
+
+	std::vector<SymOp> m_vecOps;
+	std::size_t m_iNumTrafos = 0;
+	bool m_bValid = false;
+
+
+	/**
+	 * does the trafo forbid the reflection?
+	 */
+	static bool forbids(const SymOp& op, int h, int k, int l)
+	{
+		// only trafos which rotate hkl into itself are relevant
+		if(op.rot[0]*h + op.rot[1]*k + op.rot[2]*l != h ||
+			op.rot[3]*h + op.rot[4]*k + op.rot[5]*l != k ||
+			op.rot[6]*h + op.rot[7]*k + op.rot[8]*l != l)
+			return false;
+
+		// is inner product of hkl and translation an int?
+		return (op.trans[0]*h + op.trans[1]*k + op.trans[2]*l) % TRANS_DENOM != 0;
+	}
+
+
+public:
+	/**
+	 * compile the trafos
+	 * @return false if a trafo has no integer rotation or rational translation
+	 */
+	template<class t_mat = ublas::matrix<double>, template<class...> class t_cont = std::vector>
+	bool Compile(const t_cont<t_mat>& vecTrafos)
+	{
+		using t_real = typename t_mat::value_type;
+		const constexpr t_real dEps = t_real(1e-6);
+
+		m_vecOps.clear();
+		m_iNumTrafos = vecTrafos.size();
+		m_bValid = false;
+
+		auto to_int = [dEps](t_real d, int& i) -> bool
+		{
+			t_real dRound = std::round(d);
+			i = int(dRound);
+			return std::abs(d - dRound) < dEps;
+		};
+
+		for(std::size_t iMat = 0; iMat < vecTrafos.size(); ++iMat)
+		{
+			const t_mat& mat = vecTrafos[iMat];
+			if(mat.size1() < 3 || mat.size2() < 4)
+				return false;
+
+			SymOp op;
+			op.idx = iMat;
+
+			for(int i=0; i<3; ++i)
+			{
+				// recip -> transpose
+				for(int j=0; j<3; ++j)
+					if(!to_int(mat(j,i), op.rot[i*3 + j]))
+						return false;
+
+				if(!to_int(mat(i,3) * t_real(TRANS_DENOM), op.trans[i]))
+					return false;
+			}
+
+			// trafos without fractional translations cannot forbid any reflection
+			if(op.trans[0] % TRANS_DENOM == 0 && op.trans[1] % TRANS_DENOM == 0 &&
+				op.trans[2] % TRANS_DENOM == 0)
+				continue;
+
+			m_vecOps.push_back(op);
+		}
+
+		m_bValid = true;
+		return true;
+	}
+
+
+	bool IsValid() const { return m_bValid; }
+
+
+	/**
+	 * reflection systematically allowed? if not, return index of trafo which forbids it
+	 */
+	bool IsAllowed(int h, int k, int l, std::size_t* pTrafoIdx=nullptr) const
+	{
+		for(const SymOp& op : m_vecOps)
+		{
+			if(forbids(op, h, k, l))
+			{
+				if(pTrafoIdx) *pTrafoIdx = op.idx;
+				return false;
+			}
+		}
+
+		if(pTrafoIdx) *pTrafoIdx = m_iNumTrafos;
+		return true;
+	}
+
+
+	/**
+	 * allowed reflections in the box [hMin..hMax] x [kMin..kMax] x [lMin..lMax],
+	 * stored with l running fastest
+	 */
+	std::vector<unsigned char> GetAllowed(int hMin, int hMax, int kMin, int kMax, int lMin, int lMax) const
+	{
+		const int iNumH = std::max(hMax-hMin+1, 0);
+		const int iNumK = std::max(kMax-kMin+1, 0);
+		const int iNumL = std::max(lMax-lMin+1, 0);
+		std::vector<unsigned char> vecAllowed(std::size_t(iNumH)*iNumK*iNumL, 1);
+
+		std::size_t iIdx = 0;
+		for(int h=hMin; h<=hMax; ++h)
+		for(int k=kMin; k<=kMax; ++k)
+		for(int l=lMin; l<=lMax; ++l, ++iIdx)
+		{
+			for(const SymOp& op : m_vecOps)
+			{
+				if(forbids(op, h, k, l))
+				{
+					vecAllowed[iIdx] = 0;
+					break;
+				}
+			}
+		}
+
+		return vecAllowed;
+	}
+};
+
 }
 #endif
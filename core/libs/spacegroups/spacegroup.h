@@ -62,6 +62,9 @@ protected:
 	std::vector<unsigned int> m_vecInvTrafos, m_vecPrimTrafos,
 		m_vecCenterTrafos, m_vecTrans;
 
+	// precompiled trafos for the reflection conditions
+	ReflectionConditions m_reflconds, m_reflcondsCentring;
+
 public:
 	SpaceGroup() = default;
 	~SpaceGroup() = default;
@@ -72,7 +75,8 @@ public:
 		m_strCrystalSysName(sg.m_strCrystalSysName), m_vecTrafos(sg.m_vecTrafos),
 		m_vecCentringTrafos(sg.m_vecCentringTrafos),
 		m_vecInvTrafos(sg.m_vecInvTrafos), m_vecPrimTrafos(sg.m_vecPrimTrafos),
-		m_vecCenterTrafos(sg.m_vecCenterTrafos), m_vecTrans(sg.m_vecTrans)
+		m_vecCenterTrafos(sg.m_vecCenterTrafos), m_vecTrans(sg.m_vecTrans),
+		m_reflconds(sg.m_reflconds), m_reflcondsCentring(sg.m_reflcondsCentring)
 	{}
 
 	SpaceGroup(SpaceGroup&& sg)
@@ -81,7 +85,8 @@ public:
 		m_strCrystalSysName(std::move(sg.m_strCrystalSysName)), m_vecTrafos(std::move(sg.m_vecTrafos)),
 		m_vecCentringTrafos(sg.m_vecCentringTrafos),
 		m_vecInvTrafos(std::move(sg.m_vecInvTrafos)), m_vecPrimTrafos(std::move(sg.m_vecPrimTrafos)),
-		m_vecCenterTrafos(std::move(sg.m_vecCenterTrafos)), m_vecTrans(std::move(sg.m_vecTrans))
+		m_vecCenterTrafos(std::move(sg.m_vecCenterTrafos)), m_vecTrans(std::move(sg.m_vecTrans)),
+		m_reflconds(std::move(sg.m_reflconds)), m_reflcondsCentring(std::move(sg.m_reflcondsCentring))
 	{}
 
 
@@ -90,6 +95,9 @@ public:
 	 */
 	bool HasReflection(int h, int k, int l, std::size_t* pTrafoIdx=nullptr) const
 	{
+		if(m_reflconds.IsValid())
+			return m_reflconds.IsAllowed(h, k, l, pTrafoIdx);
+
 		std::pair<bool, std::size_t> pair =
 			is_reflection_allowed<std::vector, t_mat, t_vec>
 				(h,k,l, m_vecTrafos);
@@ -107,7 +115,11 @@ public:
 	{
 		bool bAllowed = 1;
 
-		if(m_vecCentringTrafos.size()) // calculate from space group
+		if(m_vecCentringTrafos.size() && m_reflcondsCentring.IsValid())
+		{
+			bAllowed = m_reflcondsCentring.IsAllowed(h, k, l, pTrafoIdx);
+		}
+		else if(m_vecCentringTrafos.size()) // calculate from space group
 		{
 			std::pair<bool, std::size_t> pair =
 				is_reflection_allowed<std::vector, t_mat, t_vec>
@@ -127,6 +139,25 @@ public:
 	}
 
 
+	/**
+	 * allowed reflections in the box [hMin..hMax] x [kMin..kMax] x [lMin..lMax],
+	 * stored with l running fastest
+	 */
+	std::vector<unsigned char> HasReflections(int hMin, int hMax,
+		int kMin, int kMax, int lMin, int lMax) const
+	{
+		if(m_reflconds.IsValid())
+			return m_reflconds.GetAllowed(hMin, hMax, kMin, kMax, lMin, lMax);
+
+		std::vector<unsigned char> vecAllowed;
+		for(int h=hMin; h<=hMax; ++h)
+		for(int k=kMin; k<=kMax; ++k)
+		for(int l=lMin; l<=lMax; ++l)
+			vecAllowed.push_back(HasReflection(h, k, l));
+		return vecAllowed;
+	}
+
+
 	void SetNr(unsigned int iNr)
 	{
 		m_iNr = iNr;
@@ -164,8 +195,16 @@ public:
 	const std::string& GetPointGroup() const { return m_strPoint; }
 
 
-	void SetTrafos(std::vector<t_mat>&& vecTrafos) { m_vecTrafos = std::move(vecTrafos); }
-	void SetTrafos(const std::vector<t_mat>& vecTrafos) { m_vecTrafos = vecTrafos; }
+	void SetTrafos(std::vector<t_mat>&& vecTrafos)
+	{
+		m_vecTrafos = std::move(vecTrafos);
+		m_reflconds.Compile(m_vecTrafos);
+	}
+	void SetTrafos(const std::vector<t_mat>& vecTrafos)
+	{
+		m_vecTrafos = vecTrafos;
+		m_reflconds.Compile(m_vecTrafos);
+	}
 	const std::vector<t_mat>& GetTrafos() const { return m_vecTrafos; }
 
 	void SetInvTrafos(std::vector<unsigned int>&& vecTrafos) { m_vecInvTrafos = std::move(vecTrafos); }
@@ -178,6 +217,7 @@ public:
 		m_vecCenterTrafos = std::move(vecTrafos);
 		for(unsigned int iIdx : m_vecCenterTrafos)
 			m_vecCentringTrafos.push_back(m_vecTrafos[iIdx]);
+		m_reflcondsCentring.Compile(m_vecCentringTrafos);
 	}
 	void SetCenterTrafos(const std::vector<unsigned int>& vecTrafos)
 	{
@@ -185,6 +225,7 @@ public:
 		m_vecCenterTrafos = vecTrafos;
 		for(unsigned int iIdx : m_vecCenterTrafos)
 			m_vecCentringTrafos.push_back(m_vecTrafos[iIdx]);
+		m_reflcondsCentring.Compile(m_vecCentringTrafos);
 	}
 	void SetTransTrafos(std::vector<unsigned int>&& vecTrafos) { m_vecTrans = std::move(vecTrafos); }
 	void SetTransTrafos(const std::vector<unsigned int>& vecTrafos) { m_vecTrans = vecTrafos; }
@@ -221,6 +262,7 @@ class SpaceGroups
 
 	protected:
 		bool LoadSpaceGroups(const std::string& strFile, bool bMandatory=1, const std::string& strXmlRoot="");
+		template<class t_prop> bool Load(const t_prop& xml, const std::string& strXmlRoot);
 
 	public:
 		~SpaceGroups();
@@ -31,6 +31,7 @@
 
 #include <sstream>
 #include "libs/globals.h"	// find_resource
+#include "libs/tabimage.h"
 
 
 namespace xtl {
@@ -82,17 +83,20 @@ const SpaceGroup<t_real>* SpaceGroups<t_real>::Find(const std::string& strSG) co
 template<class t_real>
 bool SpaceGroups<t_real>::LoadSpaceGroups(const std::string& strFile, bool bMandatory, const std::string& strXmlRoot)
 {
-	using t_mat = typename SpaceGroup<t_real>::t_mat;
-	//using t_vec = typename SpaceGroup<t_real>::t_vec;
+	bool bOk = false;
+	load_table(strFile, "space groups",
+		[this, &strXmlRoot, &bOk](const auto& xml) { bOk = this->Load(xml, strXmlRoot); },
+		bMandatory);
+	return bOk;
+}
 
-	std::string strTabFile = find_resource(strFile, bMandatory);
-	if(strTabFile == "")
-		return false;
-	tl::log_debug("Loading space groups from file \"", strTabFile, "\".");
 
-	tl::Prop<std::string> xml;
-	if(!xml.Load(strTabFile.c_str(), tl::PropType::XML))
-		return false;
+template<class t_real>
+template<class t_prop>
+bool SpaceGroups<t_real>::Load(const t_prop& xml, const std::string& strXmlRoot)
+{
+	using t_mat = typename SpaceGroup<t_real>::t_mat;
+	//using t_vec = typename SpaceGroup<t_real>::t_vec;
 
 	//unsigned int iNumSGs = xml.Query<unsigned int>(strXmlRoot + "/sgroups/num_groups", 230);
 	typedef typename t_mapSpaceGroups::value_type t_val;
@@ -107,10 +111,10 @@ bool SpaceGroups<t_real>::LoadSpaceGroups(const std::string& strFile, bool bMand
 		if(!xml.Exists(strGroup.c_str()))
 			break;
 
-		unsigned int iSgNr = xml.Query<unsigned int>(strXmlRoot + "/" + strGroup + "/number");
-		std::string strName = tl::trimmed(xml.Query<std::string>(strXmlRoot + "/" + strGroup + "/name"));
-		std::string strLaue = tl::trimmed(xml.Query<std::string>(strXmlRoot + "/" + strGroup + "/lauegroup"));
-		unsigned int iNumTrafos = xml.Query<unsigned int>(strXmlRoot + "/" + strGroup + "/num_trafos", 0);
+		unsigned int iSgNr = xml.template Query<unsigned int>(strXmlRoot + "/" + strGroup + "/number");
+		std::string strName = tl::trimmed(xml.template Query<std::string>(strXmlRoot + "/" + strGroup + "/name"));
+		std::string strLaue = tl::trimmed(xml.template Query<std::string>(strXmlRoot + "/" + strGroup + "/lauegroup"));
+		unsigned int iNumTrafos = xml.template Query<unsigned int>(strXmlRoot + "/" + strGroup + "/num_trafos", 0);
 
 		std::vector<t_mat> vecTrafos;
 		std::vector<unsigned int> vecInvTrafos, vecPrimTrafos, vecCenterTrafos, vecTrans;
@@ -126,7 +130,7 @@ bool SpaceGroups<t_real>::LoadSpaceGroups(const std::string& strFile, bool bMand
 			if(!xml.Exists(strTrafo.c_str()))
 				break;
 
-			std::string strTrafoVal = xml.Query<std::string>(strXmlRoot + "/" + strTrafo);
+			std::string strTrafoVal = xml.template Query<std::string>(strXmlRoot + "/" + strTrafo);
 			std::pair<std::string, std::string> pairSg = tl::split_first(strTrafoVal, std::string(";"), 1);
 
 			std::istringstream istrMat(pairSg.first);
@@ -172,9 +176,9 @@ bool SpaceGroups<t_real>::LoadSpaceGroups(const std::string& strFile, bool bMand
 		{ return sg1->GetNr() < sg2->GetNr(); });
 
 	if(s_strSrc == "")
-		s_strSrc = xml.Query<std::string>(strXmlRoot + "/sgroups/source", "");
+		s_strSrc = xml.template Query<std::string>(strXmlRoot + "/sgroups/source", "");
 	if(s_strUrl == "")
-		s_strUrl = xml.Query<std::string>(strXmlRoot + "/sgroups/source_url", "");
+		s_strUrl = xml.template Query<std::string>(strXmlRoot + "/sgroups/source_url", "");
 
 
 	if(g_vecSpaceGroups.size() < 230)
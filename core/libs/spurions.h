@@ -0,0 +1,393 @@
+/**
+ * batch checks of scan positions for spurions, dark angles and kinematic limits
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef __TAKIN_SPURIONS_H__
+#define __TAKIN_SPURIONS_H__
+
+#include <array>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <algorithm>
+#include <thread>
+
+#include "tlibs/phys/lattice.h"
+#include "tlibs/phys/neutrons.h"
+#include "tlibs/math/linalg.h"
+#include "tlibs/math/math.h"
+#include "tlibs/file/prop.h"
+#include "tlibs/helper/thread.h"
+
+
+template<class T = double>
+struct DarkAngle
+{
+	T dAngleStart;
+	T dAngleEnd;
+	T dAngleOffs;
+
+	int iCentreOn;    // 0=mono, 1=sample, 2=ana
+	int iRelativeTo;  // 0=crystal angle, 1=in axis, 2=out axis
+};
+
+
+/**
+ * instrument and sample configuration for the spurion checks
+ */
+template<class t_real = double>
+struct SpurionConfig
+{
+	using t_vec = tl::ublas::vector<t_real>;
+
+	tl::Lattice<t_real> lattice{5., 5., 5., tl::get_pi<t_real>()/2., tl::get_pi<t_real>()/2., tl::get_pi<t_real>()/2.};
+	t_vec vec1 = tl::make_vec<t_vec>({ 1., 0., 0. });	// scattering plane (rlu)
+	t_vec vec2 = tl::make_vec<t_vec>({ 0., 1., 0. });
+
+	t_real dMonoD = 3.355, dAnaD = 3.355;	// d-spacings (A)
+	bool bSenseM = false, bSenseS = true, bSenseA = false;
+
+	unsigned int iMaxOrder = 5;	// maximum order for higher-order spurions
+	t_real dBraggTol = 0.05;	// Q' (1/A) closer than this to a lattice point is flagged
+
+	std::vector<DarkAngle<t_real>> vecDarkAngles;
+
+
+	/**
+	 * loads the sample, scattering plane, instrument and dark angles from a takin file
+	 */
+	bool Load(const tl::Prop<std::string>& xml, const std::string& strXmlRoot = "taz/")
+	{
+		if(!xml.Exists(strXmlRoot + "sample/a"))
+			return false;
+
+		auto query = [&xml, &strXmlRoot](const std::string& strKey, t_real dDef) -> t_real
+		{
+			return xml.template Query<t_real>(strXmlRoot + strKey, dDef);
+		};
+
+		lattice = tl::Lattice<t_real>(query("sample/a", 5.), query("sample/b", 5.), query("sample/c", 5.),
+			tl::d2r(query("sample/alpha", 90.)), tl::d2r(query("sample/beta", 90.)),
+			tl::d2r(query("sample/gamma", 90.)));
+
+		vec1 = tl::make_vec<t_vec>({ query("plane/x0", 1.), query("plane/x1", 0.), query("plane/x2", 0.) });
+		vec2 = tl::make_vec<t_vec>({ query("plane/y0", 0.), query("plane/y1", 1.), query("plane/y2", 0.) });
+
+		dMonoD = query("tas/mono_d", dMonoD);
+		dAnaD = query("tas/ana_d", dAnaD);
+		bSenseM = xml.template Query<int>(strXmlRoot + "tas/sense_m", bSenseM) != 0;
+		bSenseS = xml.template Query<int>(strXmlRoot + "tas/sense_s", bSenseS) != 0;
+		bSenseA = xml.template Query<int>(strXmlRoot + "tas/sense_a", bSenseA) != 0;
+
+		// same format as in DarkAnglesDlg
+		vecDarkAngles.clear();
+		unsigned int iNumAngles = xml.template Query<unsigned int>(strXmlRoot + "darkangles/num", 0);
+		for(unsigned int iAngle=0; iAngle<iNumAngles; ++iAngle)
+		{
+			const std::string strNr = "darkangles/" + tl::var_to_str(iAngle);
+
+			DarkAngle<t_real> angle;
+			angle.dAngleStart = query(strNr + "/start", 0.);
+			angle.dAngleEnd = query(strNr + "/end", 0.);
+			angle.dAngleOffs = query(strNr + "/offs", 0.);
+			angle.iCentreOn = xml.template Query<int>(strXmlRoot + strNr + "/centreon", 1);
+			angle.iRelativeTo = xml.template Query<int>(strXmlRoot + strNr + "/relativeto", 0);
+			vecDarkAngles.emplace_back(std::move(angle));
+		}
+
+		return true;
+	}
+};
+
+
+/**
+ * planned scan position
+ */
+template<class t_real = double>
+struct SpurionPos
+{
+	t_real h = 0, k = 0, l = 0;
+	t_real ki = 0, kf = 0;
+};
+
+
+/**
+ * result of the checks for one position
+ */
+template<class t_real = double>
+struct SpurionResult
+{
+	// kinematic limits: false if the position cannot be reached
+	bool bReachable = false;
+	std::string strError;
+
+	t_real dE = 0, dQ = 0;
+
+	// instrument angles (rad)
+	t_real dMonoTT = 0, dSampleTheta = 0, dSampleTT = 0, dAnaTT = 0;
+
+	// accidental elastic (currat-axe) spurions
+	tl::ElasticSpurion elast;
+
+	// higher-order inelastic spurions for fixed Ei and fixed Ef
+	std::vector<tl::InelasticSpurion<t_real>> vecInelCKI, vecInelCKF;
+
+	// elastic positions Q' seen at the same angles with kf' = ki and ki' = kf,
+	// and their distances to the nearest lattice point (1/A), < 0 if not calculated
+	std::array<t_real, 3> hklElastKfKi{{ 0, 0, 0 }}, hklElastKiKf{{ 0, 0, 0 }};
+	t_real dBraggDistKfKi = -1, dBraggDistKiKf = -1;
+	bool bBraggKfKi = false, bBraggKiKf = false;
+
+	// indices of the dark angles obstructing the beam
+	std::vector<std::size_t> vecDarkAngles;
+
+
+	bool HasSpurions() const
+	{
+		return elast.bAType || elast.bMType ||
+			vecInelCKI.size() || vecInelCKF.size() ||
+			bBraggKfKi || bBraggKiKf;
+	}
+
+	bool IsOk() const
+	{
+		return bReachable && !HasSpurions() && vecDarkAngles.size() == 0;
+	}
+};
+
+
+/**
+ * does the beam at one of the axes pass through a dark angle?
+ * angles in deg, as in the TAS layout: the outgoing axis is the incoming one rotated by 2theta
+ */
+template<class t_real = double>
+bool is_beam_obstructed(const DarkAngle<t_real>& angle, t_real dTwoTheta, t_real dCrystalTheta)
+{
+	const t_real dAngleIn = 0.;
+	const t_real dAngleOut = dTwoTheta;
+
+	t_real dAbsOffs = 0.;
+	switch(angle.iRelativeTo)
+	{
+		case 0: dAbsOffs = dAngleIn + dCrystalTheta; break;	// relative to crystal angle theta
+		case 1: dAbsOffs = dAngleIn; break;			// relative to incoming axis
+		case 2: dAbsOffs = dAngleOut; break;			// relative to outgoing axis
+	}
+
+	auto norm_angle = [](t_real dAngle) -> t_real
+	{
+		dAngle = std::fmod(dAngle, t_real(360));
+		return dAngle < t_real(0) ? dAngle + t_real(360) : dAngle;
+	};
+
+	const t_real dStart = norm_angle(angle.dAngleStart + angle.dAngleOffs + dAbsOffs);
+	const t_real dRange = angle.dAngleEnd - angle.dAngleStart;
+
+	// the incoming beam is seen from the component, i.e. in the reversed direction
+	for(t_real dBeam : { norm_angle(dAngleIn + t_real(180)), norm_angle(dAngleOut) })
+	{
+		if(tl::is_in_angular_range<t_real>(tl::d2r(dStart), tl::d2r(dRange), tl::d2r(dBeam)))
+			return true;
+	}
+
+	return false;
+}
+
+
+/**
+ * checks a single position
+ */
+template<class t_real = double>
+SpurionResult<t_real> check_spurions(const SpurionConfig<t_real>& cfg, const SpurionPos<t_real>& pos)
+{
+	using t_vec = tl::ublas::vector<t_real>;
+	using t_mat = tl::ublas::matrix<t_real>;
+	static const tl::t_length_si<t_real> angs = tl::get_one_angstrom<t_real>();
+	static const tl::t_energy_si<t_real> meV = tl::get_one_meV<t_real>();
+	static const tl::t_angle_si<t_real> rads = tl::get_one_radian<t_real>();
+
+	SpurionResult<t_real> res;
+
+	try
+	{
+		const tl::t_energy_si<t_real> Ei = tl::k2E(pos.ki / angs);
+		const tl::t_energy_si<t_real> Ef = tl::k2E(pos.kf / angs);
+		res.dE = (Ei - Ef) / meV;
+
+		// kinematic limits
+		res.dMonoTT = tl::get_mono_twotheta(pos.ki / angs, cfg.dMonoD * angs, cfg.bSenseM) / rads;
+		res.dAnaTT = tl::get_mono_twotheta(pos.kf / angs, cfg.dAnaD * angs, cfg.bSenseA) / rads;
+		if(tl::is_nan_or_inf<t_real>(res.dMonoTT) || tl::is_nan_or_inf<t_real>(res.dAnaTT))
+			throw tl::Err("Invalid monochromator or analyser angle.");
+
+		t_vec vecQ;
+		tl::get_tas_angles(cfg.lattice, cfg.vec1, cfg.vec2,
+			pos.ki, pos.kf, pos.h, pos.k, pos.l, cfg.bSenseS,
+			&res.dSampleTheta, &res.dSampleTT, &vecQ);
+		if(tl::is_nan_or_inf<t_real>(res.dSampleTT) || tl::is_nan_or_inf<t_real>(res.dSampleTheta))
+			throw tl::Err("Invalid sample 2theta angle.");
+
+		res.dQ = tl::veclen(vecQ);
+		res.bReachable = true;
+
+
+		// higher-order inelastic spurions
+		res.vecInelCKI = tl::check_inelastic_spurions(1, Ei, Ef, res.dE*meV, cfg.iMaxOrder);
+		res.vecInelCKF = tl::check_inelastic_spurions(0, Ei, Ef, res.dE*meV, cfg.iMaxOrder);
+
+
+		// currat-axe spurions: q relative to the nearest lattice point,
+		// ki and kf in a frame where kf is ki rotated by 2theta around the plane normal
+		const t_mat matUB = tl::get_UB(cfg.lattice, cfg.vec1, cfg.vec2);
+		const t_vec vecG = tl::prod_mv(matUB, tl::make_vec<t_vec>({
+			std::round(pos.h), std::round(pos.k), std::round(pos.l) }));
+
+		if(res.dQ > t_real(0))
+		{
+			const t_vec vecKi = tl::make_vec<t_vec>({ pos.ki, 0. });
+			const t_vec vecKf = tl::make_vec<t_vec>({ pos.kf*std::cos(res.dSampleTT),
+				pos.kf*std::sin(res.dSampleTT) });
+
+			t_vec vecQPlane = vecQ; vecQPlane.resize(2, true);
+			t_vec vecq = vecQ - vecG; vecq.resize(2, true);
+
+			const t_real dRot = tl::vec_angle(t_vec(vecKi - vecKf)) - tl::vec_angle(vecQPlane);
+			vecq = tl::prod_mv(tl::rotation_matrix_2d(dRot), vecq);
+
+			if(tl::veclen(vecq) > t_real(0))
+				res.elast = tl::check_elastic_spurion(vecKi, vecKf, vecq);
+		}
+
+
+		// elastic positions at the same angles, as in ElasticDlg;
+		// for an elastic position these are the position itself
+		const t_real eps = 1e-6;
+		const bool bElastic = tl::float_equal<t_real>(pos.ki, pos.kf, eps);
+		for(int iElast=0; iElast<2; ++iElast)
+		{
+			if(bElastic)
+				break;
+
+			t_real dMonoTT = res.dMonoTT, dAnaTT = res.dAnaTT;
+			if(iElast == 0)		// kf' = ki
+				dAnaTT = tl::get_mono_twotheta(pos.ki / angs, cfg.dAnaD * angs, cfg.bSenseA) / rads;
+			else			// ki' = kf
+				dMonoTT = tl::get_mono_twotheta(pos.kf / angs, cfg.dMonoD * angs, cfg.bSenseM) / rads;
+			if(tl::is_nan_or_inf<t_real>(dMonoTT) || tl::is_nan_or_inf<t_real>(dAnaTT))
+				continue;
+
+			std::array<t_real, 3>& hkl = iElast == 0 ? res.hklElastKfKi : res.hklElastKiKf;
+			t_real& dDist = iElast == 0 ? res.dBraggDistKfKi : res.dBraggDistKiKf;
+			bool& bBragg = iElast == 0 ? res.bBraggKfKi : res.bBraggKiKf;
+
+			try
+			{
+				t_real dki = 0, dkf = 0, dE = 0;
+				t_vec vecQElast;
+				tl::get_hkl_from_tas_angles<t_real>(cfg.lattice, cfg.vec1, cfg.vec2,
+					cfg.dMonoD, cfg.dAnaD, dMonoTT*t_real(0.5), dAnaTT*t_real(0.5),
+					res.dSampleTheta, res.dSampleTT,
+					cfg.bSenseM, cfg.bSenseA, cfg.bSenseS,
+					&hkl[0], &hkl[1], &hkl[2], &dki, &dkf, &dE, 0, &vecQElast);
+
+				if(tl::is_nan_or_inf<t_real>(hkl[0]) || tl::is_nan_or_inf<t_real>(hkl[1]) ||
+					tl::is_nan_or_inf<t_real>(hkl[2]))
+					continue;
+
+				// the direct beam is not a spurion
+				const t_vec vecHKL = tl::make_vec<t_vec>({
+					std::round(hkl[0]), std::round(hkl[1]), std::round(hkl[2]) });
+				if(tl::veclen(vecHKL) == t_real(0))
+					continue;
+
+				dDist = tl::veclen(t_vec(vecQElast - tl::prod_mv(matUB, vecHKL)));
+				bBragg = dDist < cfg.dBraggTol;
+			}
+			catch(const std::exception&)
+			{
+				// elastic position not reachable
+			}
+		}
+
+
+		// dark angles
+		for(std::size_t iAngle=0; iAngle<cfg.vecDarkAngles.size(); ++iAngle)
+		{
+			const DarkAngle<t_real>& angle = cfg.vecDarkAngles[iAngle];
+
+			t_real dTT = res.dSampleTT, dTh = res.dSampleTheta;
+			if(angle.iCentreOn == 0)
+				dTT = res.dMonoTT, dTh = res.dMonoTT*t_real(0.5);
+			else if(angle.iCentreOn == 2)
+				dTT = res.dAnaTT, dTh = res.dAnaTT*t_real(0.5);
+
+			if(is_beam_obstructed<t_real>(angle, tl::r2d(dTT), tl::r2d(dTh)))
+				res.vecDarkAngles.push_back(iAngle);
+		}
+	}
+	catch(const std::exception& ex)
+	{
+		res.bReachable = false;
+		res.strError = ex.what();
+	}
+
+	return res;
+}
+
+
+/**
+ * checks a list of positions in parallel
+ */
+template<class t_real = double>
+std::vector<SpurionResult<t_real>> check_spurions(const SpurionConfig<t_real>& cfg,
+	const std::vector<SpurionPos<t_real>>& vecPos,
+	unsigned int iNumThreads = std::thread::hardware_concurrency())
+{
+	std::vector<SpurionResult<t_real>> vecRes(vecPos.size());
+
+	const std::size_t iChunk = 256;
+	tl::ThreadPool<void()> tp(std::max(1u, iNumThreads));
+
+	for(std::size_t iStart=0; iStart<vecPos.size(); iStart+=iChunk)
+	{
+		const std::size_t iEnd = std::min(iStart+iChunk, vecPos.size());
+		tp.AddTask([&cfg, &vecPos, &vecRes, iStart, iEnd]()
+		{
+			for(std::size_t iPos=iStart; iPos<iEnd; ++iPos)
+				vecRes[iPos] = check_spurions<t_real>(cfg, vecPos[iPos]);
+		});
+	}
+
+	tp.Start();
+	for(auto& fut : tp.GetResults())
+		fut.get();
+
+	return vecRes;
+}
+
+
+#endif
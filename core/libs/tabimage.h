@@ -0,0 +1,122 @@
+/**
+ * loading of data tables from xml files or their binary images
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef __TAKIN_TABIMAGE_H__
+#define __TAKIN_TABIMAGE_H__
+
+#include <string>
+#include <cstring>
+
+#include "tlibs/file/prop.h"
+#include "tlibs/file/propbin.h"
+#include "tlibs/file/file.h"
+#include "tlibs/log/log.h"
+#include "libs/globals.h"
+
+
+/**
+ * name of the binary image belonging to a table, e.g. "res/data/sgroups.xml" -> "res/data/sgroups.bin"
+ */
+static inline std::string get_table_image_name(const std::string& strTabFile)
+{
+	std::string strImgFile = strTabFile;
+	for(const char* pcExt : { ".gz", ".bz2", ".xml" })
+	{
+		std::size_t iLen = std::strlen(pcExt);
+		if(strImgFile.length() > iLen && strImgFile.compare(strImgFile.length()-iLen, iLen, pcExt) == 0)
+			strImgFile.resize(strImgFile.length() - iLen);
+	}
+
+	return strImgFile + ".bin";
+}
+
+
+/**
+ * writes the binary image of a table, used by gentab
+ */
+template<bool bCaseSensitive = 0>
+bool save_table_image(const std::string& strTabFile)
+{
+	tl::Prop<std::string, bCaseSensitive> xml;
+	if(!xml.Load(strTabFile.c_str(), tl::PropType::XML))
+		return false;
+
+	std::uint64_t iSrcSize = 0, iSrcHash = 0;
+	if(!tl::get_propbin_source_id(strTabFile, iSrcSize, iSrcHash))
+		return false;
+
+	tl::PropBin<std::string, bCaseSensitive> img;
+	if(!img.FromProp(xml, iSrcSize, iSrcHash))
+		return false;
+
+	return img.Save(get_table_image_name(strTabFile));
+}
+
+
+/**
+ * loads a table from its binary image, if available and up-to-date,
+ * or from the xml file otherwise
+ * @param fktLoad function to call with the loaded tl::Prop or tl::PropBin
+ */
+template<bool bCaseSensitive = 0, class t_func>
+bool load_table(const std::string& strFile, const char* pcDesc,
+	t_func&& fktLoad, bool bMandatory = true)
+{
+	std::string strTabFile = find_resource(strFile, bMandatory);
+	if(strTabFile == "")
+		return false;
+
+	std::string strImgFile = get_table_image_name(strTabFile);
+	if(tl::file_exists(strImgFile.c_str()))
+	{
+		// the image stores the size and hash of the xml contents it was created from
+		tl::PropBin<std::string, bCaseSensitive> img;
+		std::uint64_t iSrcSize = 0, iSrcHash = 0;
+		if(img.Load(strImgFile) && tl::get_propbin_source_id(strTabFile, iSrcSize, iSrcHash)
+			&& img.GetSourceSize() == iSrcSize && img.GetSourceHash() == iSrcHash)
+		{
+			tl::log_debug("Loading ", pcDesc, " from file \"", strImgFile, "\".");
+			fktLoad(img);
+			return true;
+		}
+
+		tl::log_warn("Table image \"", strImgFile, "\" does not match \"", strTabFile, "\", ignoring it.");
+	}
+
+	tl::log_debug("Loading ", pcDesc, " from file \"", strTabFile, "\".");
+
+	tl::Prop<std::string, bCaseSensitive> xml;
+	if(!xml.Load(strTabFile.c_str(), tl::PropType::XML))
+		return false;
+
+	fktLoad(xml);
+	return true;
+}
+
+
+#endif
@@ -0,0 +1,167 @@
+/**
+ * cancellable calculations in a worker thread
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef __TAKIN_WORKER_H__
+#define __TAKIN_WORKER_H__
+
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <list>
+#include <functional>
+#include <cstdint>
+
+
+/**
+ * runs one calculation at a time in a worker thread, a new calculation supersedes the running one.
+ * superseded threads are only signalled to stop, they are joined once they have finished,
+ * so that the gui thread never has to wait for them.
+ */
+template<class t_result>
+class CancellableWorker
+{
+public:
+	// the calculation, returns nullptr if it was stopped
+	using t_calc = std::function<std::shared_ptr<t_result>(const std::atomic<bool>& atStop)>;
+
+	// called in the worker thread when a result is ready
+	using t_notify = std::function<void()>;
+
+protected:
+	struct WorkerThread
+	{
+		std::unique_ptr<std::thread> pth;
+		std::shared_ptr<std::atomic<bool>> patStop, patDone;
+	};
+
+	WorkerThread m_thCur;
+	std::list<WorkerThread> m_lstOld;	// stopped, but possibly still running
+
+	std::mutex m_mtxResult;
+	std::uint64_t m_iGeneration = 0;	// guarded by m_mtxResult
+	std::shared_ptr<t_result> m_pResult;
+
+
+public:
+	CancellableWorker() = default;
+	~CancellableWorker() { Stop(true); }
+
+	CancellableWorker(const CancellableWorker&) = delete;
+	CancellableWorker& operator=(const CancellableWorker&) = delete;
+
+
+	/**
+	 * stops the running calculation and discards its results,
+	 * only waits for the stopped threads if bWait is set
+	 */
+	void Stop(bool bWait = false)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mtxResult);
+			++m_iGeneration;
+			m_pResult.reset();
+		}
+
+		if(m_thCur.pth)
+		{
+			m_thCur.patStop->store(true);
+			m_lstOld.emplace_back(std::move(m_thCur));
+			m_thCur = WorkerThread();
+		}
+
+		for(auto iter = m_lstOld.begin(); iter != m_lstOld.end();)
+		{
+			if(bWait || iter->patDone->load())
+			{
+				iter->pth->join();
+				iter = m_lstOld.erase(iter);
+			}
+			else
+			{
+				++iter;
+			}
+		}
+	}
+
+
+	/**
+	 * starts a new calculation, superseding the running one
+	 */
+	void Start(t_calc&& calc, t_notify&& notify)
+	{
+		Stop();
+
+		std::uint64_t iGeneration = 0;
+		{
+			std::lock_guard<std::mutex> lock(m_mtxResult);
+			iGeneration = m_iGeneration;
+		}
+
+		std::shared_ptr<std::atomic<bool>> patStop = std::make_shared<std::atomic<bool>>(false);
+		std::shared_ptr<std::atomic<bool>> patDone = std::make_shared<std::atomic<bool>>(false);
+		m_thCur.patStop = patStop;
+		m_thCur.patDone = patDone;
+
+		m_thCur.pth.reset(new std::thread([this, calc=std::move(calc), notify=std::move(notify),
+			iGeneration, patStop, patDone]()
+		{
+			struct SetDone { std::atomic<bool>& atDone; ~SetDone() { atDone.store(true); } } setdone{*patDone};
+
+			std::shared_ptr<t_result> pResult = calc(*patStop);
+			if(!pResult || patStop->load())
+				return;
+
+			// hand the results over, unless a newer calculation has been started in the meantime
+			{
+				std::lock_guard<std::mutex> lock(m_mtxResult);
+				if(iGeneration != m_iGeneration)
+					return;
+				m_pResult = pResult;
+			}
+
+			if(notify)
+				notify();
+		}));
+	}
+
+
+	/**
+	 * takes the result of the newest calculation, nullptr if none is available
+	 */
+	std::shared_ptr<t_result> TakeResult()
+	{
+		std::shared_ptr<t_result> pResult;
+		std::lock_guard<std::mutex> lock(m_mtxResult);
+		std::swap(pResult, m_pResult);
+		return pResult;
+	}
+};
+
+
+#endif
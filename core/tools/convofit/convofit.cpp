@@ -31,6 +31,7 @@
 #include "tlibs/log/log.h"
 #include "tlibs/log/debug.h"
 #include "tlibs/math/rand.h"
+#include "tlibs/fit/swarm.h"
 
 #include <iostream>
 #include <fstream>
@@ -355,6 +356,11 @@ bool Convofit::run_job(const std::string& _strJob)
 	unsigned int iMaxFuncCalls = prop.Query<unsigned>("fitter/max_funccalls", 0);
 	t_real dTolerance = prop.Query<t_real>("fitter/tolerance", 0.5);
 
+	// optional particle swarm pre-search, 0 particles: disabled
+	std::size_t iSwarmParticles = prop.Query<std::size_t>("fitter/swarm_particles", 0);
+	std::size_t iSwarmGenerations = prop.Query<std::size_t>("fitter/swarm_generations", 20);
+	std::size_t iSwarmMaxBestIters = prop.Query<std::size_t>("fitter/swarm_max_best_iters", 4);
+
 	std::string strScOutFile = prop.Query<std::string>("output/scan_file");
 	std::string strModOutFile = prop.Query<std::string>("output/model_file");
 	std::string strLogOutFile = prop.Query<std::string>("output/log_file");
@@ -821,6 +827,72 @@ bool Convofit::run_job(const std::string& _strJob)
 	mod.SetMinuitParams(params);
 
 
+	// global pre-search for the free parameters within their error ranges,
+	// the particles are evaluated in parallel, each chi^2 call works on a model copy
+	if(bDoFit && iSwarmParticles)
+	{
+		std::vector<std::size_t> vecFreeIdx;
+		std::vector<tl::t_real_min> vecMin, vecMax;
+		for(std::size_t iParam = 0; iParam < params.Params().size(); ++iParam)
+		{
+			const minuit::MinuitParameter& param = params.Parameter(iParam);
+			if(param.IsFixed() || param.IsConst())
+				continue;
+
+			tl::t_real_min dMin = param.Value() - param.Error();
+			tl::t_real_min dMax = param.Value() + param.Error();
+			if(param.HasLowerLimit()) dMin = std::max<tl::t_real_min>(dMin, param.LowerLimit());
+			if(param.HasUpperLimit()) dMax = std::min<tl::t_real_min>(dMax, param.UpperLimit());
+
+			vecFreeIdx.push_back(iParam);
+			vecMin.push_back(dMin);
+			vecMax.push_back(dMax);
+		}
+
+		// the workers run in parallel, so the individual chi^2 calls are single-threaded;
+		// modules whose copies share their parameters can only evaluate one particle at a time
+		const bool bParSwarm = pSqw->HasIndependentCopies();
+		const unsigned int iSwarmThreads = bParSwarm ? std::max(iNumThreads, 1u) : 1u;
+		if(!bParSwarm && iNumThreads > 1)
+			tl::log_warn("S(Q,E) module copies are not independent, evaluating the swarm particles serially.");
+
+		tl::Chi2Function_mult<t_real_sc, std::vector> chi2fktSwarm = chi2fkt;
+		chi2fktSwarm.SetDebug(false);
+		chi2fktSwarm.SetNumThreads(bParSwarm ? 1 : iNumThreads);
+
+		const std::vector<tl::t_real_min> vecAllParams = params.Params();
+		auto chi2swarm = [&chi2fktSwarm, &vecAllParams, &vecFreeIdx](const std::vector<tl::t_real_min>& vecFree) -> tl::t_real_min
+		{
+			std::vector<tl::t_real_min> vecParams = vecAllParams;
+			for(std::size_t iFree = 0; iFree < vecFreeIdx.size(); ++iFree)
+				vecParams[vecFreeIdx[iFree]] = vecFree[iFree];
+			return chi2fktSwarm(vecParams);
+		};
+
+		if(vecFreeIdx.size())
+		{
+			tl::log_info("Performing swarm pre-search with ", iSwarmParticles, " particles.");
+			tl::UnkindnessPar<tl::t_real_min> swarm;
+			swarm.SetFunc(chi2swarm, iSwarmThreads);
+			swarm.SetMaxGenerations(iSwarmGenerations);
+			swarm.SetMaxBestIters(iSwarmMaxBestIters);
+			swarm.Init(iSwarmParticles, vecMin, vecMax);
+			swarm.Run();
+
+			if(swarm.IsBestPosValid())
+			{
+				const std::vector<tl::t_real_min>& vecBest = swarm.GetBestPos();
+				for(std::size_t iFree = 0; iFree < vecFreeIdx.size(); ++iFree)
+					params.SetValue(vecFreeIdx[iFree], vecBest[iFree]);
+				mod.SetMinuitParams(params);
+
+				tl::log_info("Swarm pre-search: chi2 = ", swarm.GetBestVal(),
+					" after ", swarm.GetNumEvals(), " evaluations.");
+			}
+		}
+	}
+
+
 	minuit::MnStrategy strat(iStrat);
 
 	std::unique_ptr<minuit::MnApplication> pmini;
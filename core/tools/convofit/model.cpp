@@ -120,13 +120,10 @@ tl::t_real_min SqwFuncModel::operator()(tl::t_real_min x_principal) const
 	t_real dS = 0.;
 	t_real dhklE_mean[4] = { 0., 0., 0., 0. };
 
-	for(const ublas::vector<t_real_reso>& vecHKLE : vecNeutrons)
-	{
-		dS += t_real((*m_pSqw)(vecHKLE[0], vecHKLE[1], vecHKLE[2], vecHKLE[3]));
-
-		for(int i = 0; i < 4; ++i)
-			dhklE_mean[i] += t_real(vecHKLE[i]);
-	}
+	t_real_reso dhklE_sum[4] = { 0., 0., 0., 0. };
+	dS += t_real(sqw_sum(*m_pSqw, vecNeutrons, dhklE_sum));
+	for(int i = 0; i < 4; ++i)
+		dhklE_mean[i] += t_real(dhklE_sum[i]);
 
 	dS /= t_real(m_iNumNeutrons);
 	dS += m_pSqw->GetBackground(vecScanPos[0], vecScanPos[1], vecScanPos[2], vecScanPos[3]);
@@ -100,8 +100,16 @@ bool load_file(const std::vector<std::string>& vecFiles, Scan& scan, bool bNormT
 		return 0;
 	tl::log_info("Loading \"", vecFiles[0], "\".");
 
+	// columns to read up-front from formats supporting partial reads
+	std::vector<std::string> vecHintCols{{ "QH", "QK", "QL", "EN" }};
+	for(const std::string& strCol : { scan.strCntCol, scan.strMonCol, scan.strCntErrCol, scan.strMonErrCol })
+	{
+		if(strCol != "")
+			vecHintCols.push_back(strCol);
+	}
+
 	std::unique_ptr<tl::FileInstrBase<t_real_sc>>
-		pInstr(tl::FileInstrBase<t_real_sc>::LoadInstr(vecFiles[0].c_str()));
+		pInstr(tl::FileInstrBase<t_real_sc>::LoadInstr(vecFiles[0].c_str(), &vecHintCols));
 	if(!pInstr)
 	{
 		tl::log_err("Cannot load \"", vecFiles[0], "\".");
@@ -112,7 +120,7 @@ bool load_file(const std::vector<std::string>& vecFiles, Scan& scan, bool bNormT
 	{
 		tl::log_info("Loading \"", vecFiles[iFile], "\" for merging.");
 		std::unique_ptr<tl::FileInstrBase<t_real_sc>>
-			pInstrM(tl::FileInstrBase<t_real_sc>::LoadInstr(vecFiles[iFile].c_str()));
+			pInstrM(tl::FileInstrBase<t_real_sc>::LoadInstr(vecFiles[iFile].c_str(), &vecHintCols));
 		if(!pInstrM)
 		{
 			tl::log_err("Cannot load \"", vecFiles[iFile], "\".");
@@ -37,6 +37,7 @@
 #include "tlibs/log/log.h"
 #include "tlibs/math/linalg.h"
 #include "libs/spacegroups/sghelper.h"
+#include "libs/tabimage.h"
 #if !defined(NO_CLP) && defined(USE_CLP_SPACEGROUPS)
 	#include "libs/spacegroups/spacegroup_clp.h"
 #endif
@@ -680,5 +681,25 @@ int main()
 		tl::log_err("Cannot create magnetic form factor coefficient table, because required periodic table is invalid.");
 	}
 
+	// binary images of the tables for faster loading
+	std::cout << "Generating binary table images ... ";
+	bool bImagesOk = true;
+	for(const char* pcTab : { "res/data/elements.xml.gz", "res/data/ffacts.xml.gz",
+		"res/data/scatlens.xml.gz", "res/data/sgroups.xml.gz" })
+	{
+		if(tl::file_exists(pcTab) && !save_table_image(pcTab))
+		{
+			tl::log_err("Cannot write binary image of \"", pcTab, "\".");
+			bImagesOk = false;
+		}
+	}
+	// magnetic form factors use case-sensitive keys
+	if(tl::file_exists("res/data/magffacts.xml.gz") && !save_table_image<true>("res/data/magffacts.xml.gz"))
+	{
+		tl::log_err("Cannot write binary image of \"res/data/magffacts.xml.gz\".");
+		bImagesOk = false;
+	}
+	if(bImagesOk) std::cout << "OK" << std::endl;
+
 	return 0;
 }
@@ -31,8 +31,10 @@
 #include <clipper/clipper.h>
 #include <vector>
 #include <sstream>
+#include <array>
 #include "tlibs/math/linalg.h"
 #include "tlibs/math/linalg_ops.h"
+#include "tlibs/phys/atoms.h"
 #include "tlibs/string/string.h"
 #include "libs/spacegroups/spacegroup_clp.h"
 
@@ -63,34 +65,21 @@ void gen_dirs()
 	std::cout << vecTrafos.size() << " symmetry operations." << std::endl;
 
 
-	t_vec vecDir(4);
+	// distinct rotation parts, translations do not act on directions
+	std::vector<std::array<int, 9>> vecRots = tl::get_symop_rotations<t_mat, double>(vecTrafos);
+	std::cout << vecRots.size() << " distinct rotations." << std::endl;
+
+
+	std::array<double, 3> vecDir;
 	std::cout << "Enter direction: ";
 	std::cin >> vecDir[0] >> vecDir[1] >> vecDir[2];
-	vecDir[3] = 0.;		// no translations, only point groups
-
 
-	std::vector<t_vec> vecNewDirs;
-	std::cout << "\nall transformations:" << std::endl;
-	for(const t_mat& matTrafo : vecTrafos)
-	{
-		t_vec vecDirNew = ublas::prod(matTrafo, vecDir);
-		std::cout << vecDirNew << " (from trafo " << matTrafo << ")" << std::endl;
-
-		bool bHasDir = 0;
-		for(const t_vec& vec : vecNewDirs)
-			if(tl::vec_equal(vec, vecDirNew))
-			{
-				bHasDir = 1;
-				break;
-			}
-		if(!bHasDir)
-			vecNewDirs.push_back(vecDirNew);
-	}
+	std::vector<std::array<double, 3>> vecNewDirs = tl::get_equivalent_vecs<double>(vecRots, vecDir);
 
 	std::cout << "\nunique transformations:" << std::endl;
-	for(const t_vec& vec : vecNewDirs)
+	for(const std::array<double, 3>& vec : vecNewDirs)
 	{
-		std::cout << vec << std::endl;
+		std::cout << "(" << vec[0] << ", " << vec[1] << ", " << vec[2] << ")" << std::endl;
 	}
 }
 
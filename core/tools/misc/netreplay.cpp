@@ -0,0 +1,121 @@
+/**
+ * plays back a recorded instrument message stream for offline tests of the network cache
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date 2026
+ * @license GPLv2
+ *
+ * g++ -std=c++14 -O2 -I../.. -o netreplay netreplay.cpp ../../tlibs/net/tcp.cpp ../../tlibs/log/log.cpp -lboost_system -lboost_program_options -lpthread
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+#include <iostream>
+#include <string>
+#include <chrono>
+
+#include "tlibs/net/tcp_replay.h"
+#include "tlibs/log/log.h"
+
+#include <boost/program_options.hpp>
+namespace opts = boost::program_options;
+
+
+int main(int argc, char** argv)
+{
+	std::string strFile;
+	unsigned short iPort = 14869;
+	double dSpeed = 1.;
+	bool bLoop = false;
+
+	opts::options_description args("program options");
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("rec",
+		opts::value<decltype(strFile)>(&strFile), "stream recording from the takin network menu")));
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("port",
+		opts::value<decltype(iPort)>(&iPort), "port to listen on, default: 14869 (nicos cache)")));
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("speed",
+		opts::value<decltype(dSpeed)>(&dSpeed), "playback speed, 0: as fast as possible")));
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("loop",
+		opts::bool_switch(&bLoop), "repeat the recording until the client disconnects")));
+
+	opts::positional_options_description args_pos;
+	args_pos.add("rec", -1);
+
+	opts::basic_command_line_parser<char> clparser(argc, argv);
+	clparser.options(args);
+	clparser.positional(args_pos);
+	opts::basic_parsed_options<char> parsedopts = clparser.run();
+
+	opts::variables_map opts_map;
+	opts::store(parsedopts, opts_map);
+	opts::notify(opts_map);
+
+	if(strFile == "")
+	{
+		std::cerr << "Please give a stream recording.\n" << args << std::endl;
+		return -1;
+	}
+
+
+	tl::TcpTxtReplay<> server;
+	if(!server.load(strFile))
+		return -1;
+
+	const auto& vecMsgs = server.get_messages();
+	if(vecMsgs.size() == 0)
+	{
+		tl::log_err("No messages in \"", strFile, "\".");
+		return -1;
+	}
+
+	const double dDuration = vecMsgs.rbegin()->first - vecMsgs.begin()->first;
+	tl::log_info("Loaded ", vecMsgs.size(), " messages spanning ", dDuration, " s.");
+
+	server.set_speed(dSpeed);
+	server.set_loop(bLoop);
+
+	std::chrono::steady_clock::time_point tStart;
+	server.add_server_start([&tStart](unsigned short)
+	{
+		tStart = std::chrono::steady_clock::now();
+		tl::log_info("Client connected, starting playback.");
+	});
+
+	if(!server.start_server(iPort))
+	{
+		tl::log_err("Cannot start server on port ", iPort, ".");
+		return -1;
+	}
+
+	tl::log_info("Waiting for a client on port ", iPort, "...");
+	server.wait_playback();
+
+	const double dTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+	const std::size_t iNumSent = server.get_num_sent();
+	tl::log_info("Sent ", iNumSent, " messages in ", dTime, " s (", double(iNumSent)/dTime, " messages/s).");
+
+	server.disconnect();
+	return 0;
+}
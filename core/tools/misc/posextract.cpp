@@ -47,10 +47,14 @@ namespace opts = boost::program_options;
 
 
 
+// only these columns are read up-front from formats supporting it
+static const std::vector<std::string> g_vecPosCols{{ "QH", "QK", "QL", "EN" }};
+
+
 static void extract_monteconvo_pos(const char* pcIn, const char* pcOut)
 {
 	std::shared_ptr<tl::FileInstrBase<t_real>> ptrInstr(
-		tl::FileInstrBase<t_real>::LoadInstr(pcIn));
+		tl::FileInstrBase<t_real>::LoadInstr(pcIn, &g_vecPosCols));
 	tl::FileInstrBase<t_real> *pInstr = ptrInstr.get();
 
 	if(!pInstr)
@@ -137,13 +141,18 @@ static void extract_pos(
 	std::tie(strFilterCol, strFilterColVal) = tl::split_first(_strFilterCol, std::string{"="}, 1);
 	t_real dFilterColVal = tl::str_to_var<t_real>(strFilterColVal);
 
+	std::vector<std::string> vecHintCols = g_vecPosCols;
+	vecHintCols.insert(vecHintCols.end(), vecCols.begin(), vecCols.end());
+	if(strFilterCol != "")
+		vecHintCols.push_back(strFilterCol);
+
 
 	for(const std::string& strScan : vecScans)
 	{
 		tl::log_info("Loading \"", strScan, "\".");
 
 		std::shared_ptr<tl::FileInstrBase<t_real>> ptrInstr(
-			tl::FileInstrBase<t_real>::LoadInstr(strScan.c_str()));
+			tl::FileInstrBase<t_real>::LoadInstr(strScan.c_str(), &vecHintCols));
 
 		if(!ptrInstr)
 		{
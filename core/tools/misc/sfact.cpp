@@ -33,6 +33,8 @@
 #include <tuple>
 #include <algorithm>
 #include <sstream>
+#include <memory>
+#include <array>
 #include "tlibs/math/linalg_ops.h"
 #include "tlibs/phys/atoms.h"
 #include "tlibs/phys/mag.h"
@@ -124,7 +126,8 @@ static std::string load_spacegroup(const tl::Prop<>& file)
 // Atom positions
 // --------------------------------------------------------------------------------------------
 static inline
-std::tuple<std::vector<std::string>, std::vector<t_vec>, std::unordered_map<std::string, t_real>>
+std::tuple<std::vector<std::string>, std::vector<t_vec>, std::unordered_map<std::string, t_real>,
+	std::vector<t_vec>>
 enter_atoms()
 {
 	std::cout << "\n----------------------------------------------------------------------\n" << std::endl;
@@ -132,6 +135,7 @@ enter_atoms()
 	std::vector<std::string> vecElems;
 	std::vector<t_vec> vecAtoms;
 	std::unordered_map<std::string, t_real> mapMag;
+	std::vector<t_vec> vecSpinDirs;
 
 	while(1)
 	{
@@ -156,6 +160,11 @@ enter_atoms()
 		if(strMag == "")
 			strMag = "0";
 
+		std::cout << "Enter atom " << (iAtom) << " moment direction [x y z (in frac. units), or <Enter> for none]: ";
+		std::string strSpin;
+		std::getline(std::cin, strSpin);
+		tl::trim(strSpin);
+
 
 		vecElems.push_back(strElem);
 
@@ -168,21 +177,35 @@ enter_atoms()
 		t_real dMag;
 		std::istringstream istrMag(strMag);
 		istrMag >> dMag;
+		// moment vector for the magnetic intensities
+		t_vec vecSpin = ublas::zero_vector<t_real>(3);
+		if(strSpin != "")
+		{
+			std::istringstream istrSpin(strSpin);
+			istrSpin >> vecSpin[0] >> vecSpin[1] >> vecSpin[2];
+			t_real dLen = ublas::norm_2(vecSpin);
+			if(!tl::float_equal<t_real>(dLen, 0.))
+				vecSpin *= dMag / dLen;
+		}
+		vecSpinDirs.push_back(vecSpin);
+
 		dMag = tl::mag_scatlen_eff(dMag);
 		mapMag[strElem] = dMag;
 	}
 
-	return std::make_tuple(vecElems, vecAtoms, mapMag);
+	return std::make_tuple(vecElems, vecAtoms, mapMag, vecSpinDirs);
 }
 
 
 static inline
-std::tuple<std::vector<std::string>, std::vector<t_vec>, std::unordered_map<std::string, t_real>>
+std::tuple<std::vector<std::string>, std::vector<t_vec>, std::unordered_map<std::string, t_real>,
+	std::vector<t_vec>>
 load_atoms(const tl::Prop<>& file)
 {
 	std::vector<std::string> vecElems;
 	std::vector<t_vec> vecAtoms;
 	std::unordered_map<std::string, t_real> mapMag;
+	std::vector<t_vec> vecSpinDirs;
 
 	std::size_t iNumAtoms = file.Query<std::size_t>((g_strXmlRoot + "sample/atoms/num").c_str(), 0);
 	vecElems.reserve(iNumAtoms);
@@ -203,9 +226,10 @@ load_atoms(const tl::Prop<>& file)
 
 		vecElems.push_back(strAtomName);
 		vecAtoms.push_back(vec);
+		vecSpinDirs.push_back(ublas::zero_vector<t_real>(3));
 	}
 
-	return std::make_tuple(vecElems, vecAtoms, mapMag);
+	return std::make_tuple(vecElems, vecAtoms, mapMag, vecSpinDirs);
 }
 // --------------------------------------------------------------------------------------------
 
@@ -281,11 +305,12 @@ void gen_atoms_sfact(const char *pcFile = nullptr)
 	std::vector<std::string> vecElems;
 	std::vector<t_vec> vecAtoms;
 	std::unordered_map<std::string, t_real> mapMag;
+	std::vector<t_vec> vecSpinDirs;
 
 	if(bHasFile)
-		std::tie(vecElems, vecAtoms, mapMag) = load_atoms(file);
+		std::tie(vecElems, vecAtoms, mapMag, vecSpinDirs) = load_atoms(file);
 	else
-		std::tie(vecElems, vecAtoms, mapMag) = enter_atoms();
+		std::tie(vecElems, vecAtoms, mapMag, vecSpinDirs) = enter_atoms();
 	// --------------------------------------------------------------------------------------------
 
 
@@ -298,6 +323,12 @@ void gen_atoms_sfact(const char *pcFile = nullptr)
 	std::vector<std::complex<t_real>> vecScatlens;
 	std::vector<std::complex<t_real>> vecMagScatlens;
 	std::vector<int> vecAtomIndices;
+	std::vector<t_vec> vecAllAtomsFrac, vecAllSpins;
+	bool bHasSpins = false;
+
+	// form factor tables per species, looked up only once
+	std::vector<const xtl::FormfactList<t_real>::elem_type*> vecSpeciesFF;
+	std::vector<const xtl::MagFormfactList<t_real>::elem_type*> vecSpeciesMFF;
 
 	t_real dsigCoh = 0.;
 	t_real dsigInc = 0.;
@@ -328,6 +359,16 @@ void gen_atoms_sfact(const char *pcFile = nullptr)
 		}
 		std::complex<t_real> b = pElem->GetCoherent();
 
+		const xtl::FormfactList<t_real>::elem_type* pElemff = lstff->Find(vecElems[iAtom]);
+		if(pElemff == nullptr)
+		{
+			std::cerr << "Error: cannot get form factor for "
+				<< vecElems[iAtom] << "." << std::endl;
+			return;
+		}
+		vecSpeciesFF.push_back(pElemff);
+		vecSpeciesMFF.push_back(lstmff->Find(vecElems[iAtom]));
+
 
 		// microscopic cross-sections
 		dsigCoh += pElem->GetXSecCoherent().real()*vecNumAtoms[iAtom];
@@ -361,9 +402,19 @@ void gen_atoms_sfact(const char *pcFile = nullptr)
 
 
 		// store calculations
+		// moment in the orthonormal frame, the same for all equivalent positions
+		t_vec vecSpin = tl::mult<t_mat, t_vec>(matA, vecSpinDirs[iAtom]);
+		if(ublas::norm_2(vecSpin) > 0.)
+		{
+			vecSpin *= ublas::norm_2(vecSpinDirs[iAtom]) / ublas::norm_2(vecSpin);
+			bHasSpins = true;
+		}
+
 		for(t_vec vecThisAtom : vecPos)
 		{
 			vecThisAtom.resize(3,1);
+			vecAllAtomsFrac.push_back(vecThisAtom);
+			vecAllSpins.push_back(vecSpin * 0.5);	// S = mu / g
 			vecAllAtoms.push_back(tl::mult<t_mat, t_vec>(matA, vecThisAtom));
 			vecScatlens.push_back(b);
 			vecMagScatlens.push_back(p);
@@ -389,11 +440,40 @@ void gen_atoms_sfact(const char *pcFile = nullptr)
 
 
 
+	// --------------------------------------------------------------------------------------------
+	// Magnetic intensities with domain averaging over the space group operations
+	// --------------------------------------------------------------------------------------------
+	std::unique_ptr<tl::MagStructFactBatch<t_real>> pMagSFact;
+	if(bHasSpins)
+	{
+		std::vector<std::size_t> vecSpecies(vecAtomIndices.begin(), vecAtomIndices.end());
+		std::vector<tl::MagStructFactBatch<t_real>::t_ffact> vecMagFFs;
+		for(const xtl::MagFormfactList<t_real>::elem_type* pElemMff : vecSpeciesMFF)
+		{
+			if(pElemMff)
+				vecMagFFs.push_back([pElemMff](t_real dQ) -> t_real { return pElemMff->GetFormfactTab(dQ); });
+			else
+				vecMagFFs.push_back(nullptr);
+		}
+
+		pMagSFact.reset(new tl::MagStructFactBatch<t_real>(vecAllAtomsFrac, vecAllSpins, vecSpecies));
+		pMagSFact->SetRecipBasis(matB);
+		pMagSFact->SetFormfacts(vecMagFFs);
+		pMagSFact->SetSymOps(vecTrafos);
+		pMagSFact->SetNumThreads(get_max_threads());
+		std::cout << "\nMagnetic intensities are averaged over "
+			<< pMagSFact->GetNumDomains() << " domain operations." << std::endl;
+	}
+	// --------------------------------------------------------------------------------------------
+
+
+
 	// --------------------------------------------------------------------------------------------
 	// Bragg peaks
 	// --------------------------------------------------------------------------------------------
 	std::vector<t_real> vecFormfacts;
 	std::vector<t_real> vecMagFormfacts;
+	std::vector<t_real> vecSpeciesFormfacts, vecSpeciesMagFormfacts;
 
 	while(1)
 	{
@@ -408,31 +488,22 @@ void gen_atoms_sfact(const char *pcFile = nullptr)
 		std::cout << "G = " << dG << " / A" << std::endl;
 
 
+		// form factors only depend on the species and |G|
+		vecSpeciesFormfacts.clear();
+		vecSpeciesMagFormfacts.clear();
+		for(std::size_t iSpecies=0; iSpecies<vecSpeciesFF.size(); ++iSpecies)
+		{
+			vecSpeciesFormfacts.push_back(vecSpeciesFF[iSpecies]->GetFormfact(dG));
+			vecSpeciesMagFormfacts.push_back(vecSpeciesMFF[iSpecies] ?
+				vecSpeciesMFF[iSpecies]->GetFormfact(dG) : 0.);
+		}
+
 		vecFormfacts.clear();
 		vecMagFormfacts.clear();
-		for(unsigned int iAtom=0; iAtom<vecAllAtoms.size(); ++iAtom)
+		for(int iSpecies : vecAtomIndices)
 		{
-			//const t_vec& vecAtom = vecAllAtoms[iAtom];
-			const xtl::FormfactList<t_real>::elem_type* pElemff = lstff->Find(vecElems[vecAtomIndices[iAtom]]);
-			const xtl::MagFormfactList<t_real>::elem_type* pElemMff = lstmff->Find(vecElems[vecAtomIndices[iAtom]]);
-
-			if(pElemff == nullptr)
-			{
-				std::cerr << "Error: cannot get form factor for "
-					<< vecElems[vecAtomIndices[iAtom]] << "." << std::endl;
-				return;
-			}
-			/*if(pElemMff == nullptr)
-			{
-				std::cerr << "Warning: cannot get magnetic form factor for "
-					<< vecElems[vecAtomIndices[iAtom]] << "." << std::endl;
-			}*/
-
-			t_real dFF = pElemff ? pElemff->GetFormfact(dG) : 0.;
-			vecFormfacts.push_back(dFF);
-
-			t_real dMFF = pElemMff ? pElemMff->GetFormfact(dG) : 0.;
-			vecMagFormfacts.push_back(dMFF);
+			vecFormfacts.push_back(vecSpeciesFormfacts[iSpecies]);
+			vecMagFormfacts.push_back(vecSpeciesMagFormfacts[iSpecies]);
 		}
 
 
@@ -474,6 +545,15 @@ void gen_atoms_sfact(const char *pcFile = nullptr)
 		std::cout << "|Fm| = " << std::sqrt(dFmsq) << " fm" << std::endl;
 		std::cout << "|Fm|^2 = " << dFmsq << " fm^2" << std::endl;
 
+		if(pMagSFact)
+		{
+			const std::vector<std::array<t_real, 3>> vecHKL{{{ h, k, l }}};
+			t_real dIm = pMagSFact->CalcIntensities(vecHKL, false)[0];
+			t_real dImAvg = pMagSFact->CalcIntensities(vecHKL, true)[0];
+			std::cout << "|Fm_perp|^2 = " << dIm << " fm^2 (single domain)" << std::endl;
+			std::cout << "|Fm_perp|^2 = " << dImAvg << " fm^2 (domain average)" << std::endl;
+		}
+
 		std::cout << std::endl;
 		std::cout << "X-ray atomic structure factor: " << std::endl;
 		t_real dFxsq = (std::conj(Fx)*Fx).real();
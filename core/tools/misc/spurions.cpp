@@ -0,0 +1,323 @@
+/**
+ * checks planned scan positions for spurions, dark angles and kinematic limits
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2
+ *
+ * g++ -std=c++14 -O2 -I../.. -o spurions spurions.cpp ../../tlibs/log/log.cpp -lboost_system -lboost_iostreams -lboost_program_options -lpthread
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <limits>
+
+#include "libs/spurions.h"
+#include "tlibs/string/string.h"
+#include "tlibs/log/log.h"
+
+#include <boost/program_options.hpp>
+namespace opts = boost::program_options;
+
+
+using t_real = double;
+static const tl::t_length_si<t_real> angs = tl::get_one_angstrom<t_real>();
+static const tl::t_energy_si<t_real> meV = tl::get_one_meV<t_real>();
+static const std::size_t iPrec = 6;
+static const std::size_t iWidth = 12;
+
+
+/**
+ * loads a position list, either with columns "h k l E" (as written by posextract)
+ * or "h k l ki kf"; the "# fixed_ki:" and "# kfix:" header lines override the defaults
+ */
+static bool load_positions(const std::string& strFile, bool bFixedKi, t_real dKFix,
+	std::vector<SpurionPos<t_real>>& vecPos)
+{
+	std::ifstream ifstr(strFile);
+	if(!ifstr)
+	{
+		tl::log_err("Cannot open position file \"", strFile, "\".");
+		return false;
+	}
+
+	std::string strLine;
+	std::size_t iLine = 0;
+	while(std::getline(ifstr, strLine))
+	{
+		++iLine;
+		tl::trim(strLine);
+		if(strLine == "")
+			continue;
+
+		if(strLine[0] == '#')
+		{
+			std::string strKey, strVal;
+			std::tie(strKey, strVal) = tl::split_first<std::string>(strLine.substr(1), std::string(":"), true);
+			if(strKey == "fixed_ki")
+				bFixedKi = tl::str_to_var<int>(strVal) != 0;
+			else if(strKey == "kfix")
+				dKFix = tl::str_to_var<t_real>(strVal);
+			continue;
+		}
+
+		std::vector<t_real> vecCols;
+		tl::get_tokens<t_real, std::string>(strLine, " \t,;", vecCols);
+
+		SpurionPos<t_real> pos;
+		if(vecCols.size() == 4)
+		{
+			pos.h = vecCols[0]; pos.k = vecCols[1]; pos.l = vecCols[2];
+
+			t_real& kFix = bFixedKi ? pos.ki : pos.kf;
+			t_real& kOther = bFixedKi ? pos.kf : pos.ki;
+			kFix = dKFix;
+
+			try
+			{
+				kOther = tl::get_other_k(vecCols[3]*meV, dKFix/angs, bFixedKi) * angs;
+			}
+			catch(const std::exception&)
+			{
+				// energy not reachable with this kfix, reported as kinematic limit
+				kOther = std::numeric_limits<t_real>::quiet_NaN();
+			}
+		}
+		else if(vecCols.size() >= 5)
+		{
+			pos.h = vecCols[0]; pos.k = vecCols[1]; pos.l = vecCols[2];
+			pos.ki = vecCols[3]; pos.kf = vecCols[4];
+		}
+		else
+		{
+			tl::log_err("Invalid position in line ", iLine, " of \"", strFile, "\".");
+			continue;
+		}
+
+		vecPos.push_back(pos);
+	}
+
+	return true;
+}
+
+
+/**
+ * one report line per position
+ */
+static void write_report(std::ostream& ostr, const SpurionPos<t_real>& pos,
+	const SpurionResult<t_real>& res, std::size_t iNr)
+{
+	ostr << std::left << std::setw(8) << iNr << " ";
+	for(t_real d : { pos.h, pos.k, pos.l, res.dE, pos.ki, pos.kf })
+		ostr << std::left << std::setw(iWidth) << d << " ";
+
+	if(res.bReachable)
+	{
+		for(t_real d : { res.dMonoTT, res.dSampleTheta, res.dSampleTT, res.dAnaTT })
+		{
+			t_real dDeg = tl::r2d(d);
+			tl::set_eps_0(dDeg, 1e-6);
+			ostr << std::left << std::setw(iWidth) << dDeg << " ";
+		}
+	}
+	else
+	{
+		for(int i=0; i<4; ++i)
+			ostr << std::left << std::setw(iWidth) << "--" << " ";
+	}
+
+	std::vector<std::string> vecFlags;
+	if(!res.bReachable)
+		vecFlags.push_back("unreachable (" + res.strError + ")");
+
+	if(res.elast.bAType)
+		vecFlags.push_back(std::string("currat-axe A-type (") + (res.elast.bAKfSmallerKi ? "kf<ki" : "kf>ki") + ")");
+	if(res.elast.bMType)
+		vecFlags.push_back(std::string("currat-axe M-type (") + (res.elast.bMKfSmallerKi ? "kf<ki" : "kf>ki") + ")");
+
+	for(const tl::InelasticSpurion<t_real>& spuri : res.vecInelCKI)
+		vecFlags.push_back("higher order, fixed Ei (ana. order " + tl::var_to_str(spuri.iOrderAna) + ")");
+	for(const tl::InelasticSpurion<t_real>& spuri : res.vecInelCKF)
+		vecFlags.push_back("higher order, fixed Ef (mono. order " + tl::var_to_str(spuri.iOrderMono) + ")");
+
+	auto bragg_flag = [](const char* pcName, const std::array<t_real, 3>& hkl, t_real dDist) -> std::string
+	{
+		std::ostringstream ostrFlag;
+		ostrFlag.precision(iPrec);
+		ostrFlag << "elastic " << pcName << " near Bragg peak ("
+			<< std::round(hkl[0]) << " " << std::round(hkl[1]) << " " << std::round(hkl[2])
+			<< "), dQ = " << dDist << " 1/A";
+		return ostrFlag.str();
+	};
+
+	if(res.bBraggKfKi)
+		vecFlags.push_back(bragg_flag("kf'=ki", res.hklElastKfKi, res.dBraggDistKfKi));
+	if(res.bBraggKiKf)
+		vecFlags.push_back(bragg_flag("ki'=kf", res.hklElastKiKf, res.dBraggDistKiKf));
+
+	for(std::size_t iAngle : res.vecDarkAngles)
+		vecFlags.push_back("dark angle " + tl::var_to_str(iAngle+1));
+
+	if(vecFlags.size() == 0)
+		ostr << "ok";
+	for(std::size_t iFlag=0; iFlag<vecFlags.size(); ++iFlag)
+	{
+		if(iFlag > 0)
+			ostr << "; ";
+		ostr << vecFlags[iFlag];
+	}
+	ostr << "\n";
+}
+
+
+int main(int argc, char** argv)
+{
+	std::ios_base::sync_with_stdio(0);
+
+	std::vector<std::string> vecFiles;
+	std::string strTaz, strOut;
+	t_real dKFix = 2.662;
+	bool bFixedKi = false, bAll = false;
+	unsigned int iThreads = std::max(1u, std::thread::hardware_concurrency());
+	SpurionConfig<t_real> cfg;
+
+	opts::options_description args("program options");
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("pos",
+		opts::value<decltype(vecFiles)>(&vecFiles), "position files with columns h k l E or h k l ki kf")));
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("taz",
+		opts::value<decltype(strTaz)>(&strTaz), "takin file with the sample, instrument and dark angles")));
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("out",
+		opts::value<decltype(strOut)>(&strOut), "report file, default: standard output")));
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("kfix",
+		opts::value<decltype(dKFix)>(&dKFix), "fixed wavenumber for h k l E lists")));
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("fixed-ki",
+		opts::bool_switch(&bFixedKi), "ki instead of kf is fixed for h k l E lists")));
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("order",
+		opts::value<decltype(cfg.iMaxOrder)>(&cfg.iMaxOrder), "maximum order for higher-order spurions")));
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("bragg-tol",
+		opts::value<decltype(cfg.dBraggTol)>(&cfg.dBraggTol), "flag elastic positions closer than this to a Bragg peak (1/A)")));
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("threads",
+		opts::value<decltype(iThreads)>(&iThreads), "number of worker threads")));
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("all",
+		opts::bool_switch(&bAll), "also list the positions without problems")));
+
+	opts::positional_options_description args_pos;
+	args_pos.add("pos", -1);
+
+	opts::basic_command_line_parser<char> clparser(argc, argv);
+	clparser.options(args);
+	clparser.positional(args_pos);
+	opts::basic_parsed_options<char> parsedopts = clparser.run();
+
+	opts::variables_map opts_map;
+	opts::store(parsedopts, opts_map);
+	opts::notify(opts_map);
+
+	if(vecFiles.size() == 0 || strTaz == "")
+	{
+		std::cerr << "Please give a takin file and some position files.\n" << args << std::endl;
+		return -1;
+	}
+
+
+	// sample and instrument configuration
+	{
+		const unsigned int iMaxOrder = cfg.iMaxOrder;
+		const t_real dBraggTol = cfg.dBraggTol;
+
+		tl::Prop<std::string> xml;
+		if(!xml.Load(strTaz.c_str(), tl::PropType::XML) || !cfg.Load(xml))
+		{
+			tl::log_err("Cannot load takin file \"", strTaz, "\".");
+			return -1;
+		}
+
+		cfg.iMaxOrder = iMaxOrder;
+		cfg.dBraggTol = dBraggTol;
+	}
+
+
+	// positions
+	std::vector<SpurionPos<t_real>> vecPos;
+	for(const std::string& strFile : vecFiles)
+		load_positions(strFile, bFixedKi, dKFix, vecPos);
+
+	tl::log_info("Checking ", vecPos.size(), " positions using ", iThreads, " thread(s).");
+	std::vector<SpurionResult<t_real>> vecRes = check_spurions<t_real>(cfg, vecPos, iThreads);
+
+
+	// report
+	std::ostream *pOstr = &std::cout;
+	std::ofstream ofstr;
+	if(strOut != "")
+	{
+		ofstr.open(strOut);
+		if(ofstr.is_open())
+			pOstr = &ofstr;
+		else
+			tl::log_err("Cannot open output file \"", strOut, "\", using standard output.");
+	}
+
+	std::ostream& ostr = *pOstr;
+	ostr.precision(iPrec);
+
+	ostr << "# " << std::left << std::setw(6) << "No." << " ";
+	for(const char* pcCol : { "h", "k", "l", "E (meV)", "ki (1/A)", "kf (1/A)",
+		"2th_m (deg)", "th_s (deg)", "2th_s (deg)", "2th_a (deg)" })
+		ostr << std::left << std::setw(iWidth) << pcCol << " ";
+	ostr << "findings\n";
+
+	std::size_t iUnreachable = 0, iSpurions = 0, iDark = 0;
+	for(std::size_t iPos=0; iPos<vecPos.size(); ++iPos)
+	{
+		const SpurionResult<t_real>& res = vecRes[iPos];
+		if(!res.bReachable) ++iUnreachable;
+		if(res.HasSpurions()) ++iSpurions;
+		if(res.vecDarkAngles.size()) ++iDark;
+
+		if(bAll || !res.IsOk())
+			write_report(ostr, vecPos[iPos], res, iPos+1);
+	}
+
+	ostr << "#\n";
+	ostr << "# positions checked: " << vecPos.size() << "\n";
+	ostr << "# unreachable: " << iUnreachable << "\n";
+	ostr << "# with spurions: " << iSpurions << "\n";
+	ostr << "# in dark angles: " << iDark << "\n";
+	ostr.flush();
+
+	return 0;
+}
@@ -0,0 +1,197 @@
+/**
+ * converts S(Q, E) text tables to binary k-d files for the monteconvo modules
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2
+ *
+ * g++ -std=c++14 -O2 -I../.. -o sqwtab2bin sqwtab2bin.cpp ../../tlibs/log/log.cpp -DTLIBS_INC_HDR_IMPLS -lboost_iostreams -lboost_system -lboost_program_options
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+
+#include "tlibs/math/kd.h"
+#include "tlibs/file/kdbin.h"
+#include "tlibs/file/loaddat.h"
+#include "tlibs/string/string.h"
+#include "tlibs/log/log.h"
+
+#include <list>
+#include <vector>
+#include <fstream>
+#include <iostream>
+
+#include <boost/program_options.hpp>
+namespace opts = boost::program_options;
+
+using t_real = double;
+using t_map = tl::KdFlat<t_real>::t_map;
+
+
+/**
+ * h,k,l,E,S table as read by the SqwKdTree module
+ */
+static bool load_hklE(const std::string& strIn, tl::Kd<t_real>& kd, t_map& mapParams)
+{
+	std::ifstream ifstr(strIn);
+	if(!ifstr)
+	{
+		tl::log_err("Cannot open \"", strIn, "\".");
+		return false;
+	}
+
+	std::list<std::vector<t_real>> lstPoints;
+	std::string strLine;
+	while(std::getline(ifstr, strLine))
+	{
+		tl::trim(strLine);
+		if(strLine.length() == 0)
+			continue;
+
+		if(strLine[0] == '#')
+		{
+			strLine[0] = ' ';
+			mapParams.insert(tl::split_first(strLine, std::string(":"), 1));
+			continue;
+		}
+
+		std::vector<t_real> vecSqw;
+		tl::get_tokens<t_real>(strLine, std::string(" \t"), vecSqw);
+		if(vecSqw.size() != 5)
+		{
+			tl::log_err("Need h,k,l,E,S data.");
+			return false;
+		}
+
+		lstPoints.emplace_back(std::move(vecSqw));
+	}
+
+	tl::log_info("Loaded ", lstPoints.size(), " S(Q, E) points.");
+	kd.Load(lstPoints, 4);
+	return true;
+}
+
+
+/**
+ * q,E,S columns as read by the SqwTable1d module
+ */
+static bool load_qE(const std::string& strIn, tl::Kd<t_real>& kd, t_map& mapParams,
+	unsigned int iqCol, unsigned int iECol, unsigned int iSCol)
+{
+	tl::DatFile<t_real> dat;
+	if(!dat.Load(strIn))
+	{
+		tl::log_err("Cannot load \"", strIn, "\".");
+		return false;
+	}
+
+	if(std::max(std::max(iqCol, iECol), iSCol) >= dat.GetColumnCount())
+	{
+		tl::log_err("Invalid column index.");
+		return false;
+	}
+
+	std::list<std::vector<t_real>> lstPoints;
+	for(std::size_t iRow=0; iRow<dat.GetRowCount(); ++iRow)
+	{
+		lstPoints.emplace_back(std::vector<t_real>{{
+			dat.GetColumn(iqCol)[iRow],
+			dat.GetColumn(iECol)[iRow],
+			dat.GetColumn(iSCol)[iRow] }});
+	}
+
+	for(const auto& pair : dat.GetHeader())
+		mapParams.insert(pair);
+
+	tl::log_info("Loaded ", lstPoints.size(), " S(Q, E) points.");
+	kd.Load(lstPoints, 2);
+	return true;
+}
+
+
+int main(int argc, char** argv)
+{
+	std::string strIn, strOut;
+	bool b1d = 0;
+	unsigned int iqCol = 0, iECol = 1, iSCol = 2;
+
+	opts::options_description args("program options");
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("in-file",
+		opts::value<decltype(strIn)>(&strIn), "input text table")));
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("out-file",
+		opts::value<decltype(strOut)>(&strOut), "output k-d file")));
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("table1d",
+		opts::bool_switch(&b1d),
+		"input is a q,E,S table for the 1d module instead of h,k,l,E,S")));
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("q-column",
+		opts::value<decltype(iqCol)>(&iqCol), "q column index for --table1d")));
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("E-column",
+		opts::value<decltype(iECol)>(&iECol), "E column index for --table1d")));
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("S-column",
+		opts::value<decltype(iSCol)>(&iSCol), "S column index for --table1d")));
+
+	opts::positional_options_description args_pos;
+	args_pos.add("in-file", 1);
+	args_pos.add("out-file", 1);
+
+	opts::basic_command_line_parser<char> clparser(argc, argv);
+	clparser.options(args);
+	clparser.positional(args_pos);
+	opts::basic_parsed_options<char> parsedopts = clparser.run();
+
+	opts::variables_map opts_map;
+	opts::store(parsedopts, opts_map);
+	opts::notify(opts_map);
+
+	if(strIn == "" || strOut == "")
+	{
+		std::cerr << "Usage: " << argv[0] << " [options] <in-file> <out-file>\n"
+			<< args << std::endl;
+		return -1;
+	}
+
+
+	tl::Kd<t_real> kd;
+	t_map mapParams;
+
+	bool bLoaded = b1d ? load_qE(strIn, kd, mapParams, iqCol, iECol, iSCol)
+		: load_hklE(strIn, kd, mapParams);
+	if(!bLoaded)
+		return -1;
+	tl::log_info("Generated k-d tree.");
+
+	tl::KdFlat<t_real> kdflat;
+	if(!kdflat.FromTree(kd, &mapParams) || !kdflat.Save(strOut))
+	{
+		tl::log_err("Cannot write \"", strOut, "\".");
+		return -1;
+	}
+
+	tl::log_info("Wrote ", kdflat.GetNodeCount(), " nodes to \"", strOut, "\".");
+	return 0;
+}
@@ -1,14 +1,14 @@
 /**
  * convert tof files to images
  * @author Tobias Weber <tweber@ill.fr>
- * @date 15/nov/2021
+ * @date 15/nov/2021, oct-2026
  * @license GPLv2
  *
- * g++ -o tof tof.cpp -lboost_system -lboost_filesystem -lboost_iostreams -lpng
+ * g++ -std=c++14 -O2 -I../.. -o tof tof.cpp -lboost_system -lboost_filesystem -lboost_iostreams -lboost_program_options -lpng -lpthread
  *
  * ----------------------------------------------------------------------------
  * Takin (inelastic neutron scattering software package)
- * Copyright (C) 2017-2021  Tobias WEBER (Institut Laue-Langevin (ILL),
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
  *                          Grenoble, France).
  * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
  *                          (TUM), Garching, Germany).
@@ -32,6 +32,11 @@
 #include <sstream>
 #include <fstream>
 #include <string>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cctype>
+#include <cstdint>
 
 #include <boost/filesystem/path.hpp>
 #include <boost/filesystem/operations.hpp>
@@ -45,95 +50,267 @@ namespace ios = boost::iostreams;
 #include <boost/gil/extension/io/png.hpp>
 namespace gil = boost::gil;
 
+#include <boost/program_options.hpp>
+namespace opts = boost::program_options;
 
-#define PSD_WIDTH  128
-#define PSD_HEIGHT 128
-#define TOF_COUNT  128
+#include "tlibs/helper/thread.h"
 
 
-bool convert_tof(const fs::path& tof_file, const fs::path& out_file)
+// tof file data type for counts
+using t_data = std::uint32_t;
+using t_sum = std::uint64_t;
+
+
+/**
+ * detector geometry, default values are used
+ * if neither the command line nor the file trailer give them
+ */
+struct TofGeo
+{
+	unsigned width = 128;
+	unsigned height = 128;
+	unsigned channels = 128;
+};
+
+
+struct TofOpts
 {
-	// tof file data type for counts
-	using t_data = std::uint32_t;
+	// geometry given on the command line, 0: from file
+	TofGeo geo{0, 0, 0};
+
+	// number of tof channels combined in the projections
+	unsigned tbin = 1;
+
+	bool write_channels = true;
+	bool write_projections = true;
 
-	// total image, summing over all channels
-	gil::gray16_image_t total_png(PSD_WIDTH, PSD_HEIGHT);
-	auto total_view = gil::view(total_png);
+	// stretch summed images to the 16 bit range instead of clipping
+	bool scale = false;
+};
 
-	for(unsigned t=0; t<TOF_COUNT; ++t)
+
+/**
+ * the meta information at the end of the file is text,
+ * search backwards for the beginning of the printable block
+ */
+static std::size_t find_trailer(const char* data, std::size_t size)
+{
+	std::size_t pos = size;
+	while(pos > 0)
 	{
-		std::ostringstream ostr_file;
-		ostr_file << out_file.string() << "_" << t << ".png";
-		std::string png_file = ostr_file.str();
+		unsigned char c = static_cast<unsigned char>(data[pos-1]);
+		if(!std::isprint(c) && !std::isspace(c))
+			break;
+		--pos;
+	}
 
-		ios::mapped_file_source file(tof_file,
-			PSD_WIDTH*PSD_HEIGHT*sizeof(t_data),
-			t*PSD_WIDTH*PSD_HEIGHT*sizeof(t_data));
+	// the count data consists of whole words
+	pos = (pos + sizeof(t_data) - 1) / sizeof(t_data) * sizeof(t_data);
+	return std::min(pos, size);
+}
 
-		if(!file.is_open())
-			return false;
 
-		const t_data* data = reinterpret_cast<const t_data*>(file.data());
+/**
+ * look for the detector dimensions in "key: value" or "key = value" lines
+ */
+static void parse_trailer_geo(const std::string& trailer, TofGeo& geo)
+{
+	std::istringstream istr(trailer);
+	std::string line;
 
-		// image of a tof channel
-		gil::gray16_image_t png(PSD_WIDTH, PSD_HEIGHT);
-		auto view = gil::view(png);
+	while(std::getline(istr, line))
+	{
+		std::size_t sep = line.find_first_of(":=");
+		if(sep == std::string::npos)
+			continue;
 
-		std::uint64_t counts = 0;
-		for(unsigned y=0; y<PSD_HEIGHT; ++y)
-		{
-			auto row = view.row_begin(y);
-			auto total_row = total_view.row_begin(y);
+		std::string key = line.substr(0, sep);
+		std::transform(key.begin(), key.end(), key.begin(),
+			[](unsigned char c) -> char { return std::tolower(c); });
+		key.erase(std::remove_if(key.begin(), key.end(),
+			[](unsigned char c) -> bool { return std::isspace(c) || c == '_'; }), key.end());
 
-			for(unsigned x=0; x<PSD_WIDTH; ++x)
-			{
-				t_data cnt = data[y*PSD_WIDTH + x];
+		unsigned val = 0;
+		std::istringstream(line.substr(sep+1)) >> val;
+		if(val == 0)
+			continue;
 
-				*(row + x) = cnt;
+		if(key == "width" || key == "psdwidth" || key == "xsize" || key == "xpixels")
+			geo.width = val;
+		else if(key == "height" || key == "psdheight" || key == "ysize" || key == "ypixels")
+			geo.height = val;
+		else if(key == "channels" || key == "tofchannels" || key == "timechannels" || key == "tofcount")
+			geo.channels = val;
+	}
+}
 
-				if(t == 0)
-					*(total_row + x) = cnt;
-				else
-					*(total_row + x) = *(total_row + x) + cnt;
 
-				counts += cnt;
-				//std::cout << std::hex << cnt << " ";
-			}
-			//std::cout << std::endl;
-		}
+static void write_summed(const std::string& file, const std::vector<t_sum>& data,
+	unsigned w, unsigned h, bool scale)
+{
+	gil::gray16_image_t png(w, h);
+	auto view = gil::view(png);
 
-		file.close();
+	t_sum max = 0;
+	if(scale)
+		max = *std::max_element(data.begin(), data.end());
 
-		if(counts)
+	const t_sum max16 = std::numeric_limits<std::uint16_t>::max();
+	for(unsigned y=0; y<h; ++y)
+	{
+		auto row = view.row_begin(y);
+		for(unsigned x=0; x<w; ++x)
 		{
-			//std::cout << "Channel " << t << ": " << std::dec << counts << std::endl;
-			// write channel image
-			gil::write_view(png_file, view, gil::png_tag());
+			t_sum val = data[y*w + x];
+			if(scale && max > max16)
+				val = val * max16 / max;
+			*(row + x) = std::uint16_t(std::min(val, max16));
 		}
 	}
 
-	// write total image
-	std::string total_png_file = out_file.string() + ".png";
-	gil::write_view(total_png_file, total_view, gil::png_tag());
+	gil::write_view(file, view, gil::png_tag());
+}
+
+
+/**
+ * convert a single tof file, using iThreads threads for the channels
+ */
+static bool convert_tof(const fs::path& tof_file, const fs::path& out_file,
+	const TofOpts& opts, unsigned iThreads)
+{
+	// map the whole file once
+	ios::mapped_file_source file(tof_file);
+	if(!file.is_open())
+		return false;
+
+	const char* raw = file.data();
+	const std::size_t size = file.size();
 
 	// meta information at the end of the file
-	std::size_t size = fs::file_size(tof_file);
-	std::ptrdiff_t size_rest = size - PSD_WIDTH*PSD_HEIGHT*TOF_COUNT*sizeof(t_data);
-	if(size_rest > 0)
+	std::size_t trailer_pos = find_trailer(raw, size);
+	std::string trailer(raw + trailer_pos, size - trailer_pos);
+
+	TofGeo geo;
+	parse_trailer_geo(trailer, geo);
+	if(opts.geo.width) geo.width = opts.geo.width;
+	if(opts.geo.height) geo.height = opts.geo.height;
+	if(opts.geo.channels) geo.channels = opts.geo.channels;
+
+	const std::size_t img_size = std::size_t(geo.width) * geo.height;
+	const std::size_t data_size = img_size * geo.channels * sizeof(t_data);
+	if(!img_size || data_size > size)
 	{
-		ios::mapped_file_source file(tof_file,
-			size_rest,
-			PSD_WIDTH*PSD_HEIGHT*TOF_COUNT*sizeof(t_data));
+		std::cerr << "File \"" << tof_file.string() << "\" is too small for "
+			<< geo.width << "x" << geo.height << "x" << geo.channels << " counts." << std::endl;
+		return false;
+	}
+
+	// the trailer starts directly after the counts
+	trailer.assign(raw + data_size, size - data_size);
+	const t_data* data = reinterpret_cast<const t_data*>(raw);
+
+	const unsigned tbin = std::max(opts.tbin, 1u);
+	const unsigned tbins = (geo.channels + tbin - 1) / tbin;
+
+	// per-channel partial sums, combined after all channels are done
+	std::vector<t_sum> total(img_size, 0);
+	std::vector<t_sum> proj_xt(std::size_t(geo.width) * tbins, 0);
+	std::vector<t_sum> proj_yt(std::size_t(geo.height) * tbins, 0);
+	std::mutex mtx;
 
-		if(file.is_open())
+	auto conv_channels = [&](unsigned t_start, unsigned t_end) -> void
+	{
+		std::vector<t_sum> total_part(img_size, 0);
+
+		for(unsigned t=t_start; t<t_end; ++t)
 		{
-			const char* data = reinterpret_cast<const char*>(file.data());
+			const t_data* chan = data + t*img_size;
+			const unsigned tb = t / tbin;
+
+			// image of a tof channel
+			gil::gray16_image_t png(geo.width, geo.height);
+			auto view = gil::view(png);
+
+			std::vector<t_sum> xt(geo.width, 0), yt(geo.height, 0);
+
+			t_sum counts = 0;
+			for(unsigned y=0; y<geo.height; ++y)
+			{
+				auto row = view.row_begin(y);
+
+				for(unsigned x=0; x<geo.width; ++x)
+				{
+					t_data cnt = chan[y*geo.width + x];
+
+					*(row + x) = std::uint16_t(std::min<t_data>(cnt, std::numeric_limits<std::uint16_t>::max()));
+					total_part[y*geo.width + x] += cnt;
+					xt[x] += cnt;
+					yt[y] += cnt;
+					counts += cnt;
+				}
+			}
 
-			std::string txt_file = out_file.string() + ".txt";
-			std::ofstream ofstr_txt(txt_file);
+			{
+				std::lock_guard<std::mutex> lock(mtx);
+				for(unsigned x=0; x<geo.width; ++x)
+					proj_xt[tb*geo.width + x] += xt[x];
+				for(unsigned y=0; y<geo.height; ++y)
+					proj_yt[tb*geo.height + y] += yt[y];
+			}
 
-			ofstr_txt.write(data, size_rest);
+			if(counts && opts.write_channels)
+			{
+				// write channel image
+				std::ostringstream ostr_file;
+				ostr_file << out_file.string() << "_" << t << ".png";
+				gil::write_view(ostr_file.str(), view, gil::png_tag());
+			}
 		}
+
+		std::lock_guard<std::mutex> lock(mtx);
+		for(std::size_t i=0; i<img_size; ++i)
+			total[i] += total_part[i];
+	};
+
+	iThreads = std::max(1u, std::min(iThreads, geo.channels));
+	if(iThreads == 1)
+	{
+		conv_channels(0, geo.channels);
+	}
+	else
+	{
+		tl::ThreadPool<void()> tp(iThreads);
+		const unsigned chunk = (geo.channels + iThreads - 1) / iThreads;
+		for(unsigned t=0; t<geo.channels; t+=chunk)
+		{
+			unsigned t_end = std::min(t+chunk, geo.channels);
+			tp.AddTask([&conv_channels, t, t_end]() { conv_channels(t, t_end); });
+		}
+
+		tp.Start();
+		for(auto& fut : tp.GetResults())
+			fut.get();
+	}
+
+	// write total image, summing over all channels
+	write_summed(out_file.string() + ".png", total,
+		geo.width, geo.height, opts.scale);
+
+	// write projections, tof channel along the vertical axis
+	if(opts.write_projections)
+	{
+		write_summed(out_file.string() + "_xt.png", proj_xt,
+			geo.width, tbins, opts.scale);
+		write_summed(out_file.string() + "_yt.png", proj_yt,
+			geo.height, tbins, opts.scale);
+	}
+
+	if(trailer.size())
+	{
+		std::string txt_file = out_file.string() + ".txt";
+		std::ofstream ofstr_txt(txt_file);
+
+		ofstr_txt.write(trailer.data(), trailer.size());
 	}
 
 	return true;
@@ -142,31 +319,153 @@ bool convert_tof(const fs::path& tof_file, const fs::path& out_file)
 
 int main(int argc, char** argv)
 {
-	if(argc < 2)
+	std::vector<std::string> vecFiles;
+	std::string strOutDir;
+	std::string strExt = ".tof";
+	unsigned iThreads = std::max(1u, std::thread::hardware_concurrency());
+	bool bNoChannels = false, bNoProj = false;
+	TofOpts tofopts;
+
+	opts::options_description args("program options");
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("file",
+		opts::value<decltype(vecFiles)>(&vecFiles), "tof files or directories")));
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("out-dir",
+		opts::value<decltype(strOutDir)>(&strOutDir), "output directory, default: next to the input files")));
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("ext",
+		opts::value<decltype(strExt)>(&strExt), "file extension to look for in directories")));
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("threads",
+		opts::value<decltype(iThreads)>(&iThreads), "number of worker threads")));
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("width",
+		opts::value<decltype(tofopts.geo.width)>(&tofopts.geo.width), "detector width, default: from file or 128")));
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("height",
+		opts::value<decltype(tofopts.geo.height)>(&tofopts.geo.height), "detector height, default: from file or 128")));
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("channels",
+		opts::value<decltype(tofopts.geo.channels)>(&tofopts.geo.channels), "tof channels, default: from file or 128")));
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("tbin",
+		opts::value<decltype(tofopts.tbin)>(&tofopts.tbin), "tof channels per bin in the projections")));
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("scale",
+		opts::bool_switch(&tofopts.scale), "scale summed images to 16 bits instead of clipping")));
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("no-channels",
+		opts::bool_switch(&bNoChannels), "do not write the individual channel images")));
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("no-projections",
+		opts::bool_switch(&bNoProj), "do not write the x-t and y-t projections")));
+
+	opts::positional_options_description args_pos;
+	args_pos.add("file", -1);
+
+	opts::basic_command_line_parser<char> clparser(argc, argv);
+	clparser.options(args);
+	clparser.positional(args_pos);
+	opts::basic_parsed_options<char> parsedopts = clparser.run();
+
+	opts::variables_map opts_map;
+	opts::store(parsedopts, opts_map);
+	opts::notify(opts_map);
+
+	tofopts.write_channels = !bNoChannels;
+	tofopts.write_projections = !bNoProj;
+
+	if(vecFiles.size() == 0)
 	{
-		std::cerr << "Please give some TOF files." << std::endl;
+		std::cerr << "Please give some TOF files or directories.\n" << args << std::endl;
 		return -1;
 	}
 
-	for(int i=1; i<argc; ++i)
+
+	// collect input files, directories are scanned non-recursively
+	std::vector<fs::path> files;
+	for(const std::string& strFile : vecFiles)
 	{
-		fs::path file(argv[i]);
+		fs::path file(strFile);
 
 		if(!fs::exists(file))
 		{
-			std::cerr << "File \"" << argv[i] << "\" does not exist!" << std::endl;
+			std::cerr << "File \"" << strFile << "\" does not exist!" << std::endl;
 			continue;
 		}
 
+		if(fs::is_directory(file))
+		{
+			std::vector<fs::path> dir_files;
+			for(fs::directory_iterator iter(file); iter != fs::directory_iterator(); ++iter)
+			{
+				if(fs::is_regular_file(iter->path()) && iter->path().extension().string() == strExt)
+					dir_files.push_back(iter->path());
+			}
 
+			std::sort(dir_files.begin(), dir_files.end());
+			files.insert(files.end(), dir_files.begin(), dir_files.end());
+		}
+		else
+		{
+			files.push_back(file);
+		}
+	}
+
+	if(strOutDir != "" && !fs::exists(strOutDir))
+		fs::create_directories(strOutDir);
+
+	std::mutex mtxOut;
+	auto conv_file = [&](const fs::path& file, unsigned iChannelThreads) -> bool
+	{
 		fs::path file_out = file;
 		file_out.replace_extension("");
+		if(strOutDir != "")
+			file_out = fs::path(strOutDir) / file_out.filename();
 
-		if(convert_tof(file, file_out))
-			std::cout << "Converted file \"" << argv[i] << "\"." << std::endl;
+		bool ok = false;
+		try
+		{
+			ok = convert_tof(file, file_out, tofopts, iChannelThreads);
+		}
+		catch(const std::exception& ex)
+		{
+			std::lock_guard<std::mutex> lock(mtxOut);
+			std::cerr << "Error: " << ex.what() << std::endl;
+		}
+
+		std::lock_guard<std::mutex> lock(mtxOut);
+		if(ok)
+			std::cout << "Converted file \"" << file.string() << "\"." << std::endl;
 		else
-			std::cerr << "Failed to convert file \"" << argv[i] << "\"." << std::endl;
+			std::cerr << "Failed to convert file \"" << file.string() << "\"." << std::endl;
+		return ok;
+	};
+
+
+	iThreads = std::max(iThreads, 1u);
+	std::size_t iFailed = 0;
+
+	if(files.size() == 1 || iThreads == 1)
+	{
+		// few files: parallelise over the channels
+		for(const fs::path& file : files)
+			iFailed += !conv_file(file, iThreads);
+	}
+	else
+	{
+		// batch mode: one file per worker
+		tl::ThreadPool<bool()> tp(iThreads);
+		for(const fs::path& file : files)
+			tp.AddTask([&conv_file, file]() -> bool { return conv_file(file, 1); });
+
+		tp.Start();
+		for(auto& fut : tp.GetResults())
+			iFailed += !fut.get();
 	}
 
-	return 0;
+	if(files.size() > 1)
+		std::cout << "Converted " << files.size()-iFailed << " of " << files.size() << " files." << std::endl;
+	return iFailed ? -1 : 0;
 }
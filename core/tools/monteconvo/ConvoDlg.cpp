@@ -322,6 +322,14 @@ ConvoDlg::ConvoDlg(QWidget* pParent, QSettings* pSett)
 	QAction *pActionDisp = new QAction("Plot Dispersion", this);
 	pMenuConvoActions->addAction(pActionDisp);
 
+	pMenuConvoActions->addSeparator();
+
+	m_pSqwCache = new QAction("Cache S(Q, E) Dispersion", this);
+	m_pSqwCache->setToolTip("Tabulate the dispersion of the S(Q, E) model and keep it for later runs.");
+	m_pSqwCache->setCheckable(true);
+	m_pSqwCache->setChecked(false);
+	pMenuConvoActions->addAction(m_pSqwCache);
+
 
 	// results menu
 	QMenu *pMenuPlots = new QMenu("Results", this);
@@ -384,6 +392,20 @@ ConvoDlg::ConvoDlg(QWidget* pParent, QSettings* pSett)
 	connect(pActionStart, &QAction::triggered, this, &ConvoDlg::Start);
 	connect(pActionStartFit, &QAction::triggered, this, &ConvoDlg::StartFit);
 	connect(pActionDisp, &QAction::triggered, this, &ConvoDlg::StartDisp);
+	connect(m_pSqwCache, &QAction::toggled, [this]()
+	{
+		// re-create the model, keeping its parameters
+		std::vector<SqwBase::t_var> vecVars;
+		if(m_pSqw)
+			vecVars = m_pSqw->GetVars();
+
+		createSqwModel(editSqw->text());
+		if(m_pSqw && vecVars.size())
+		{
+			m_pSqw->SetVars(vecVars);
+			emit SqwLoaded(m_pSqw->GetVars(), &m_pSqw->GetFitVars());
+		}
+	});
 	connect(pExportPlot, &QAction::triggered, m_plotwrap.get(), &QwtPlotWrapper::SavePlot);
 	connect(pExportPlot2d, &QAction::triggered, m_plotwrap2d.get(), &QwtPlotWrapper::SavePlot);
 	connect(pExportPlotGpl, &QAction::triggered, m_plotwrap.get(), &QwtPlotWrapper::ExportGpl);
@@ -557,7 +579,7 @@ void ConvoDlg::createSqwModel(const QString& qstrFile)
 	}
 
 	m_pSqw.reset();
-	m_pSqw = construct_sqw(strSqwIdent, strSqwFile);
+	m_pSqw = construct_sqw(strSqwIdent, strSqwFile, m_pSqwCache && m_pSqwCache->isChecked());
 	if(!m_pSqw)
 	{
 		QMessageBox::critical(this, "Error", "Unknown S(Q,E) model selected.");
@@ -107,6 +107,7 @@ protected:
 		m_vecComboNames, m_vecCheckNames;
 
 	QAction *m_pLiveResults = nullptr, *m_pLivePlots = nullptr;
+	QAction *m_pSqwCache = nullptr;
 
 	// recent files
 	QMenu *m_pMenuRecent = nullptr;
@@ -359,16 +359,13 @@ void ConvoDlg::StartSim1D(bool bForceDeferred, unsigned int seed)
 						tl::init_rand_seed(seed, false);
 					Ellipsoid4d<t_real> elli = localreso.GenerateMC_deferred(iNumNeutrons, vecNeutrons);
 
-					for(const ublas::vector<t_real>& vecHKLE : vecNeutrons)
-					{
-						if(this->StopRequested())
-							return std::make_pair(false, 0.);
-
-						dS += (*m_pSqw)(vecHKLE[0], vecHKLE[1], vecHKLE[2], vecHKLE[3]);
+					if(this->StopRequested())
+						return std::make_pair(false, 0.);
 
-						for(int i = 0; i < 4; ++i)
-							dhklE_mean[i] += vecHKLE[i];
-					}
+					dS += sqw_sum(*m_pSqw, vecNeutrons, dhklE_mean,
+						[this]() -> bool { return this->StopRequested(); });
+					if(this->StopRequested())
+						return std::make_pair(false, 0.);
 
 					// normalise to mc neutron count
 					dS /= t_real(iNumNeutrons*iNumSampleSteps);
@@ -908,16 +905,13 @@ void ConvoDlg::StartSim2D(bool bForceDeferred, unsigned int seed)
 						tl::init_rand_seed(seed, false);
 					Ellipsoid4d<t_real> elli = localreso.GenerateMC_deferred(iNumNeutrons, vecNeutrons);
 
-					for(const ublas::vector<t_real>& vecHKLE : vecNeutrons)
-					{
-						if(this->StopRequested())
-							return std::make_pair(false, 0.);
-
-						dS += (*m_pSqw)(vecHKLE[0], vecHKLE[1], vecHKLE[2], vecHKLE[3]);
+					if(this->StopRequested())
+						return std::make_pair(false, 0.);
 
-						for(int i = 0; i < 4; ++i)
-							dhklE_mean[i] += vecHKLE[i];
-					}
+					dS += sqw_sum(*m_pSqw, vecNeutrons, dhklE_mean,
+						[this]() -> bool { return this->StopRequested(); });
+					if(this->StopRequested())
+						return std::make_pair(false, 0.);
 
 					// normalise to mc neutron count
 					dS /= t_real(iNumNeutrons*iNumSampleSteps);
@@ -33,7 +33,7 @@
 #include "tlibs/math/linalg.h"
 #include "tlibs/phys/neutrons.h"
 #include <fstream>
-#include <list>
+#include <algorithm>
 
 using t_real = t_real_reso;
 
@@ -62,45 +62,155 @@ SqwElast::SqwElast(const char* pcFile) : m_bLoadedFromFile(true)
 		AddPeak(h,k,l, dSigQ, dSigE, dS);
 	}
 
-	tl::log_info("Number of elastic peaks: ", m_lstPeaks.size());
+	BuildIndex();
+
+	tl::log_info("Number of elastic peaks: ", m_vecPeaks.size(),
+		", index cells: ", m_mapCells.size(), ".");
 	SqwBase::m_bOk = true;
 }
 
+
+/**
+ * adds a peak, BuildIndex() has to be called afterwards
+ */
 void SqwElast::AddPeak(t_real h, t_real k, t_real l, t_real dSigQ, t_real dSigE, t_real dS)
 {
 	ElastPeak pk;
 	pk.h = h; pk.k = k; pk.l = l;
 	pk.dSigQ = dSigQ; pk.dSigE = dSigE;
 	pk.dS = dS;
-	m_lstPeaks.push_back(std::move(pk));
+	m_vecPeaks.push_back(std::move(pk));
+
+	m_bIndexValid = false;
 }
 
-t_real SqwElast::operator()(t_real dh, t_real dk, t_real dl, t_real dE) const
+
+long SqwElast::GetCellIdx(t_real dCoord) const
+{
+	return long(std::floor(dCoord / m_dCellSize));
+}
+
+
+/**
+ * packs the cell indices into 21 bits each,
+ * far-away cells may alias, which only costs some extra distance checks
+ */
+std::uint64_t SqwElast::GetCellKey(long iH, long iK, long iL) const
+{
+	const std::uint64_t iMask = (std::uint64_t(1) << 21) - 1;
+	const long iOffs = long(1) << 20;
+
+	return ((std::uint64_t(iH + iOffs) & iMask) << 42) |
+		((std::uint64_t(iK + iOffs) & iMask) << 21) |
+		(std::uint64_t(iL + iOffs) & iMask);
+}
+
+
+/**
+ * sorts the peaks by hkl grid cell, the cell size is the largest cutoff radius,
+ * so all peaks contributing at a point lie in its 27 neighbouring cells
+ */
+void SqwElast::BuildIndex()
+{
+	m_mapCells.clear();
+	m_bIndexValid = false;
+
+	if(m_vecPeaks.size() == 0 || m_dCutoff <= t_real(0) || m_dCutoff >= t_real(1))
+		return;
+
+	m_dCutoffFact2 = t_real(-2) * std::log(m_dCutoff);
+	const t_real dCutoffFact = std::sqrt(m_dCutoffFact2);
+	t_real dMaxRadius = 0.;
+	for(const ElastPeak& pk : m_vecPeaks)
+		dMaxRadius = std::max(dMaxRadius, std::abs(pk.dSigQ) * dCutoffFact);
+	if(dMaxRadius <= t_real(0))
+		return;
+	m_dCellSize = dMaxRadius;
+
+	std::vector<std::pair<std::uint64_t, std::size_t>> vecKeys;
+	vecKeys.reserve(m_vecPeaks.size());
+	for(std::size_t iPk=0; iPk<m_vecPeaks.size(); ++iPk)
+	{
+		const ElastPeak& pk = m_vecPeaks[iPk];
+		vecKeys.emplace_back(GetCellKey(GetCellIdx(pk.h), GetCellIdx(pk.k), GetCellIdx(pk.l)), iPk);
+	}
+	std::stable_sort(vecKeys.begin(), vecKeys.end(),
+		[](const std::pair<std::uint64_t, std::size_t>& key1,
+			const std::pair<std::uint64_t, std::size_t>& key2) -> bool
+		{ return key1.first < key2.first; });
+
+	std::vector<ElastPeak> vecSorted;
+	vecSorted.reserve(m_vecPeaks.size());
+	for(std::size_t iPk=0; iPk<vecKeys.size(); ++iPk)
+	{
+		vecSorted.push_back(m_vecPeaks[vecKeys[iPk].second]);
+
+		if(iPk==0 || vecKeys[iPk].first != vecKeys[iPk-1].first)
+			m_mapCells[vecKeys[iPk].first] = std::make_pair(iPk, iPk+1);
+		else
+			++m_mapCells[vecKeys[iPk].first].second;
+	}
+	m_vecPeaks = std::move(vecSorted);
+
+	m_bIndexValid = true;
+}
+
+
+/**
+ * contribution of a single peak, zero outside its cutoff radius
+ */
+t_real SqwElast::PeakContrib(const ElastPeak& pk, t_real dh, t_real dk, t_real dl, t_real dE) const
 {
-	const ublas::vector<t_real> vecCur = tl::make_vec({dh, dk, dl});
+	const t_real dDistQ2 = (pk.h-dh)*(pk.h-dh) + (pk.k-dk)*(pk.k-dk) + (pk.l-dl)*(pk.l-dl);
+
+	if(m_bIndexValid)
+	{
+		if(dDistQ2 > pk.dSigQ*pk.dSigQ*m_dCutoffFact2 || dE*dE > pk.dSigE*pk.dSigE*m_dCutoffFact2)
+			return t_real(0);
+	}
+
+	return pk.dS * tl::gauss_model<t_real>(std::sqrt(dDistQ2), 0., pk.dSigQ, 1., 0.) *
+		tl::gauss_model<t_real>(dE, 0., pk.dSigE, 1., 0.);
+}
+
 
+t_real SqwElast::operator()(t_real dh, t_real dk, t_real dl, t_real dE) const
+{
 	if(!m_bLoadedFromFile)	// use nearest integer bragg peak
 	{
-		const ublas::vector<t_real> vecPt = tl::make_vec({std::round(dh), std::round(dk), std::round(dl)});
+		const t_real dDH = std::round(dh) - dh;
+		const t_real dDK = std::round(dk) - dk;
+		const t_real dDL = std::round(dl) - dl;
 
-		const t_real dDistQ = ublas::norm_2(vecPt-vecCur);
+		const t_real dDistQ = std::sqrt(dDH*dDH + dDK*dDK + dDL*dDL);
 		const t_real dSigmaQ = 0.02;
 		const t_real dSigmaE = 0.02;
 
 		return tl::gauss_model<t_real>(dDistQ, 0., dSigmaQ, 1., 0.) *
 			tl::gauss_model<t_real>(dE, 0., dSigmaE, 1., 0.);
 	}
-	else	// use bragg peaks from config file
+	else if(!m_bIndexValid)	// use all bragg peaks from config file
+	{
+		t_real dS = 0.;
+		for(const ElastPeak& pk : m_vecPeaks)
+			dS += PeakContrib(pk, dh, dk, dl, dE);
+		return dS;
+	}
+	else	// only use bragg peaks from config file in neighbouring cells
 	{
 		t_real dS = 0.;
 
-		for(const ElastPeak& pk : m_lstPeaks)
+		const long iH = GetCellIdx(dh), iK = GetCellIdx(dk), iL = GetCellIdx(dl);
+		for(long iDH=-1; iDH<=1; ++iDH)
+		for(long iDK=-1; iDK<=1; ++iDK)
+		for(long iDL=-1; iDL<=1; ++iDL)
 		{
-			const ublas::vector<t_real> vecPk = tl::make_vec({pk.h, pk.k, pk.l});
-			const t_real dDistQ = ublas::norm_2(vecPk-vecCur);
+			auto iterCell = m_mapCells.find(GetCellKey(iH+iDH, iK+iDK, iL+iDL));
+			if(iterCell == m_mapCells.end())
+				continue;
 
-			dS += pk.dS * tl::gauss_model<t_real>(dDistQ, 0., pk.dSigQ, 1., 0.) *
-				tl::gauss_model<t_real>(dE, 0., pk.dSigE, 1., 0.);
+			for(std::size_t iPk=iterCell->second.first; iPk<iterCell->second.second; ++iPk)
+				dS += PeakContrib(m_vecPeaks[iPk], dh, dk, dl, dE);
 		}
 
 		return dS;
@@ -111,12 +221,31 @@ t_real SqwElast::operator()(t_real dh, t_real dk, t_real dl, t_real dE) const
 std::vector<SqwBase::t_var> SqwElast::GetVars() const
 {
 	std::vector<SqwBase::t_var> vecVars;
+	vecVars.push_back(SqwBase::t_var{"cutoff", "real", tl::var_to_str(m_dCutoff)});
 	return vecVars;
 }
 
 
-void SqwElast::SetVars(const std::vector<SqwBase::t_var>&)
+void SqwElast::SetVars(const std::vector<SqwBase::t_var>& vecVars)
 {
+	if(vecVars.size() == 0)
+		return;
+
+	bool bCutoffChanged = false;
+	for(const SqwBase::t_var& var : vecVars)
+	{
+		const std::string& strVar = std::get<0>(var);
+		const std::string& strVal = std::get<2>(var);
+
+		if(strVar == "cutoff")
+		{
+			m_dCutoff = tl::str_to_var<decltype(m_dCutoff)>(strVal);
+			bCutoffChanged = true;
+		}
+	}
+
+	if(bCutoffChanged)
+		BuildIndex();
 }
 
 
@@ -126,6 +255,11 @@ SqwBase* SqwElast::shallow_copy() const
 	*static_cast<SqwBase*>(pElast) = *static_cast<const SqwBase*>(this);
 
 	pElast->m_bLoadedFromFile = m_bLoadedFromFile;
-	pElast->m_lstPeaks = m_lstPeaks;	// not a shallow copy!
+	pElast->m_vecPeaks = m_vecPeaks;	// not a shallow copy!
+	pElast->m_mapCells = m_mapCells;
+	pElast->m_dCellSize = m_dCellSize;
+	pElast->m_bIndexValid = m_bIndexValid;
+	pElast->m_dCutoff = m_dCutoff;
+	pElast->m_dCutoffFact2 = m_dCutoffFact2;
 	return pElast;
 }
@@ -29,8 +29,9 @@
 #ifndef __MCONV_SQWMOD_ELAST_H__
 #define __MCONV_SQWMOD_ELAST_H__
 
-#include <list>
+#include <vector>
 #include <unordered_map>
+#include <cstdint>
 
 #include "tlibs/helper/boost_hacks.h"
 #include <boost/numeric/ublas/vector.hpp>
@@ -60,7 +61,23 @@ class SqwElast : public SqwBase
 {
 protected:
 	bool m_bLoadedFromFile = false;
-	std::list<ElastPeak> m_lstPeaks;
+
+	// peaks, sorted by grid cell once the index is built
+	std::vector<ElastPeak> m_vecPeaks;
+
+	// spatial index: hkl grid cell -> [begin, end) range in m_vecPeaks
+	std::unordered_map<std::uint64_t, std::pair<std::size_t, std::size_t>> m_mapCells;
+	t_real_reso m_dCellSize = 0.;
+	bool m_bIndexValid = false;
+
+	// peaks are neglected where their gaussian has dropped below this fraction of its maximum
+	t_real_reso m_dCutoff = 1e-8;
+	t_real_reso m_dCutoffFact2 = 0.;	// -2 ln(cutoff)
+
+protected:
+	std::uint64_t GetCellKey(long iH, long iK, long iL) const;
+	long GetCellIdx(t_real_reso dCoord) const;
+	t_real_reso PeakContrib(const ElastPeak& pk, t_real_reso dh, t_real_reso dk, t_real_reso dl, t_real_reso dE) const;
 
 public:
 	SqwElast() { SqwBase::m_bOk = true; }
@@ -68,6 +85,7 @@ public:
 	virtual t_real_reso operator()(t_real_reso dh, t_real_reso dk, t_real_reso dl, t_real_reso dE) const override;
 
 	void AddPeak(t_real_reso h, t_real_reso k, t_real_reso l, t_real_reso dSigQ, t_real_reso dSigE, t_real_reso dS);
+	void BuildIndex();
 
 	virtual std::vector<SqwBase::t_var> GetVars() const override;
 	virtual void SetVars(const std::vector<SqwBase::t_var>&) override;
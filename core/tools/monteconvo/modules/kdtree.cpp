@@ -47,8 +47,38 @@ SqwKdTree::SqwKdTree(const char* pcFile)
 
 bool SqwKdTree::open(const char* pcFile)
 {
-	m_kd = std::make_shared<tl::Kd<t_real>>();
+	m_kd = std::make_shared<tl::KdFlat<t_real>>();
+	m_mapParams.clear();
 
+	if(tl::KdFlat<t_real>::IsKdBinFile(pcFile))
+		return open_bin(pcFile);
+	return open_txt(pcFile);
+}
+
+
+/**
+ * load a prebuilt tree, the file is mapped and can be shared between processes
+ */
+bool SqwKdTree::open_bin(const char* pcFile)
+{
+	if(!m_kd->Load(pcFile))
+		return false;
+
+	if(m_kd->GetDim() != 4 || m_kd->GetRowLen() < 5)
+	{
+		tl::log_err("Need a k-d file with h,k,l,E,S data.");
+		m_kd->Unload();
+		return false;
+	}
+
+	m_mapParams = m_kd->GetParams();
+	tl::log_info("Mapped k-d tree with ", m_kd->GetNodeCount(), " S(Q, E) points.");
+	return true;
+}
+
+
+bool SqwKdTree::open_txt(const char* pcFile)
+{
 	std::ifstream ifstr(pcFile);
 	if(!ifstr.is_open())
 		return false;
@@ -84,7 +114,10 @@ bool SqwKdTree::open(const char* pcFile)
 	}
 
 	tl::log_info("Loaded ",  iCurPoint, " S(Q, E) points.");
-	m_kd->Load(lstPoints, 4);
+	tl::Kd<t_real> kd;
+	kd.Load(lstPoints, 4);
+	if(!m_kd->FromTree(kd, &m_mapParams))
+		return false;
 	tl::log_info("Generated k-d tree.");
 
 	return true;
@@ -94,7 +127,7 @@ bool SqwKdTree::open(const char* pcFile)
 t_real SqwKdTree::operator()(t_real dh, t_real dk, t_real dl, t_real dE) const
 {
 	// meV and rlu units will have equal scaling in the kd tree!
-	std::vector<t_real> vechklE = {dh, dk, dl, dE};
+	const t_real vechklE[] = {dh, dk, dl, dE};
 
 	// Warning: Will return 0 when bounding box has one of the four dimensions is 0
 	if(!m_kd->IsPointInGrid(vechklE))
@@ -103,7 +136,9 @@ t_real SqwKdTree::operator()(t_real dh, t_real dk, t_real dl, t_real dE) const
 		return 0.;
 	}
 
-	std::vector<t_real> vec = m_kd->GetNearestNode(vechklE);
+	const t_real* vec = m_kd->GetNearestNode(vechklE);
+	if(!vec)
+		return 0.;
 	//std::cout << "querying (" << dh << " " << dk << " " << dl << " " << dE << "), result: "
 	//	<< vec[0] << " " << vec[1] << " " << vec[2] << " " << vec[3] << std::endl;
 
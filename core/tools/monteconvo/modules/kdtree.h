@@ -39,6 +39,7 @@
 
 #include "tlibs/math/math.h"
 #include "tlibs/math/kd.h"
+#include "tlibs/file/kdbin.h"
 #include "tlibs/file/loaddat.h"
 #include "../../res/defs.h"
 #include "../sqwbase.h"
@@ -53,12 +54,17 @@ namespace ublas = boost::numeric::ublas;
 
 /**
  * tabulated kd tree model
+ * reads either h,k,l,E,S text tables or binary k-d files (see tools/misc/sqwtab2bin.cpp)
  */
 class SqwKdTree : public SqwBase
 {
 protected:
 	std::unordered_map<std::string, std::string> m_mapParams;
-	std::shared_ptr<tl::Kd<t_real_reso>> m_kd;
+	std::shared_ptr<tl::KdFlat<t_real_reso>> m_kd;
+
+protected:
+	bool open_txt(const char* pcFile);
+	bool open_bin(const char* pcFile);
 
 public:
 	SqwKdTree(const char* pcFile = nullptr);
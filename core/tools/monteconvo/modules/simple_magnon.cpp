@@ -32,6 +32,7 @@
 #include "tlibs/math/math.h"
 #include "tlibs/math/linalg.h"
 #include "tlibs/phys/neutrons.h"
+#include "tlibs/math/lineshapes.h"
 #include <fstream>
 #include <list>
 
@@ -96,6 +97,16 @@ SqwMagnon::SqwMagnon(const char* pcFile)
  */
 std::tuple<std::vector<t_real>, std::vector<t_real>>
 SqwMagnon::disp(t_real dh, t_real dk, t_real dl) const
+{
+	return disp_vecs(dh, dk, dl);
+}
+
+
+/**
+ * dispersion E(Q), writing into the given buffers
+ */
+std::size_t SqwMagnon::disp_into(t_real dh, t_real dk, t_real dl,
+	t_real *pE, t_real *pW, std::size_t iMaxBranches) const
 {
 	dh -= m_vecBragg[0];
 	dk -= m_vecBragg[1];
@@ -109,34 +120,35 @@ SqwMagnon::disp(t_real dh, t_real dk, t_real dl) const
 	}
 
 	if(!pDisp)
-		return std::make_tuple(std::vector<t_real>(), std::vector<t_real>());
+		return 0;
+	if(iMaxBranches < 2)
+		return 2;
 
 	t_real dq = std::sqrt(dh*dh + dk*dk + dl*dl);
 	t_real dE = pDisp(dq, m_dD, m_dOffs);
 	t_real dW = t_real(1);
 
-	return std::make_tuple(std::vector<t_real>({dE, -dE}),
-		std::vector<t_real>({dW, dW}));
+	pE[0] = dE; pE[1] = -dE;
+	pW[0] = dW; pW[1] = dW;
+	return 2;
 }
 
 
 /**
- * dynamical structure factor S(Q,E)
+ * S(Q,E) for the given dispersion branches
  */
-t_real SqwMagnon::operator()(t_real dh, t_real dk, t_real dl, t_real dE) const
+t_real SqwMagnon::line_shape(t_real /*dh*/, t_real /*dk*/, t_real /*dl*/, t_real dE,
+	const t_real *pE, const t_real *pW, std::size_t iNumBranches) const
 {
-	std::vector<t_real> vecE0, vecW;
-	std::tie(vecE0, vecW) = disp(dh, dk, dl);
-
 	t_real dInc = 0.;
 	if(!tl::float_equal<t_real>(m_dIncAmp, 0.))
 		dInc = tl::gauss_model<t_real>(dE, 0., m_dIncSig, m_dIncAmp, 0.);
 
 	t_real dS = 0;
-	if(vecE0.size())
+	if(iNumBranches)
 	{
-		for(std::size_t i=0; i<vecE0.size(); ++i)
-			dS += std::abs(tl::DHO_model<t_real>(dE, m_dT, vecE0[i], m_dE_HWHM, vecW[i], 0.));
+		for(std::size_t i=0; i<iNumBranches; ++i)
+			dS += std::abs(tl::DHO_model<t_real>(dE, m_dT, pE[i], m_dE_HWHM, pW[i], 0.));
 		dS *= m_dS0;
 	}
 
@@ -144,6 +156,57 @@ t_real SqwMagnon::operator()(t_real dh, t_real dk, t_real dl, t_real dE) const
 }
 
 
+/**
+ * dynamical structure factor S(Q,E)
+ */
+t_real SqwMagnon::operator()(t_real dh, t_real dk, t_real dl, t_real dE) const
+{
+	SqwDispBuf buf;
+	const std::size_t iNumBranches = fill_disp(dh, dk, dl, buf);
+
+	return line_shape(dh, dk, dl, dE, buf.E(), buf.W(), iNumBranches);
+}
+
+
+/**
+ * S(Q,E) for a batch of mc points
+ */
+void SqwMagnon::sqw_batch(std::size_t iNum, const t_real *pH, const t_real *pK,
+	const t_real *pL, const t_real *pE, t_real *pS) const
+{
+	std::vector<t_real> vecTmp(iNum);
+
+	if(m_iWhichDisp == 0 || m_iWhichDisp == 1)
+	{
+		for(std::size_t i=0; i<iNum; ++i)
+		{
+			const t_real dh = pH[i] - m_vecBragg[0];
+			const t_real dk = pK[i] - m_vecBragg[1];
+			const t_real dl = pL[i] - m_vecBragg[2];
+			const t_real dq = std::sqrt(dh*dh + dk*dk + dl*dl);
+
+			vecTmp[i] = m_iWhichDisp == 0 ? ferro_disp(dq, m_dD, m_dOffs) : antiferro_disp(dq, m_dD, m_dOffs);
+		}
+
+		// the two branches at +E0 and -E0 have identical DHO line shapes
+		tl::DHO_model_batch<t_real>(iNum, pE, m_dT, vecTmp.data(), m_dE_HWHM, t_real(1), pS);
+		for(std::size_t i=0; i<iNum; ++i)
+			pS[i] *= t_real(2)*m_dS0;
+	}
+	else
+	{
+		std::fill(pS, pS+iNum, t_real(0));
+	}
+
+	if(!tl::float_equal<t_real>(m_dIncAmp, 0.))
+	{
+		tl::gauss_model_batch<t_real>(iNum, pE, t_real(0), m_dIncSig, m_dIncAmp, vecTmp.data());
+		for(std::size_t i=0; i<iNum; ++i)
+			pS[i] += vecTmp[i];
+	}
+}
+
+
 std::vector<SqwBase::t_var> SqwMagnon::GetVars() const
 {
 	std::vector<SqwBase::t_var> vecVars;
@@ -74,7 +74,15 @@ public:
 
 	virtual std::tuple<std::vector<t_real_reso>, std::vector<t_real_reso>>
 		disp(t_real_reso dh, t_real_reso dk, t_real_reso dl) const override;
+	virtual std::size_t disp_into(t_real_reso dh, t_real_reso dk, t_real_reso dl,
+		t_real_reso *pE, t_real_reso *pW, std::size_t iMaxBranches) const override;
+	virtual std::size_t GetDispBranchCount() const override { return 2; }
+	virtual bool HasLineShape() const override { return true; }
+	virtual t_real_reso line_shape(t_real_reso dh, t_real_reso dk, t_real_reso dl, t_real_reso dE,
+		const t_real_reso *pE, const t_real_reso *pW, std::size_t iNumBranches) const override;
 	virtual t_real_reso operator()(t_real_reso dh, t_real_reso dk, t_real_reso dl, t_real_reso dE) const override;
+	virtual void sqw_batch(std::size_t iNum, const t_real_reso *pH, const t_real_reso *pK,
+		const t_real_reso *pL, const t_real_reso *pE, t_real_reso *pS) const override;
 
 	const ublas::vector<t_real_reso>& GetBragg() const { return m_vecBragg; }
 
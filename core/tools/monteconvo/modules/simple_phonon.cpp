@@ -32,6 +32,7 @@
 #include "tlibs/math/math.h"
 #include "tlibs/math/linalg.h"
 #include "tlibs/phys/neutrons.h"
+#include "tlibs/math/lineshapes.h"
 #include <fstream>
 #include <list>
 
@@ -45,12 +46,47 @@ t_real SqwPhonon::phonon_disp(t_real dq, t_real da, t_real df)
 }
 
 
+/**
+ * the tree only stores placeholder indices for the branch widths and weights,
+ * look up their current values once here instead of for every mc point
+ */
+void SqwPhonon::resolve_branch_params()
+{
+	m_dBranchE_HWHM[0] = m_dTA1_E_HWHM;
+	m_dBranchE_HWHM[1] = m_dTA2_E_HWHM;
+	m_dBranchE_HWHM[2] = m_dLA_E_HWHM;
+
+	m_dBranchq_HWHM[0] = m_dTA1_q_HWHM;
+	m_dBranchq_HWHM[1] = m_dTA2_q_HWHM;
+	m_dBranchq_HWHM[2] = m_dLA_q_HWHM;
+
+	m_dBranchS0[0] = m_dTA1_S0;
+	m_dBranchS0[1] = m_dTA2_S0;
+	m_dBranchS0[2] = m_dLA_S0;
+}
+
+
+/**
+ * negative values are placeholders: -1: TA1, -2: TA2, -3: LA
+ */
+t_real SqwPhonon::resolve_branch_param(t_real dVal, const t_real* pParams)
+{
+	if(dVal >= 0.)
+		return dVal;
+
+	const std::size_t iBranch = std::size_t(-dVal - 0.5);
+	return iBranch < 3 ? pParams[iBranch] : dVal;
+}
+
+
 void SqwPhonon::create()
 {
+	resolve_branch_params();
+
 #ifdef USE_RTREE
 	m_rt = std::make_shared<tl::Rt<t_real,3,RT_ELEMS>>();
 #else
-	m_kd = std::make_shared<tl::Kd<t_real>>();
+	m_kd = std::make_shared<tl::KdFlat<t_real>>();
 #endif
 
 	const bool bSaveOnlyIndices = 1;
@@ -76,6 +112,14 @@ void SqwPhonon::create()
 	tl::log_info("TA1: ", m_vecTA1);
 	tl::log_info("TA2: ", m_vecTA2);
 
+#ifndef USE_RTREE
+	if(load_tree())
+	{
+		m_bOk = 1;
+		return;
+	}
+#endif
+
 	std::list<std::vector<t_real>> lst;
 	for(t_real dq=-1.; dq<1.; dq+=1./t_real(m_iNumqs))
 	{
@@ -138,14 +182,77 @@ void SqwPhonon::create()
 	m_rt->Load(lst);
 	tl::log_info("Generated R* tree.");
 #else
-	m_kd->Load(lst, 3);
+	tl::Kd<t_real> kd;
+	kd.Load(lst, 3);
+	tl::KdFlat<t_real>::t_map mapParams{{"phonon_key", tree_key()}};
+	if(!m_kd->FromTree(kd, &mapParams))
+	{
+		tl::log_err("Cannot generate k-d tree.");
+		m_bOk = 0;
+		return;
+	}
 	tl::log_info("Generated k-d tree.");
+
+	if(m_strTreeFile != "")
+	{
+		if(m_kd->Save(m_strTreeFile))
+			tl::log_info("Saved k-d tree to \"", m_strTreeFile, "\".");
+		else
+			tl::log_warn("Cannot save k-d tree to \"", m_strTreeFile, "\".");
+	}
 #endif
 
 	m_bOk = 1;
 }
 
 
+#ifndef USE_RTREE
+/**
+ * parameters which determine the tree contents,
+ * the widths and weights are only stored as branch indices
+ */
+std::string SqwPhonon::tree_key() const
+{
+	std::ostringstream ostr;
+	ostr.precision(std::numeric_limits<t_real>::max_digits10);
+
+	ostr << m_iNumqs << ";" << m_iNumArc << ";" << m_dArcMax << ";"
+		<< vec_to_str(m_vecBragg) << ";" << vec_to_str(m_vecLA) << ";"
+		<< vec_to_str(m_vecTA1) << ";" << vec_to_str(m_vecTA2) << ";"
+		<< m_dLA_amp << ";" << m_dLA_freq << ";"
+		<< m_dTA1_amp << ";" << m_dTA1_freq << ";"
+		<< m_dTA2_amp << ";" << m_dTA2_freq;
+
+	return ostr.str();
+}
+
+
+/**
+ * try to map a previously generated tree with matching parameters
+ */
+bool SqwPhonon::load_tree()
+{
+	if(m_strTreeFile == "" || !tl::KdFlat<t_real>::IsKdBinFile(m_strTreeFile))
+		return false;
+
+	if(!m_kd->Load(m_strTreeFile))
+		return false;
+
+	auto iterKey = m_kd->GetParams().find("phonon_key");
+	if(m_kd->GetDim() != 3 || m_kd->GetRowLen() < 7 ||
+		iterKey == m_kd->GetParams().end() || iterKey->second != tree_key())
+	{
+		tl::log_info("Tree file \"", m_strTreeFile, "\" does not match the parameters, regenerating.");
+		m_kd->Unload();
+		return false;
+	}
+
+	tl::log_info("Mapped k-d tree with ", m_kd->GetNodeCount(), " S(Q, E) points.");
+	return true;
+}
+#endif
+
+
 void SqwPhonon::destroy()
 {
 #ifdef USE_RTREE
@@ -207,6 +314,9 @@ SqwPhonon::SqwPhonon(const char* pcFile)
 			if(vecToks[0] == "num_qs") m_iNumqs = tl::str_to_var<unsigned int>(vecToks[1]);
 			if(vecToks[0] == "num_arc") m_iNumArc = tl::str_to_var<unsigned int>(vecToks[1]);
 			if(vecToks[0] == "arc_max") m_dArcMax = tl::str_to_var_parse<t_real>(vecToks[1]);
+#ifndef USE_RTREE
+			else if(vecToks[0] == "tree_file") m_strTreeFile = vecToks[1];
+#endif
 
 			else if(vecToks[0] == "G") m_vecLA = m_vecBragg = tl::make_vec({tl::str_to_var_parse<t_real>(vecToks[1]), tl::str_to_var_parse<t_real>(vecToks[2]), tl::str_to_var_parse<t_real>(vecToks[3])});
 			else if(vecToks[0] == "TA1") m_vecTA1 = tl::make_vec({tl::str_to_var_parse<t_real>(vecToks[1]), tl::str_to_var_parse<t_real>(vecToks[2]), tl::str_to_var_parse<t_real>(vecToks[3])});
@@ -243,53 +353,26 @@ SqwPhonon::SqwPhonon(const char* pcFile)
 
 t_real SqwPhonon::operator()(t_real dh, t_real dk, t_real dl, t_real dE) const
 {
-	std::vector<t_real> vechklE = {dh, dk, dl, dE};
 #ifdef USE_RTREE
+	std::vector<t_real> vechklE = {dh, dk, dl, dE};
 	if(!m_rt->IsPointInGrid(vechklE)) return 0.;
 	std::vector<t_real> vec = m_rt->GetNearestNode(vechklE);
 #else
+	const t_real vechklE[] = {dh, dk, dl, dE};
 	if(!m_kd->IsPointInGrid(vechklE)) return 0.;
-	std::vector<t_real> vec = m_kd->GetNearestNode(vechklE);
+	const t_real* vec = m_kd->GetNearestNode(vechklE);
+	if(!vec) return 0.;
 #endif
 
 	t_real dE0 = vec[3];
-	t_real dS = vec[4];
+	t_real dS = resolve_branch_param(vec[4], m_dBranchS0);
 	t_real dT = m_dT;
-	t_real dE_HWHM = vec[5];
-	t_real dQ_HWHM = vec[6];
-
-	// index, not value
-	if(dE_HWHM < 0.)
-	{
-		if(tl::float_equal<t_real>(dE_HWHM, -1., 0.1))		// TA1
-			dE_HWHM = m_dTA1_E_HWHM;
-		else if(tl::float_equal<t_real>(dE_HWHM, -2., 0.1))	// TA2
-			dE_HWHM = m_dTA2_E_HWHM;
-		else if(tl::float_equal<t_real>(dE_HWHM, -3., 0.1))	// LA
-			dE_HWHM = m_dLA_E_HWHM;
-	}
-	if(dQ_HWHM < 0.)
-	{
-		if(tl::float_equal<t_real>(dQ_HWHM, -1., 0.1))		// TA1
-			dQ_HWHM = m_dTA1_q_HWHM;
-		else if(tl::float_equal<t_real>(dQ_HWHM, -2., 0.1))	// TA2
-			dQ_HWHM = m_dTA2_q_HWHM;
-		else if(tl::float_equal<t_real>(dQ_HWHM, -3., 0.1))	// LA
-			dQ_HWHM = m_dLA_q_HWHM;
-	}
-	if(dS < 0.)
-	{
-		if(tl::float_equal<t_real>(dS, -1., 0.1))		// TA1
-			dS = m_dTA1_S0;
-		else if(tl::float_equal<t_real>(dS, -2., 0.1))	// TA2
-			dS = m_dTA2_S0;
-		else if(tl::float_equal<t_real>(dS, -3., 0.1))	// LA
-			dS = m_dLA_S0;
-	}
+	t_real dE_HWHM = resolve_branch_param(vec[5], m_dBranchE_HWHM);
+	t_real dQ_HWHM = resolve_branch_param(vec[6], m_dBranchq_HWHM);
 
-	t_real dqDist = std::sqrt(std::pow(vec[0]-vechklE[0], 2.)
-		+ std::pow(vec[1]-vechklE[1], 2.)
-		+ std::pow(vec[2]-vechklE[2], 2.));
+	t_real dqDist = std::sqrt((vec[0]-vechklE[0])*(vec[0]-vechklE[0])
+		+ (vec[1]-vechklE[1])*(vec[1]-vechklE[1])
+		+ (vec[2]-vechklE[2])*(vec[2]-vechklE[2]));
 
 	t_real dInc = 0.;
 	if(!tl::float_equal<t_real>(m_dIncAmp, 0.))
@@ -301,6 +384,72 @@ t_real SqwPhonon::operator()(t_real dh, t_real dk, t_real dl, t_real dE) const
 }
 
 
+/**
+ * S(Q,E) for a batch of mc points:
+ * the nearest tree nodes are looked up first, then the line shapes are evaluated for all points
+ */
+void SqwPhonon::sqw_batch(std::size_t iNum, const t_real *pH, const t_real *pK,
+	const t_real *pL, const t_real *pE, t_real *pS) const
+{
+	std::vector<t_real> vecE0(iNum), vecS(iNum), vecE_HWHM(iNum), vecQ_Sig(iNum), vecQDist(iNum), vecTmp(iNum);
+	std::vector<unsigned char> vecFound(iNum, 0);
+	const t_real dHWHM2Sig = tl::get_HWHM2SIGMA<t_real>();
+
+	for(std::size_t i=0; i<iNum; ++i)
+	{
+#ifdef USE_RTREE
+		std::vector<t_real> vechklE = {pH[i], pK[i], pL[i], pE[i]};
+		std::vector<t_real> vec;
+		if(m_rt->IsPointInGrid(vechklE))
+			vec = m_rt->GetNearestNode(vechklE);
+		const bool bFound = (vec.size() >= 7);
+#else
+		const t_real vechklE[] = {pH[i], pK[i], pL[i], pE[i]};
+		const t_real* vec = nullptr;
+		if(m_kd->IsPointInGrid(vechklE))
+			vec = m_kd->GetNearestNode(vechklE);
+		const bool bFound = (vec != nullptr);
+#endif
+
+		if(!bFound)
+		{
+			// outside the grid: zero weight, finite dummy line shape
+			vecE0[i] = vecE_HWHM[i] = vecQ_Sig[i] = t_real(1);
+			vecS[i] = vecQDist[i] = t_real(0);
+			continue;
+		}
+
+		vecFound[i] = 1;
+		vecE0[i] = vec[3];
+		vecS[i] = resolve_branch_param(vec[4], m_dBranchS0);
+		vecE_HWHM[i] = resolve_branch_param(vec[5], m_dBranchE_HWHM);
+		vecQ_Sig[i] = resolve_branch_param(vec[6], m_dBranchq_HWHM) * dHWHM2Sig;
+
+		vecQDist[i] = std::sqrt((vec[0]-pH[i])*(vec[0]-pH[i])
+			+ (vec[1]-pK[i])*(vec[1]-pK[i])
+			+ (vec[2]-pL[i])*(vec[2]-pL[i]));
+	}
+
+	tl::DHO_model_batch<t_real>(iNum, pE, m_dT, vecE0.data(), vecE_HWHM.data(), t_real(1), pS);
+	tl::gauss_model_batch<t_real>(iNum, vecQDist.data(), t_real(0), vecQ_Sig.data(), t_real(1), vecTmp.data());
+
+	for(std::size_t i=0; i<iNum; ++i)
+		pS[i] *= vecS[i] * vecTmp[i];
+
+	if(!tl::float_equal<t_real>(m_dIncAmp, 0.))
+	{
+		tl::gauss_model_batch<t_real>(iNum, pE, t_real(0), m_dIncSig, m_dIncAmp, vecTmp.data());
+		for(std::size_t i=0; i<iNum; ++i)
+			pS[i] += vecTmp[i];
+	}
+
+	// like operator(), points outside the grid have no incoherent part either
+	for(std::size_t i=0; i<iNum; ++i)
+		if(!vecFound[i])
+			pS[i] = t_real(0);
+}
+
+
 std::vector<SqwBase::t_var> SqwPhonon::GetVars() const
 {
 	std::vector<SqwBase::t_var> vecVars;
@@ -395,6 +544,8 @@ void SqwPhonon::SetVars(const std::vector<SqwBase::t_var>& vecVars)
 
 	if(bRecreateTree)
 		create();
+	else
+		resolve_branch_params();
 }
 
 
@@ -407,6 +558,7 @@ SqwBase* SqwPhonon::shallow_copy() const
 	pCpy->m_rt = m_rt;
 #else
 	pCpy->m_kd = m_kd;
+	pCpy->m_strTreeFile = m_strTreeFile;
 #endif
 	pCpy->m_iNumqs = m_iNumqs;
 	pCpy->m_iNumArc = m_iNumArc;
@@ -439,6 +591,7 @@ SqwBase* SqwPhonon::shallow_copy() const
 	pCpy->m_dIncSig = m_dIncSig;
 
 	pCpy->m_dT = m_dT;
+	pCpy->resolve_branch_params();
 	return pCpy;
 }
 
@@ -504,6 +657,19 @@ SqwPhononSingleBranch::SqwPhononSingleBranch(const char* pcFile)
 std::tuple<std::vector<t_real>, std::vector<t_real>>
 SqwPhononSingleBranch::disp(t_real dh, t_real dk, t_real dl) const
 {
+	return disp_vecs(dh, dk, dl);
+}
+
+
+/**
+ * dispersion E(Q), writing into the given buffers
+ */
+std::size_t SqwPhononSingleBranch::disp_into(t_real dh, t_real dk, t_real dl,
+	t_real *pE, t_real *pW, std::size_t iMaxBranches) const
+{
+	if(iMaxBranches < 2)
+		return 2;
+
 	dh -= m_vecBragg[0];
 	dk -= m_vecBragg[1];
 	dl -= m_vecBragg[2];
@@ -512,8 +678,9 @@ SqwPhononSingleBranch::disp(t_real dh, t_real dk, t_real dl) const
 	t_real dE0 = phonon_disp(dq, m_damp, m_dfreq);
 	t_real dWeight = t_real(1);
 
-	return std::make_tuple(std::vector<t_real>({dE0, -dE0}),
-		std::vector<t_real>({dWeight, dWeight}));
+	pE[0] = dE0; pE[1] = -dE0;
+	pW[0] = dWeight; pW[1] = dWeight;
+	return 2;
 }
 
 
@@ -522,14 +689,55 @@ SqwPhononSingleBranch::disp(t_real dh, t_real dk, t_real dl) const
  */
 t_real SqwPhononSingleBranch::operator()(t_real dh, t_real dk, t_real dl, t_real dE) const
 {
-	std::vector<t_real> vecE0, vecW;
-	std::tie(vecE0, vecW) = disp(dh, dk, dl);
+	SqwDispBuf buf;
+	const std::size_t iNumBranches = fill_disp(dh, dk, dl, buf);
+
+	return line_shape(dh, dk, dl, dE, buf.E(), buf.W(), iNumBranches);
+}
+
 
+/**
+ * S(Q,E) for the given dispersion branches, the DHO already includes the branch at -E
+ */
+t_real SqwPhononSingleBranch::line_shape(t_real /*dh*/, t_real /*dk*/, t_real /*dl*/, t_real dE,
+	const t_real *pE, const t_real *pW, std::size_t iNumBranches) const
+{
 	t_real dInc = 0.;
 	if(!tl::float_equal<t_real>(m_dIncAmp, 0.))
 		dInc = tl::gauss_model<t_real>(dE, 0., m_dIncSig, m_dIncAmp, 0.);
 
-	return std::abs(tl::DHO_model<t_real>(dE, m_dT, vecE0[0], m_dHWHM, m_dS0*vecW[0], 0.)) + dInc;
+	if(!iNumBranches)
+		return dInc;
+
+	return std::abs(tl::DHO_model<t_real>(dE, m_dT, pE[0], m_dHWHM, m_dS0*pW[0], 0.)) + dInc;
+}
+
+
+/**
+ * S(Q,E) for a batch of mc points
+ */
+void SqwPhononSingleBranch::sqw_batch(std::size_t iNum, const t_real *pH, const t_real *pK,
+	const t_real *pL, const t_real *pE, t_real *pS) const
+{
+	std::vector<t_real> vecE0(iNum);
+	for(std::size_t i=0; i<iNum; ++i)
+	{
+		const t_real dh = pH[i] - m_vecBragg[0];
+		const t_real dk = pK[i] - m_vecBragg[1];
+		const t_real dl = pL[i] - m_vecBragg[2];
+
+		vecE0[i] = phonon_disp(std::sqrt(dh*dh + dk*dk + dl*dl), m_damp, m_dfreq);
+	}
+
+	tl::DHO_model_batch<t_real>(iNum, pE, m_dT, vecE0.data(), m_dHWHM, m_dS0, pS);
+
+	if(!tl::float_equal<t_real>(m_dIncAmp, 0.))
+	{
+		std::vector<t_real> vecInc(iNum);
+		tl::gauss_model_batch<t_real>(iNum, pE, t_real(0), m_dIncSig, m_dIncAmp, vecInc.data());
+		for(std::size_t i=0; i<iNum; ++i)
+			pS[i] += vecInc[i];
+	}
 }
 
 
@@ -37,6 +37,7 @@
 
 #include "tlibs/math/math.h"
 #include "tlibs/math/kd.h"
+#include "tlibs/file/kdbin.h"
 #include "tlibs/file/loaddat.h"
 #include "../../res/defs.h"
 #include "../sqwbase.h"
@@ -64,11 +65,19 @@ protected:
 	void create();
 	void destroy();
 
+#ifndef USE_RTREE
+	std::string tree_key() const;
+	bool load_tree();
+#endif
+
 protected:
 #ifdef USE_RTREE
 	std::shared_ptr<tl::Rt<t_real_reso, 3, RT_ELEMS>> m_rt;
 #else
-	std::shared_ptr<tl::Kd<t_real_reso>> m_kd;
+	std::shared_ptr<tl::KdFlat<t_real_reso>> m_kd;
+
+	// optional binary file caching the generated tree
+	std::string m_strTreeFile;
 #endif
 	unsigned int m_iNumqs = 250;
 	unsigned int m_iNumArc = 50;
@@ -87,6 +96,13 @@ protected:
 	t_real_reso m_dIncAmp=0., m_dIncSig=0.1;
 	t_real_reso m_dT = 100.;
 
+	// branch parameters for the placeholders -1 (TA1), -2 (TA2) and -3 (LA) stored in the tree
+	t_real_reso m_dBranchE_HWHM[3], m_dBranchq_HWHM[3], m_dBranchS0[3];
+
+protected:
+	void resolve_branch_params();
+	static t_real_reso resolve_branch_param(t_real_reso dVal, const t_real_reso* pParams);
+
 public:
 	SqwPhonon(const ublas::vector<t_real_reso>& vecBragg,
 		const ublas::vector<t_real_reso>& vecTA1,
@@ -100,6 +116,8 @@ public:
 	virtual ~SqwPhonon() = default;
 
 	virtual t_real_reso operator()(t_real_reso dh, t_real_reso dk, t_real_reso dl, t_real_reso dE) const override;
+	virtual void sqw_batch(std::size_t iNum, const t_real_reso *pH, const t_real_reso *pK,
+		const t_real_reso *pL, const t_real_reso *pE, t_real_reso *pS) const override;
 
 
 	const ublas::vector<t_real_reso>& GetBragg() const { return m_vecBragg; }
@@ -139,8 +157,16 @@ public:
 
 	virtual std::tuple<std::vector<t_real_reso>, std::vector<t_real_reso>>
 		disp(t_real_reso dh, t_real_reso dk, t_real_reso dl) const override;
+	virtual std::size_t disp_into(t_real_reso dh, t_real_reso dk, t_real_reso dl,
+		t_real_reso *pE, t_real_reso *pW, std::size_t iMaxBranches) const override;
+	virtual std::size_t GetDispBranchCount() const override { return 2; }
+	virtual bool HasLineShape() const override { return true; }
+	virtual t_real_reso line_shape(t_real_reso dh, t_real_reso dk, t_real_reso dl, t_real_reso dE,
+		const t_real_reso *pE, const t_real_reso *pW, std::size_t iNumBranches) const override;
 	virtual t_real_reso
 		operator()(t_real_reso dh, t_real_reso dk, t_real_reso dl, t_real_reso dE) const override;
+	virtual void sqw_batch(std::size_t iNum, const t_real_reso *pH, const t_real_reso *pK,
+		const t_real_reso *pL, const t_real_reso *pE, t_real_reso *pS) const override;
 
 	const ublas::vector<t_real_reso>& GetBragg() const { return m_vecBragg; }
 
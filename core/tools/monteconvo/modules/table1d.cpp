@@ -49,6 +49,25 @@ SqwTable1d::SqwTable1d(const char* pcFile)
 bool SqwTable1d::open(const char* pcFile)
 {
 	tl::log_debug("Loading \"", pcFile, "\"", ".");
+
+	// prebuilt q,E,S tree
+	if(tl::KdFlat<t_real>::IsKdBinFile(pcFile))
+	{
+		m_dat.reset();
+		m_kd = std::make_shared<tl::KdFlat<t_real>>();
+		m_bOk = m_kd->Load(pcFile);
+
+		if(m_bOk && (m_kd->GetDim() != 2 || m_kd->GetRowLen() < 3))
+		{
+			tl::log_err("Need a k-d file with q,E,S data.");
+			m_bOk = false;
+		}
+
+		if(m_bOk)
+			tl::log_info("Mapped k-d tree with ", m_kd->GetNodeCount(), " S(Q, E) points.");
+		return m_bOk;
+	}
+
 	m_dat = std::make_shared<tl::DatFile<t_real>>(pcFile);
 	m_bOk = m_dat->IsOk();
 	CreateKd();
@@ -64,7 +83,11 @@ void SqwTable1d::CreateKd()
 		return;
 	}
 
-	m_kd = std::make_shared<tl::Kd<t_real>>();
+	// tree was loaded directly, the column settings do not apply
+	if(!m_dat)
+		return;
+
+	tl::Kd<t_real> kd;
 	std::list<std::vector<t_real>> lstPoints;
 
 	t_real minq = std::numeric_limits<t_real>::max();
@@ -89,7 +112,14 @@ void SqwTable1d::CreateKd()
 	tl::log_info("Loaded ", m_dat->GetRowCount(), " S(Q, E) points.");
 	tl::log_info("q range: ", minq, "..", maxq, ", E range: ", minE, "..", maxE, ".");
 
-	m_kd->Load(lstPoints, 2);
+	kd.Load(lstPoints, 2);
+	m_kd = std::make_shared<tl::KdFlat<t_real>>();
+	if(!m_kd->FromTree(kd))
+	{
+		tl::log_err("Cannot generate k-d tree.");
+		m_bOk = false;
+		return;
+	}
 	tl::log_info("Generated k-d tree.");
 }
 
@@ -104,12 +134,14 @@ t_real SqwTable1d::operator()(t_real dh, t_real dk, t_real dl, t_real dE) const
 	t_real dq = std::sqrt(dh*dh + dk*dk + dl*dl);
 
 	// meV and rlu units will have equal scaling in the kd tree!
-	std::vector<t_real> vecqE{{dq, dE}};
+	const t_real vecqE[] = {dq, dE};
 
 	if(!m_kd->IsPointInGrid(vecqE))
 		return 0.;
 
-	std::vector<t_real> vec = m_kd->GetNearestNode(vecqE);
+	const t_real* vec = m_kd->GetNearestNode(vecqE);
+	if(!vec)
+		return 0.;
 	return vec[2];
 }
 
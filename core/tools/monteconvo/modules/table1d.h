@@ -39,6 +39,7 @@
 
 #include "tlibs/math/math.h"
 #include "tlibs/math/kd.h"
+#include "tlibs/file/kdbin.h"
 #include "tlibs/file/loaddat.h"
 #include "../../res/defs.h"
 #include "../sqwbase.h"
@@ -48,12 +49,13 @@ namespace ublas = boost::numeric::ublas;
 
 /**
  * tabulated 1d model
+ * reads either column tables or binary q,E,S k-d files (see tools/misc/sqwtab2bin.cpp)
  */
 class SqwTable1d : public SqwBase
 {
 protected:
 	std::shared_ptr<tl::DatFile<t_real_reso>> m_dat;
-	std::shared_ptr<tl::Kd<t_real_reso>> m_kd;
+	std::shared_ptr<tl::KdFlat<t_real_reso>> m_kd;
 
 	t_real_reso m_G[3] = { 0., 0., 0. };
 
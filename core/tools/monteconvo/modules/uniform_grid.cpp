@@ -118,6 +118,16 @@ SqwUniformGrid::~SqwUniformGrid()
 
 std::tuple<std::vector<t_real>, std::vector<t_real>>
 	SqwUniformGrid::disp(t_real dh, t_real dk, t_real dl) const
+{
+	return disp_vecs(dh, dk, dl);
+}
+
+
+/**
+ * dispersion branches with non-zero weight, writing into the given buffers
+ */
+std::size_t SqwUniformGrid::disp_into(t_real dh, t_real dk, t_real dl,
+	t_real *pE, t_real *pW, std::size_t iMaxBranches) const
 {
 	/**
 	 * calculate file index based on coordinates
@@ -150,7 +160,7 @@ std::tuple<std::vector<t_real>, std::vector<t_real>>
 	if(!tl::file_exists(m_strDataFile.c_str()))
 	{
 		tl::log_err("Grid data file \"", m_strDataFile, "\" does not exist.");
-		return std::make_tuple(std::vector<t_real>(), std::vector<t_real>());
+		return 0;
 	}
 
 	std::ifstream ifstr(m_strDataFile);
@@ -158,7 +168,7 @@ std::tuple<std::vector<t_real>, std::vector<t_real>>
 	if(!ifstr)
 	{
 		tl::log_err("Data file \"", m_strDataFile, "\" cannot be opened.");
-		return std::make_tuple(std::vector<t_real>(), std::vector<t_real>());
+		return 0;
 	}
 
 
@@ -171,7 +181,7 @@ std::tuple<std::vector<t_real>, std::vector<t_real>>
 	if(!_dat_file_offs.first)
 	{
 		tl::log_err("Grid data file \"", m_strDataFile, "\" cannot be mapped.");
-		return std::make_tuple(std::vector<t_real>(), std::vector<t_real>());
+		return 0;
 	}
 
 	std::size_t dat_file_offs = *_dat_file_offs.second.get();
@@ -185,7 +195,7 @@ std::tuple<std::vector<t_real>, std::vector<t_real>>
 	if(!_num_branches.first)
 	{
 		tl::log_err("Grid data file \"", m_strDataFile, "\" cannot be mapped (1).");
-		return std::make_tuple(std::vector<t_real>(), std::vector<t_real>());
+		return 0;
 	}
 
 	// number of dispersion branches and weights
@@ -198,25 +208,29 @@ std::tuple<std::vector<t_real>, std::vector<t_real>>
 	if(!_branches.first)
 	{
 		tl::log_err("Grid data file \"", m_strDataFile, "\" cannot be mapped (2).");
-		return std::make_tuple(std::vector<t_real>(), std::vector<t_real>());
+		return 0;
 	}
 
 	const t_real *pBranches = _branches.second.get();
 
-	std::vector<t_real> vecE, vecw;
+	std::size_t iNumNonZero = 0;
 	for(unsigned int iBranch=0; iBranch<iNumBranches; ++iBranch)
 	{
 		if(!tl::float_equal(pBranches[iBranch*2 + 1], t_real(0)))
 		{
-			vecE.push_back(pBranches[iBranch*2 + 0]);	// energy
-			vecw.push_back(pBranches[iBranch*2 + 1]);	// weight
+			if(iNumNonZero < iMaxBranches)
+			{
+				pE[iNumNonZero] = pBranches[iBranch*2 + 0];	// energy
+				pW[iNumNonZero] = pBranches[iBranch*2 + 1];	// weight
+			}
+			++iNumNonZero;
 		}
 	}
 
 	// ------------------------------------------------------------------------
 
 
-	return std::make_tuple(vecE, vecw);
+	return iNumNonZero;
 }
 
 
@@ -225,16 +239,26 @@ std::tuple<std::vector<t_real>, std::vector<t_real>>
  */
 t_real SqwUniformGrid::operator()(t_real dh, t_real dk, t_real dl, t_real dE) const
 {
-	std::vector<t_real> vecE, vecW;
-	std::tie(vecE, vecW) = disp(dh, dk, dl);
+	SqwDispBuf buf;
+	const std::size_t iNumBranches = fill_disp(dh, dk, dl, buf);
 
+	return line_shape(dh, dk, dl, dE, buf.E(), buf.W(), iNumBranches);
+}
+
+
+/**
+ * S(q,E) for the given dispersion branches
+ */
+t_real SqwUniformGrid::line_shape(t_real /*dh*/, t_real /*dk*/, t_real /*dl*/, t_real dE,
+	const t_real *pE, const t_real *pW, std::size_t iNumBranches) const
+{
 	t_real dInc = 0;
 	if(!tl::float_equal(m_dIncAmp, t_real(0)))
 		dInc = tl::gauss_model(dE, t_real(0), m_dIncSigma, m_dIncAmp, t_real(0));
 
 	t_real dS = 0;
-	for(std::size_t iE=0; iE<vecE.size(); ++iE)
-		dS += tl::gauss_model(dE, vecE[iE], m_dSigma, vecW[iE], t_real(0));
+	for(std::size_t iE=0; iE<iNumBranches; ++iE)
+		dS += tl::gauss_model(dE, pE[iE], m_dSigma, pW[iE], t_real(0));
 
 	return m_dS0*dS * tl::bose_cutoff(dE, m_dT, m_dcut) + dInc;
 }
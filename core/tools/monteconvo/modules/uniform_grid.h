@@ -74,6 +74,11 @@ class SqwUniformGrid : public SqwBase
 
 		virtual std::tuple<std::vector<t_real>, std::vector<t_real>>
 			disp(t_real dh, t_real dk, t_real dl) const override;
+		virtual std::size_t disp_into(t_real dh, t_real dk, t_real dl,
+			t_real *pE, t_real *pW, std::size_t iMaxBranches) const override;
+		virtual bool HasLineShape() const override { return true; }
+		virtual t_real line_shape(t_real dh, t_real dk, t_real dl, t_real dE,
+			const t_real *pE, const t_real *pW, std::size_t iNumBranches) const override;
 		virtual t_real operator()(t_real dh, t_real dk, t_real dl, t_real dE) const override;
 
 		virtual std::vector<t_var> GetVars() const override;
@@ -75,6 +75,9 @@ static const std::string g_strXmlRoot("taz/");
 static t_real g_dEpsRlu = EPS_RLU;
 static t_real g_dEpsPlane = EPS_PLANE;
 
+// tabulate the dispersion of the S(Q, E) model
+static bool g_bSqwCache = false;
+
 
 // ----------------------------------------------------------------------------
 // configuration
@@ -248,7 +251,7 @@ static std::shared_ptr<SqwBase> create_sqw_model(const std::string& strSqwIdent,
 		return nullptr;
 	}
 
-	std::shared_ptr<SqwBase> pSqw = construct_sqw(strSqwIdent, strSqwFile);
+	std::shared_ptr<SqwBase> pSqw = construct_sqw(strSqwIdent, strSqwFile, g_bSqwCache);
 	if(!pSqw)
 	{
 		tl::log_err("Unknown S(Q, E) model selected.");
@@ -531,15 +534,9 @@ static bool start_convo_1d(ConvoConfig& cfg, const tl::Prop<std::string>& xml, c
 				Ellipsoid4d<t_real> elli =
 					localreso.GenerateMC_deferred(cfg.neutron_count, vecNeutrons);
 
-				for(const ublas::vector<t_real>& vecHKLE : vecNeutrons)
-				{
-					// TODO: add an option to let the user choose if S(Q,E) is
-					// really the dynamical structure factor, or its absolute square
-					dS += (*pSqw)(vecHKLE[0], vecHKLE[1], vecHKLE[2], vecHKLE[3]);
-
-					for(int i=0; i<4; ++i)
-						dhklE_mean[i] += vecHKLE[i];
-				}
+				// TODO: add an option to let the user choose if S(Q,E) is
+				// really the dynamical structure factor, or its absolute square
+				dS += sqw_sum(*pSqw, vecNeutrons, dhklE_mean);
 
 				dS /= t_real(cfg.neutron_count*cfg.sample_step_count);
 				for(int i=0; i<4; ++i)
@@ -938,15 +935,9 @@ static bool start_convo_2d(ConvoConfig& cfg, const tl::Prop<std::string>& xml, c
 				Ellipsoid4d<t_real> elli =
 					localreso.GenerateMC_deferred(cfg.neutron_count, vecNeutrons);
 
-				for(const ublas::vector<t_real>& vecHKLE : vecNeutrons)
-				{
-					// TODO: add an option to let the user choose if S(Q,E) is
-					// really the dynamical structure factor, or its absolute square
-					dS += (*pSqw)(vecHKLE[0], vecHKLE[1], vecHKLE[2], vecHKLE[3]);
-
-					for(int i=0; i<4; ++i)
-						dhklE_mean[i] += vecHKLE[i];
-				}
+				// TODO: add an option to let the user choose if S(Q,E) is
+				// really the dynamical structure factor, or its absolute square
+				dS += sqw_sum(*pSqw, vecNeutrons, dhklE_mean);
 
 				dS /= t_real(cfg.neutron_count*cfg.sample_step_count);
 				for(int i=0; i<4; ++i)
@@ -1088,6 +1079,10 @@ int monteconvo_main(int argc, char** argv)
 			new opts::option_description("sqw-param-override",
 			opts::value<decltype(sqw_params)>(&sqw_params),
 			"override parameters for S(Q, E) model")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("sqw-cache",
+			opts::bool_switch(&g_bSqwCache),
+			"tabulate the dispersion of the S(Q, E) model and keep it for later runs")));
 
 		// dummy arg if launched from takin executable
 		bool bStartedFromTakin = false;
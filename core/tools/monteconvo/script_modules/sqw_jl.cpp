@@ -32,6 +32,8 @@
 #include "tlibs/file/file.h"
 #include "tlibs/ext/jl.h"
 
+#include <algorithm>
+
 using t_real = t_real_reso;
 
 
@@ -115,6 +117,9 @@ SqwJl::SqwJl(const std::string& strFile) : m_pmtx(std::make_shared<std::mutex>()
 		jl_get_global(jl_main_module, jl_symbol("TakinDisp")));
 	m_pBackground = reinterpret_cast<jl_function_t*>(
 		jl_get_global(jl_main_module, jl_symbol("TakinBackground")));
+	m_pSqwBatch = reinterpret_cast<jl_function_t*>(
+		jl_get_global(jl_main_module, jl_symbol("TakinSqw_batch!")));
+	m_pArrType = jl_apply_array_type((jl_value_t*)tl::jl_traits<t_real>::get_type(), 1);
 
 	PrintExceptions();
 
@@ -139,6 +144,9 @@ SqwJl::SqwJl(const std::string& strFile) : m_pmtx(std::make_shared<std::mutex>()
 	else
 		tl::log_warn("No TakinBackground function was found in \"", strFile, "\".");
 
+	if(m_pSqwBatch)
+		tl::log_info("TakinSqw_batch! function was found in \"", strFile, "\".");
+
 	// does the module have a TakinSqw function?
 	if(!m_pSqw)
 	{
@@ -294,6 +302,62 @@ t_real SqwJl::operator()(t_real dh, t_real dk, t_real dl, t_real dE) const
 }
 
 
+/**
+ * dynamical structure factor for a batch of points,
+ * calls TakinSqw_batch!(S, h, k, l, E) with arrays sharing the given buffers if it is available
+ */
+void SqwJl::sqw_batch(std::size_t iNum, const t_real *pH, const t_real *pK,
+	const t_real *pL, const t_real *pE, t_real *pS) const
+{
+	std::fill(pS, pS+iNum, t_real(0));
+	if(!m_bOk)
+	{
+		tl::log_err("Julia interpreter has not initialised, cannot query S(Q, E).");
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(*m_pmtx);
+
+	if(!m_pSqwBatch || !m_pArrType)
+	{
+		for(std::size_t i=0; i<iNum; ++i)
+		{
+			jl_value_t *phklE[4] =
+			{
+				tl::jl_traits<t_real>::box(pH[i]),
+				tl::jl_traits<t_real>::box(pK[i]),
+				tl::jl_traits<t_real>::box(pL[i]),
+				tl::jl_traits<t_real>::box(pE[i])
+			};
+			jl_value_t *pSqw = jl_call((jl_function_t*)m_pSqw, phklE, 4);
+			if(pSqw)
+				pS[i] = t_real(tl::jl_traits<t_real>::unbox(pSqw));
+		}
+
+		PrintExceptions();
+		return;
+	}
+
+	// the arrays do not own their buffers, no data is copied
+	jl_value_t **pArgs = nullptr;
+	JL_GC_PUSHARGS(pArgs, 5);
+	pArgs[0] = (jl_value_t*)jl_ptr_to_array_1d((jl_value_t*)m_pArrType, pS, iNum, 0);
+	pArgs[1] = (jl_value_t*)jl_ptr_to_array_1d((jl_value_t*)m_pArrType, const_cast<t_real*>(pH), iNum, 0);
+	pArgs[2] = (jl_value_t*)jl_ptr_to_array_1d((jl_value_t*)m_pArrType, const_cast<t_real*>(pK), iNum, 0);
+	pArgs[3] = (jl_value_t*)jl_ptr_to_array_1d((jl_value_t*)m_pArrType, const_cast<t_real*>(pL), iNum, 0);
+	pArgs[4] = (jl_value_t*)jl_ptr_to_array_1d((jl_value_t*)m_pArrType, const_cast<t_real*>(pE), iNum, 0);
+
+	jl_call((jl_function_t*)m_pSqwBatch, pArgs, 5);
+	JL_GC_POP();
+
+	if(jl_exception_occurred())
+	{
+		PrintExceptions();
+		std::fill(pS, pS+iNum, t_real(0));
+	}
+}
+
+
 /**
  * background function
  */
@@ -444,6 +508,9 @@ SqwBase* SqwJl::shallow_copy() const
 	pSqw->m_pInit = this->m_pInit;
 	pSqw->m_pSqw = this->m_pSqw;
 	pSqw->m_pDisp = this->m_pDisp;
+	pSqw->m_pBackground = this->m_pBackground;
+	pSqw->m_pSqwBatch = this->m_pSqwBatch;
+	pSqw->m_pArrType = this->m_pArrType;
 	pSqw->m_pmtx = this->m_pmtx;
 
 	return pSqw;
@@ -470,13 +537,15 @@ std::tuple<std::string, std::string, std::string, std::string> sqw_info()
 std::shared_ptr<SqwBase> sqw_construct(const std::string& strCfgFile)
 {
 	//tl::log_info("In ", __func__, ".");
-	return std::make_shared<SqwProc<SqwJl>>(strCfgFile);
+	return std::make_shared<SqwProc<SqwJl>>(strCfgFile.c_str(),
+		SqwProcStartMode::START_PARENT_FORK_CHILD, nullptr, nullptr, get_sqw_proc_children());
 }
 
 
 SqwBase* sqw_construct_raw(const std::string& strCfgFile)
 {
-	return new SqwProc<SqwJl>(strCfgFile);
+	return new SqwProc<SqwJl>(strCfgFile.c_str(),
+		SqwProcStartMode::START_PARENT_FORK_CHILD, nullptr, nullptr, get_sqw_proc_children());
 }
 
 
@@ -45,6 +45,11 @@ protected:
 	/*jl_function_t*/ void *m_pDisp = nullptr;
 	/*jl_function_t*/ void *m_pBackground = nullptr;
 
+	// optional in-place batch function TakinSqw_batch!(S, h, k, l, E)
+	/*jl_function_t*/ void *m_pSqwBatch = nullptr;
+	// Vector{t_real} type used to wrap the batch buffers
+	/*jl_value_t*/ void *m_pArrType = nullptr;
+
 	// filter variables that don't start with the given prefix
 	std::string m_strVarPrefix = "g_";
 
@@ -61,9 +66,13 @@ public:
 		t_real_reso dh, t_real_reso dk, t_real_reso dl) const override;
 	virtual t_real_reso operator()(
 		t_real_reso dh, t_real_reso dk, t_real_reso dl, t_real_reso dE) const override;
+	virtual void sqw_batch(std::size_t iNum, const t_real_reso *pH, const t_real_reso *pK,
+		const t_real_reso *pL, const t_real_reso *pE, t_real_reso *pS) const override;
 	virtual t_real_reso GetBackground(
 		t_real_reso dh, t_real_reso dk, t_real_reso dl, t_real_reso dE) const override;
 
+	virtual bool HasIndependentCopies() const override { return false; }	// copies share the module
+
 	virtual std::vector<SqwBase::t_var> GetVars() const override;
 	virtual void SetVars(const std::vector<SqwBase::t_var>&) override;
 
@@ -34,6 +34,9 @@
 #include <boost/dll/runtime_symbol_info.hpp>
 #include <boost/python/stl_iterator.hpp>
 
+#include <algorithm>
+#include <cstring>
+
 using t_real = t_real_reso;
 
 
@@ -49,6 +52,56 @@ Please refer to the Takin help for more information and tutorials.)RAWSTR";
 #define MAX_PARAM_VAL_SIZE 128
 
 
+/**
+ * holds the global interpreter lock in the current scope,
+ * it is released after each call, so other threads are not blocked between batches
+ */
+class PyGilLock
+{
+private:
+	PyGILState_STATE m_state;
+
+public:
+	PyGilLock() : m_state(::PyGILState_Ensure()) {}
+	~PyGilLock() { ::PyGILState_Release(m_state); }
+
+	PyGilLock(const PyGilLock&) = delete;
+	const PyGilLock& operator=(const PyGilLock&) = delete;
+};
+
+
+/**
+ * wraps a buffer as read-only numpy array without copying it
+ */
+static py::object to_np_array(const py::object& np_frombuffer, const py::object& np_dtype,
+	const t_real* pArr, std::size_t iNum)
+{
+	py::object mem{py::handle<>(::PyMemoryView_FromMemory(
+		const_cast<char*>(reinterpret_cast<const char*>(pArr)),
+		Py_ssize_t(iNum*sizeof(t_real)), PyBUF_READ))};
+
+	return np_frombuffer(mem, np_dtype);
+}
+
+
+/**
+ * copies a numpy array, a list or a scalar into a vector
+ */
+static void from_np_array(const py::object& np_ascontiguousarray, const py::object& np_dtype,
+	const py::object& arr, std::vector<t_real>& vec)
+{
+	py::object arrContig = np_ascontiguousarray(arr, np_dtype);
+
+	Py_buffer buf;
+	if(::PyObject_GetBuffer(arrContig.ptr(), &buf, PyBUF_C_CONTIGUOUS) != 0)
+		py::throw_error_already_set();
+
+	vec.resize(std::size_t(buf.len) / sizeof(t_real));
+	std::memcpy(vec.data(), buf.buf, vec.size()*sizeof(t_real));
+	::PyBuffer_Release(&buf);
+}
+
+
 SqwPy::SqwPy(const std::string& strFile) : m_pmtx(std::make_shared<std::mutex>())
 {
 	if(!tl::file_exists(strFile.c_str()))
@@ -62,24 +115,28 @@ SqwPy::SqwPy(const std::string& strFile) : m_pmtx(std::make_shared<std::mutex>()
 	std::string strMod = tl::get_file_noext(tl::get_file_nodir(strFile));
 	const bool bSetScriptCWD = true;
 
-	try	// mandatory stuff
+	static bool bInited = false;
+	if(!bInited)
 	{
-		static bool bInited = false;
-		if(!bInited)
+		::Py_InitializeEx(0);
+		if(!::Py_IsInitialized())
 		{
-			::Py_InitializeEx(0);
-			if(!::Py_IsInitialized())
-			{
-				tl::log_err("Cannot initialise Python interpreter.");
-				return;
-			}
-
-			std::string strPy = Py_GetVersion();
-			tl::find_all_and_replace(strPy, std::string("\n"), std::string(", "));
-			tl::log_debug("Initialised Python interpreter version ", strPy, ".");
-			bInited = true;
+			tl::log_err("Cannot initialise Python interpreter.");
+			return;
 		}
 
+		std::string strPy = Py_GetVersion();
+		tl::find_all_and_replace(strPy, std::string("\n"), std::string(", "));
+		tl::log_debug("Initialised Python interpreter version ", strPy, ".");
+
+		// release the interpreter lock, it is acquired by PyGilLock for every call
+		::PyEval_SaveThread();
+		bInited = true;
+	}
+
+	PyGilLock gil;
+	try	// mandatory stuff
+	{
 		// set script paths
 		m_sys = py::import("sys");
 		py::dict sysdict = py::extract<py::dict>(m_sys.attr("__dict__"));
@@ -141,6 +198,26 @@ SqwPy::SqwPy(const std::string& strFile) : m_pmtx(std::make_shared<std::mutex>()
 				m_background = moddict["TakinBackground"];
 			else
 				tl::log_warn("Python script has no TakinBackground function.");
+
+			// numpy is needed for the vectorised interface
+			try
+			{
+				py::object np = py::import("numpy");
+				m_np_frombuffer = np.attr("frombuffer");
+				m_np_ascontiguousarray = np.attr("ascontiguousarray");
+				m_np_dtype = np.attr("dtype")(sizeof(t_real) == 4 ? "f4" : "f8");
+			}
+			catch(const py::error_already_set& ex)
+			{
+				PyErr_Clear();
+				tl::log_warn("Cannot import numpy, the vectorised interface is not available.");
+			}
+
+			if(moddict.has_key("TakinSqwBatch") && !m_np_frombuffer.is_none())
+			{
+				m_SqwBatch = moddict["TakinSqwBatch"];
+				tl::log_debug("Using vectorised TakinSqwBatch function.");
+			}
 		}
 		catch(const py::error_already_set& ex) {}
 	}
@@ -155,6 +232,15 @@ SqwPy::SqwPy(const std::string& strFile) : m_pmtx(std::make_shared<std::mutex>()
 
 SqwPy::~SqwPy()
 {
+	if(::Py_IsInitialized())
+	{
+		// release the references while holding the interpreter lock
+		PyGilLock gil;
+		m_sys = m_os = m_mod = py::object();
+		m_Sqw = m_background = m_disp = m_Init = py::object();
+		m_SqwBatch = m_np_frombuffer = m_np_ascontiguousarray = m_np_dtype = py::object();
+	}
+
 	//tl::log_debug("Unloading Python interpreter.");
 	//Py_FinalizeEx();
 }
@@ -174,12 +260,22 @@ std::tuple<std::vector<t_real>, std::vector<t_real>>
 
 
 	std::lock_guard<std::mutex> lock(*m_pmtx);
+	PyGilLock gil;
 
 	std::vector<t_real> vecEs, vecWs;
 
 	try
 	{
-		if(!!m_disp)
+		if(!!m_disp && !m_np_ascontiguousarray.is_none())
+		{
+			// read the energies and weights via numpy, which also accepts lists
+			py::object lst = m_disp(dh, dk, dl);
+			if(py::len(lst) >= 1)
+				from_np_array(m_np_ascontiguousarray, m_np_dtype, lst[0], vecEs);
+			if(py::len(lst) >= 2)
+				from_np_array(m_np_ascontiguousarray, m_np_dtype, lst[1], vecWs);
+		}
+		else if(!!m_disp)
 		{
 			py::object lst = m_disp(dh, dk, dl);
 			py::stl_input_iterator<py::object> iterLst(lst);
@@ -229,6 +325,7 @@ t_real SqwPy::operator()(t_real dh, t_real dk, t_real dl, t_real dE) const
 
 
 	std::lock_guard<std::mutex> lock(*m_pmtx);
+	PyGilLock gil;
 	try
 	{
 		return py::extract<t_real>(m_Sqw(dh, dk, dl, dE));
@@ -243,6 +340,56 @@ t_real SqwPy::operator()(t_real dh, t_real dk, t_real dl, t_real dE) const
 }
 
 
+/**
+ * S(Q,E) for a batch of mc points, calls TakinSqwBatch with numpy arrays if it is available
+ */
+void SqwPy::sqw_batch(std::size_t iNum, const t_real *pH, const t_real *pK,
+	const t_real *pL, const t_real *pE, t_real *pS) const
+{
+	std::fill(pS, pS+iNum, t_real(0));
+	if(!m_bOk)
+	{
+		tl::log_err("Interpreter has not initialised, cannot query S(Q, E).");
+		return;
+	}
+
+
+	std::lock_guard<std::mutex> lock(*m_pmtx);
+	PyGilLock gil;
+	try
+	{
+		if(m_SqwBatch.is_none())
+		{
+			for(std::size_t i=0; i<iNum; ++i)
+				pS[i] = py::extract<t_real>(m_Sqw(pH[i], pK[i], pL[i], pE[i]));
+			return;
+		}
+
+		// the arrays share the memory of the given buffers
+		py::object arrS = m_SqwBatch(
+			to_np_array(m_np_frombuffer, m_np_dtype, pH, iNum),
+			to_np_array(m_np_frombuffer, m_np_dtype, pK, iNum),
+			to_np_array(m_np_frombuffer, m_np_dtype, pL, iNum),
+			to_np_array(m_np_frombuffer, m_np_dtype, pE, iNum));
+
+		std::vector<t_real> vecS;
+		from_np_array(m_np_ascontiguousarray, m_np_dtype, arrS, vecS);
+
+		if(vecS.size() == iNum)
+			std::copy(vecS.begin(), vecS.end(), pS);
+		else if(vecS.size() == 1)
+			std::fill(pS, pS+iNum, vecS[0]);
+		else
+			tl::log_err("TakinSqwBatch returned ", vecS.size(), " values for ", iNum, " points.");
+	}
+	catch(const py::error_already_set& ex)
+	{
+		PyErr_Print();
+		PyErr_Clear();
+	}
+}
+
+
 /**
  * background function, only queried for every mc point
  */
@@ -255,6 +402,7 @@ t_real SqwPy::GetBackground(t_real dh, t_real dk, t_real dl, t_real dE) const
 	}
 
 	std::lock_guard<std::mutex> lock(*m_pmtx);
+	PyGilLock gil;
 	try
 	{
 		if(!!m_background)
@@ -282,6 +430,7 @@ std::vector<SqwBase::t_var> SqwPy::GetVars() const
 		return vecVars;
 	}
 
+	PyGilLock gil;
 	try
 	{
 		py::dict dict = py::extract<py::dict>(m_mod.attr("__dict__"));
@@ -342,6 +491,7 @@ void SqwPy::SetVars(const std::vector<SqwBase::t_var>& vecVars)
 		return;
 	}
 
+	PyGilLock gil;
 	try
 	{
 		py::dict dict = py::extract<py::dict>(m_mod.attr("__dict__"));
@@ -403,6 +553,11 @@ void SqwPy::SetVars(const std::vector<SqwBase::t_var>& vecVars)
 
 SqwBase* SqwPy::shallow_copy() const
 {
+	// the interpreter is not running if the script could not be found
+	std::unique_ptr<PyGilLock> gil;
+	if(::Py_IsInitialized())
+		gil = std::make_unique<PyGilLock>();
+
 	SqwPy* pSqw = new SqwPy();
 	*static_cast<SqwBase*>(pSqw) = *static_cast<const SqwBase*>(this);
 
@@ -414,6 +569,10 @@ SqwBase* SqwPy::shallow_copy() const
 	pSqw->m_Init = this->m_Init;
 	pSqw->m_disp = this->m_disp;
 	pSqw->m_background = this->m_background;
+	pSqw->m_SqwBatch = this->m_SqwBatch;
+	pSqw->m_np_frombuffer = this->m_np_frombuffer;
+	pSqw->m_np_ascontiguousarray = this->m_np_ascontiguousarray;
+	pSqw->m_np_dtype = this->m_np_dtype;
 
 	return pSqw;
 }
@@ -442,13 +601,15 @@ std::shared_ptr<SqwBase> sqw_construct(const std::string& strCfgFile)
 {
 	//tl::log_info("In ", __func__, ".");
 	//return std::make_shared<SqwPy>(strCfgFile);
-	return std::make_shared<SqwProc<SqwPy>>(strCfgFile);
+	return std::make_shared<SqwProc<SqwPy>>(strCfgFile.c_str(),
+		SqwProcStartMode::START_PARENT_FORK_CHILD, nullptr, nullptr, get_sqw_proc_children());
 }
 
 
 SqwBase* sqw_construct_raw(const std::string& strCfgFile)
 {
-	return new SqwProc<SqwPy>(strCfgFile);
+	return new SqwProc<SqwPy>(strCfgFile.c_str(),
+		SqwProcStartMode::START_PARENT_FORK_CHILD, nullptr, nullptr, get_sqw_proc_children());
 }
 
 
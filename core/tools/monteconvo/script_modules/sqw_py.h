@@ -51,6 +51,9 @@ protected:
 	py::object m_sys, m_os, m_mod;
 	py::object m_Sqw, m_background, m_disp, m_Init;
 
+	// optional vectorised S(Q, E) function and the numpy functions to call it
+	py::object m_SqwBatch, m_np_frombuffer, m_np_ascontiguousarray, m_np_dtype;
+
 	// filter variables that don't start with the given prefix
 	std::string m_strVarPrefix = "g_";
 
@@ -62,8 +65,12 @@ public:
 	virtual std::tuple<std::vector<t_real_reso>, std::vector<t_real_reso>>
 		disp(t_real_reso dh, t_real_reso dk, t_real_reso dl) const override;
 	virtual t_real_reso operator()(t_real_reso dh, t_real_reso dk, t_real_reso dl, t_real_reso dE) const override;
+	virtual void sqw_batch(std::size_t iNum, const t_real_reso *pH, const t_real_reso *pK,
+		const t_real_reso *pL, const t_real_reso *pE, t_real_reso *pS) const override;
 	virtual t_real_reso GetBackground(t_real_reso dh, t_real_reso dk, t_real_reso dl, t_real_reso dE) const override;
 
+	virtual bool HasIndependentCopies() const override { return false; }	// copies share the module
+
 	virtual std::vector<SqwBase::t_var> GetVars() const override;
 	virtual void SetVars(const std::vector<SqwBase::t_var>&) override;
 
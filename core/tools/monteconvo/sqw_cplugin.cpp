@@ -0,0 +1,435 @@
+/**
+ * S(Q, E) module using the C-level plugin interface
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date 2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "sqw_cplugin.h"
+#include "tlibs/log/log.h"
+#include "tlibs/string/string.h"
+
+#include <atomic>
+#include <type_traits>
+
+using t_real = t_real_reso;
+
+// the plugin interface uses double, other types are converted
+static constexpr bool g_bRealIsDouble = std::is_same<t_real, double>::value;
+
+
+// the last per-thread instance looked up by this thread
+struct t_thread_inst_cache
+{
+	std::uint64_t iGen = 0;
+	const void *pInst = nullptr;
+};
+
+static thread_local t_thread_inst_cache g_threadInstCache;
+
+// generation 0 is never used, so an empty cache never matches
+static std::atomic<std::uint64_t> g_iNextCloneGen{1};
+
+
+
+SqwCPlugin::SqwCPlugin(const takin_sqw_interface *pPlugin, const std::string& strCfgFile)
+	: SqwCPlugin(pPlugin, pPlugin->create(strCfgFile.c_str()))
+{
+	m_strCfgFile = strCfgFile;
+
+	if(m_pInst)
+	{
+		const char* pcStrategy = "serialised calls";
+		if(m_strategy == SqwCPluginStrategy::SHARED)
+			pcStrategy = "shared instance";
+		else if(m_strategy == SqwCPluginStrategy::PER_THREAD)
+			pcStrategy = "per-thread instances";
+
+		tl::log_debug("S(Q, E) plugin \"", m_pPlugin->ident, "\" uses ", pcStrategy,
+			HasCap(TAKIN_SQW_CAP_BATCH) ? " and batch evaluation." : ".");
+	}
+	else
+	{
+		tl::log_err("S(Q, E) plugin \"", m_pPlugin->ident, "\" could not create a module instance.");
+	}
+}
+
+
+/**
+ * takes ownership of the instance pInst
+ */
+SqwCPlugin::SqwCPlugin(const takin_sqw_interface *pPlugin, void *pInst)
+	: m_pPlugin{pPlugin}, m_pInst{pInst}
+{
+	m_bOk = (m_pInst != nullptr);
+	m_iCloneGen = g_iNextCloneGen++;
+
+	// pick the fastest safe calling strategy
+	if(HasCap(TAKIN_SQW_CAP_THREADSAFE))
+		m_strategy = SqwCPluginStrategy::SHARED;
+	else if(HasCap(TAKIN_SQW_CAP_CLONE))
+		m_strategy = SqwCPluginStrategy::PER_THREAD;
+	else
+		m_strategy = SqwCPluginStrategy::SERIALISED;
+}
+
+
+SqwCPlugin::~SqwCPlugin()
+{
+	std::lock_guard<std::mutex> lock(m_mtx);
+	ClearThreadInsts();
+
+	if(m_pInst)
+		m_pPlugin->destroy(m_pInst);
+	m_pInst = nullptr;
+}
+
+
+bool SqwCPlugin::CheckPlugin(const takin_sqw_interface *pPlugin, std::string& strErr)
+{
+	if(!pPlugin)
+	{
+		strErr = "No function table given.";
+		return false;
+	}
+
+	if(pPlugin->abi_version != TAKIN_SQW_ABI_VERSION)
+	{
+		strErr = "Plugin interface version " + tl::var_to_str(pPlugin->abi_version)
+			+ " is not supported, expected version "
+			+ tl::var_to_str(TAKIN_SQW_ABI_VERSION) + ".";
+		return false;
+	}
+
+	if(pPlugin->struct_size < sizeof(takin_sqw_interface))
+	{
+		strErr = "Function table is incomplete.";
+		return false;
+	}
+
+	if(!pPlugin->ident || pPlugin->ident[0] == 0)
+	{
+		strErr = "No module identifier given.";
+		return false;
+	}
+
+	if(!pPlugin->create || !pPlugin->destroy || !pPlugin->sqw
+		|| !pPlugin->get_vars || !pPlugin->set_var)
+	{
+		strErr = "Mandatory functions are missing.";
+		return false;
+	}
+
+	if(((pPlugin->caps & TAKIN_SQW_CAP_BATCH) && !pPlugin->sqw_batch)
+		|| ((pPlugin->caps & TAKIN_SQW_CAP_DISP) && !pPlugin->disp)
+		|| ((pPlugin->caps & TAKIN_SQW_CAP_BACKGROUND) && !pPlugin->background)
+		|| ((pPlugin->caps & TAKIN_SQW_CAP_CLONE) && !pPlugin->clone))
+	{
+		strErr = "Functions for the announced capabilities are missing.";
+		return false;
+	}
+
+	return true;
+}
+
+
+/**
+ * destroys the per-thread clones, m_mtx has to be locked.
+ * the clones are destroyed immediately, so no other thread may be evaluating the module,
+ * see SetVars()
+ */
+void SqwCPlugin::ClearThreadInsts()
+{
+	for(auto& pair : m_mapThreadInst)
+	{
+		if(pair.second)
+			m_pPlugin->destroy(pair.second);
+	}
+
+	m_mapThreadInst.clear();
+
+	// invalidate the threads' lookup caches
+	m_iCloneGen = g_iNextCloneGen++;
+}
+
+
+/**
+ * gets the calling thread's clone of the module instance, creating it on first use
+ */
+const void* SqwCPlugin::GetThreadInst() const
+{
+	// fast path without locking
+	const std::uint64_t iGen = m_iCloneGen.load();
+	if(g_threadInstCache.iGen == iGen)
+		return g_threadInstCache.pInst;
+
+	std::lock_guard<std::mutex> lock(m_mtx);
+
+	void *&pInst = m_mapThreadInst[std::this_thread::get_id()];
+	if(!pInst)
+	{
+		pInst = m_pPlugin->clone(m_pInst);
+		if(!pInst)
+		{
+			// the clone hook failed, the caller has to serialise its calls on the shared instance;
+			// the cache entry prevents further attempts until the variables change
+			tl::log_err("S(Q, E) plugin \"", m_pPlugin->ident, "\" could not clone its module instance.");
+			m_mapThreadInst.erase(std::this_thread::get_id());
+
+			g_threadInstCache.iGen = m_iCloneGen.load();
+			g_threadInstCache.pInst = m_pInst;
+			return m_pInst;
+		}
+	}
+
+	g_threadInstCache.iGen = m_iCloneGen.load();
+	g_threadInstCache.pInst = pInst;
+	return pInst;
+}
+
+
+/**
+ * calls func with the module instance to be used by the calling thread
+ */
+template<class t_func>
+auto SqwCPlugin::Call(t_func&& func) const -> decltype(func(m_pInst))
+{
+	switch(m_strategy)
+	{
+		case SqwCPluginStrategy::SHARED:
+			return func(m_pInst);
+		case SqwCPluginStrategy::PER_THREAD:
+		{
+			const void *pInst = GetThreadInst();
+			if(pInst != m_pInst)
+				return func(pInst);
+
+			// no clone available, fall back to serialised calls
+			std::lock_guard<std::mutex> lock(m_mtx);
+			return func(m_pInst);
+		}
+		case SqwCPluginStrategy::SERIALISED:
+		default:
+		{
+			std::lock_guard<std::mutex> lock(m_mtx);
+			return func(m_pInst);
+		}
+	}
+}
+
+
+
+std::tuple<std::vector<t_real>, std::vector<t_real>>
+SqwCPlugin::disp(t_real dh, t_real dk, t_real dl) const
+{
+	if(!m_pInst || !HasCap(TAKIN_SQW_CAP_DISP))
+		return SqwBase::disp(dh, dk, dl);
+
+	return disp_vecs(dh, dk, dl);
+}
+
+
+std::size_t SqwCPlugin::disp_into(t_real dh, t_real dk, t_real dl,
+	t_real *pE, t_real *pW, std::size_t iMaxBranches) const
+{
+	if(!m_pInst || !HasCap(TAKIN_SQW_CAP_DISP))
+		return 0;
+
+	return Call([&](const void *pInst) -> std::size_t
+	{
+		if(g_bRealIsDouble)
+		{
+			return m_pPlugin->disp(pInst, dh, dk, dl,
+				reinterpret_cast<double*>(pE), reinterpret_cast<double*>(pW), iMaxBranches);
+		}
+
+		std::vector<double> vecE(iMaxBranches), vecW(iMaxBranches);
+		std::size_t iNum = m_pPlugin->disp(pInst, dh, dk, dl, vecE.data(), vecW.data(), iMaxBranches);
+		for(std::size_t i=0; i<std::min(iNum, iMaxBranches); ++i)
+		{
+			pE[i] = t_real(vecE[i]);
+			pW[i] = t_real(vecW[i]);
+		}
+		return iNum;
+	});
+}
+
+
+t_real SqwCPlugin::operator()(t_real dh, t_real dk, t_real dl, t_real dE) const
+{
+	if(!m_pInst)
+		return t_real(0);
+
+	return Call([&](const void *pInst) -> t_real
+	{
+		return t_real(m_pPlugin->sqw(pInst, dh, dk, dl, dE));
+	});
+}
+
+
+void SqwCPlugin::sqw_batch(std::size_t iNum, const t_real *pH, const t_real *pK,
+	const t_real *pL, const t_real *pE, t_real *pS) const
+{
+	if(!m_pInst)
+	{
+		std::fill(pS, pS+iNum, t_real(0));
+		return;
+	}
+
+	// the instance is only looked up or locked once for the whole batch
+	Call([&](const void *pInst) -> void
+	{
+		if(HasCap(TAKIN_SQW_CAP_BATCH) && g_bRealIsDouble)
+		{
+			m_pPlugin->sqw_batch(pInst, iNum,
+				reinterpret_cast<const double*>(pH), reinterpret_cast<const double*>(pK),
+				reinterpret_cast<const double*>(pL), reinterpret_cast<const double*>(pE),
+				reinterpret_cast<double*>(pS));
+		}
+		else if(HasCap(TAKIN_SQW_CAP_BATCH))
+		{
+			std::vector<double> vecH(pH, pH+iNum), vecK(pK, pK+iNum),
+				vecL(pL, pL+iNum), vecE(pE, pE+iNum), vecS(iNum);
+			m_pPlugin->sqw_batch(pInst, iNum, vecH.data(), vecK.data(),
+				vecL.data(), vecE.data(), vecS.data());
+			std::copy(vecS.begin(), vecS.end(), pS);
+		}
+		else
+		{
+			for(std::size_t i=0; i<iNum; ++i)
+				pS[i] = t_real(m_pPlugin->sqw(pInst, pH[i], pK[i], pL[i], pE[i]));
+		}
+	});
+}
+
+
+t_real SqwCPlugin::GetBackground(t_real dh, t_real dk, t_real dl, t_real dE) const
+{
+	if(!m_pInst || !HasCap(TAKIN_SQW_CAP_BACKGROUND))
+		return t_real(0);
+
+	return Call([&](const void *pInst) -> t_real
+	{
+		return t_real(m_pPlugin->background(pInst, dh, dk, dl, dE));
+	});
+}
+
+
+
+std::vector<SqwBase::t_var> SqwCPlugin::GetVars() const
+{
+	std::vector<SqwBase::t_var> vecVars;
+	if(!m_pInst)
+		return vecVars;
+
+	std::string strVars;
+	{
+		std::lock_guard<std::mutex> lock(m_mtx);
+
+		std::size_t iLen = m_pPlugin->get_vars(m_pInst, nullptr, 0);
+		if(iLen == 0)
+			return vecVars;
+
+		std::vector<char> vecBuf(iLen, 0);
+		m_pPlugin->get_vars(m_pInst, vecBuf.data(), vecBuf.size());
+		strVars = vecBuf.data();
+	}
+
+	// lines of "ident\ttype\tvalue"
+	std::vector<std::string> vecLines;
+	tl::get_tokens<std::string, std::string>(strVars, "\n", vecLines);
+	for(const std::string& strLine : vecLines)
+	{
+		std::vector<std::string> vecFields;
+		tl::get_tokens<std::string, std::string>(strLine, "\t", vecFields);
+		if(vecFields.size() < 2)
+			continue;
+		if(vecFields.size() < 3)
+			vecFields.emplace_back("");
+
+		vecVars.emplace_back(SqwBase::t_var{vecFields[0], vecFields[1], vecFields[2]});
+	}
+
+	return vecVars;
+}
+
+
+void SqwCPlugin::SetVars(const std::vector<SqwBase::t_var>& vecVars)
+{
+	if(!m_pInst || !vecVars.size())
+		return;
+
+	std::lock_guard<std::mutex> lock(m_mtx);
+	for(const SqwBase::t_var& var : vecVars)
+		m_pPlugin->set_var(m_pInst, std::get<0>(var).c_str(), std::get<2>(var).c_str());
+
+	// the clones have to be recreated with the new values
+	ClearThreadInsts();
+}
+
+
+bool SqwCPlugin::SetVarIfAvail(const std::string& strKey, const std::string& strNewVal)
+{
+	if(!m_pInst)
+		return false;
+
+	std::lock_guard<std::mutex> lock(m_mtx);
+	bool bSet = m_pPlugin->set_var(m_pInst, strKey.c_str(), strNewVal.c_str()) != 0;
+	if(bSet)
+		ClearThreadInsts();
+	return bSet;
+}
+
+
+
+SqwBase* SqwCPlugin::shallow_copy() const
+{
+	SqwCPlugin *pCopy = nullptr;
+
+	if(m_pInst && HasCap(TAKIN_SQW_CAP_CLONE))
+	{
+		void *pInst = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(m_mtx);
+			pInst = m_pPlugin->clone(m_pInst);
+		}
+
+		if(pInst)
+		{
+			pCopy = new SqwCPlugin(m_pPlugin, pInst);
+			pCopy->m_strCfgFile = m_strCfgFile;
+		}
+	}
+
+	if(!pCopy)
+	{
+		// no clone hook: create a new instance and transfer the variables
+		pCopy = new SqwCPlugin(m_pPlugin, m_pPlugin->create(m_strCfgFile.c_str()));
+		pCopy->m_strCfgFile = m_strCfgFile;
+		pCopy->SetVars(GetVars());
+	}
+
+	pCopy->m_vecFit = m_vecFit;
+	return pCopy;
+}
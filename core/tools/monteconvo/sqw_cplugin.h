@@ -0,0 +1,122 @@
+/**
+ * S(Q, E) module using the C-level plugin interface
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date 2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef __MCONV_SQW_CPLUGIN_H__
+#define __MCONV_SQW_CPLUGIN_H__
+
+#include "sqwbase.h"
+#include "sqw_plugin_abi.h"
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <unordered_map>
+#include <string>
+#include <cstdint>
+
+
+/**
+ * how the plugin functions are called from several threads
+ */
+enum class SqwCPluginStrategy
+{
+	SHARED,         // thread-safe plugin: all threads use the same instance
+	PER_THREAD,     // clonable plugin: each thread uses its own instance
+	SERIALISED,     // neither: calls are serialised by a mutex
+};
+
+
+class SqwCPlugin : public SqwBase
+{
+protected:
+	const takin_sqw_interface *m_pPlugin = nullptr;
+
+	// instance created in the constructor, the one the variables are set on
+	void *m_pInst = nullptr;
+
+	SqwCPluginStrategy m_strategy = SqwCPluginStrategy::SERIALISED;
+
+	// needed to create new instances if the plugin cannot clone them
+	std::string m_strCfgFile{};
+
+	// per-thread clones of m_pInst, recreated when variables change
+	mutable std::unordered_map<std::thread::id, void*> m_mapThreadInst{};
+	mutable std::mutex m_mtx{};
+
+	// unique id of the current set of clones, used for the per-thread lookup cache
+	std::atomic<std::uint64_t> m_iCloneGen{0};
+
+
+protected:
+	SqwCPlugin(const takin_sqw_interface *pPlugin, void *pInst);
+
+	bool HasCap(std::uint32_t iCap) const { return (m_pPlugin->caps & iCap) != 0; }
+
+	const void* GetThreadInst() const;
+	void ClearThreadInsts();
+
+	template<class t_func> auto Call(t_func&& func) const -> decltype(func(m_pInst));
+
+
+public:
+	SqwCPlugin(const takin_sqw_interface *pPlugin, const std::string& strCfgFile);
+	virtual ~SqwCPlugin();
+
+	SqwCPlugin(const SqwCPlugin&) = delete;
+	const SqwCPlugin& operator=(const SqwCPlugin&) = delete;
+
+	/**
+	 * checks the version and mandatory entries of a plugin function table
+	 */
+	static bool CheckPlugin(const takin_sqw_interface *pPlugin, std::string& strErr);
+
+	SqwCPluginStrategy GetStrategy() const { return m_strategy; }
+
+	virtual std::tuple<std::vector<t_real_reso>, std::vector<t_real_reso>>
+		disp(t_real_reso dh, t_real_reso dk, t_real_reso dl) const override;
+	virtual std::size_t disp_into(t_real_reso dh, t_real_reso dk, t_real_reso dl,
+		t_real_reso *pE, t_real_reso *pW, std::size_t iMaxBranches) const override;
+
+	virtual t_real_reso operator()(t_real_reso dh, t_real_reso dk, t_real_reso dl, t_real_reso dE) const override;
+	virtual void sqw_batch(std::size_t iNum, const t_real_reso *pH, const t_real_reso *pK,
+		const t_real_reso *pL, const t_real_reso *pE, t_real_reso *pS) const override;
+
+	virtual t_real_reso GetBackground(t_real_reso dh, t_real_reso dk, t_real_reso dl, t_real_reso dE) const override;
+
+	virtual std::vector<SqwBase::t_var> GetVars() const override;
+
+	// the variables must not be changed while other threads evaluate this object,
+	// as this destroys the per-thread clones they are using; copies can be changed independently
+	virtual void SetVars(const std::vector<SqwBase::t_var>&) override;
+	virtual bool SetVarIfAvail(const std::string& strKey, const std::string& strNewVal) override;
+
+	virtual SqwBase* shallow_copy() const override;
+};
+
+
+#endif
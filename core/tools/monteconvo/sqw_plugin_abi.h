@@ -0,0 +1,114 @@
+/**
+ * C-level interface for S(Q, E) plugin modules
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date 2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+/*
+ * A plugin exports the C function "takin_sqw_plugin" returning a pointer to a
+ * static takin_sqw_interface table. Only plain C types cross the library boundary,
+ * so plugins do not need to be rebuilt for every Takin version, only when
+ * TAKIN_SQW_ABI_VERSION changes. Entries added in later minor revisions are
+ * appended at the end of the table and detected via struct_size.
+ */
+
+#ifndef __MCONV_SQW_PLUGIN_ABI_H__
+#define __MCONV_SQW_PLUGIN_ABI_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define TAKIN_SQW_ABI_VERSION 1
+
+
+/* capability flags */
+#define TAKIN_SQW_CAP_THREADSAFE  (1u << 0)   /* sqw/sqw_batch/disp/background may be called concurrently on one instance */
+#define TAKIN_SQW_CAP_BATCH       (1u << 1)   /* sqw_batch is implemented */
+#define TAKIN_SQW_CAP_DISP        (1u << 2)   /* disp is implemented */
+#define TAKIN_SQW_CAP_BACKGROUND  (1u << 3)   /* background is implemented */
+#define TAKIN_SQW_CAP_CLONE       (1u << 4)   /* clone is implemented, e.g. for per-thread instances */
+
+
+typedef struct takin_sqw_interface
+{
+	/* TAKIN_SQW_ABI_VERSION and sizeof(takin_sqw_interface) of the plugin */
+	uint32_t abi_version;
+	uint32_t struct_size;
+
+	/* combination of TAKIN_SQW_CAP_* */
+	uint32_t caps;
+
+	/* module identifier, long name and help text */
+	const char *ident;
+	const char *long_name;
+	const char *help;
+
+	/* creates an instance from a configuration file, returns NULL on failure */
+	void* (*create)(const char *cfg_file);
+	void (*destroy)(void *inst);
+
+	/* independent copy of an instance including its current variables, optional */
+	void* (*clone)(const void *inst);
+
+	/* dynamical structure factor at one point */
+	double (*sqw)(const void *inst, double h, double k, double l, double E);
+
+	/* dynamical structure factor at n points, optional */
+	void (*sqw_batch)(const void *inst, size_t n,
+		const double *h, const double *k, const double *l, const double *E, double *S);
+
+	/* writes at most max_branches energies and weights, returns the total number of branches, optional */
+	size_t (*disp)(const void *inst, double h, double k, double l,
+		double *E, double *weights, size_t max_branches);
+
+	/* background at a nominal scan position, optional */
+	double (*background)(const void *inst, double h, double k, double l, double E);
+
+	/*
+	 * model variables, serialised as lines of "ident\ttype\tvalue\n";
+	 * writes at most buf_len bytes including the terminating zero and
+	 * returns the required buffer size
+	 */
+	size_t (*get_vars)(const void *inst, char *buf, size_t buf_len);
+
+	/* sets a variable, returns 0 if it is unknown */
+	int (*set_var)(void *inst, const char *ident, const char *value);
+} takin_sqw_interface;
+
+
+/* signature of the exported "takin_sqw_plugin" function */
+typedef const takin_sqw_interface* (*takin_sqw_plugin_func)(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,219 @@
+/**
+ * exports an SqwBase-derived module via the C-level plugin interface
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date 2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef __MCONV_SQW_PLUGIN_ADAPTER_H__
+#define __MCONV_SQW_PLUGIN_ADAPTER_H__
+
+#include "sqw_plugin_abi.h"
+#include "sqwbase.h"
+
+#include <string>
+#include <sstream>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+
+
+/**
+ * C functions forwarding to a module class t_sqw, used in the plugin library:
+ *
+ *   extern "C" const takin_sqw_interface* takin_sqw_plugin()
+ *   {
+ *     static const takin_sqw_interface plugin = SqwPluginAdapter<SqwMod>::make_plugin(
+ *       "ident", "Long Name", "Help", TAKIN_SQW_CAP_THREADSAFE);
+ *     return &plugin;
+ *   }
+ *
+ * all functions are noexcept, exceptions must not cross the library boundary.
+ */
+template<class t_sqw>
+class SqwPluginAdapter
+{
+	static_assert(std::is_base_of<SqwBase, t_sqw>::value, "Module has to derive from SqwBase.");
+	static_assert(std::is_same<t_real_reso, double>::value, "The plugin interface uses double precision.");
+
+protected:
+	static const t_sqw* inst(const void *pInst) { return static_cast<const t_sqw*>(pInst); }
+	static t_sqw* inst(void *pInst) { return static_cast<t_sqw*>(pInst); }
+
+public:
+	static void* create(const char *pcCfg) noexcept
+	{
+		try
+		{
+			t_sqw *pSqw = new t_sqw(pcCfg ? pcCfg : "");
+			if(!pSqw->IsOk())
+			{
+				delete pSqw;
+				return nullptr;
+			}
+			return pSqw;
+		}
+		catch(...)
+		{
+			return nullptr;
+		}
+	}
+
+	static void destroy(void *pInst) noexcept
+	{
+		delete inst(pInst);
+	}
+
+	static void* clone(const void *pInst) noexcept
+	{
+		try
+		{
+			// the copy has to be of the module type, as destroy() deletes a t_sqw
+			return static_cast<t_sqw*>(inst(pInst)->shallow_copy());
+		}
+		catch(...)
+		{
+			return nullptr;
+		}
+	}
+
+	static double sqw(const void *pInst, double h, double k, double l, double E) noexcept
+	{
+		try
+		{
+			return (*inst(pInst))(h, k, l, E);
+		}
+		catch(...)
+		{
+			return 0.;
+		}
+	}
+
+	static void sqw_batch(const void *pInst, size_t n,
+		const double *h, const double *k, const double *l, const double *E, double *S) noexcept
+	{
+		try
+		{
+			inst(pInst)->sqw_batch(n, h, k, l, E, S);
+		}
+		catch(...)
+		{
+			std::fill(S, S+n, 0.);
+		}
+	}
+
+	static size_t disp(const void *pInst, double h, double k, double l,
+		double *E, double *weights, size_t max_branches) noexcept
+	{
+		try
+		{
+			return inst(pInst)->disp_into(h, k, l, E, weights, max_branches);
+		}
+		catch(...)
+		{
+			return 0;
+		}
+	}
+
+	static double background(const void *pInst, double h, double k, double l, double E) noexcept
+	{
+		try
+		{
+			return inst(pInst)->GetBackground(h, k, l, E);
+		}
+		catch(...)
+		{
+			return 0.;
+		}
+	}
+
+	static size_t get_vars(const void *pInst, char *pcBuf, size_t iBufLen) noexcept
+	{
+		try
+		{
+			std::ostringstream ostr;
+			for(const SqwBase::t_var& var : inst(pInst)->GetVars())
+				ostr << std::get<0>(var) << "\t" << std::get<1>(var) << "\t" << std::get<2>(var) << "\n";
+			const std::string str = ostr.str();
+
+			if(pcBuf && iBufLen)
+			{
+				const std::size_t iLen = std::min(str.length(), iBufLen-1);
+				std::memcpy(pcBuf, str.c_str(), iLen);
+				pcBuf[iLen] = 0;
+			}
+			return str.length() + 1;
+		}
+		catch(...)
+		{
+			return 0;
+		}
+	}
+
+	static int set_var(void *pInst, const char *pcIdent, const char *pcVal) noexcept
+	{
+		try
+		{
+			return inst(pInst)->SetVarIfAvail(pcIdent, pcVal) ? 1 : 0;
+		}
+		catch(...)
+		{
+			return 0;
+		}
+	}
+
+
+	/**
+	 * function table, the batch, disp and clone capabilities are always available via SqwBase
+	 */
+	static takin_sqw_interface make_plugin(const char *pcIdent, const char *pcLongName,
+		const char *pcHelp, uint32_t iCaps)
+	{
+		takin_sqw_interface plugin;
+		std::memset(&plugin, 0, sizeof(plugin));
+
+		plugin.abi_version = TAKIN_SQW_ABI_VERSION;
+		plugin.struct_size = sizeof(takin_sqw_interface);
+		plugin.caps = iCaps | TAKIN_SQW_CAP_BATCH | TAKIN_SQW_CAP_DISP | TAKIN_SQW_CAP_CLONE;
+
+		plugin.ident = pcIdent;
+		plugin.long_name = pcLongName;
+		plugin.help = pcHelp;
+
+		plugin.create = &create;
+		plugin.destroy = &destroy;
+		plugin.clone = &clone;
+		plugin.sqw = &sqw;
+		plugin.sqw_batch = &sqw_batch;
+		plugin.disp = &disp;
+		plugin.background = &background;
+		plugin.get_vars = &get_vars;
+		plugin.set_var = &set_var;
+
+		return plugin;
+	}
+};
+
+
+#endif
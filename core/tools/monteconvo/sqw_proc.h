@@ -55,7 +55,11 @@
 
 #include "sqwbase.h"
 #include <mutex>
+#include <condition_variable>
+#include <thread>
 #include <memory>
+#include <algorithm>
+#include <cstdlib>
 #include <string>
 #include <vector>
 #include <unistd.h>
@@ -75,6 +79,68 @@ enum class SqwProcStartMode
 };
 
 
+/**
+ * state shared by all copies of an SqwProc in the parent process,
+ * the child processes form a worker pool: requests are given to any free child
+ */
+struct SqwProcPool
+{
+	std::mutex mtx{};
+	std::condition_variable cv{};
+
+	std::vector<pid_t> vecPid{};
+	std::vector<bool> vecBusy{};
+	std::vector<bool> vecAlive{};
+
+	// ended child processes which are to be replaced at the next quiescent point
+	std::vector<bool> vecRestart{};
+
+	// no child process has been running at the last request
+	bool bFailed = false;
+
+	// needed to restart crashed child processes
+	SqwProcStartMode mode = SqwProcStartMode::START_PARENT_FORK_CHILD;
+	std::string strCfg{}, strExec{};
+
+	// variables set so far, they are re-sent to restarted child processes
+	std::vector<SqwBase::t_var> vecVars{};
+};
+
+
+/**
+ * number of child processes for scripted modules,
+ * can be set using the TAKIN_SQW_PROCESSES environment variable
+ */
+inline unsigned int get_sqw_proc_children()
+{
+	if(const char* pcNum = std::getenv("TAKIN_SQW_PROCESSES"))
+	{
+		long iNum = std::strtol(pcNum, nullptr, 10);
+		if(iNum > 0)
+			return static_cast<unsigned int>(iNum);
+	}
+
+	return std::max(1u, std::thread::hardware_concurrency());
+}
+
+
+/**
+ * seconds to wait for the reply of a child process before giving it up, 0: no limit;
+ * can be set using the TAKIN_SQW_TIMEOUT environment variable
+ */
+inline unsigned int get_sqw_proc_timeout()
+{
+	if(const char* pcTimeout = std::getenv("TAKIN_SQW_TIMEOUT"))
+	{
+		long iTimeout = std::strtol(pcTimeout, nullptr, 10);
+		if(iTimeout >= 0)
+			return static_cast<unsigned int>(iTimeout);
+	}
+
+	return 600;
+}
+
+
 template<class t_sqw>
 class SqwProc : public SqwBase
 {
@@ -83,16 +149,35 @@ private:
 
 
 protected:
-	mutable std::vector<std::shared_ptr<std::mutex>> m_pmtx;
+	std::shared_ptr<SqwProcPool> m_pPool;
 
 	std::size_t m_iNumChildProcesses = 1;
 	std::string m_strProcBaseName;
-	std::vector<pid_t> m_pidChild;
 
 	std::vector<std::shared_ptr<boost::interprocess::managed_shared_memory>> m_pMem;
 	std::vector<std::shared_ptr<boost::interprocess::message_queue>> m_pmsgIn, m_pmsgOut;
 	std::vector<void*> m_pSharedPars;
 
+	// shared h, k, l, E and S arrays for batch requests
+	std::vector<t_real_reso*> m_pBatch;
+
+
+protected:
+	bool SpawnChild(std::size_t iChild) const;
+	bool WaitChildReady(std::size_t iChild) const;
+	bool ReplaceChild(std::size_t iChild) const;
+	bool RestartChild(std::size_t iChild) const;
+	void RestartChildren() const;
+
+	long AcquireChild(long iChild = -1, bool bWait = true) const;
+	void ReleaseChild(std::size_t iChild) const;
+
+	template<class t_func> bool WithChild(long iChild, t_func&& func) const;
+
+	void SendBatch(std::size_t iChild, std::size_t iNum, const t_real_reso *pH,
+		const t_real_reso *pK, const t_real_reso *pL, const t_real_reso *pE) const;
+	bool RecvBatch(std::size_t iChild, std::size_t iNum, t_real_reso *pS) const;
+
 
 public:
 	SqwProc();
@@ -106,9 +191,12 @@ public:
 		disp(t_real_reso dh, t_real_reso dk, t_real_reso dl) const override;
 	virtual t_real_reso
 		operator()(t_real_reso dh, t_real_reso dk, t_real_reso dl, t_real_reso dE) const override;
+	virtual void sqw_batch(std::size_t iNum, const t_real_reso *pH, const t_real_reso *pK,
+		const t_real_reso *pL, const t_real_reso *pE, t_real_reso *pS) const override;
 	virtual t_real_reso
 		GetBackground(t_real_reso dh, t_real_reso dk, t_real_reso dl, t_real_reso dE) const override;
 	virtual bool IsOk() const override;
+	virtual bool HasIndependentCopies() const override { return false; }	// copies share the child processes
 
 	virtual std::vector<SqwBase::t_var> GetVars() const override;
 	virtual void SetVars(const std::vector<SqwBase::t_var>&) override;
@@ -35,17 +35,28 @@
 #include "tlibs/log/log.h"
 #include "tlibs/math/rand.h"
 
+#include <deque>
+#include <tuple>
+
 #include <signal.h>
 #include <unistd.h>
 #include <errno.h>
+#ifndef __MINGW32__
+	#include <sys/wait.h>
+#endif
 
 #include <boost/interprocess/managed_shared_memory.hpp>
 #include <boost/interprocess/allocators/allocator.hpp>
 #include <boost/interprocess/containers/string.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 
 #define MSG_QUEUE_SIZE     512
 #define PARAM_MEM          1024*1024
 #define WAIT_END_PROCESSES 250
+#define CHILD_ALIVE_CHECK  500     // ms between checks if a busy child process is still running
+#define PROC_BATCH_SIZE    4096    // maximum number of points per batch request
+#define PROC_BATCH_MIN     64      // minimum number of points given to one child process
+#define PROC_MEM           (PARAM_MEM + 5*PROC_BATCH_SIZE*sizeof(t_real_reso) + 64*1024)
 
 
 namespace ipr = boost::interprocess;
@@ -215,6 +226,7 @@ enum class ProcMsgTypes
 
 	DISP,
 	SQW,
+	SQW_BATCH,
 	BCK,
 	GET_VARS,
 	SET_VARS,
@@ -231,6 +243,12 @@ struct ProcMsg
 	t_real dParam1, dParam2, dParam3, dParam4;
 	t_real dRet;
 	bool bRet;
+
+	// number of points in the shared batch arrays
+	std::size_t iNum = 0;
+
+	// process id, sent with the READY message
+	pid_t pid = 0;
 };
 
 
@@ -268,6 +286,114 @@ static ProcMsg msg_recv(ipr::message_queue& msgqueue)
 	return msg;
 }
 
+
+/**
+ * checks if a child process is still running
+ */
+static bool proc_alive(pid_t pid)
+{
+#ifndef __MINGW32__
+	// pid not (yet) known
+	if(pid <= 0)
+		return true;
+
+	// reap forked child processes which have ended
+	pid_t pidWait = waitpid(pid, nullptr, WNOHANG);
+	if(pidWait == pid)
+		return false;
+	else if(pidWait == 0)
+		return true;
+
+	// not our own child, e.g. if it has been started via the shell
+	return kill(pid, 0) == 0 || errno != ESRCH;
+#else
+	return true;
+#endif
+}
+
+
+/**
+ * ends a child process which does not respond anymore
+ */
+static void proc_kill(pid_t pid)
+{
+#ifndef __MINGW32__
+	if(pid <= 0 || !proc_alive(pid))
+		return;
+
+	kill(pid, SIGKILL);
+	waitpid(pid, nullptr, 0);
+#endif
+}
+
+
+/**
+ * waits for a message from a child process, returns false if the child process
+ * has ended or has not replied within the timeout
+ */
+static bool msg_recv_alive(ipr::message_queue& msgqueue, ProcMsg& msg, pid_t pid)
+{
+	static const unsigned int iTimeout = get_sqw_proc_timeout();
+	const auto tEnd = boost::posix_time::microsec_clock::universal_time()
+		+ boost::posix_time::seconds(iTimeout);
+
+	try
+	{
+		while(true)
+		{
+			std::size_t iSize = 0;
+			unsigned int iPrio = 0;
+			auto tTimeout = boost::posix_time::microsec_clock::universal_time()
+				+ boost::posix_time::milliseconds(CHILD_ALIVE_CHECK);
+
+			if(msgqueue.timed_receive(&msg, sizeof(msg), iSize, iPrio, tTimeout))
+			{
+				if(iSize != sizeof(msg))
+					tl::log_err("Message size mismatch.");
+				return true;
+			}
+
+			if(!proc_alive(pid))
+				return false;
+
+			if(iTimeout && boost::posix_time::microsec_clock::universal_time() >= tEnd)
+			{
+				tl::log_err("Child process ", pid, " has not replied within ", iTimeout, " s.");
+				return false;
+			}
+		}
+	}
+	catch(const std::exception& ex)
+	{
+		tl::log_err(ex.what());
+	}
+
+	return false;
+}
+
+
+/**
+ * replaces a message queue by a new, empty one of the same name
+ */
+static void msg_recreate(ipr::message_queue& msgqueue, const std::string& strName)
+{
+	using t_queue = ipr::message_queue;
+	msgqueue.~t_queue();
+	ipr::message_queue::remove(strName.c_str());
+	new(&msgqueue) ipr::message_queue(ipr::create_only, strName.c_str(), MSG_QUEUE_SIZE, sizeof(ProcMsg));
+}
+
+
+/**
+ * sends a request to a child process and waits for its reply
+ */
+static bool msg_transact(ipr::message_queue& msgOut, ipr::message_queue& msgIn,
+	const ProcMsg& msg, ProcMsg& msgRet, pid_t pid)
+{
+	msg_send(msgOut, msg);
+	return msg_recv_alive(msgIn, msgRet, pid);
+}
+
 // ----------------------------------------------------------------------------
 
 
@@ -277,15 +403,14 @@ static ProcMsg msg_recv(ipr::message_queue& msgqueue)
 
 template<class t_sqw>
 static void child_proc(ipr::message_queue& msgToParent, ipr::message_queue& msgFromParent,
-	const char* pcCfg, void* pSharedPars)
+	const char* pcCfg, void* pSharedPars, t_real* pBatch)
 {
 	std::unique_ptr<t_sqw> pSqw(new t_sqw(pcCfg));
 
 	// tell parent that pSqw is inited
 	ProcMsg msgReady;
 	msgReady.ty = ProcMsgTypes::READY;
-	pid_t pid = getpid();
-	msgReady.dRet = *((double*)&pid);
+	msgReady.pid = getpid();
 	msgReady.bRet = pSqw->IsOk();
 	msg_send(msgToParent, msgReady);
 
@@ -314,6 +439,16 @@ static void child_proc(ipr::message_queue& msgToParent, ipr::message_queue& msgF
 				msg_send(msgToParent, msgRet);
 				break;
 			}
+			case ProcMsgTypes::SQW_BATCH:	// structure factor for the points in the shared arrays
+			{
+				msgRet.ty = msg.ty;
+				msgRet.iNum = std::min<std::size_t>(msg.iNum, PROC_BATCH_SIZE);
+				pSqw->sqw_batch(msgRet.iNum, pBatch, pBatch + PROC_BATCH_SIZE,
+					pBatch + 2*PROC_BATCH_SIZE, pBatch + 3*PROC_BATCH_SIZE,
+					pBatch + 4*PROC_BATCH_SIZE);
+				msg_send(msgToParent, msgRet);
+				break;
+			}
 			case ProcMsgTypes::BCK:		// background
 			{
 				msgRet.ty = msg.ty;
@@ -383,7 +518,8 @@ SqwProc<t_sqw>::SqwProc()
 template<class t_sqw>
 SqwProc<t_sqw>::SqwProc(const char* pcCfg, SqwProcStartMode mode,
 	const char* pcProcMemName, const char* pcProcExecName, unsigned int iNumChildProcesses)
-	: m_iNumChildProcesses(iNumChildProcesses), m_strProcBaseName(tl::rand_name<std::string>(8))
+	: m_pPool(std::make_shared<SqwProcPool>()),
+		m_iNumChildProcesses(iNumChildProcesses), m_strProcBaseName(tl::rand_name<std::string>(8))
 {
 	++m_iRefCnt;
 
@@ -391,6 +527,10 @@ SqwProc<t_sqw>::SqwProc(const char* pcCfg, SqwProcStartMode mode,
 	if(pcProcMemName)
 		m_strProcBaseName = pcProcMemName;
 
+	m_pPool->mode = mode;
+	m_pPool->strCfg = pcCfg ? pcCfg : "";
+	m_pPool->strExec = pcProcExecName ? pcProcExecName : "";
+
 	try
 	{
 		if(mode == SqwProcStartMode::START_PARENT_CREATE_CHILD || mode == SqwProcStartMode::START_PARENT_FORK_CHILD)
@@ -403,85 +543,47 @@ SqwProc<t_sqw>::SqwProc(const char* pcCfg, SqwProcStartMode mode,
 				std::string strProcName = m_strProcBaseName + "_" + tl::var_to_str(iChild);
 				tl::log_debug("Creating process memory \"", "takin_sqw_proc_*_", strProcName, "\".");
 
-				m_pmtx.push_back(std::make_shared<std::mutex>());
-
 				m_pMem.push_back(std::make_shared<ipr::managed_shared_memory>(ipr::create_only,
-					("takin_sqw_proc_mem_" + strProcName).c_str(), PARAM_MEM));
+					("takin_sqw_proc_mem_" + strProcName).c_str(), PROC_MEM));
 				m_pSharedPars.push_back(static_cast<void*>(m_pMem[iChild]->template construct<t_sh_str>
 					(("takin_sqw_proc_params_" + strProcName).c_str())
 					(t_sh_str_alloc(m_pMem[iChild]->get_segment_manager()))));
+				m_pBatch.push_back(m_pMem[iChild]->template construct<t_real>
+					(("takin_sqw_proc_batch_" + strProcName).c_str())[5*PROC_BATCH_SIZE](t_real(0)));
 
 				m_pmsgIn.push_back(std::make_shared<ipr::message_queue>(ipr::create_only,
 					("takin_sqw_proc_in_" + strProcName).c_str(), MSG_QUEUE_SIZE, sizeof(ProcMsg)));
 				m_pmsgOut.push_back(std::make_shared<ipr::message_queue>(ipr::create_only,
 					("takin_sqw_proc_out_" + strProcName).c_str(), MSG_QUEUE_SIZE, sizeof(ProcMsg)));
 
-				// create a child process
-				if(mode == SqwProcStartMode::START_PARENT_CREATE_CHILD)
+				m_pPool->vecPid.push_back(0);
+				m_pPool->vecBusy.push_back(false);
+				m_pPool->vecAlive.push_back(true);
+				m_pPool->vecRestart.push_back(false);
+
+				if(!SpawnChild(iChild))
 				{
-					if(!tl::file_exists(pcProcExecName))
-					{
-						tl::log_err("Child process file \"", pcProcExecName, "\" does not exist.");
-						return;
-					}
-
-					// start child process
-					if(std::system((std::string(pcProcExecName)
-						+ std::string(" \"") + pcCfg + std::string("\" ")
-						+ strProcName + " &").c_str()) < 0)
-					{
-						const int errnum = errno;
-						tl::log_err("Could not create child process \"", pcProcExecName, "\".",
-							" Error code: ", errnum, ".");
-					}
+					m_iNumChildProcesses = iChild+1;
+					m_pPool->vecAlive[iChild] = false;
+					break;
 				}
+			}
 
-#ifndef __MINGW32__
-				// fork a child process from the parent process
-				else if(mode == SqwProcStartMode::START_PARENT_FORK_CHILD)
+			// the child processes initialise their modules in parallel
+			m_bOk = true;
+			for(unsigned int iChild = 0; iChild < m_iNumChildProcesses; ++iChild)
+			{
+				if(!m_pPool->vecAlive[iChild])
 				{
-					pid_t pidChild = fork();
-
-					if(pidChild < 0)
-					{
-						tl::log_err("Could not fork child process.");
-						return;
-					}
-					else if(pidChild == 0)
-					{
-						// start of child process
-						m_iNumChildProcesses = 1;
-						m_pidChild.resize(1);
-						m_pidChild[0] = 0;
-
-						child_proc<t_sqw>(*m_pmsgIn[iChild], *m_pmsgOut[iChild], pcCfg, m_pSharedPars[iChild]);
-
-						exit(0);
-						// end of child process
-						return;
-					}
-
-					// in control process
-					m_pidChild.push_back(pidChild);
+					m_bOk = false;
+					continue;
 				}
-#endif
 
 				tl::log_debug("Waiting for child process ", iChild, " to become ready...");
-
-				ProcMsg msgReady = msg_recv(*m_pmsgIn[iChild]);
-				if(mode == SqwProcStartMode::START_PARENT_CREATE_CHILD)
-					m_pidChild.push_back(*((pid_t*)&msgReady.dRet));
-				m_bOk = msgReady.bRet;
-
-				if(!m_bOk)
-				{
-					tl::log_err("Child process ", m_pidChild[iChild], " reports failure.");
-					m_iNumChildProcesses = iChild+1;
-					break;
-				}
-				else
+				if(!WaitChildReady(iChild))
 				{
-					tl::log_debug("Child process ", m_pidChild[iChild], " is ready.");
+					m_pPool->vecAlive[iChild] = false;
+					m_bOk = false;
 				}
 			}
 		}
@@ -491,8 +593,10 @@ SqwProc<t_sqw>::SqwProc(const char* pcCfg, SqwProcStartMode mode,
 		{
 			// for the child process, the vectors have only one element
 			m_iNumChildProcesses = 1;
-			m_pidChild.resize(1);
-			m_pidChild[0] = 0;
+			m_pPool->vecPid.assign(1, 0);
+			m_pPool->vecBusy.assign(1, false);
+			m_pPool->vecAlive.assign(1, true);
+			m_pPool->vecRestart.assign(1, false);
 
 			const std::string& strProcName = m_strProcBaseName;
 
@@ -500,13 +604,15 @@ SqwProc<t_sqw>::SqwProc(const char* pcCfg, SqwProcStartMode mode,
 				("takin_sqw_proc_mem_" + strProcName).c_str()));
 			m_pSharedPars.push_back(static_cast<void*>(m_pMem[0]->template find<t_sh_str>
 				(("takin_sqw_proc_params_" + strProcName).c_str()).first));
+			m_pBatch.push_back(m_pMem[0]->template find<t_real>
+				(("takin_sqw_proc_batch_" + strProcName).c_str()).first);
 
 			m_pmsgIn.push_back(std::make_shared<ipr::message_queue>(ipr::open_only,
 				("takin_sqw_proc_in_" + strProcName).c_str()));
 			m_pmsgOut.push_back(std::make_shared<ipr::message_queue>(ipr::open_only,
 				("takin_sqw_proc_out_" + strProcName).c_str()));
 
-			child_proc<t_sqw>(*m_pmsgIn[0], *m_pmsgOut[0], pcCfg, m_pSharedPars[0]);
+			child_proc<t_sqw>(*m_pmsgIn[0], *m_pmsgOut[0], pcCfg, m_pSharedPars[0], m_pBatch[0]);
 		}
 	}
 	catch(const std::exception& ex)
@@ -530,30 +636,27 @@ SqwProc<t_sqw>::SqwProc(const std::string& strCfg) : SqwProc<t_sqw>::SqwProc(str
 template<class t_sqw>
 SqwProc<t_sqw>::~SqwProc()
 {
-	if(m_pidChild.size() == 0)
+	if(!m_pPool || m_pPool->vecPid.size() == 0)
 	{
 		tl::log_err("No process id registered.");
 		return;
 	}
 
 	// we're in a child process
-	if(m_pidChild[0] == 0)
+	if(m_pPool->mode == SqwProcStartMode::START_CHILD)
 	{
 		tl::log_debug("Child process ", getpid(), " ending.");
 		return;
 	}
 
-	for(unsigned int iChild=0; iChild<m_iNumChildProcesses; ++iChild)
-	{
-		// make sure that this instance is the last
-		if(m_pMem[iChild].use_count() > 1)
-			return;
-	}
+	// make sure that this instance is the last
+	if(m_pPool.use_count() > 1)
+		return;
 
 	// shut down the parent process
 	try
 	{
-		for(unsigned int iChild=0; iChild<m_iNumChildProcesses; ++iChild)
+		for(std::size_t iChild=0; iChild<m_pmsgOut.size(); ++iChild)
 		{
 			if(m_pmsgOut[iChild])
 			{
@@ -561,7 +664,7 @@ SqwProc<t_sqw>::~SqwProc()
 				msg.ty = ProcMsgTypes::QUIT;
 				msg_send(*m_pmsgOut[iChild], msg);
 
-				//kill(m_pidChild[iChild], SIGABRT);
+				//kill(m_pPool->vecPid[iChild], SIGABRT);
 			}
 		}
 
@@ -570,7 +673,7 @@ SqwProc<t_sqw>::~SqwProc()
 			// give clients time to end before removing the shared memory
 			std::this_thread::sleep_for(std::chrono::milliseconds{WAIT_END_PROCESSES});
 
-			for(unsigned int iChild=0; iChild<m_iNumChildProcesses; ++iChild)
+			for(std::size_t iChild=0; iChild<m_pMem.size(); ++iChild)
 			{
 				std::string strProcName = m_strProcBaseName + "_" + tl::var_to_str(iChild);
 
@@ -578,10 +681,14 @@ SqwProc<t_sqw>::~SqwProc()
 				ipr::message_queue::remove(("takin_sqw_proc_out_" + strProcName).c_str());
 
 				m_pMem[iChild]->template destroy<t_sh_str>(("takin_sqw_proc_params_" + strProcName).c_str());
+				m_pMem[iChild]->template destroy<t_real>(("takin_sqw_proc_batch_" + strProcName).c_str());
 				ipr::shared_memory_object::remove(("takin_sqw_proc_mem_" + strProcName).c_str());
 
 				tl::log_debug("Removed process memory \"", "takin_sqw_proc_*_",
-					strProcName, "\" for child process ", m_pidChild[iChild], ".");
+					strProcName, "\" for child process ", m_pPool->vecPid[iChild], ".");
+
+				// reap forked child processes
+				proc_alive(m_pPool->vecPid[iChild]);
 			}
 		}
 	}
@@ -592,6 +699,323 @@ SqwProc<t_sqw>::~SqwProc()
 }
 
 
+/**
+ * starts or forks child process iChild, its memory and message queues already have to exist
+ */
+template<class t_sqw>
+bool SqwProc<t_sqw>::SpawnChild(std::size_t iChild) const
+{
+	const std::string strProcName = m_strProcBaseName + "_" + tl::var_to_str(iChild);
+
+	// create a child process
+	if(m_pPool->mode == SqwProcStartMode::START_PARENT_CREATE_CHILD)
+	{
+		const std::string& strExec = m_pPool->strExec;
+		if(!tl::file_exists(strExec.c_str()))
+		{
+			tl::log_err("Child process file \"", strExec, "\" does not exist.");
+			return false;
+		}
+
+		// start child process, its pid is sent with the ready message
+		m_pPool->vecPid[iChild] = 0;
+		if(std::system((strExec + " \"" + m_pPool->strCfg + "\" " + strProcName + " &").c_str()) < 0)
+		{
+			const int errnum = errno;
+			tl::log_err("Could not create child process \"", strExec, "\".",
+				" Error code: ", errnum, ".");
+			return false;
+		}
+	}
+
+#ifndef __MINGW32__
+	// fork a child process from the parent process
+	else if(m_pPool->mode == SqwProcStartMode::START_PARENT_FORK_CHILD)
+	{
+		pid_t pidChild = fork();
+
+		if(pidChild < 0)
+		{
+			tl::log_err("Could not fork child process.");
+			return false;
+		}
+		else if(pidChild == 0)
+		{
+			// start of child process
+			child_proc<t_sqw>(*m_pmsgIn[iChild], *m_pmsgOut[iChild],
+				m_pPool->strCfg.c_str(), m_pSharedPars[iChild], m_pBatch[iChild]);
+
+			exit(0);
+			// end of child process
+		}
+
+		// in control process
+		m_pPool->vecPid[iChild] = pidChild;
+	}
+#endif
+
+	return true;
+}
+
+
+/**
+ * waits for the ready message of a newly started child process
+ */
+template<class t_sqw>
+bool SqwProc<t_sqw>::WaitChildReady(std::size_t iChild) const
+{
+	ProcMsg msgReady;
+	if(!msg_recv_alive(*m_pmsgIn[iChild], msgReady, m_pPool->vecPid[iChild]))
+	{
+		tl::log_err("Child process ", m_pPool->vecPid[iChild], " has not become ready.");
+		proc_kill(m_pPool->vecPid[iChild]);
+		return false;
+	}
+
+	if(m_pPool->mode == SqwProcStartMode::START_PARENT_CREATE_CHILD)
+		m_pPool->vecPid[iChild] = msgReady.pid;
+
+	if(!msgReady.bRet)
+	{
+		tl::log_err("Child process ", m_pPool->vecPid[iChild], " reports failure.");
+		return false;
+	}
+
+	tl::log_debug("Child process ", m_pPool->vecPid[iChild], " is ready.");
+	return true;
+}
+
+
+/**
+ * replaces a child process which has ended or hangs by a new one
+ */
+template<class t_sqw>
+bool SqwProc<t_sqw>::ReplaceChild(std::size_t iChild) const
+{
+	bool bOk = true;
+	try
+	{
+		proc_kill(m_pPool->vecPid[iChild]);
+
+		// the old process may have ended while waiting on a queue, which leaves its
+		// process-shared condition variables unusable => recreate the queues in place,
+		// all shallow copies refer to the same objects
+		const std::string strProcName = m_strProcBaseName + "_" + tl::var_to_str(iChild);
+		msg_recreate(*m_pmsgIn[iChild], "takin_sqw_proc_in_" + strProcName);
+		msg_recreate(*m_pmsgOut[iChild], "takin_sqw_proc_out_" + strProcName);
+	}
+	catch(const std::exception& ex)
+	{
+		tl::log_err(ex.what());
+		bOk = false;
+	}
+
+	bOk = bOk && SpawnChild(iChild) && WaitChildReady(iChild);
+
+	// the new process gets the variables which have been set so far
+	std::vector<SqwBase::t_var> vecVars;
+	{
+		std::lock_guard<std::mutex> lock(m_pPool->mtx);
+		vecVars = m_pPool->vecVars;
+	}
+
+	if(bOk && vecVars.size())
+	{
+		pars_to_str(*static_cast<t_sh_str*>(m_pSharedPars[iChild]), vecVars);
+
+		ProcMsg msgVars, msgRet;
+		msgVars.ty = ProcMsgTypes::SET_VARS;
+		bOk = msg_transact(*m_pmsgOut[iChild], *m_pmsgIn[iChild], msgVars, msgRet,
+			m_pPool->vecPid[iChild]) && msgRet.bRet;
+	}
+
+	if(!bOk)
+		tl::log_err("Could not restart child process ", iChild, ", it will not be used anymore.");
+
+	return bOk;
+}
+
+
+/**
+ * handles a child process which has ended or hangs, the caller has to hold the child;
+ * returns true if the child has been replaced right away.
+ * created child processes are started via exec and can be replaced at once,
+ * forked ones are only replaced by RestartChildren(), as the worker threads
+ * still running here could hold locks which the forked process needs
+ */
+template<class t_sqw>
+bool SqwProc<t_sqw>::RestartChild(std::size_t iChild) const
+{
+	if(m_pPool->mode == SqwProcStartMode::START_CHILD)
+		return false;
+
+	if(m_pPool->mode == SqwProcStartMode::START_PARENT_CREATE_CHILD)
+	{
+		tl::log_err("Child process ", m_pPool->vecPid[iChild], " has ended or does not respond, restarting it.");
+
+		const bool bOk = ReplaceChild(iChild);
+		if(!bOk)
+		{
+			std::lock_guard<std::mutex> lock(m_pPool->mtx);
+			m_pPool->vecAlive[iChild] = false;
+		}
+		return bOk;
+	}
+
+	tl::log_err("Child process ", m_pPool->vecPid[iChild], " has ended or does not respond,",
+		" it will be restarted before the next calculation.");
+
+	// stop a hanging process now, so that it does not use up a core until then;
+	// forget its pid, which could be reused by the system afterwards
+	proc_kill(m_pPool->vecPid[iChild]);
+	m_pPool->vecPid[iChild] = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(m_pPool->mtx);
+		m_pPool->vecAlive[iChild] = false;
+		m_pPool->vecRestart[iChild] = true;
+	}
+
+	// wake up requests waiting for this child
+	m_pPool->cv.notify_all();
+	return false;
+}
+
+
+/**
+ * replaces the forked child processes which have ended; called from GetVars() and SetVars(),
+ * which can also run while other threads are calculating => only restart if no child process
+ * is in use, the whole pool is then reserved, so that no request runs while forking
+ */
+template<class t_sqw>
+void SqwProc<t_sqw>::RestartChildren() const
+{
+	std::vector<std::size_t> vecChildren;
+	{
+		std::lock_guard<std::mutex> lock(m_pPool->mtx);
+		if(std::find(m_pPool->vecBusy.begin(), m_pPool->vecBusy.end(), true) != m_pPool->vecBusy.end())
+			return;
+
+		for(std::size_t iChild=0; iChild<m_iNumChildProcesses; ++iChild)
+		{
+			if(!m_pPool->vecRestart[iChild])
+				continue;
+
+			m_pPool->vecRestart[iChild] = false;
+			vecChildren.push_back(iChild);
+		}
+
+		if(vecChildren.empty())
+			return;
+		m_pPool->vecBusy.assign(m_pPool->vecBusy.size(), true);
+	}
+
+	for(std::size_t iChild : vecChildren)
+	{
+		tl::log_info("Restarting child process ", iChild, ".");
+		const bool bOk = ReplaceChild(iChild);
+
+		std::lock_guard<std::mutex> lock(m_pPool->mtx);
+		m_pPool->vecAlive[iChild] = bOk;
+		if(bOk)
+			m_pPool->bFailed = false;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_pPool->mtx);
+		m_pPool->vecBusy.assign(m_pPool->vecBusy.size(), false);
+	}
+	m_pPool->cv.notify_all();
+}
+
+
+/**
+ * reserves child process iChild or, for iChild < 0, any free child process;
+ * returns -1 if no child is free (for !bWait) or if none is running anymore
+ */
+template<class t_sqw>
+long SqwProc<t_sqw>::AcquireChild(long iChild, bool bWait) const
+{
+	std::unique_lock<std::mutex> lock(m_pPool->mtx);
+
+	while(true)
+	{
+		bool bAnyAlive = false;
+
+		for(std::size_t iCur=0; iCur<m_pPool->vecBusy.size(); ++iCur)
+		{
+			if((iChild >= 0 && long(iCur) != iChild) || !m_pPool->vecAlive[iCur])
+				continue;
+
+			bAnyAlive = true;
+			if(!m_pPool->vecBusy[iCur])
+			{
+				m_pPool->vecBusy[iCur] = true;
+				return long(iCur);
+			}
+		}
+
+		if(!bAnyAlive && iChild < 0 && !m_pPool->bFailed)
+		{
+			tl::log_err("No child process is running anymore.");
+			m_pPool->bFailed = true;
+		}
+
+		if(!bAnyAlive || !bWait)
+			return -1;
+
+		m_pPool->cv.wait(lock);
+	}
+}
+
+
+template<class t_sqw>
+void SqwProc<t_sqw>::ReleaseChild(std::size_t iChild) const
+{
+	{
+		std::lock_guard<std::mutex> lock(m_pPool->mtx);
+		m_pPool->vecBusy[iChild] = false;
+	}
+
+	// others may be waiting for a specific child
+	m_pPool->cv.notify_all();
+}
+
+
+/**
+ * runs a request func(iChild) on a reserved child process;
+ * func returns false if the child has ended, the request is then repeated once on the
+ * restarted child or, if it cannot be restarted at once, on any other child for iChild < 0
+ */
+template<class t_sqw>
+template<class t_func>
+bool SqwProc<t_sqw>::WithChild(long iChild, t_func&& func) const
+{
+	while(true)
+	{
+		const long iAcquired = AcquireChild(iChild);
+		if(iAcquired < 0)
+			return false;
+
+		bool bOk = func(std::size_t(iAcquired));
+		bool bRestarted = false;
+		if(!bOk)
+		{
+			bRestarted = RestartChild(std::size_t(iAcquired));
+			if(bRestarted)
+				bOk = func(std::size_t(iAcquired));
+		}
+
+		ReleaseChild(std::size_t(iAcquired));
+
+		// the failed child is not in the pool anymore, try another one
+		if(!bOk && !bRestarted && iChild < 0)
+			continue;
+		return bOk;
+	}
+}
+
+
 /**
  * query dispersion
  */
@@ -599,37 +1023,26 @@ template<class t_sqw>
 std::tuple<std::vector<t_real>, std::vector<t_real>>
 SqwProc<t_sqw>::disp(t_real dh, t_real dk, t_real dl) const
 {
-	auto query_disp = [this](std::size_t iChild, t_real dh, t_real dk, t_real dl)
-		-> std::tuple<std::vector<t_real>, std::vector<t_real>>
+	std::tuple<std::vector<t_real>, std::vector<t_real>> tupDisp;
+	if(!m_bOk)
+		return tupDisp;
+
+	WithChild(-1, [&](std::size_t iChild) -> bool
 	{
-		ProcMsg msg;
+		ProcMsg msg, msgRet;
 		msg.ty = ProcMsgTypes::DISP;
 		msg.dParam1 = dh;
 		msg.dParam2 = dk;
 		msg.dParam3 = dl;
-		msg_send(*m_pmsgOut[iChild], msg);
-
-		t_sh_str *pPars = static_cast<t_sh_str*>(m_pSharedPars[iChild]);
-
-		/*ProcMsg msgDisp = */msg_recv(*m_pmsgIn[iChild]);
-		return str_to_disp(*pPars);
-	};
 
+		if(!msg_transact(*m_pmsgOut[iChild], *m_pmsgIn[iChild], msg, msgRet, m_pPool->vecPid[iChild]))
+			return false;
 
-	if(!m_bOk)
-		return std::make_tuple(std::vector<t_real>{}, std::vector<t_real>{});
-
-	// find a free child process
-	for(unsigned int iChild = 0; iChild < m_iNumChildProcesses; ++iChild)
-	{
-		std::unique_lock<std::mutex> lock(*m_pmtx[iChild], std::defer_lock);
-		if(lock.try_lock())
-			return query_disp(iChild, dh, dk, dl);
-	}
+		tupDisp = str_to_disp(*static_cast<t_sh_str*>(m_pSharedPars[iChild]));
+		return true;
+	});
 
-	// if all processes are occupied, queue at the first one
-	std::lock_guard<std::mutex> lock(*m_pmtx[0]);
-	return query_disp(0, dh, dk, dl);
+	return tupDisp;
 }
 
 
@@ -639,36 +1052,141 @@ SqwProc<t_sqw>::disp(t_real dh, t_real dk, t_real dl) const
 template<class t_sqw>
 t_real SqwProc<t_sqw>::operator()(t_real dh, t_real dk, t_real dl, t_real dE) const
 {
-	auto query_sqw = [this](std::size_t iChild, t_real dh, t_real dk, t_real dl, t_real dE)
-		-> t_real
+	t_real dS = 0.;
+	if(!m_bOk)
+		return dS;
+
+	WithChild(-1, [&](std::size_t iChild) -> bool
 	{
-		ProcMsg msg;
+		ProcMsg msg, msgRet;
 		msg.ty = ProcMsgTypes::SQW;
 		msg.dParam1 = dh;
 		msg.dParam2 = dk;
 		msg.dParam3 = dl;
 		msg.dParam4 = dE;
-		msg_send(*m_pmsgOut[iChild], msg);
 
-		ProcMsg msgS = msg_recv(*m_pmsgIn[iChild]);
-		return msgS.dRet;
-	};
+		if(!msg_transact(*m_pmsgOut[iChild], *m_pmsgIn[iChild], msg, msgRet, m_pPool->vecPid[iChild]))
+			return false;
 
+		dS = msgRet.dRet;
+		return true;
+	});
 
-	if(!m_bOk)
-		return 0.;
+	return dS;
+}
+
+
+/**
+ * copies a chunk of points to the shared arrays of a reserved child process and starts its calculation
+ */
+template<class t_sqw>
+void SqwProc<t_sqw>::SendBatch(std::size_t iChild, std::size_t iNum,
+	const t_real *pH, const t_real *pK, const t_real *pL, const t_real *pE) const
+{
+	t_real *pBatch = m_pBatch[iChild];
+	std::copy(pH, pH+iNum, pBatch);
+	std::copy(pK, pK+iNum, pBatch + PROC_BATCH_SIZE);
+	std::copy(pL, pL+iNum, pBatch + 2*PROC_BATCH_SIZE);
+	std::copy(pE, pE+iNum, pBatch + 3*PROC_BATCH_SIZE);
+
+	ProcMsg msg;
+	msg.ty = ProcMsgTypes::SQW_BATCH;
+	msg.iNum = iNum;
+	msg_send(*m_pmsgOut[iChild], msg);
+}
 
-	// find a free child process
-	for(unsigned int iChild = 0; iChild < m_iNumChildProcesses; ++iChild)
+
+/**
+ * waits for a child process to finish its chunk and copies the results,
+ * returns false if the child has ended
+ */
+template<class t_sqw>
+bool SqwProc<t_sqw>::RecvBatch(std::size_t iChild, std::size_t iNum, t_real *pS) const
+{
+	ProcMsg msgRet;
+	if(!msg_recv_alive(*m_pmsgIn[iChild], msgRet, m_pPool->vecPid[iChild]))
+		return false;
+
+	const t_real *pBatchS = m_pBatch[iChild] + 4*PROC_BATCH_SIZE;
+	std::copy(pBatchS, pBatchS + std::min(iNum, msgRet.iNum), pS);
+	return true;
+}
+
+
+/**
+ * query dynamical structure factor for a batch of points:
+ * the points are split into chunks which are handed to all free child processes,
+ * the next chunk is prepared while the previous ones are being calculated
+ */
+template<class t_sqw>
+void SqwProc<t_sqw>::sqw_batch(std::size_t iNum, const t_real *pH, const t_real *pK,
+	const t_real *pL, const t_real *pE, t_real *pS) const
+{
+	std::fill(pS, pS+iNum, t_real(0));
+	if(!m_bOk || !iNum)
+		return;
+
+	// give each child process a part of the points
+	const std::size_t iNumChildren = std::max<std::size_t>(m_iNumChildProcesses, 1);
+	std::size_t iChunk = (iNum + iNumChildren - 1) / iNumChildren;
+	iChunk = std::min<std::size_t>(std::max<std::size_t>(iChunk, PROC_BATCH_MIN), PROC_BATCH_SIZE);
+
+	// chunks being calculated: [child, first point, number of points, retried]
+	std::deque<std::tuple<std::size_t, std::size_t, std::size_t, bool>> dequeRunning;
+	// chunks of ended child processes which are repeated once: [first point, number of points]
+	std::deque<std::pair<std::size_t, std::size_t>> dequeRetry;
+	std::size_t iNext = 0;
+
+	while(iNext < iNum || dequeRetry.size() || dequeRunning.size())
 	{
-		std::unique_lock<std::mutex> lock(*m_pmtx[iChild], std::defer_lock);
-		if(lock.try_lock())
-			return query_sqw(iChild, dh, dk, dl, dE);
-	}
+		if(iNext < iNum || dequeRetry.size())
+		{
+			// only wait for a free child process if no chunk is running
+			const long iChild = AcquireChild(-1, dequeRunning.empty());
+			if(iChild >= 0)
+			{
+				std::size_t iStart = iNext, iLen = 0;
+				const bool bRetry = !dequeRetry.empty();
+				if(bRetry)
+				{
+					std::tie(iStart, iLen) = dequeRetry.front();
+					dequeRetry.pop_front();
+				}
+				else
+				{
+					iLen = std::min(iChunk, iNum - iNext);
+					iNext += iLen;
+				}
+
+				SendBatch(std::size_t(iChild), iLen, pH+iStart, pK+iStart, pL+iStart, pE+iStart);
+				dequeRunning.emplace_back(std::size_t(iChild), iStart, iLen, bRetry);
+				continue;
+			}
+			else if(dequeRunning.empty())
+			{
+				tl::log_err("No child process available.");
+				break;
+			}
+		}
+
+		// collect the oldest running chunk
+		std::size_t iChild, iStart, iLen;
+		bool bRetried;
+		std::tie(iChild, iStart, iLen, bRetried) = dequeRunning.front();
+		dequeRunning.pop_front();
+
+		if(!RecvBatch(iChild, iLen, pS+iStart))
+		{
+			RestartChild(iChild);
 
-	// if all processes are occupied, queue at the first one
-	std::lock_guard<std::mutex> lock(*m_pmtx[0]);
-	return query_sqw(0, dh, dk, dl, dE);
+			if(bRetried)
+				tl::log_err("Giving up on points ", iStart, " to ", iStart+iLen-1, ".");
+			else
+				dequeRetry.emplace_back(iStart, iLen);
+		}
+
+		ReleaseChild(iChild);
+	}
 }
 
 
@@ -678,36 +1196,27 @@ t_real SqwProc<t_sqw>::operator()(t_real dh, t_real dk, t_real dl, t_real dE) co
 template<class t_sqw>
 t_real SqwProc<t_sqw>::GetBackground(t_real dh, t_real dk, t_real dl, t_real dE) const
 {
-	auto query_bck = [this](std::size_t iChild, t_real dh, t_real dk, t_real dl, t_real dE)
-		-> t_real
+	t_real dBck = 0.;
+	if(!m_bOk)
+		return dBck;
+
+	WithChild(-1, [&](std::size_t iChild) -> bool
 	{
-		ProcMsg msg;
+		ProcMsg msg, msgRet;
 		msg.ty = ProcMsgTypes::BCK;
 		msg.dParam1 = dh;
 		msg.dParam2 = dk;
 		msg.dParam3 = dl;
 		msg.dParam4 = dE;
-		msg_send(*m_pmsgOut[iChild], msg);
-
-		ProcMsg msgBck = msg_recv(*m_pmsgIn[iChild]);
-		return msgBck.dRet;
-	};
 
+		if(!msg_transact(*m_pmsgOut[iChild], *m_pmsgIn[iChild], msg, msgRet, m_pPool->vecPid[iChild]))
+			return false;
 
-	if(!m_bOk)
-		return 0.;
-
-	// find a free child process
-	for(unsigned int iChild = 0; iChild < m_iNumChildProcesses; ++iChild)
-	{
-		std::unique_lock<std::mutex> lock(*m_pmtx[iChild], std::defer_lock);
-		if(lock.try_lock())
-			return query_bck(iChild, dh, dk, dl, dE);
-	}
+		dBck = msgRet.dRet;
+		return true;
+	});
 
-	// if all processes are occupied, queue at the first one
-	std::lock_guard<std::mutex> lock(*m_pmtx[0]);
-	return query_bck(0, dh, dk, dl, dE);
+	return dBck;
 }
 
 
@@ -717,21 +1226,29 @@ bool SqwProc<t_sqw>::IsOk() const
 	if(!m_bOk)
 		return false;
 
-	// check all sub-processes
-	for(unsigned int iChild=0; iChild<m_iNumChildProcesses; ++iChild)
+	// check all running sub-processes
+	bool bAnyOk = false;
+	for(std::size_t iChild=0; iChild<m_iNumChildProcesses; ++iChild)
 	{
-		std::lock_guard<std::mutex> lock(*m_pmtx[iChild]);
+		bool bChildOk = false;
+		bool bRunning = WithChild(long(iChild), [&](std::size_t iChild) -> bool
+		{
+			ProcMsg msg, msgRet;
+			msg.ty = ProcMsgTypes::IS_OK;
+
+			if(!msg_transact(*m_pmsgOut[iChild], *m_pmsgIn[iChild], msg, msgRet, m_pPool->vecPid[iChild]))
+				return false;
 
-		ProcMsg msg;
-		msg.ty = ProcMsgTypes::IS_OK;
-		msg_send(*m_pmsgOut[iChild], msg);
+			bChildOk = msgRet.bRet;
+			return true;
+		});
 
-		ProcMsg msgRet = msg_recv(*m_pmsgIn[iChild]);
-		if(!msgRet.bRet)
+		if(bRunning && !bChildOk)
 			return false;
+		bAnyOk = bAnyOk || bChildOk;
 	}
 
-	return true;
+	return bAnyOk;
 }
 
 
@@ -741,20 +1258,27 @@ bool SqwProc<t_sqw>::IsOk() const
 template<class t_sqw>
 std::vector<SqwBase::t_var> SqwProc<t_sqw>::GetVars() const
 {
+	std::vector<SqwBase::t_var> vecVars;
 	if(!m_bOk)
-		return std::vector<SqwBase::t_var>{};
+		return vecVars;
 
-	// the variables should be the same for all sub-processes => only query the first
-	std::lock_guard<std::mutex> lock(*m_pmtx[0]);
+	// replace the forked child processes which have ended, if no calculation is running
+	RestartChildren();
 
-	ProcMsg msg;
-	msg.ty = ProcMsgTypes::GET_VARS;
-	msg_send(*m_pmsgOut[0], msg);
+	// the variables should be the same for all sub-processes => only query one
+	WithChild(-1, [&](std::size_t iChild) -> bool
+	{
+		ProcMsg msg, msgRet;
+		msg.ty = ProcMsgTypes::GET_VARS;
 
-	t_sh_str *pPars = static_cast<t_sh_str*>(m_pSharedPars[0]);
+		if(!msg_transact(*m_pmsgOut[iChild], *m_pmsgIn[iChild], msg, msgRet, m_pPool->vecPid[iChild]))
+			return false;
 
-	/*ProcMsg msgRet = */msg_recv(*m_pmsgIn[0]);
-	return str_to_pars(*pPars);
+		vecVars = str_to_pars(*static_cast<t_sh_str*>(m_pSharedPars[iChild]));
+		return true;
+	});
+
+	return vecVars;
 }
 
 
@@ -767,20 +1291,57 @@ void SqwProc<t_sqw>::SetVars(const std::vector<SqwBase::t_var>& vecVars)
 	if(!m_bOk)
 		return;
 
+	// replace the forked child processes which have ended, if no calculation is running
+	RestartChildren();
+
+	// the module cannot be used anymore if all child processes have ended and could not be restarted
+	{
+		std::lock_guard<std::mutex> lock(m_pPool->mtx);
+		const bool bAnyAlive = std::find(m_pPool->vecAlive.begin(), m_pPool->vecAlive.end(), true) != m_pPool->vecAlive.end();
+		const bool bAnyRestart = std::find(m_pPool->vecRestart.begin(), m_pPool->vecRestart.end(), true) != m_pPool->vecRestart.end();
+		if(!bAnyAlive && !bAnyRestart)
+		{
+			tl::log_err("No child process is running anymore, disabling S(Q, E) model.");
+			m_bOk = false;
+			return;
+		}
+	}
+
+	// remember the variables for restarted child processes
+	{
+		std::lock_guard<std::mutex> lock(m_pPool->mtx);
+
+		for(const SqwBase::t_var& var : vecVars)
+		{
+			auto iter = std::find_if(m_pPool->vecVars.begin(), m_pPool->vecVars.end(),
+				[&var](const SqwBase::t_var& varOld) -> bool
+				{ return std::get<0>(varOld) == std::get<0>(var); });
+
+			if(iter == m_pPool->vecVars.end())
+				m_pPool->vecVars.push_back(var);
+			else
+				*iter = var;
+		}
+	}
+
 	// set the same variables for all child-processes
-	for(unsigned int iChild=0; iChild<m_iNumChildProcesses; ++iChild)
+	for(std::size_t iChild=0; iChild<m_iNumChildProcesses; ++iChild)
 	{
-		std::lock_guard<std::mutex> lock(*m_pmtx[iChild]);
+		bool bSet = false;
+		WithChild(long(iChild), [&](std::size_t iChild) -> bool
+		{
+			ProcMsg msg, msgRet;
+			msg.ty = ProcMsgTypes::SET_VARS;
+			pars_to_str(*static_cast<t_sh_str*>(m_pSharedPars[iChild]), vecVars);
 
-		t_sh_str *pPars = static_cast<t_sh_str*>(m_pSharedPars[iChild]);
+			if(!msg_transact(*m_pmsgOut[iChild], *m_pmsgIn[iChild], msg, msgRet, m_pPool->vecPid[iChild]))
+				return false;
 
-		ProcMsg msg;
-		msg.ty = ProcMsgTypes::SET_VARS;
-		pars_to_str(*pPars, vecVars);
-		msg_send(*m_pmsgOut[iChild], msg);
+			bSet = msgRet.bRet;
+			return true;
+		});
 
-		ProcMsg msgRet = msg_recv(*m_pmsgIn[iChild]);
-		if(!msgRet.bRet)
+		if(!bSet)
 			tl::log_err("Could not set variables for child process ", iChild, ".");
 	}
 }
@@ -792,14 +1353,14 @@ SqwBase* SqwProc<t_sqw>::shallow_copy() const
 	SqwProc* pSqw = new SqwProc();
 	*static_cast<SqwBase*>(pSqw) = *static_cast<const SqwBase*>(this);
 
-	pSqw->m_pmtx = this->m_pmtx;
+	pSqw->m_pPool = this->m_pPool;
 	pSqw->m_iNumChildProcesses = this->m_iNumChildProcesses;
 	pSqw->m_pMem = this->m_pMem;
 	pSqw->m_pmsgIn = this->m_pmsgIn;
 	pSqw->m_pmsgOut = this->m_pmsgOut;
 	pSqw->m_strProcBaseName = this->m_strProcBaseName;
-	pSqw->m_pidChild = this->m_pidChild;
 	pSqw->m_pSharedPars = this->m_pSharedPars;
+	pSqw->m_pBatch = this->m_pBatch;
 	pSqw->m_iRefCnt = this->m_iRefCnt;
 
 	return pSqw;
@@ -31,8 +31,10 @@
 
 #include <string>
 #include <tuple>
+#include <algorithm>
 #include <vector>
 #include <memory>
+#include <functional>
 #include <unordered_set>
 #include <unordered_map>
 
@@ -40,6 +42,54 @@
 #include "tlibs/string/string.h"
 
 
+/**
+ * caller-side buffer for SqwBase::disp_into(),
+ * a few branches are stored inline, more are kept on the heap
+ */
+class SqwDispBuf
+{
+public:
+	static constexpr std::size_t NUM_INLINE = 16;
+
+protected:
+	t_real_reso m_E[NUM_INLINE], m_W[NUM_INLINE];
+	std::vector<t_real_reso> m_vecE{}, m_vecW{};
+
+	t_real_reso *m_pE = m_E, *m_pW = m_W;
+	std::size_t m_iCapacity = NUM_INLINE;
+	std::size_t m_iSize = 0;
+
+public:
+	SqwDispBuf() = default;
+	SqwDispBuf(const SqwDispBuf&) = delete;
+	const SqwDispBuf& operator=(const SqwDispBuf&) = delete;
+
+	void Reserve(std::size_t iNum)
+	{
+		if(iNum <= m_iCapacity)
+			return;
+
+		m_vecE.resize(iNum);
+		m_vecW.resize(iNum);
+		m_pE = m_vecE.data();
+		m_pW = m_vecW.data();
+		m_iCapacity = iNum;
+	}
+
+	t_real_reso* E() { return m_pE; }
+	t_real_reso* W() { return m_pW; }
+	const t_real_reso* E() const { return m_pE; }
+	const t_real_reso* W() const { return m_pW; }
+
+	t_real_reso E(std::size_t i) const { return m_pE[i]; }
+	t_real_reso W(std::size_t i) const { return m_pW[i]; }
+
+	std::size_t size() const { return m_iSize; }
+	std::size_t capacity() const { return m_iCapacity; }
+	void SetSize(std::size_t iSize) { m_iSize = iSize; }
+};
+
+
 /**
  * base class for S(Q, E) models
  */
@@ -69,9 +119,83 @@ public:
 		return std::tuple<std::vector<t_real_reso>, std::vector<t_real_reso>>({}, {});
 	}
 
+	/**
+	 * allocation-free variant of disp(), writes at most iMaxBranches
+	 * energies and weights into pE and pW.
+	 * returns the total number of branches, which can exceed iMaxBranches,
+	 * in that case the caller has to retry with larger buffers.
+	 * the default implementation falls back to disp().
+	 */
+	virtual std::size_t disp_into(t_real_reso dh, t_real_reso dk, t_real_reso dl,
+		t_real_reso *pE, t_real_reso *pW, std::size_t iMaxBranches) const
+	{
+		std::vector<t_real_reso> vecE, vecW;
+		std::tie(vecE, vecW) = disp(dh, dk, dl);
+
+		const std::size_t iNum = std::min(vecE.size(), vecW.size());
+		for(std::size_t i=0; i<std::min(iNum, iMaxBranches); ++i)
+		{
+			pE[i] = vecE[i];
+			pW[i] = vecW[i];
+		}
+		return iNum;
+	}
+
+	/**
+	 * maximum number of dispersion branches written by disp_into(), 0: not known beforehand
+	 */
+	virtual std::size_t GetDispBranchCount() const
+	{
+		return 0;
+	}
+
+	/**
+	 * fills the given buffer using disp_into(), returns the number of branches
+	 */
+	std::size_t fill_disp(t_real_reso dh, t_real_reso dk, t_real_reso dl, SqwDispBuf& buf) const
+	{
+		buf.Reserve(GetDispBranchCount());
+
+		std::size_t iNum = disp_into(dh, dk, dl, buf.E(), buf.W(), buf.capacity());
+		if(iNum > buf.capacity())
+		{
+			buf.Reserve(iNum);
+			iNum = disp_into(dh, dk, dl, buf.E(), buf.W(), buf.capacity());
+		}
+
+		buf.SetSize(std::min(iNum, buf.capacity()));
+		return buf.size();
+	}
+
+	/**
+	 * modules whose S(Q,E) is given by their dispersion and a line shape
+	 * can evaluate the latter for other branches, e.g. interpolated ones
+	 */
+	virtual bool HasLineShape() const
+	{
+		return false;
+	}
+
+	virtual t_real_reso line_shape(t_real_reso /*dh*/, t_real_reso /*dk*/, t_real_reso /*dl*/, t_real_reso /*dE*/,
+		const t_real_reso* /*pE*/, const t_real_reso* /*pW*/, std::size_t /*iNumBranches*/) const
+	{
+		return 0.;
+	}
+
 	// S(Q,E) dynamical structure factor function which is queried for every mc point
 	virtual t_real_reso operator()(t_real_reso dh, t_real_reso dk, t_real_reso dl, t_real_reso dE) const = 0;
 
+	/**
+	 * S(Q,E) for a batch of mc points given as separate h, k, l and E arrays,
+	 * the default implementation calls operator() for each point
+	 */
+	virtual void sqw_batch(std::size_t iNum, const t_real_reso *pH, const t_real_reso *pK,
+		const t_real_reso *pL, const t_real_reso *pE, t_real_reso *pS) const
+	{
+		for(std::size_t i=0; i<iNum; ++i)
+			pS[i] = operator()(pH[i], pK[i], pL[i], pE[i]);
+	}
+
 	// background which is queried for every nominal (Q, E) point
 	virtual t_real_reso GetBackground(t_real_reso /*dh*/, t_real_reso /*dk*/, t_real_reso /*dl*/, t_real_reso /*dE*/) const
 	{
@@ -83,6 +207,15 @@ public:
 		return m_bOk;
 	}
 
+	/**
+	 * can shallow copies evaluate different variables at the same time?
+	 * false for modules whose copies share their parameters, e.g. the script modules
+	 */
+	virtual bool HasIndependentCopies() const
+	{
+		return true;
+	}
+
 	// return model variables
 	virtual std::vector<t_var> GetVars() const = 0;
 	virtual const std::vector<t_var_fit>& GetFitVars() const
@@ -112,6 +245,22 @@ public:
 	SqwBase(const SqwBase& sqw) { this->operator=(sqw); }
 
 	virtual SqwBase* shallow_copy() const = 0;
+
+
+protected:
+	/**
+	 * disp() in terms of disp_into() for modules implementing the latter
+	 */
+	std::tuple<std::vector<t_real_reso>, std::vector<t_real_reso>>
+		disp_vecs(t_real_reso dh, t_real_reso dk, t_real_reso dl) const
+	{
+		SqwDispBuf buf;
+		std::size_t iNum = fill_disp(dh, dk, dl, buf);
+
+		return std::make_tuple(
+			std::vector<t_real_reso>(buf.E(), buf.E()+iNum),
+			std::vector<t_real_reso>(buf.W(), buf.W()+iNum));
+	}
 };
 
 
@@ -142,6 +291,59 @@ t_vec str_to_vec(const std::string& str)
 	return vec;
 }
 
+
+/**
+ * sums S(Q,E) over the given mc neutrons using SqwBase::sqw_batch(),
+ * the neutrons' (h, k, l, E) components are added to dhklE_sum if given.
+ * the neutrons are evaluated in chunks, after each of which funcStop is
+ * queried; the partial sum is returned if it requests a stop.
+ */
+template<class t_vec>
+t_real_reso sqw_sum(const SqwBase& sqw, const std::vector<t_vec>& vecNeutrons,
+	t_real_reso *dhklE_sum = nullptr, const std::function<bool()>& funcStop = nullptr)
+{
+	static constexpr std::size_t CHUNK_SIZE = 16384;
+
+	const std::size_t iNum = vecNeutrons.size();
+	const std::size_t iChunk = std::min(iNum, CHUNK_SIZE);
+	std::vector<t_real_reso> vecH(iChunk), vecK(iChunk), vecL(iChunk), vecE(iChunk), vecS(iChunk);
+
+	t_real_reso dS = 0.;
+	for(std::size_t iStart=0; iStart<iNum; iStart+=iChunk)
+	{
+		if(funcStop && funcStop())
+			break;
+
+		const std::size_t iCur = std::min(iChunk, iNum - iStart);
+		for(std::size_t i=0; i<iCur; ++i)
+		{
+			const t_vec& vecHKLE = vecNeutrons[iStart + i];
+			vecH[i] = vecHKLE[0];
+			vecK[i] = vecHKLE[1];
+			vecL[i] = vecHKLE[2];
+			vecE[i] = vecHKLE[3];
+		}
+
+		sqw.sqw_batch(iCur, vecH.data(), vecK.data(), vecL.data(), vecE.data(), vecS.data());
+
+		for(std::size_t i=0; i<iCur; ++i)
+			dS += vecS[i];
+
+		if(dhklE_sum)
+		{
+			for(std::size_t i=0; i<iCur; ++i)
+			{
+				dhklE_sum[0] += vecH[i];
+				dhklE_sum[1] += vecK[i];
+				dhklE_sum[2] += vecL[i];
+				dhklE_sum[3] += vecE[i];
+			}
+		}
+	}
+
+	return dS;
+}
+
 // ----------------------------------------------------------------------------
 
 #endif
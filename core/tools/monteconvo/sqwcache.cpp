@@ -0,0 +1,797 @@
+/**
+ * S(Q, E) module caching the dispersion of another, expensive module
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date 2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "sqwcache.h"
+
+#include "tlibs/log/log.h"
+#include "tlibs/string/string.h"
+#include "tlibs/math/math.h"
+#include "tlibs/math/rand.h"
+#include "tlibs/phys/neutrons.h"
+#include "tlibs/helper/hash.h"
+
+#include <fstream>
+#include <algorithm>
+#include <sstream>
+#include <limits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <ctime>
+#include <tuple>
+#include <boost/filesystem.hpp>
+
+namespace fs = boost::filesystem;
+using t_real = typename SqwCache::t_real;
+
+
+// file format identifier
+static const char g_acMagic[8] = { 'T', 'A', 'K', 'S', 'Q', 'W', 'C', '1' };
+
+// grid points per tile side
+static constexpr int TILE = SqwCacheTable::TILE;
+static constexpr std::size_t TILE_POINTS = (TILE+1)*(TILE+1)*(TILE+1);
+
+// tile indices are stored in 21 bits each
+static constexpr std::int64_t TILE_IDX_OFFS = std::int64_t(1) << 20;
+static constexpr std::uint64_t TILE_IDX_MASK = (std::uint64_t(1) << 21) - 1;
+
+
+// ----------------------------------------------------------------------------
+// helpers
+
+std::string get_sqw_cache_dir()
+{
+	if(const char* pcDir = std::getenv("TAKIN_SQW_CACHE_DIR"))
+		return pcDir;
+
+	boost::system::error_code err;
+	fs::path pathTmp = fs::temp_directory_path(err);
+	if(err)
+		pathTmp = ".";
+
+	return (pathTmp / "takin_sqw_cache").string();
+}
+
+
+std::uint64_t get_sqw_cache_size()
+{
+	if(const char* pcSize = std::getenv("TAKIN_SQW_CACHE_SIZE"))
+	{
+		long long iSize = std::strtoll(pcSize, nullptr, 10);
+		if(iSize >= 0)
+			return std::uint64_t(iSize) * 1024 * 1024;
+	}
+
+	return std::uint64_t(1024) * 1024 * 1024;
+}
+
+
+/**
+ * removes the least recently used cache tables in the directory until they fit into the size limit,
+ * pathKeep is not removed
+ */
+static void evict_cache_files(const fs::path& pathKeep)
+{
+	const std::uint64_t iMaxSize = get_sqw_cache_size();
+	if(!iMaxSize)
+		return;
+
+	boost::system::error_code err;
+	std::vector<std::tuple<std::time_t, std::uint64_t, fs::path>> vecFiles;
+	std::uint64_t iTotalSize = 0;
+
+	for(fs::directory_iterator iter(pathKeep.parent_path(), err); !err && iter != fs::directory_iterator(); iter.increment(err))
+	{
+		const fs::path& path = iter->path();
+		const std::string strName = path.filename().string();
+		if(strName.compare(0, 9, "sqwcache_") != 0 || path.extension() != ".dat" || !fs::is_regular_file(path, err))
+			continue;
+
+		const std::uint64_t iSize = fs::file_size(path, err);
+		const std::time_t tTime = fs::last_write_time(path, err);
+		if(err)
+			continue;
+
+		iTotalSize += iSize;
+		if(!fs::equivalent(path, pathKeep, err))
+			vecFiles.emplace_back(tTime, iSize, path);
+	}
+
+	// oldest first
+	std::sort(vecFiles.begin(), vecFiles.end());
+
+	for(const auto& tupFile : vecFiles)
+	{
+		if(iTotalSize <= iMaxSize)
+			break;
+
+		if(fs::remove(std::get<2>(tupFile), err))
+		{
+			iTotalSize -= std::get<1>(tupFile);
+			tl::log_info("Removed old S(Q, E) cache file \"", std::get<2>(tupFile).string(), "\".");
+		}
+	}
+}
+
+
+/**
+ * hash of a configuration file's contents, 0 if it cannot be read
+ */
+static std::size_t cfg_file_hash(const std::string& strFile)
+{
+	if(strFile == "")
+		return 0;
+
+	std::ifstream ifstr(strFile, std::ios_base::binary);
+	if(!ifstr)
+		return 0;
+
+	std::ostringstream ostr;
+	ostr << ifstr.rdbuf();
+	return tl::hash(ostr.str());
+}
+
+
+static std::uint64_t tile_key(std::int64_t iH, std::int64_t iK, std::int64_t iL)
+{
+	return (std::uint64_t(iH + TILE_IDX_OFFS) & TILE_IDX_MASK) << 42 |
+		(std::uint64_t(iK + TILE_IDX_OFFS) & TILE_IDX_MASK) << 21 |
+		(std::uint64_t(iL + TILE_IDX_OFFS) & TILE_IDX_MASK);
+}
+
+
+/**
+ * rounds towards negative infinity
+ */
+static std::int64_t floor_div(std::int64_t iNum, std::int64_t iDiv)
+{
+	return iNum >= 0 ? iNum/iDiv : -((-iNum + iDiv - 1) / iDiv);
+}
+
+
+template<class T>
+static void write_val(std::ostream& ostr, const T& t)
+{
+	ostr.write(reinterpret_cast<const char*>(&t), sizeof(t));
+}
+
+template<class T>
+static void write_arr(std::ostream& ostr, const std::vector<T>& vec)
+{
+	ostr.write(reinterpret_cast<const char*>(vec.data()), vec.size()*sizeof(T));
+}
+
+template<class T>
+static bool read_val(std::istream& istr, T& t)
+{
+	return bool(istr.read(reinterpret_cast<char*>(&t), sizeof(t)));
+}
+
+template<class T>
+static bool read_arr(std::istream& istr, std::vector<T>& vec, std::size_t iSize)
+{
+	vec.resize(iSize);
+	return bool(istr.read(reinterpret_cast<char*>(vec.data()), iSize*sizeof(T)));
+}
+
+
+/**
+ * tables shared by all modules with the same key, they are saved when no module uses them anymore
+ */
+static std::shared_ptr<SqwCacheTable> get_table(const std::string& strKey,
+	const std::string& strFile, t_real dStep)
+{
+	static std::mutex s_mtx;
+	static std::unordered_map<std::string, std::weak_ptr<SqwCacheTable>> s_mapTables;
+
+	std::lock_guard<std::mutex> lock(s_mtx);
+
+	for(auto iter = s_mapTables.begin(); iter != s_mapTables.end();)
+	{
+		if(iter->second.expired())
+			iter = s_mapTables.erase(iter);
+		else
+			++iter;
+	}
+
+	std::shared_ptr<SqwCacheTable> pTable = s_mapTables[strKey].lock();
+	if(!pTable)
+	{
+		pTable = std::make_shared<SqwCacheTable>(strKey, strFile, dStep);
+		pTable->Load();
+		s_mapTables[strKey] = pTable;
+	}
+
+	return pTable;
+}
+// ----------------------------------------------------------------------------
+
+
+
+// ----------------------------------------------------------------------------
+// table
+
+SqwCacheTable::SqwCacheTable(const std::string& strKey, const std::string& strFile, t_real dStep)
+	: m_strKey(strKey), m_strFile(strFile), m_dStep(dStep)
+{
+	static std::atomic<std::uint64_t> s_iNextId{1};
+	m_iId = s_iNextId++;
+}
+
+
+SqwCacheTable::~SqwCacheTable()
+{
+	if(m_bModified)
+		Save();
+}
+
+
+std::size_t SqwCacheTable::GetNumTiles() const
+{
+	std::lock_guard<std::mutex> lock(m_mtx);
+	return m_mapTiles.size();
+}
+
+
+const SqwCacheTile& SqwCacheTable::GetTile(const SqwBase& sqw,
+	std::int64_t iH, std::int64_t iK, std::int64_t iL) const
+{
+	const std::uint64_t iKey = tile_key(iH, iK, iL);
+
+	// consecutive points of a thread mostly fall into the same tile
+	thread_local std::uint64_t s_iLastId = 0, s_iLastKey = 0;
+	thread_local std::shared_ptr<SqwCacheTile> s_pLastTile;
+
+	if(s_pLastTile && s_iLastId == m_iId && s_iLastKey == iKey)
+		return *s_pLastTile;
+
+	std::shared_ptr<SqwCacheTile> pTile;
+	{
+		std::lock_guard<std::mutex> lock(m_mtx);
+		std::shared_ptr<SqwCacheTile>& pEntry = m_mapTiles[iKey];
+		if(!pEntry)
+			pEntry = std::make_shared<SqwCacheTile>();
+		pTile = pEntry;
+	}
+
+	// the first thread needing the tile calculates it, others needing it wait
+	std::call_once(pTile->flagCalc, [this, &sqw, &pTile, iH, iK, iL]()
+	{
+		SqwCacheTile& tile = *pTile;
+		tile.vecOffs.reserve(TILE_POINTS + 1);
+		tile.vecOffs.push_back(0);
+
+		SqwDispBuf buf;
+		for(int iPtH=0; iPtH<=TILE; ++iPtH)
+		for(int iPtK=0; iPtK<=TILE; ++iPtK)
+		for(int iPtL=0; iPtL<=TILE; ++iPtL)
+		{
+			const t_real dh = t_real(iH*TILE + iPtH) * m_dStep;
+			const t_real dk = t_real(iK*TILE + iPtK) * m_dStep;
+			const t_real dl = t_real(iL*TILE + iPtL) * m_dStep;
+
+			const std::size_t iNum = sqw.fill_disp(dh, dk, dl, buf);
+			tile.vecE.insert(tile.vecE.end(), buf.E(), buf.E()+iNum);
+			tile.vecW.insert(tile.vecW.end(), buf.W(), buf.W()+iNum);
+			tile.vecOffs.push_back(std::uint32_t(tile.vecE.size()));
+		}
+
+		m_bModified = true;
+	});
+
+	s_iLastId = m_iId;
+	s_iLastKey = iKey;
+	s_pLastTile = pTile;
+
+	return *pTile;
+}
+
+
+/**
+ * loads the tiles calculated in earlier runs
+ */
+bool SqwCacheTable::Load()
+{
+	std::ifstream ifstr(m_strFile, std::ios_base::binary);
+	if(!ifstr)
+		return false;
+
+	char acMagic[sizeof(g_acMagic)];
+	std::uint32_t iRealSize = 0, iTile = 0;
+	std::uint64_t iKeyLen = 0, iNumTiles = 0;
+	t_real dStep = 0.;
+
+	if(!ifstr.read(acMagic, sizeof(acMagic)) || !std::equal(acMagic, acMagic+sizeof(acMagic), g_acMagic)
+		|| !read_val(ifstr, iRealSize) || iRealSize != sizeof(t_real)
+		|| !read_val(ifstr, iTile) || iTile != std::uint32_t(TILE)
+		|| !read_val(ifstr, iKeyLen) || iKeyLen != m_strKey.length())
+	{
+		tl::log_warn("Ignoring incompatible S(Q, E) cache file \"", m_strFile, "\".");
+		return false;
+	}
+
+	// the key is compared in full, the file name only contains its hash
+	std::string strKey(iKeyLen, ' ');
+	if(!ifstr.read(&strKey[0], iKeyLen) || strKey != m_strKey
+		|| !read_val(ifstr, dStep) || dStep != m_dStep
+		|| !read_val(ifstr, iNumTiles))
+	{
+		tl::log_warn("S(Q, E) cache file \"", m_strFile, "\" belongs to another model.");
+		return false;
+	}
+
+	// size of the tile data, to reject damaged lengths before allocating
+	const std::streamoff iDataStart = ifstr.tellg();
+	ifstr.seekg(0, std::ios_base::end);
+	const std::uint64_t iDataSize = std::uint64_t(ifstr.tellg() - iDataStart);
+	ifstr.seekg(iDataStart);
+
+	std::lock_guard<std::mutex> lock(m_mtx);
+	for(std::uint64_t iTileIdx=0; iTileIdx<iNumTiles; ++iTileIdx)
+	{
+		std::uint64_t iKey = 0, iNumBranches = 0;
+		std::shared_ptr<SqwCacheTile> pTile = std::make_shared<SqwCacheTile>();
+
+		// the offsets index vecE and vecW => they have to be monotonic and within the branches
+		if(!read_val(ifstr, iKey) || !read_val(ifstr, iNumBranches)
+			|| iNumBranches > iDataSize / (2*sizeof(t_real))
+			|| !read_arr(ifstr, pTile->vecOffs, TILE_POINTS + 1)
+			|| !read_arr(ifstr, pTile->vecE, iNumBranches)
+			|| !read_arr(ifstr, pTile->vecW, iNumBranches)
+			|| pTile->vecOffs.front() != 0
+			|| !std::is_sorted(pTile->vecOffs.begin(), pTile->vecOffs.end())
+			|| pTile->vecOffs.back() != iNumBranches)
+		{
+			tl::log_err("S(Q, E) cache file \"", m_strFile, "\" is damaged.");
+			m_mapTiles.clear();
+			return false;
+		}
+
+		// mark as calculated
+		std::call_once(pTile->flagCalc, []() {});
+		m_mapTiles[iKey] = pTile;
+	}
+
+	// mark as recently used, for evicting old tables
+	boost::system::error_code err;
+	fs::last_write_time(fs::path(m_strFile), std::time(nullptr), err);
+
+	tl::log_info("Loaded ", m_mapTiles.size(), " tiles from S(Q, E) cache file \"", m_strFile, "\".");
+	return true;
+}
+
+
+bool SqwCacheTable::Save() const
+{
+	std::lock_guard<std::mutex> lock(m_mtx);
+
+	boost::system::error_code err;
+	fs::create_directories(fs::path(m_strFile).parent_path(), err);
+
+	// write to a temporary file first, other processes might use the same table
+	const std::string strTmpFile = m_strFile + "." + tl::rand_name<std::string>(8);
+	{
+		std::ofstream ofstr(strTmpFile, std::ios_base::binary);
+		if(!ofstr)
+		{
+			tl::log_err("Cannot write S(Q, E) cache file \"", m_strFile, "\".");
+			return false;
+		}
+
+		std::uint64_t iNumTiles = 0;
+		for(const auto& pairTile : m_mapTiles)
+		{
+			if(pairTile.second->vecOffs.size() == TILE_POINTS + 1)
+				++iNumTiles;
+		}
+
+		ofstr.write(g_acMagic, sizeof(g_acMagic));
+		write_val(ofstr, std::uint32_t(sizeof(t_real)));
+		write_val(ofstr, std::uint32_t(TILE));
+		write_val(ofstr, std::uint64_t(m_strKey.length()));
+		ofstr.write(m_strKey.data(), m_strKey.length());
+		write_val(ofstr, m_dStep);
+		write_val(ofstr, iNumTiles);
+
+		for(const auto& pairTile : m_mapTiles)
+		{
+			const SqwCacheTile& tile = *pairTile.second;
+			if(tile.vecOffs.size() != TILE_POINTS + 1)
+				continue;
+
+			write_val(ofstr, pairTile.first);
+			write_val(ofstr, std::uint64_t(tile.vecE.size()));
+			write_arr(ofstr, tile.vecOffs);
+			write_arr(ofstr, tile.vecE);
+			write_arr(ofstr, tile.vecW);
+		}
+
+		if(!ofstr)
+		{
+			tl::log_err("Cannot write S(Q, E) cache file \"", m_strFile, "\".");
+			std::remove(strTmpFile.c_str());
+			return false;
+		}
+	}
+
+	fs::rename(strTmpFile, m_strFile, err);
+	if(err)
+	{
+		tl::log_err("Cannot write S(Q, E) cache file \"", m_strFile, "\": ", err.message(), ".");
+		std::remove(strTmpFile.c_str());
+		return false;
+	}
+
+	m_bModified = false;
+	tl::log_info("Saved ", m_mapTiles.size(), " tiles to S(Q, E) cache file \"", m_strFile, "\".");
+
+	evict_cache_files(fs::path(m_strFile));
+	return true;
+}
+// ----------------------------------------------------------------------------
+
+
+
+// ----------------------------------------------------------------------------
+// module
+
+SqwCache::SqwCache(std::shared_ptr<SqwBase> pSqw, const std::string& strIdent,
+	const std::string& strCfgFile, const std::string& strDir)
+	: m_pSqw(pSqw), m_strIdent(strIdent), m_strCfgFile(strCfgFile),
+		m_iCfgHash(cfg_file_hash(strCfgFile)),
+		m_strDir(strDir == "" ? get_sqw_cache_dir() : strDir)
+{
+	SqwBase::m_bOk = 0;
+	if(!m_pSqw)
+	{
+		tl::log_err("No S(Q, E) module to cache.");
+		return;
+	}
+
+	// a module without a dispersion, e.g. an elastic one, cannot be tabulated
+	bool bHasDisp = false;
+	SqwDispBuf buf;
+	for(t_real dq : { 0.1, 0.55, 1.05 })
+	{
+		if(m_pSqw->fill_disp(dq, 0., 0., buf) || m_pSqw->fill_disp(0., dq, 0., buf)
+			|| m_pSqw->fill_disp(0., 0., dq, buf) || m_pSqw->fill_disp(dq, dq, dq, buf))
+		{
+			bHasDisp = true;
+			break;
+		}
+	}
+
+	if(!bHasDisp)
+	{
+		tl::log_err("S(Q, E) module \"", m_strIdent, "\" has no dispersion which could be cached.");
+		return;
+	}
+
+	m_bModLineShape = m_pSqw->HasLineShape();
+	if(!m_bModLineShape)
+	{
+		tl::log_warn("S(Q, E) module \"", m_strIdent, "\" has no separate line shape, ",
+			"it is replaced by Gaussians using the cache_* variables.");
+		UpdateLineShape();
+	}
+
+	UpdateTable();
+	SqwBase::m_bOk = 1;
+}
+
+
+/**
+ * takes the parameters of the replacement line shape from the module's variables, if it has them
+ */
+void SqwCache::UpdateLineShape()
+{
+	for(const SqwBase::t_var& var : m_pSqw->GetVars())
+	{
+		const std::string& strVar = std::get<0>(var);
+		const std::string& strVal = std::get<2>(var);
+
+		if(strVar == "T") m_dT = tl::str_to_var<decltype(m_dT)>(strVal);
+		else if(strVar == "bose_cutoff" || strVar == "cutoff") m_dcut = tl::str_to_var<decltype(m_dcut)>(strVal);
+		else if(strVar == "sigma") m_dSigma = tl::str_to_var<decltype(m_dSigma)>(strVal);
+		else if(strVar == "inc_amp") m_dIncAmp = tl::str_to_var<decltype(m_dIncAmp)>(strVal);
+		else if(strVar == "inc_sigma" || strVar == "inc_sig") m_dIncSigma = tl::str_to_var<decltype(m_dIncSigma)>(strVal);
+		else if(strVar == "S0") m_dS0 = tl::str_to_var<decltype(m_dS0)>(strVal);
+	}
+}
+
+
+/**
+ * selects the table for the module's current variables
+ */
+void SqwCache::UpdateTable()
+{
+	std::ostringstream ostrKey;
+	ostrKey.precision(std::numeric_limits<t_real>::max_digits10);
+	ostrKey << m_strIdent << "\n" << m_strCfgFile << "\n" << m_iCfgHash << "\n" << m_dStep << "\n";
+	for(const SqwBase::t_var& var : m_pSqw->GetVars())
+		ostrKey << std::get<0>(var) << " = " << std::get<2>(var) << "\n";
+
+	const std::string strKey = ostrKey.str();
+	if(m_pTable && m_pTable->GetKey() == strKey)
+		return;
+
+	std::string strIdent = m_strIdent;
+	for(char& ch : strIdent)
+	{
+		if(!std::isalnum(static_cast<unsigned char>(ch)))
+			ch = '_';
+	}
+
+	std::ostringstream ostrFile;
+	ostrFile << "sqwcache_" << strIdent << "_" << std::hex << tl::hash(strKey) << ".dat";
+
+	m_pTable = get_table(strKey, (fs::path(m_strDir) / ostrFile.str()).string(), m_dStep);
+	tl::log_debug("Using S(Q, E) cache table \"", ostrFile.str(), "\" with ", m_pTable->GetNumTiles(), " tiles.");
+}
+
+
+std::tuple<std::vector<t_real>, std::vector<t_real>>
+	SqwCache::disp(t_real dh, t_real dk, t_real dl) const
+{
+	return disp_vecs(dh, dk, dl);
+}
+
+
+/**
+ * dispersion interpolated between the surrounding grid points
+ */
+std::size_t SqwCache::disp_into(t_real dh, t_real dk, t_real dl,
+	t_real *pE, t_real *pW, std::size_t iMaxBranches) const
+{
+	const t_real dStep = m_pTable->GetStep();
+	const t_real dPos[3] = { dh/dStep, dk/dStep, dl/dStep };
+
+	std::int64_t iTile[3], iLocal[3];
+	t_real dFrac[3];
+	for(int i=0; i<3; ++i)
+	{
+		const std::int64_t iPos = std::int64_t(std::floor(dPos[i]));
+		iTile[i] = floor_div(iPos, TILE);
+		iLocal[i] = iPos - iTile[i]*TILE;
+		dFrac[i] = dPos[i] - t_real(iPos);
+	}
+
+	const SqwCacheTile& tile = m_pTable->GetTile(*m_pSqw, iTile[0], iTile[1], iTile[2]);
+
+	// the eight surrounding grid points and their weights
+	std::size_t iCorner[8];
+	t_real dWeight[8];
+	std::size_t iMaxCorner = 0;
+	bool bSameBranches = true;
+	std::size_t iNum = 0;
+
+	for(int iC=0; iC<8; ++iC)
+	{
+		const int iDH = (iC>>2) & 1, iDK = (iC>>1) & 1, iDL = iC & 1;
+
+		iCorner[iC] = std::size_t(((iLocal[0]+iDH)*(TILE+1) + (iLocal[1]+iDK))*(TILE+1) + (iLocal[2]+iDL));
+		dWeight[iC] = (iDH ? dFrac[0] : 1.-dFrac[0]) *
+			(iDK ? dFrac[1] : 1.-dFrac[1]) *
+			(iDL ? dFrac[2] : 1.-dFrac[2]);
+
+		if(dWeight[iC] > dWeight[iMaxCorner])
+			iMaxCorner = iC;
+
+		const std::size_t iNumCorner = tile.vecOffs[iCorner[iC]+1] - tile.vecOffs[iCorner[iC]];
+		if(iC == 0)
+			iNum = iNumCorner;
+		else if(iNumCorner != iNum)
+			bSameBranches = false;
+	}
+
+	// the branches cannot be matched if their number changes => use the nearest point
+	if(!bSameBranches)
+	{
+		const std::uint32_t iOffs = tile.vecOffs[iCorner[iMaxCorner]];
+		const std::size_t iNumNearest = tile.vecOffs[iCorner[iMaxCorner]+1] - iOffs;
+
+		for(std::size_t iBranch=0; iBranch<std::min(iNumNearest, iMaxBranches); ++iBranch)
+		{
+			pE[iBranch] = tile.vecE[iOffs + iBranch];
+			pW[iBranch] = tile.vecW[iOffs + iBranch];
+		}
+		return iNumNearest;
+	}
+
+	for(std::size_t iBranch=0; iBranch<std::min(iNum, iMaxBranches); ++iBranch)
+	{
+		t_real dE = 0., dW = 0.;
+		for(int iC=0; iC<8; ++iC)
+		{
+			const std::uint32_t iOffs = tile.vecOffs[iCorner[iC]];
+			dE += dWeight[iC] * tile.vecE[iOffs + iBranch];
+			dW += dWeight[iC] * tile.vecW[iOffs + iBranch];
+		}
+
+		pE[iBranch] = dE;
+		pW[iBranch] = dW;
+	}
+
+	return iNum;
+}
+
+
+std::size_t SqwCache::GetDispBranchCount() const
+{
+	return m_pSqw->GetDispBranchCount();
+}
+
+
+/**
+ * S(q,E) from the cached dispersion
+ */
+t_real SqwCache::operator()(t_real dh, t_real dk, t_real dl, t_real dE) const
+{
+	SqwDispBuf buf;
+	const std::size_t iNumBranches = fill_disp(dh, dk, dl, buf);
+
+	if(m_bModLineShape)
+		return m_pSqw->line_shape(dh, dk, dl, dE, buf.E(), buf.W(), iNumBranches);
+
+	t_real dInc = 0;
+	if(!tl::float_equal(m_dIncAmp, t_real(0)))
+		dInc = tl::gauss_model(dE, t_real(0), m_dIncSigma, m_dIncAmp, t_real(0));
+
+	t_real dS = 0;
+	for(std::size_t iE=0; iE<iNumBranches; ++iE)
+		dS += tl::gauss_model(dE, buf.E(iE), m_dSigma, buf.W(iE), t_real(0));
+
+	return m_dS0*dS * tl::bose_cutoff(dE, m_dT, m_dcut) + dInc;
+}
+
+
+/**
+ * the background is only queried for the nominal points and is not cached
+ */
+t_real SqwCache::GetBackground(t_real dh, t_real dk, t_real dl, t_real dE) const
+{
+	return m_pSqw->GetBackground(dh, dk, dl, dE);
+}
+
+
+bool SqwCache::IsOk() const
+{
+	return SqwBase::IsOk() && m_pTable && m_pSqw->IsOk();
+}
+
+
+bool SqwCache::HasIndependentCopies() const
+{
+	// the tiles are calculated using the copies of the cached module
+	return m_pSqw->HasIndependentCopies();
+}
+
+
+
+// ----------------------------------------------------------------------------
+// get & set variables
+
+std::vector<SqwCache::t_var> SqwCache::GetVars() const
+{
+	std::vector<t_var> vecVars = m_pSqw->GetVars();
+
+	vecVars.push_back(SqwBase::t_var{"cache_step", "real", tl::var_to_str(m_dStep)});
+	if(m_bModLineShape)
+		return vecVars;
+
+	vecVars.push_back(SqwBase::t_var{"cache_T", "real", tl::var_to_str(m_dT)});
+	vecVars.push_back(SqwBase::t_var{"cache_bose_cutoff", "real", tl::var_to_str(m_dcut)});
+	vecVars.push_back(SqwBase::t_var{"cache_sigma", "real", tl::var_to_str(m_dSigma)});
+	vecVars.push_back(SqwBase::t_var{"cache_inc_amp", "real", tl::var_to_str(m_dIncAmp)});
+	vecVars.push_back(SqwBase::t_var{"cache_inc_sigma", "real", tl::var_to_str(m_dIncSigma)});
+	vecVars.push_back(SqwBase::t_var{"cache_S0", "real", tl::var_to_str(m_dS0)});
+
+	return vecVars;
+}
+
+
+/**
+ * sets the variables of the cache and of the module, a new table is used if the latter change
+ */
+void SqwCache::SetVars(const std::vector<SqwCache::t_var>& vecVars)
+{
+	if(!vecVars.size()) return;
+
+	std::vector<t_var> vecModVars;
+	bool bNewTable = false;
+
+	for(const SqwBase::t_var& var : vecVars)
+	{
+		const std::string& strVar = std::get<0>(var);
+		const std::string& strVal = std::get<2>(var);
+
+		if(strVar == "cache_step")
+		{
+			t_real dStep = tl::str_to_var<t_real>(strVal);
+			if(dStep > t_real(0))
+			{
+				bNewTable = bNewTable || (dStep != m_dStep);
+				m_dStep = dStep;
+			}
+			else
+			{
+				tl::log_err("Invalid S(Q, E) cache step: ", strVal, ".");
+			}
+		}
+		else if(strVar == "cache_T") m_dT = tl::str_to_var<decltype(m_dT)>(strVal);
+		else if(strVar == "cache_bose_cutoff") m_dcut = tl::str_to_var<decltype(m_dcut)>(strVal);
+		else if(strVar == "cache_sigma") m_dSigma = tl::str_to_var<decltype(m_dSigma)>(strVal);
+		else if(strVar == "cache_inc_amp") m_dIncAmp = tl::str_to_var<decltype(m_dIncAmp)>(strVal);
+		else if(strVar == "cache_inc_sigma") m_dIncSigma = tl::str_to_var<decltype(m_dIncSigma)>(strVal);
+		else if(strVar == "cache_S0") m_dS0 = tl::str_to_var<decltype(m_dS0)>(strVal);
+		else vecModVars.push_back(var);
+	}
+
+	if(vecModVars.size())
+	{
+		m_pSqw->SetVars(vecModVars);
+		bNewTable = true;
+
+		if(!m_bModLineShape)
+			UpdateLineShape();
+	}
+
+	if(bNewTable)
+		UpdateTable();
+}
+
+
+
+// ----------------------------------------------------------------------------
+// copy
+
+SqwBase* SqwCache::shallow_copy() const
+{
+	SqwCache *pMod = new SqwCache();
+	*static_cast<SqwBase*>(pMod) = *static_cast<const SqwBase*>(this);
+
+	pMod->m_pSqw.reset(m_pSqw->shallow_copy());
+	pMod->m_strIdent = this->m_strIdent;
+	pMod->m_strCfgFile = this->m_strCfgFile;
+	pMod->m_iCfgHash = this->m_iCfgHash;
+	pMod->m_strDir = this->m_strDir;
+	pMod->m_pTable = this->m_pTable;
+
+	pMod->m_dStep = this->m_dStep;
+	pMod->m_bModLineShape = this->m_bModLineShape;
+	pMod->m_dT = this->m_dT;
+	pMod->m_dcut = this->m_dcut;
+	pMod->m_dSigma = this->m_dSigma;
+	pMod->m_dS0 = this->m_dS0;
+	pMod->m_dIncAmp = this->m_dIncAmp;
+	pMod->m_dIncSigma = this->m_dIncSigma;
+
+	return pMod;
+}
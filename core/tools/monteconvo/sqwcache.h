@@ -0,0 +1,178 @@
+/**
+ * S(Q, E) module caching the dispersion of another, expensive module
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date 2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef __MCONV_SQW_CACHE_H__
+#define __MCONV_SQW_CACHE_H__
+
+#include "sqwbase.h"
+
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+
+/**
+ * dispersion branches on a block of (SqwCacheTable::TILE+1)^3 grid points
+ */
+struct SqwCacheTile
+{
+	std::once_flag flagCalc{};
+
+	// branches of grid point i: [vecOffs[i], vecOffs[i+1])
+	std::vector<std::uint32_t> vecOffs{};
+	std::vector<t_real_reso> vecE{}, vecW{};
+};
+
+
+/**
+ * tabulated dispersion of a module with a given set of variables,
+ * the tiles are calculated when they are first accessed
+ */
+class SqwCacheTable
+{
+public:
+	using t_real = t_real_reso;
+	static constexpr int TILE = 8;
+
+protected:
+	// identifies the module, its configuration and its variables
+	std::string m_strKey{};
+	std::string m_strFile{};
+	t_real m_dStep = 0.01;
+
+	// unique id, used for the per-thread lookup cache
+	std::uint64_t m_iId = 0;
+
+	mutable std::mutex m_mtx{};
+	mutable std::unordered_map<std::uint64_t, std::shared_ptr<SqwCacheTile>> m_mapTiles{};
+	mutable std::atomic<bool> m_bModified{false};
+
+public:
+	SqwCacheTable(const std::string& strKey, const std::string& strFile, t_real dStep);
+	~SqwCacheTable();
+
+	SqwCacheTable(const SqwCacheTable&) = delete;
+	const SqwCacheTable& operator=(const SqwCacheTable&) = delete;
+
+	const std::string& GetKey() const { return m_strKey; }
+	t_real GetStep() const { return m_dStep; }
+	std::size_t GetNumTiles() const;
+
+	/**
+	 * tile with the given indices, calculated using the module sqw if needed
+	 */
+	const SqwCacheTile& GetTile(const SqwBase& sqw, std::int64_t iH, std::int64_t iK, std::int64_t iL) const;
+
+	bool Load();
+
+	// must not be called while the table is in use
+	bool Save() const;
+};
+
+
+class SqwCache : public SqwBase
+{
+public:
+	using t_real = t_real_reso;
+
+protected:
+	std::shared_ptr<SqwBase> m_pSqw{};
+	std::string m_strIdent{}, m_strCfgFile{};
+	std::size_t m_iCfgHash = 0;	// of the configuration file's contents
+	std::string m_strDir{};
+
+	std::shared_ptr<SqwCacheTable> m_pTable{};
+
+	// grid step in rlu
+	t_real m_dStep = 0.01;
+
+	// use the module's line shape, otherwise the one of the uniform grid module,
+	// with the parameters taken from the module's variables of the same names
+	bool m_bModLineShape = false;
+	t_real m_dT = 100.;
+	t_real m_dcut = 0.02;
+	t_real m_dSigma = 0.05;
+	t_real m_dS0 = 1.;
+	t_real m_dIncAmp = 0.;
+	t_real m_dIncSigma = 0.05;
+
+protected:
+	SqwCache() = default;
+	void UpdateTable();
+	void UpdateLineShape();
+
+public:
+	/**
+	 * caches pSqw, the module identifier and the configuration file's name and contents are part of the table's key;
+	 * the tables are stored in strDir or, if empty, in get_sqw_cache_dir()
+	 */
+	SqwCache(std::shared_ptr<SqwBase> pSqw, const std::string& strIdent,
+		const std::string& strCfgFile, const std::string& strDir = "");
+	virtual ~SqwCache() = default;
+
+	std::shared_ptr<SqwBase> GetModule() const { return m_pSqw; }
+	std::shared_ptr<SqwCacheTable> GetTable() const { return m_pTable; }
+
+	virtual std::tuple<std::vector<t_real>, std::vector<t_real>>
+		disp(t_real dh, t_real dk, t_real dl) const override;
+	virtual std::size_t disp_into(t_real dh, t_real dk, t_real dl,
+		t_real *pE, t_real *pW, std::size_t iMaxBranches) const override;
+	virtual std::size_t GetDispBranchCount() const override;
+
+	virtual t_real operator()(t_real dh, t_real dk, t_real dl, t_real dE) const override;
+	virtual t_real GetBackground(t_real dh, t_real dk, t_real dl, t_real dE) const override;
+
+	virtual bool IsOk() const override;
+	virtual bool HasIndependentCopies() const override;
+
+	virtual std::vector<t_var> GetVars() const override;
+	virtual void SetVars(const std::vector<t_var>&) override;
+
+	virtual SqwBase* shallow_copy() const override;
+};
+
+
+/**
+ * directory for the cache tables, can be set using the TAKIN_SQW_CACHE_DIR environment variable
+ */
+extern std::string get_sqw_cache_dir();
+
+
+/**
+ * size limit of the cache directory in bytes, 0: no limit; the least recently used tables are
+ * removed when saving a table exceeds it; can be set in MB using the TAKIN_SQW_CACHE_SIZE
+ * environment variable, the default is 1 GB
+ */
+extern std::uint64_t get_sqw_cache_size();
+
+
+#endif
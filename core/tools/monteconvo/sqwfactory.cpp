@@ -38,6 +38,8 @@
 #include "sqw_proc.h"
 #include "sqw_proc_impl.h"
 #include "sqwrawdelegate.h"
+#include "sqw_cplugin.h"
+#include "sqwcache.h"
 #include "sqwnull.h"
 
 #include "tlibs/log/log.h"
@@ -69,11 +71,17 @@ using t_fkt_raw_new = typename std::remove_pointer<t_pfkt_raw_new>::type;
 using t_pfkt_raw_del = void(*)(SqwBase*);
 using t_fkt_raw_del = typename std::remove_pointer<t_pfkt_raw_del>::type;
 
+// versioned C interface: "takin_sqw_plugin", see sqw_plugin_abi.h
+using t_fkt_cplugin = typename std::remove_pointer<takin_sqw_plugin_func>::type;
+
 
 // key: identifier, value: [func, long name, help text]
 using t_mapSqw = std::unordered_map<std::string, std::tuple<t_pfkt, std::string, std::string>>;
 using t_mapSqwRaw = std::unordered_map<std::string, std::tuple<t_pfkt_raw_new, t_pfkt_raw_del, std::string, std::string>>;
 
+// key: identifier, value: function table, which also holds the names
+using t_mapSqwC = std::unordered_map<std::string, const takin_sqw_interface*>;
+
 // key: identifier, value: [long name, binary file name, help text]
 using t_mapSqwExt = std::unordered_map<std::string, std::tuple<std::string, std::string, std::string>>;
 
@@ -150,6 +158,9 @@ static t_mapSqw g_mapSqw =
 // raw pointer constructors
 static t_mapSqwRaw g_mapSqwRaw;
 
+// C interface plugins
+static t_mapSqwC g_mapSqwC;
+
 // external process plugins
 static t_mapSqwExt g_mapSqwExt;
 
@@ -184,6 +195,16 @@ std::vector<std::tuple<std::string, std::string, std::string>> get_sqw_names()
 		vec.emplace_back(std::move(tup));
 	}
 
+	for(const t_mapSqwC::value_type& val : g_mapSqwC)
+	{
+		t_tup tup;
+		std::get<0>(tup) = val.first;
+		std::get<1>(tup) = val.second->long_name ? val.second->long_name : val.first;
+		std::get<2>(tup) = val.second->help ? val.second->help : "";
+
+		vec.emplace_back(std::move(tup));
+	}
+
 	for(const t_mapSqwExt::value_type& val : g_mapSqwExt)
 	{
 		t_tup tup;
@@ -206,11 +227,12 @@ std::vector<std::tuple<std::string, std::string, std::string>> get_sqw_names()
 }
 
 
-std::shared_ptr<SqwBase> construct_sqw(const std::string& strName,
+static std::shared_ptr<SqwBase> construct_sqw_module(const std::string& strName,
 	const std::string& strConfigFile)
 {
 	typename t_mapSqw::const_iterator iter = g_mapSqw.find(strName);
 	typename t_mapSqwRaw::const_iterator iterRaw = g_mapSqwRaw.find(strName);
+	typename t_mapSqwC::const_iterator iterC = g_mapSqwC.find(strName);
 	typename t_mapSqwExt::const_iterator iterExt = g_mapSqwExt.find(strName);
 
 	if(iter != g_mapSqw.end())
@@ -239,6 +261,11 @@ std::shared_ptr<SqwBase> construct_sqw(const std::string& strName,
 		tl::log_debug("Constructing \"", iterRaw->first, "\" S(Q, E) module via raw interface.");
 		return std::make_shared<SqwRawDelegate>(pFktNew(strConfigFile));
 	}
+	else if(iterC != g_mapSqwC.end())
+	{
+		tl::log_debug("Constructing \"", iterC->first, "\" S(Q, E) module via C interface.");
+		return std::make_shared<SqwCPlugin>(iterC->second, strConfigFile);
+	}
 	else if(iterExt != g_mapSqwExt.end())
 	{
 		tl::log_debug("Constructing \"", iterExt->first, "\" S(Q, E) module via external interface.");
@@ -256,6 +283,25 @@ std::shared_ptr<SqwBase> construct_sqw(const std::string& strName,
 }
 
 
+std::shared_ptr<SqwBase> construct_sqw(const std::string& strName,
+	const std::string& strConfigFile, bool bCache)
+{
+	std::shared_ptr<SqwBase> pSqw = construct_sqw_module(strName, strConfigFile);
+	if(!bCache || !pSqw || !pSqw->IsOk())
+		return pSqw;
+
+	tl::log_debug("Caching the dispersion of \"", strName, "\" S(Q, E) module.");
+	std::shared_ptr<SqwBase> pCache = std::make_shared<SqwCache>(pSqw, strName, strConfigFile);
+	if(!pCache->IsOk())
+	{
+		tl::log_warn("Using the uncached \"", strName, "\" S(Q, E) module.");
+		return pSqw;
+	}
+
+	return pCache;
+}
+
+
 
 
 // --------------------------------------------------------------------------------
@@ -392,6 +438,17 @@ void unload_sqw_plugins()
 		if(!pMod)
 			continue;
 
+		if(pMod->has("takin_sqw_plugin"))
+		{
+			const takin_sqw_interface *pPlugin = pMod->get<t_fkt_cplugin>("takin_sqw_plugin")();
+			tl::log_debug("Unloading plugin: ", pPlugin->ident, ".");
+			g_mapSqwC.erase(pPlugin->ident);
+
+			pMod->unload();
+			pMod.reset();
+			continue;
+		}
+
 		std::function<t_fkt_info> fktInfo =
 #ifndef __MINGW32__
 			pMod->get<t_pfkt_info>("takin_sqw_info");
@@ -454,6 +511,38 @@ void load_sqw_plugins()
 					if(!pmod || !*pmod)
 						continue;
 
+					// prefer the versioned C interface, which does not depend on the Takin version
+					if(pmod->has("takin_sqw_plugin"))
+					{
+						const takin_sqw_interface *pPlugin = pmod->get<t_fkt_cplugin>("takin_sqw_plugin")();
+
+						std::string strErr;
+						if(!SqwCPlugin::CheckPlugin(pPlugin, strErr))
+						{
+							tl::log_err("Skipping S(Q, E) plugin \"", strPlugin, "\": ", strErr);
+							pmod->unload();
+							continue;
+						}
+
+						const std::string strModIdent = pPlugin->ident;
+						if(g_mapSqw.find(strModIdent) != g_mapSqw.end()
+							|| g_mapSqwRaw.find(strModIdent) != g_mapSqwRaw.end()
+							|| g_mapSqwC.find(strModIdent) != g_mapSqwC.end())
+						{
+							tl::log_warn("Module id=", strModIdent, " is already registered."
+								" Plugin: ", strPlugin, ".");
+							pmod->unload();
+							continue;
+						}
+
+						g_mapSqwC.insert(t_mapSqwC::value_type{ strModIdent, pPlugin });
+						g_vecMods.emplace_back(std::move(pmod));
+						tl::log_info("Loaded plugin: ", strPlugin, " -> ", strModIdent,
+							" (\"", pPlugin->long_name ? pPlugin->long_name : "", "\", C interface version ",
+							pPlugin->abi_version, ").");
+						continue;
+					}
+
 					// import info function
 					if(!pmod->has("takin_sqw_info"))
 					{
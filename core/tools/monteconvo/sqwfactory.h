@@ -38,8 +38,9 @@
 #include <string>
 
 
+// bCache: wrap the module in an SqwCache tabulating its dispersion
 extern std::shared_ptr<SqwBase> construct_sqw(const std::string& strName,
-	const std::string& strConfigFile);
+	const std::string& strConfigFile, bool bCache = false);
 
 // [identifier, long name, help text]
 extern std::vector<std::tuple<std::string, std::string, std::string>> get_sqw_names();
@@ -51,16 +51,49 @@ public:
 		return m_pDelegate->disp(dh, dk, dl);
 	}
 
+	virtual std::size_t disp_into(t_real_reso dh, t_real_reso dk, t_real_reso dl,
+		t_real_reso *pE, t_real_reso *pW, std::size_t iMaxBranches) const override
+	{
+		return m_pDelegate->disp_into(dh, dk, dl, pE, pW, iMaxBranches);
+	}
+
+	virtual std::size_t GetDispBranchCount() const override
+	{
+		return m_pDelegate->GetDispBranchCount();
+	}
+
+	virtual bool HasLineShape() const override
+	{
+		return m_pDelegate->HasLineShape();
+	}
+
+	virtual t_real_reso line_shape(t_real_reso dh, t_real_reso dk, t_real_reso dl, t_real_reso dE,
+		const t_real_reso *pE, const t_real_reso *pW, std::size_t iNumBranches) const override
+	{
+		return m_pDelegate->line_shape(dh, dk, dl, dE, pE, pW, iNumBranches);
+	}
+
 	virtual t_real_reso operator()(t_real_reso dh, t_real_reso dk, t_real_reso dl, t_real_reso dE) const override
 	{
 		return m_pDelegate->operator()(dh, dk, dl, dE);
 	}
 
+	virtual void sqw_batch(std::size_t iNum, const t_real_reso *pH, const t_real_reso *pK,
+		const t_real_reso *pL, const t_real_reso *pE, t_real_reso *pS) const override
+	{
+		m_pDelegate->sqw_batch(iNum, pH, pK, pL, pE, pS);
+	}
+
 	virtual bool IsOk() const override
 	{
 		return m_pDelegate->IsOk();
 	}
 
+	virtual bool HasIndependentCopies() const override
+	{
+		return m_pDelegate->HasIndependentCopies();
+	}
+
 
 	virtual std::vector<t_var> GetVars() const override
 	{
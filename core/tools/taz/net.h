@@ -35,13 +35,23 @@
 
 #include "tasoptions.h"
 #include "dialogs/NetCacheDlg.h"
+#include "tlibs/net/tcp_replay.h"
 
 
 class NetCache : public QObject
 { Q_OBJECT
+	protected:
+		// records the raw messages from the instrument, for use with the netreplay tool
+		tl::TcpTxtRecorder<> m_recorder;
+
 	public:
 		virtual ~NetCache() {};
 
+		bool StartRecording(const std::string& strFile, const std::string& strComment = "")
+		{ return m_recorder.start(strFile, strComment); }
+		void StopRecording() { m_recorder.stop(); }
+		bool IsRecording() const { return m_recorder.is_recording(); }
+
 		virtual void connect(const std::string& strHost, const std::string& strPort,
 			const std::string& strUser, const std::string& strPass) = 0;
 		virtual void disconnect() = 0;
@@ -0,0 +1,186 @@
+/**
+ * coalesces the updates from the instrument's network cache
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date 2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "net_coalesce.h"
+
+#include <QThread>
+#include <algorithm>
+
+using t_real = t_real_glob;
+
+
+NetCacheCoalescer::NetCacheCoalescer(NetCache *pCache, unsigned int iIntervalMs, QObject *pParent)
+	: QObject(pParent), m_pCache(pCache)
+{
+	m_crys.clear();
+	m_triag.clear();
+
+	// the net cache emits its signals from the network thread,
+	// so they are collected there and not queued in the gui's event loop
+	QObject::connect(m_pCache, &NetCache::updated_cache_value,
+		this, &NetCacheCoalescer::push_value, Qt::DirectConnection);
+	QObject::connect(m_pCache, &NetCache::vars_changed,
+		this, &NetCacheCoalescer::push_vars, Qt::DirectConnection);
+	QObject::connect(m_pCache, &NetCache::cleared_cache,
+		this, &NetCacheCoalescer::push_clear, Qt::DirectConnection);
+
+	QObject::connect(&m_timer, &QTimer::timeout, this, &NetCacheCoalescer::flush);
+	SetInterval(iIntervalMs);
+}
+
+
+NetCacheCoalescer::~NetCacheCoalescer()
+{
+	m_timer.stop();
+}
+
+
+void NetCacheCoalescer::SetInterval(unsigned int iIntervalMs)
+{
+	m_iInterval = std::max(1u, iIntervalMs);
+	m_timer.start(m_iInterval);
+}
+
+
+NetCacheStats NetCacheCoalescer::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_mtx);
+	return m_stats;
+}
+
+
+/**
+ * remember the time of the first update not yet passed on
+ */
+void NetCacheCoalescer::mark_pending()
+{
+	if(!m_bPending)
+	{
+		m_bPending = true;
+		m_tOldest = t_clock::now();
+	}
+}
+
+
+void NetCacheCoalescer::push_value(const std::string& strKey, const CacheVal& val)
+{
+	std::lock_guard<std::mutex> lock(m_mtx);
+
+	++m_stats.iReceived;
+
+	auto iter = m_mapVals.find(strKey);
+	if(iter == m_mapVals.end())
+	{
+		m_mapVals.emplace(strKey, val);
+	}
+	else
+	{
+		// overwrite the previous value, which has not yet been shown
+		iter->second = val;
+		++m_stats.iDropped;
+	}
+
+	mark_pending();
+}
+
+
+void NetCacheCoalescer::push_vars(const CrystalOptions& crys, const TriangleOptions& triag)
+{
+	if(!crys.IsAnythingChanged() && !triag.IsAnythingChanged())
+		return;
+
+	std::lock_guard<std::mutex> lock(m_mtx);
+
+	m_crys.merge(crys);
+	m_triag.merge(triag);
+
+	mark_pending();
+}
+
+
+void NetCacheCoalescer::push_clear()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mtx);
+
+		m_mapVals.clear();
+		m_crys.clear();
+		m_triag.clear();
+		m_stats = NetCacheStats{};
+		m_bPending = false;
+	}
+
+	// the values are cleared immediately if we're in the gui thread
+	if(QThread::currentThread() == thread())
+		emit cleared_cache();
+	else
+		QMetaObject::invokeMethod(this, "cleared_cache", Qt::QueuedConnection);
+}
+
+
+/**
+ * pass the collected updates on to the views, called in the gui thread
+ */
+void NetCacheCoalescer::flush()
+{
+	t_mapCacheVal mapVals;
+	CrystalOptions crys;
+	TriangleOptions triag;
+	NetCacheStats stats;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mtx);
+		if(!m_bPending)
+			return;
+
+		std::swap(mapVals, m_mapVals);
+		crys = m_crys;
+		triag = m_triag;
+		m_crys.clear();
+		m_triag.clear();
+		m_bPending = false;
+
+		t_real dLatency = std::chrono::duration<t_real>(t_clock::now() - m_tOldest).count();
+		++m_stats.iBatches;
+		m_stats.dLatency = dLatency;
+		m_stats.dMaxLatency = std::max(m_stats.dMaxLatency, dLatency);
+		stats = m_stats;
+	}
+
+	for(const t_mapCacheVal::value_type& pair : mapVals)
+		emit updated_cache_value(pair.first, pair.second);
+
+	// recalculate the views only once per batch
+	if(crys.IsAnythingChanged() || triag.IsAnythingChanged())
+		emit vars_changed(crys, triag);
+
+	emit updated_stats(stats);
+}
+
+
+#include "moc_net_coalesce.cpp"
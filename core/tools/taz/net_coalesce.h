@@ -0,0 +1,97 @@
+/**
+ * coalesces the updates from the instrument's network cache
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date 2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef __NET_COALESCE_H__
+#define __NET_COALESCE_H__
+
+#include "net.h"
+
+#include <QObject>
+#include <QTimer>
+#include <mutex>
+#include <chrono>
+
+
+/**
+ * collects the updates of a NetCache, which arrive in the network thread,
+ * and passes them on to the views in batches: only the latest value of each key
+ * is kept and the views are recalculated at most once per interval
+ */
+class NetCacheCoalescer : public QObject
+{ Q_OBJECT
+	public:
+		using t_clock = std::chrono::steady_clock;
+
+	protected:
+		NetCache *m_pCache = nullptr;
+
+		QTimer m_timer;
+		unsigned int m_iInterval = 50;	// [ms]
+
+		// pending updates, guarded by m_mtx
+		mutable std::mutex m_mtx;
+		t_mapCacheVal m_mapVals;
+		CrystalOptions m_crys;
+		TriangleOptions m_triag;
+		bool m_bPending = false;
+		t_clock::time_point m_tOldest;
+
+		NetCacheStats m_stats;
+
+	protected:
+		// called in the network thread
+		void push_value(const std::string& strKey, const CacheVal& val);
+		void push_vars(const CrystalOptions& crys, const TriangleOptions& triag);
+		void push_clear();
+
+		void mark_pending();
+
+	protected slots:
+		void flush();
+
+	public:
+		// pCache has to be disconnected or deleted before this object
+		NetCacheCoalescer(NetCache *pCache, unsigned int iIntervalMs = 50, QObject *pParent = nullptr);
+		virtual ~NetCacheCoalescer();
+
+		NetCache* GetCache() const { return m_pCache; }
+
+		void SetInterval(unsigned int iIntervalMs);
+		unsigned int GetInterval() const { return m_iInterval; }
+
+		NetCacheStats GetStats() const;
+
+	signals:
+		void vars_changed(const CrystalOptions& crys, const TriangleOptions& triag);
+		void updated_cache_value(const std::string& strKey, const CacheVal& val);
+		void cleared_cache();
+
+		void updated_stats(const NetCacheStats& stats);
+};
+
+#endif
@@ -99,6 +99,8 @@ NicosCache::NicosCache(QSettings* pSettings) : m_pSettings(pSettings)
 		//"logbook/remark",
 	});
 
+	m_recorder.attach(m_tcp);
+
 	using namespace boost::placeholders;
 	m_tcp.add_connect(boost::bind(&NicosCache::slot_connected, this, _1, _2));
 	m_tcp.add_disconnect(boost::bind(&NicosCache::slot_disconnected, this, _1, _2));
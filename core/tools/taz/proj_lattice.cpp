@@ -233,7 +233,7 @@ void ProjLattice::CalcPeaks(const xtl::LatticeCommon<t_real>& latticecommon, boo
 				{
 					t_real dF = 0.;
 					std::tie(std::ignore, dF, std::ignore) =
-						latticecommon.GetStructFact(vecPeak);
+						latticecommon.GetStructFact(ih, ik, il);
 
 					pPeak->AddRadius(dF);
 					bModifiedRadii = 1;
@@ -145,6 +145,26 @@ void Recip3DDlg::CalcPeaks(const xtl::LatticeCommon<t_real_glob>& recipcommon)
 
 	std::vector<Peak3d> vecPeaks;
 
+	// calculate the structure factors of all allowed reflections in one batch
+	const bool bCalcStructFacts = pSpaceGroup && recipcommon.CanCalcStructFact();
+	std::vector<std::complex<t_real>> vecStructFacts;
+	std::size_t iStructFact = 0;
+
+	if(bCalcStructFacts)
+	{
+		std::vector<std::array<int, 3>> vecHKL;
+		for(t_real h = -m_dMaxPeaks; h <= m_dMaxPeaks; h += 1.)
+		for(t_real k = -m_dMaxPeaks; k <= m_dMaxPeaks; k += 1.)
+		for(t_real l = -m_dMaxPeaks; l <= m_dMaxPeaks; l += 1.)
+		{
+			int ih = int(h), ik = int(k), il = int(l);
+			if(pSpaceGroup->HasReflection(ih, ik, il))
+				vecHKL.push_back({{ ih, ik, il }});
+		}
+
+		vecStructFacts = recipcommon.GetStructFacts(vecHKL);
+	}
+
 	for(t_real h = -m_dMaxPeaks; h <= m_dMaxPeaks; h += 1.)
 	for(t_real k = -m_dMaxPeaks; k <= m_dMaxPeaks; k += 1.)
 	for(t_real l = -m_dMaxPeaks; l <= m_dMaxPeaks; l += 1.)
@@ -171,10 +191,11 @@ void Recip3DDlg::CalcPeaks(const xtl::LatticeCommon<t_real_glob>& recipcommon)
 		std::string strStructfact;
 		t_real dFsq = -1.;
 
-		if(pSpaceGroup && recipcommon.CanCalcStructFact())
+		if(bCalcStructFacts)
 		{
-			std::tie(std::ignore, peak.dF, dFsq) =
-				recipcommon.GetStructFact(peak.vecPeak);
+			const std::complex<t_real>& cF = vecStructFacts[iStructFact++];
+			dFsq = (std::conj(cF)*cF).real();
+			peak.dF = std::sqrt(dFsq);
 
 			tl::set_eps_0(dFsq, g_dEpsGfx);
 			tl::set_eps_0(peak.dF, g_dEpsGfx);
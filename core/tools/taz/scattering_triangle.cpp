@@ -35,6 +35,7 @@
 #include "tlibs/phys/neutrons.h"
 #include "tlibs/string/spec_char.h"
 #include "tlibs/log/log.h"
+#include "tlibs/helper/thread.h"
 #include "scattering_triangle.h"
 
 #include <QToolTip>
@@ -42,6 +43,8 @@
 #include <sstream>
 #include <cmath>
 #include <tuple>
+#include <map>
+#include <iterator>
 
 
 // symbol drawing sizes
@@ -190,6 +193,7 @@ ScatteringTriangle::ScatteringTriangle(ScatteringTriangleScene& scene)
 ScatteringTriangle::~ScatteringTriangle()
 {
 	m_bUpdate = m_bReady = false;
+	m_workerPeaks.Stop(true);
 	ClearPeaks();
 }
 
@@ -978,328 +982,565 @@ static inline std::string print_complex(const std::complex<T>& c)
 }
 
 
-void ScatteringTriangle::CalcPeaks(const xtl::LatticeCommon<t_real>& recipcommon, bool bIsPowder)
+/**
+ * parameters the plane-independent bragg peaks depend on
+ */
+static std::vector<t_real> get_bragg_peaks_key(const xtl::LatticeCommon<t_real>& recipcommon,
+	int iMaxPeaks, bool bIsPowder)
 {
-	ClearPeaks();
-	m_vecPowderLines.clear();
-	m_vecPowderLineWidths.clear();
-	m_kdLattice.Unload();
-
-	m_lattice = recipcommon.lattice;
-	m_recip = recipcommon.recip;
-	m_plane = recipcommon.plane;
-	m_matPlane = recipcommon.matPlane;
-	m_matPlaneRlu = recipcommon.matPlaneRLU;
-	m_matPlane_inv = recipcommon.matPlane_inv;
-
-	tl::Powder<int, t_real_glob> powder;
-	powder.SetRecipLattice(&m_recip);
-
-	m_bz.SetEpsilon(g_dEps);
-	m_bz.SetMaxNN(g_iMaxNN);
-	m_bz3.SetEpsilon(g_dEps);
-	m_bz3.SetMaxNN(g_iMaxNN);
-
-	// -------------------------------------------------------------------------
-	// central peak for BZ calculation
-#ifdef CALC_BZ_AROUND_ZERO
-	ublas::vector<int> veciCent = tl::make_vec({0.,0.,0.});
-#else
-	std::vector<std::tuple<int, int>> vecPeaksToTry =
+	const tl::Lattice<t_real>& lattice = recipcommon.lattice;
+
+	std::vector<t_real> vecKey
 	{
-		std::make_tuple(1, 2), std::make_tuple(1, 3), std::make_tuple(1, 4), std::make_tuple(1, 5), std::make_tuple(1, 6),
-		std::make_tuple(2, 1), std::make_tuple(2, 3), std::make_tuple(2, 4), std::make_tuple(2, 5), std::make_tuple(2, 6),
-		std::make_tuple(3, 1), std::make_tuple(3, 2), std::make_tuple(3, 4), std::make_tuple(3, 5), std::make_tuple(3, 6),
+		lattice.GetA(), lattice.GetB(), lattice.GetC(),
+		lattice.GetAlpha(), lattice.GetBeta(), lattice.GetGamma(),
+		t_real(iMaxPeaks), t_real(bIsPowder), t_real(recipcommon.CanCalcStructFact()),
+		t_real(recipcommon.vecAllAtomsFrac.size()),
 	};
 
-	ublas::vector<int> veciCent;
-	for(const std::tuple<int, int>& tup : vecPeaksToTry)
+	for(const t_vec& vecAtom : recipcommon.vecAllAtomsFrac)
+		vecKey.insert(vecKey.end(), vecAtom.begin(), vecAtom.end());
+	for(const std::complex<t_real>& b : recipcommon.vecScatlens)
 	{
-		veciCent.clear();
-
-		t_vec vecdCent = std::get<0>(tup) * recipcommon.dir0RLU +
-			std::get<1>(tup) * recipcommon.dir1RLU;
-		veciCent = tl::convert_vec<t_real, int>(vecdCent);
-		if(recipcommon.pSpaceGroup &&
-			!recipcommon.pSpaceGroup->HasGenReflection(veciCent[0], veciCent[1], veciCent[2]))
-			continue;
-		break;
+		vecKey.push_back(b.real());
+		vecKey.push_back(b.imag());
 	}
 
-	if(!veciCent.size())
-		veciCent = tl::make_vec({0.,0.,0.});
-#endif
-	// -------------------------------------------------------------------------
+	return vecKey;
+}
 
 
-	static const std::string strAA = tl::get_spec_char_utf8("AA") +
-		tl::get_spec_char_utf8("sup-") +
-		tl::get_spec_char_utf8("sup1");
-	static const std::string strSup2 = tl::get_spec_char_utf8("sup2");
+/**
+ * enumerate the generally allowed bragg peaks in slabs of constant h
+ * @return nullptr if the calculation was stopped
+ */
+static std::shared_ptr<const BraggPeaks> calc_bragg_peaks(
+	const xtl::LatticeCommon<t_real>& recipcommon, int iMaxPeaks, bool bIsPowder,
+	std::vector<t_real>&& vecKey, const std::atomic<bool>& atStop)
+{
+	using t_slab = std::tuple<std::vector<std::array<int, 3>>, std::vector<t_vec>, std::vector<unsigned char>>;
+	const xtl::SpaceGroup<t_real>* pSpaceGroup = recipcommon.pSpaceGroup;
+	const tl::Lattice<t_real>& recip = recipcommon.recip;
 
-	static const QColor colPeakAllowed = Qt::red;
-	static const QColor colPeakForbidden(0xaa, 0xaa, 0xaa);
-	static const QColor colPeakOrigin = Qt::darkGreen;
+	auto calc_slab = [iMaxPeaks, pSpaceGroup, &recip, &atStop](int ih) -> t_slab
+	{
+		t_slab slab;
+		if(atStop.load())
+			return slab;
 
-	std::list<std::vector<t_real>> lstPeaksForKd;
-	t_real dMinF = std::numeric_limits<t_real>::max(), dMaxF = -1.;
+		for(int ik = -iMaxPeaks; ik <= iMaxPeaks; ++ik)
+		for(int il = -iMaxPeaks; il <= iMaxPeaks; ++il)
+		{
+			bool bHasRefl = true;
+			if(pSpaceGroup)
+			{
+				if(!pSpaceGroup->HasGenReflection(ih, ik, il))
+					continue;
+				bHasRefl = pSpaceGroup->HasReflection(ih, ik, il);
+			}
 
-	const int iMaxNN = g_iMaxNN <= 4 ? 2 : g_iMaxNN-2;	// TODO
+			std::get<0>(slab).push_back({{ ih, ik, il }});
+			std::get<1>(slab).emplace_back(recip.GetPos(t_real(ih), t_real(ik), t_real(il)));
+			std::get<2>(slab).push_back(bHasRefl);
+		}
 
-	// iterate over all bragg peaks
-	const int iMaxPeaks = bIsPowder ? m_iMaxPeaks/2 : m_iMaxPeaks;
+		return slab;
+	};
+
+	tl::ThreadPool<t_slab()> tp(std::max<unsigned int>(1, get_max_threads()));
 	for(int ih = -iMaxPeaks; ih <= iMaxPeaks; ++ih)
-	for(int ik = -iMaxPeaks; ik <= iMaxPeaks; ++ik)
-	for(int il = -iMaxPeaks; il <= iMaxPeaks; ++il)
+		tp.AddTask([&calc_slab, ih]() -> t_slab { return calc_slab(ih); });
+	tp.Start();
+
+	// collect the slabs in order of h
+	std::shared_ptr<BraggPeaks> pPeaks = std::make_shared<BraggPeaks>();
+	pPeaks->vecKey = std::move(vecKey);
+	pPeaks->pSpaceGroup = pSpaceGroup;
+
+	for(auto& fut : tp.GetResults())
 	{
-		const t_real h = t_real(ih);
-		const t_real k = t_real(ik);
-		const t_real l = t_real(il);
-		const t_vec vecPeakHKL = tl::make_vec<t_vec>({ h, k, l });
+		t_slab slab = fut.get();
+		pPeaks->vecHKL.insert(pPeaks->vecHKL.end(), std::get<0>(slab).begin(), std::get<0>(slab).end());
+		std::move(std::get<1>(slab).begin(), std::get<1>(slab).end(), std::back_inserter(pPeaks->vecPos));
+		pPeaks->vecHasRefl.insert(pPeaks->vecHasRefl.end(), std::get<2>(slab).begin(), std::get<2>(slab).end());
+	}
 
-		bool bHasRefl = true;
-		bool bHasGenRefl = true;
+	if(atStop.load())
+		return nullptr;
 
-		if(recipcommon.pSpaceGroup)
+	// structure factors of all allowed peaks, so that they can be reused for other planes
+	if(recipcommon.CanCalcStructFact())
+	{
+		std::vector<std::array<int, 3>> vecHKL;
+		for(std::size_t iPeak=0; iPeak<pPeaks->vecHKL.size(); ++iPeak)
+			if(pPeaks->vecHasRefl[iPeak])
+				vecHKL.push_back(pPeaks->vecHKL[iPeak]);
+
+		std::vector<std::complex<t_real>> vecF = recipcommon.GetStructFacts(vecHKL, &atStop);
+		if(atStop.load())
+			return nullptr;
+
+		pPeaks->vecF.resize(pPeaks->vecHKL.size(), std::complex<t_real>(0., 0.));
+		std::size_t iF = 0;
+		for(std::size_t iPeak=0; iPeak<pPeaks->vecHKL.size(); ++iPeak)
+			if(pPeaks->vecHasRefl[iPeak])
+				pPeaks->vecF[iPeak] = vecF[iF++];
+	}
+
+	if(atStop.load())
+		return nullptr;
+
+	// add peaks in 1/A and rlu units (only 1/A vectors are used for kd calculation)
+	if(!bIsPowder)
+	{
+		std::list<std::vector<t_real>> lstPeaksForKd;
+		for(std::size_t iPeak=0; iPeak<pPeaks->vecHKL.size(); ++iPeak)
 		{
-			bHasRefl = recipcommon.pSpaceGroup->HasReflection(ih, ik, il);
-			bHasGenRefl = recipcommon.pSpaceGroup->HasGenReflection(ih, ik, il);
+			const t_vec& vecPeak = pPeaks->vecPos[iPeak];
+			const std::array<int, 3>& hkl = pPeaks->vecHKL[iPeak];
+
+			lstPeaksForKd.push_back(std::vector<t_real>
+				{ vecPeak[0],vecPeak[1],vecPeak[2], t_real(hkl[0]),t_real(hkl[1]),t_real(hkl[2]) });
 		}
 
-		if(!bHasGenRefl)
-			continue;
+		pPeaks->kd.Load(lstPeaksForKd, 3, &atStop);
+		if(atStop.load())
+			return nullptr;
+	}
 
-		t_vec vecPeak = m_recip.GetPos(h, k, l);
+	return pPeaks;
+}
 
-		// add peak in 1/A and rlu units (only 1/A vectors are used for kd calculation)
-		lstPeaksForKd.push_back(std::vector<t_real>
-			{ vecPeak[0],vecPeak[1],vecPeak[2], h,k,l/*, dF*/ });
 
-		// add peaks for 3d calculation of 1st BZ
-		if(g_b3dBZ && bHasGenRefl)
-		{
-			if(ih==veciCent[0] && ik==veciCent[1] && il==veciCent[2])
-				m_bz3.SetCentralReflex(vecPeak, &vecPeakHKL);
-			else if(std::abs(ih-veciCent[0]) <= iMaxNN &&
-				std::abs(ik-veciCent[1]) <= iMaxNN &&
-				std::abs(il-veciCent[2]) <= iMaxNN)
-				m_bz3.AddReflex(vecPeak, &vecPeakHKL);
-		}
+void ScatteringTriangle::CalcPeaks(const xtl::LatticeCommon<t_real>& recipcommon, bool bIsPowder)
+{
+	const int iMaxPeaks = bIsPowder ? m_iMaxPeaks/2 : m_iMaxPeaks;
+	const t_real dPlaneDistTolerance = m_dPlaneDistTolerance;
+	const t_real dScaleFactor = m_dScaleFactor;
+	const bool bShowAllPeaks = m_bShowAllPeaks;
 
-		t_real dDist = 0.;
-		t_vec vecDropped = m_plane.GetDroppedPerp(vecPeak, &dDist);
-		bool bInPlane = tl::float_equal<t_real>(dDist, 0., m_dPlaneDistTolerance);
+	// the plane-independent peaks can be reused if only the scattering plane has changed
+	std::shared_ptr<const BraggPeaks> pOldPeaks = m_pBraggPeaks;
 
-		// --------------------------------------------------------------------
-		// structure factors
-		std::complex<t_real> cF(-1., -1.);
-		t_real dF = -1., dFsq = -1.;
+	// cancels a running calculation and discards its results
+	m_workerPeaks.Start([recipcommon, bIsPowder, iMaxPeaks, dPlaneDistTolerance,
+		dScaleFactor, bShowAllPeaks, pOldPeaks](const std::atomic<bool>& atStop)
+		-> std::shared_ptr<BraggPeaksResult>
+	{
+		std::shared_ptr<BraggPeaksResult> pResult = std::make_shared<BraggPeaksResult>();
+		pResult->bIsPowder = bIsPowder;
 
-		if(bHasRefl && recipcommon.CanCalcStructFact() && (bInPlane || bIsPowder))
-		{
-			std::tie(cF, dF, dFsq) =
-				recipcommon.GetStructFact(vecPeak);
+		std::vector<t_real> vecKey = get_bragg_peaks_key(recipcommon, iMaxPeaks, bIsPowder);
+		if(pOldPeaks && pOldPeaks->vecKey == vecKey && pOldPeaks->pSpaceGroup == recipcommon.pSpaceGroup)
+			pResult->pPeaks = pOldPeaks;
+		else
+			pResult->pPeaks = calc_bragg_peaks(recipcommon, iMaxPeaks, bIsPowder, std::move(vecKey), atStop);
 
-			//dFsq *= tl::lorentz_factor(dAngle);
-			tl::set_eps_0(dFsq, g_dEpsGfx);
+		if(!pResult->pPeaks || atStop.load())
+			return nullptr;
 
-			tl::set_eps_0(dF, g_dEpsGfx);
-			dMinF = std::min(dF, dMinF);
-			dMaxF = std::max(dF, dMaxF);
-		}
-		// --------------------------------------------------------------------
+		const BraggPeaks& peaks = *pResult->pPeaks;
 
-		t_vec vecCoord = ublas::prod(m_matPlane_inv, vecDropped);
-		t_real dX = vecCoord[0];
-		t_real dY = -vecCoord[1];
+		pResult->lattice = recipcommon.lattice;
+		pResult->recip = recipcommon.recip;
+		pResult->plane = recipcommon.plane;
+		pResult->matPlane = recipcommon.matPlane;
+		pResult->matPlaneRlu = recipcommon.matPlaneRLU;
+		pResult->matPlane_inv = recipcommon.matPlane_inv;
 
-		if(bIsPowder && (bHasRefl || m_bShowAllPeaks))
-			powder.AddPeak(ih, ik, il, dF);
+		const tl::Lattice<t_real>& recip = pResult->recip;
+		const tl::Plane<t_real>& plane = pResult->plane;
+		const t_mat& matPlane_inv = pResult->matPlane_inv;
 
-		// ignore peaks that are not in the scattering plane
-		if(!bInPlane)
-			continue;
+		tl::Powder<int, t_real_glob> powder;
+		powder.SetRecipLattice(&recip);
 
-		// (000), i.e. direct beam, also needed for powder
-		if(bIsPowder && (ih != 0 || ik != 0 || il != 0))
-			continue;
+		tl::Brillouin2D<t_real>& bz = pResult->bz;
+		tl::Brillouin3D<t_real>& bz3 = pResult->bz3;
+
+		bz.SetEpsilon(g_dEps);
+		bz.SetMaxNN(g_iMaxNN);
+		bz3.SetEpsilon(g_dEps);
+		bz3.SetMaxNN(g_iMaxNN);
 
-		if(bHasRefl || m_bShowAllPeaks)
+		// ---------------------------------------------------------------------
+		// central peak for BZ calculation
+#ifdef CALC_BZ_AROUND_ZERO
+		ublas::vector<int> veciCent = tl::make_vec({0.,0.,0.});
+#else
+		std::vector<std::tuple<int, int>> vecPeaksToTry =
 		{
-			RecipPeak *pPeak = new RecipPeak();
-			if(ih==0 && ik==0 && il==0)
-				pPeak->SetColor(bHasRefl ? colPeakOrigin : colPeakForbidden);
-			else
-				pPeak->SetColor(bHasRefl ? colPeakAllowed : colPeakForbidden);
+			std::make_tuple(1, 2), std::make_tuple(1, 3), std::make_tuple(1, 4), std::make_tuple(1, 5), std::make_tuple(1, 6),
+			std::make_tuple(2, 1), std::make_tuple(2, 3), std::make_tuple(2, 4), std::make_tuple(2, 5), std::make_tuple(2, 6),
+			std::make_tuple(3, 1), std::make_tuple(3, 2), std::make_tuple(3, 4), std::make_tuple(3, 5), std::make_tuple(3, 6),
+		};
 
-			pPeak->setPos(dX * m_dScaleFactor, dY * m_dScaleFactor);
-			pPeak->SetRadius(dF >= 0. ? dF : 1.);
-			pPeak->setData(TRIANGLE_NODE_TYPE_KEY, NODE_BRAGG);
+		ublas::vector<int> veciCent;
+		for(const std::tuple<int, int>& tup : vecPeaksToTry)
+		{
+			veciCent.clear();
+
+			t_vec vecdCent = std::get<0>(tup) * recipcommon.dir0RLU +
+				std::get<1>(tup) * recipcommon.dir1RLU;
+			veciCent = tl::convert_vec<t_real, int>(vecdCent);
+			if(recipcommon.pSpaceGroup &&
+				!recipcommon.pSpaceGroup->HasGenReflection(veciCent[0], veciCent[1], veciCent[2]))
+				continue;
+			break;
+		}
 
-			std::ostringstream ostrLabel, ostrTip;
-			ostrLabel.precision(g_iPrecGfx);
-			ostrTip.precision(g_iPrec);
+		if(!veciCent.size())
+			veciCent = tl::make_vec({0.,0.,0.});
+#endif
+		// ---------------------------------------------------------------------
 
-			ostrLabel << "(" << ih << " " << ik << " " << il << ")";
-			ostrTip << "G = (" << ih << " " << ik << " " << il << ") rlu";
 
-			tl::set_eps_0(vecPeak, g_dEps);
-			ostrTip << "\nG = (" << vecPeak[0] << ", "
-				<< vecPeak[1] << ", "
-				<< vecPeak[2] << ") " << strAA;
+		static const std::string strAA = tl::get_spec_char_utf8("AA") +
+			tl::get_spec_char_utf8("sup-") +
+			tl::get_spec_char_utf8("sup1");
+		static const std::string strSup2 = tl::get_spec_char_utf8("sup2");
 
-			if(dFsq > -1.)
-			{
-				if(g_bShowFsq)
-					ostrLabel << "\nS = " << dFsq;
-				else
-					ostrLabel << "\nF = " << dF;
+		t_real dMinF = std::numeric_limits<t_real>::max(), dMaxF = -1.;
+		const int iMaxNN = g_iMaxNN <= 4 ? 2 : g_iMaxNN-2;	// TODO
+
+		// iterate over all generally allowed bragg peaks
+		for(std::size_t iPeak=0; iPeak<peaks.vecHKL.size(); ++iPeak)
+		{
+			if(iPeak % 4096 == 0 && atStop.load())
+				return nullptr;
 
-				ostrTip << "\nF = " << print_complex<t_real>(cF) << " fm";
-				ostrTip << "\nS = " << dFsq << " fm" << strSup2;
+			const int ih = peaks.vecHKL[iPeak][0];
+			const int ik = peaks.vecHKL[iPeak][1];
+			const int il = peaks.vecHKL[iPeak][2];
+			const t_vec vecPeakHKL = tl::make_vec<t_vec>({ t_real(ih), t_real(ik), t_real(il) });
+
+			const bool bHasRefl = peaks.vecHasRefl[iPeak];
+			t_vec vecPeak = peaks.vecPos[iPeak];
+
+			// add peaks for 3d calculation of 1st BZ
+			if(g_b3dBZ)
+			{
+				if(ih==veciCent[0] && ik==veciCent[1] && il==veciCent[2])
+					bz3.SetCentralReflex(vecPeak, &vecPeakHKL);
+				else if(std::abs(ih-veciCent[0]) <= iMaxNN &&
+					std::abs(ik-veciCent[1]) <= iMaxNN &&
+					std::abs(il-veciCent[2]) <= iMaxNN)
+					bz3.AddReflex(vecPeak, &vecPeakHKL);
 			}
-			else if(!bHasRefl)
+
+			t_real dDist = 0.;
+			t_vec vecDropped = plane.GetDroppedPerp(vecPeak, &dDist);
+			bool bInPlane = tl::float_equal<t_real>(dDist, 0., dPlaneDistTolerance);
+
+			// ----------------------------------------------------------------
+			// structure factors
+			std::complex<t_real> cF(-1., -1.);
+			t_real dF = -1., dFsq = -1.;
+
+			if(bHasRefl && peaks.vecF.size() && (bInPlane || bIsPowder))
 			{
-				pPeak->SetPeakAllowed(0);
-				//pPeak->SetRadius(0.);
-				ostrTip << "\nStructurally forbidden reflection.";
+				cF = peaks.vecF[iPeak];
+				dFsq = (std::conj(cF)*cF).real();
+				dF = std::sqrt(dFsq);
+
+				//dFsq *= tl::lorentz_factor(dAngle);
+				tl::set_eps_0(dFsq, g_dEpsGfx);
+
+				tl::set_eps_0(dF, g_dEpsGfx);
+				dMinF = std::min(dF, dMinF);
+				dMaxF = std::max(dF, dMaxF);
 			}
+			// ----------------------------------------------------------------
 
+			t_vec vecCoord = ublas::prod(matPlane_inv, vecDropped);
+			t_real dX = vecCoord[0];
+			t_real dY = -vecCoord[1];
 
-			pPeak->SetLabel(ostrLabel.str().c_str());
-			pPeak->setToolTip(QString::fromUtf8(ostrTip.str().c_str(), ostrTip.str().length()));
+			if(bIsPowder && (bHasRefl || bShowAllPeaks))
+				powder.AddPeak(ih, ik, il, dF);
 
-			m_vecPeaks.push_back(pPeak);
-			m_scene.addItem(pPeak);
-		}
+			// ignore peaks that are not in the scattering plane
+			if(!bInPlane)
+				continue;
 
+			// (000), i.e. direct beam, also needed for powder
+			if(bIsPowder && (ih != 0 || ik != 0 || il != 0))
+				continue;
 
-		// add peaks for 2d approximation of 1st BZ
-		if(!g_b3dBZ && bHasGenRefl)
-		{
-			t_vec vecN = tl::make_vec({dX, dY});
-			if(ih==veciCent[0] && ik==veciCent[1] && il==veciCent[2])
+			if(bHasRefl || bShowAllPeaks)
 			{
-				m_bz.SetCentralReflex(vecN, &vecPeakHKL);
+				RecipPeakDesc desc;
+				desc.hkl = peaks.vecHKL[iPeak];
+				desc.bOrigin = (ih==0 && ik==0 && il==0);
+				desc.bAllowed = bHasRefl;
+				desc.dX = dX * dScaleFactor;
+				desc.dY = dY * dScaleFactor;
+				desc.dRadius = dF >= 0. ? dF : 1.;
+
+				std::ostringstream ostrLabel, ostrTip;
+				ostrLabel.precision(g_iPrecGfx);
+				ostrTip.precision(g_iPrec);
+
+				ostrLabel << "(" << ih << " " << ik << " " << il << ")";
+				ostrTip << "G = (" << ih << " " << ik << " " << il << ") rlu";
+
+				tl::set_eps_0(vecPeak, g_dEps);
+				ostrTip << "\nG = (" << vecPeak[0] << ", "
+					<< vecPeak[1] << ", "
+					<< vecPeak[2] << ") " << strAA;
+
+				if(dFsq > -1.)
+				{
+					if(g_bShowFsq)
+						ostrLabel << "\nS = " << dFsq;
+					else
+						ostrLabel << "\nF = " << dF;
+
+					ostrTip << "\nF = " << print_complex<t_real>(cF) << " fm";
+					ostrTip << "\nS = " << dFsq << " fm" << strSup2;
+				}
+				else if(!bHasRefl)
+				{
+					ostrTip << "\nStructurally forbidden reflection.";
+				}
+
+				desc.strLabel = ostrLabel.str();
+				desc.strToolTip = ostrTip.str();
+				pResult->vecPeakDescs.emplace_back(std::move(desc));
 			}
-			else if(std::abs(ih-veciCent[0])<=2 && std::abs(ik-veciCent[1])<=2
-				&& std::abs(il-veciCent[2])<=2)
+
+
+			// add peaks for 2d approximation of 1st BZ
+			if(!g_b3dBZ)
 			{
-				m_bz.AddReflex(vecN, &vecPeakHKL);
+				t_vec vecN = tl::make_vec({dX, dY});
+				if(ih==veciCent[0] && ik==veciCent[1] && il==veciCent[2])
+				{
+					bz.SetCentralReflex(vecN, &vecPeakHKL);
+				}
+				else if(std::abs(ih-veciCent[0])<=2 && std::abs(ik-veciCent[1])<=2
+					&& std::abs(il-veciCent[2])<=2)
+				{
+					bz.AddReflex(vecN, &vecPeakHKL);
+				}
 			}
-		}
-	}  // peak iteration
+		}  // peak iteration
 
-	// single crystal
-	if(!bIsPowder)
-	{
-		if(g_b3dBZ)
+		if(atStop.load())
+			return nullptr;
+
+		// single crystal
+		if(!bIsPowder)
 		{
-			m_bz3.CalcBZ(get_max_threads());
+			if(g_b3dBZ)
+			{
+				bz3.CalcBZ(get_max_threads(), &atStop);
+				if(atStop.load())
+					return nullptr;
 
-			// ----------------------------------------------------------------
-			// calculate points of high symmetry
-			std::vector<t_vec> vecSymmDirs = {
-				tl::make_vec<t_vec>({1,0,0}), tl::make_vec<t_vec>({0,1,0}), tl::make_vec<t_vec>({0,0,1}),
+				// ------------------------------------------------------------
+				// calculate points of high symmetry
+				std::vector<t_vec> vecSymmDirs = {
+					tl::make_vec<t_vec>({1,0,0}), tl::make_vec<t_vec>({0,1,0}), tl::make_vec<t_vec>({0,0,1}),
 
-				tl::make_vec<t_vec>({1,1,0}), tl::make_vec<t_vec>({0,1,1}), tl::make_vec<t_vec>({1,0,1}),
-				tl::make_vec<t_vec>({1,-1,0}), tl::make_vec<t_vec>({0,1,-1}), tl::make_vec<t_vec>({1,0,-1}),
+					tl::make_vec<t_vec>({1,1,0}), tl::make_vec<t_vec>({0,1,1}), tl::make_vec<t_vec>({1,0,1}),
+					tl::make_vec<t_vec>({1,-1,0}), tl::make_vec<t_vec>({0,1,-1}), tl::make_vec<t_vec>({1,0,-1}),
 
-				tl::make_vec<t_vec>({1,1,1}), tl::make_vec<t_vec>({1,1,-1}), tl::make_vec<t_vec>({1,-1,-1}),
-				tl::make_vec<t_vec>({1,-1,1}),
-			};
+					tl::make_vec<t_vec>({1,1,1}), tl::make_vec<t_vec>({1,1,-1}), tl::make_vec<t_vec>({1,-1,-1}),
+					tl::make_vec<t_vec>({1,-1,1}),
+				};
 
-			for(const t_vec& vecSymmDir : vecSymmDirs)
-			{
-				const t_vec vecSymmDirInvA = m_recip.GetPos(vecSymmDir[0], vecSymmDir[1], vecSymmDir[2]);
-				tl::Line<t_real> lineSymmDir(m_bz3.GetCentralReflex(), vecSymmDirInvA);
-				std::vector<t_vec> vecSymmIntersects = m_bz3.GetIntersection(lineSymmDir);
-				for(t_vec& vecSymmIntersect : vecSymmIntersects)
-					m_vecBZ3SymmPts.emplace_back(std::move(vecSymmIntersect));
-			}
-			// ----------------------------------------------------------------
+				for(const t_vec& vecSymmDir : vecSymmDirs)
+				{
+					const t_vec vecSymmDirInvA = recip.GetPos(vecSymmDir[0], vecSymmDir[1], vecSymmDir[2]);
+					tl::Line<t_real> lineSymmDir(bz3.GetCentralReflex(), vecSymmDirInvA);
+					std::vector<t_vec> vecSymmIntersects = bz3.GetIntersection(lineSymmDir);
+					for(t_vec& vecSymmIntersect : vecSymmIntersects)
+						pResult->vecBZ3SymmPts.emplace_back(std::move(vecSymmIntersect));
+				}
+				// ------------------------------------------------------------
 
-			// ----------------------------------------------------------------
-			// calculate intersection with scattering plane
-			tl::Plane<t_real> planeBZ3 = tl::Plane<t_real>(m_bz3.GetCentralReflex(),
-				m_plane.GetNorm());
+				// ------------------------------------------------------------
+				// calculate intersection with scattering plane
+				tl::Plane<t_real> planeBZ3 = tl::Plane<t_real>(bz3.GetCentralReflex(),
+					plane.GetNorm());
 
-			std::tie(std::ignore, m_vecBZ3VertsUnproj) = m_bz3.GetIntersection(planeBZ3);
+				std::tie(std::ignore, pResult->vecBZ3VertsUnproj) = bz3.GetIntersection(planeBZ3);
 
-			for(const t_vec& _vecBZ3Vert : m_vecBZ3VertsUnproj)
-			{
-				t_vec vecBZ3Vert = ublas::prod(m_matPlane_inv, _vecBZ3Vert - m_bz3.GetCentralReflex());
-				vecBZ3Vert.resize(2, true);
-				vecBZ3Vert[1] = -vecBZ3Vert[1];
+				for(const t_vec& _vecBZ3Vert : pResult->vecBZ3VertsUnproj)
+				{
+					t_vec vecBZ3Vert = ublas::prod(matPlane_inv, _vecBZ3Vert - bz3.GetCentralReflex());
+					vecBZ3Vert.resize(2, true);
+					vecBZ3Vert[1] = -vecBZ3Vert[1];
 
-				m_vecBZ3Verts.push_back(vecBZ3Vert);
+					pResult->vecBZ3Verts.push_back(vecBZ3Vert);
+				}
+				// ------------------------------------------------------------
+			}
+			else
+			{
+				bz.CalcBZ();
 			}
-			// ----------------------------------------------------------------
 		}
-		else
+
+		// single crystal peaks
+		if(dMaxF >= 0.)
 		{
-			m_bz.CalcBZ();
+			bool bValidStructFacts = !tl::float_equal(dMinF, dMaxF, g_dEpsGfx);
+			for(RecipPeakDesc& desc : pResult->vecPeakDescs)
+			{
+				if(bValidStructFacts)
+				{
+					t_real dFScale = (desc.dRadius-dMinF) / (dMaxF-dMinF);
+					desc.dRadius = tl::lerp(MIN_PEAK_SIZE, MAX_PEAK_SIZE, dFScale);
+				}
+				else
+				{
+					desc.dRadius = DEF_PEAK_SIZE;
+				}
+			}
 		}
 
-		m_kdLattice.Load(lstPeaksForKd, 3);
-	}
-
-	// single crystal peaks
-	if(dMaxF >= 0.)
-	{
-		bool bValidStructFacts = !tl::float_equal(dMinF, dMaxF, g_dEpsGfx);
-		for(RecipPeak *pPeak : m_vecPeaks)
+		// powder lines
+		if(bIsPowder)
 		{
-			if(bValidStructFacts)
+			using t_line = typename decltype(powder)::t_peak;
+			std::vector<t_line>& vecPowderLines = pResult->vecPowderLines;
+			std::vector<t_real>& vecPowderLineWidths = pResult->vecPowderLineWidths;
+
+			vecPowderLines = powder.GetUniquePeaksSumF();
+			vecPowderLineWidths.reserve(vecPowderLines.size());
+
+			t_real dMinFLine = 0.;
+			t_real dMaxFLine = 0.;
+
+			if(dMaxF >= 0.)
 			{
-				t_real dFScale = (pPeak->GetRadius()-dMinF) / (dMaxF-dMinF);
-				pPeak->SetRadius(tl::lerp(MIN_PEAK_SIZE, MAX_PEAK_SIZE, dFScale));
+				auto minmaxiters = std::minmax_element(vecPowderLines.begin(), vecPowderLines.end(),
+					[](const t_line& line1, const t_line& line2) -> bool
+					{
+						return std::get<4>(line1) < std::get<4>(line2);
+					});
+				dMinFLine = std::get<4>(*minmaxiters.first);
+				dMaxFLine = std::get<4>(*minmaxiters.second);
 			}
-			else
+
+			bool bValidStructFacts = !tl::float_equal(dMinFLine, dMaxFLine, g_dEpsGfx);
+			for(t_line& line : vecPowderLines)
 			{
-				pPeak->SetRadius(DEF_PEAK_SIZE);
+				if(bValidStructFacts)
+				{
+					t_real dFScale = (std::get<4>(line)-dMinFLine) / (dMaxFLine-dMinFLine);
+					vecPowderLineWidths.push_back(tl::lerp(MIN_PEAK_SIZE, MAX_PEAK_SIZE, dFScale));
+				}
+				else
+				{
+					vecPowderLineWidths.push_back(1.);
+				}
 			}
 		}
-	}
 
-	// powder lines
-	if(bIsPowder)
+		return pResult;
+	},
+	[this]() { emit m_scene.peaksCalculated(); });
+}
+
+
+/**
+ * apply the results of the peak calculation, called in the gui thread
+ */
+bool ScatteringTriangle::ApplyPeaks()
+{
+	static const QColor colPeakAllowed = Qt::red;
+	static const QColor colPeakForbidden(0xaa, 0xaa, 0xaa);
+	static const QColor colPeakOrigin = Qt::darkGreen;
+
+	// no results or results of an outdated calculation?
+	std::shared_ptr<BraggPeaksResult> pResult = m_workerPeaks.TakeResult();
+	if(!pResult)
+		return false;
+
+	m_lattice = std::move(pResult->lattice);
+	m_recip = std::move(pResult->recip);
+	m_plane = std::move(pResult->plane);
+	m_matPlane = std::move(pResult->matPlane);
+	m_matPlaneRlu = std::move(pResult->matPlaneRlu);
+	m_matPlane_inv = std::move(pResult->matPlane_inv);
+
+	m_pBraggPeaks = pResult->pPeaks;
+	if(pResult->bIsPowder)
+		m_kdLattice.Unload();
+
+	m_bz = std::move(pResult->bz);
+	m_bz3 = std::move(pResult->bz3);
+	m_vecBZ3VertsUnproj = std::move(pResult->vecBZ3VertsUnproj);
+	m_vecBZ3Verts = std::move(pResult->vecBZ3Verts);
+	m_vecBZ3SymmPts = std::move(pResult->vecBZ3SymmPts);
+
+	m_vecPowderLines = std::move(pResult->vecPowderLines);
+	m_vecPowderLineWidths = std::move(pResult->vecPowderLineWidths);
+
+	// only create or modify the graphics items of peaks that have changed
+	std::map<std::array<int, 3>, std::size_t> mapOldPeaks;
+	for(std::size_t iPeak=0; iPeak<m_vecPeakDescs.size(); ++iPeak)
+		mapOldPeaks.emplace(m_vecPeakDescs[iPeak].hkl, iPeak);
+
+	std::vector<RecipPeak*> vecPeaks;
+	vecPeaks.reserve(pResult->vecPeakDescs.size());
+
+	for(const RecipPeakDesc& desc : pResult->vecPeakDescs)
 	{
-		using t_line = typename decltype(powder)::t_peak;
-		m_vecPowderLines = powder.GetUniquePeaksSumF();
-		m_vecPowderLineWidths.reserve(m_vecPowderLines.size());
+		RecipPeak *pPeak = nullptr;
 
-		t_real dMinFLine = 0.;
-		t_real dMaxFLine = 0.;
+		auto iterOld = mapOldPeaks.find(desc.hkl);
+		if(iterOld != mapOldPeaks.end())
+		{
+			std::swap(pPeak, m_vecPeaks[iterOld->second]);
 
-		if(dMaxF >= 0.)
+			if(m_vecPeakDescs[iterOld->second] == desc)
+			{
+				vecPeaks.push_back(pPeak);
+				continue;
+			}
+		}
+		else
 		{
-			auto minmaxiters = std::minmax_element(m_vecPowderLines.begin(), m_vecPowderLines.end(),
-				[](const t_line& line1, const t_line& line2) -> bool
-				{
-					return std::get<4>(line1) < std::get<4>(line2);
-				});
-			dMinFLine = std::get<4>(*minmaxiters.first);
-			dMaxFLine = std::get<4>(*minmaxiters.second);
+			pPeak = new RecipPeak();
+			pPeak->setData(TRIANGLE_NODE_TYPE_KEY, NODE_BRAGG);
+			m_scene.addItem(pPeak);
 		}
 
-		bool bValidStructFacts = !tl::float_equal(dMinFLine, dMaxFLine, g_dEpsGfx);
-		for(t_line& line : m_vecPowderLines)
+		if(desc.bOrigin)
+			pPeak->SetColor(desc.bAllowed ? colPeakOrigin : colPeakForbidden);
+		else
+			pPeak->SetColor(desc.bAllowed ? colPeakAllowed : colPeakForbidden);
+
+		pPeak->setPos(desc.dX, desc.dY);
+		pPeak->SetRadius(desc.dRadius);
+		pPeak->SetPeakAllowed(desc.bAllowed);
+		pPeak->SetLabel(QString::fromUtf8(desc.strLabel.c_str(), desc.strLabel.length()));
+		pPeak->setToolTip(QString::fromUtf8(desc.strToolTip.c_str(), desc.strToolTip.length()));
+		pPeak->update();
+
+		vecPeaks.push_back(pPeak);
+	}
+
+	// remove the peaks that are not present anymore
+	for(RecipPeak* pPeak : m_vecPeaks)
+	{
+		if(pPeak)
 		{
-			if(bValidStructFacts)
-			{
-				t_real dFScale = (std::get<4>(line)-dMinFLine) / (dMaxFLine-dMinFLine);
-				m_vecPowderLineWidths.push_back(tl::lerp(MIN_PEAK_SIZE, MAX_PEAK_SIZE, dFScale));
-			}
-			else
-			{
-				m_vecPowderLineWidths.push_back(1.);
-			}
+			m_scene.removeItem(pPeak);
+			delete pPeak;
 		}
 	}
 
+	m_vecPeaks = std::move(vecPeaks);
+	m_vecPeakDescs = std::move(pResult->vecPeakDescs);
+
 	m_scene.emitAllParams();
 	this->update();
+	return true;
 }
 
 
@@ -1369,6 +1610,9 @@ t_vec ScatteringTriangle::GetKfVecPlane() const
 
 void ScatteringTriangle::ClearPeaks()
 {
+	// stop a running calculation and discard its results
+	m_workerPeaks.Stop();
+
 	m_bz.Clear();
 	m_bz3.Clear();
 	m_vecBZ3VertsUnproj.clear();
@@ -1385,6 +1629,7 @@ void ScatteringTriangle::ClearPeaks()
 		}
 	}
 	m_vecPeaks.clear();
+	m_vecPeakDescs.clear();
 }
 
 
@@ -1590,6 +1835,10 @@ ScatteringTriangleScene::ScatteringTriangleScene(QObject* pParent)
 	m_pTri(new ScatteringTriangle(*this))
 {
 	this->addItem(m_pTri.get());
+
+	// peaks are calculated in a worker thread and applied in the gui thread
+	QObject::connect(this, &ScatteringTriangleScene::peaksCalculated,
+		this, &ScatteringTriangleScene::applyPeaks, Qt::QueuedConnection);
 }
 
 
@@ -1597,6 +1846,13 @@ ScatteringTriangleScene::~ScatteringTriangleScene()
 {}
 
 
+void ScatteringTriangleScene::applyPeaks()
+{
+	if(m_pTri && m_pTri->ApplyPeaks())
+		emit peaksChanged();
+}
+
+
 void ScatteringTriangleScene::SetDs(t_real dMonoD, t_real dAnaD)
 {
 	m_dMonoD = dMonoD;
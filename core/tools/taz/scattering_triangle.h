@@ -30,6 +30,7 @@
 #define __TAZ_SCATT_TRIAG_H__
 
 #include <memory>
+#include <array>
 #include <QGraphicsScene>
 #include <QGraphicsView>
 #include <QGraphicsItem>
@@ -47,6 +48,7 @@
 
 #include "libs/globals.h"
 #include "libs/globals_qt.h"
+#include "libs/worker.h"
 #include "libs/spacegroups/spacegroup.h"
 #include "libs/formfactors/formfact.h"
 #include "libs/spacegroups/latticehelper.h"
@@ -123,6 +125,73 @@ class RecipPeak : public QGraphicsItem
 };
 
 
+/**
+ * graphical properties of a bragg peak, calculated in the worker thread
+ */
+struct RecipPeakDesc
+{
+	std::array<int, 3> hkl{{ 0, 0, 0 }};
+	t_real_glob dX = 0., dY = 0.;
+	t_real_glob dRadius = 3.;
+	bool bAllowed = 1;
+	bool bOrigin = 0;
+	std::string strLabel, strToolTip;
+
+	bool operator==(const RecipPeakDesc& desc) const
+	{
+		return hkl == desc.hkl && dX == desc.dX && dY == desc.dY &&
+			dRadius == desc.dRadius && bAllowed == desc.bAllowed &&
+			bOrigin == desc.bOrigin && strLabel == desc.strLabel &&
+			strToolTip == desc.strToolTip;
+	}
+};
+
+
+/**
+ * bragg peaks of a lattice, independent of the scattering plane,
+ * reused as long as only the plane changes
+ */
+struct BraggPeaks
+{
+	// lattice, space group, atoms and hkl range of the peaks
+	std::vector<t_real_glob> vecKey;
+	const xtl::SpaceGroup<t_real_glob>* pSpaceGroup = nullptr;
+
+	// generally allowed reflections
+	std::vector<std::array<int, 3>> vecHKL;
+	std::vector<ublas::vector<t_real_glob>> vecPos;	// in 1/A
+	std::vector<unsigned char> vecHasRefl;
+	std::vector<std::complex<t_real_glob>> vecF;	// empty if not available
+
+	// nearest-neighbour search for single crystals
+	tl::Kd<t_real_glob> kd;
+};
+
+
+/**
+ * results of a bragg peak calculation, handed to the gui thread
+ */
+struct BraggPeaksResult
+{
+	bool bIsPowder = 0;
+
+	std::shared_ptr<const BraggPeaks> pPeaks;
+	std::vector<RecipPeakDesc> vecPeakDescs;
+
+	tl::Lattice<t_real_glob> lattice, recip;
+	ublas::matrix<t_real_glob> matPlane, matPlaneRlu, matPlane_inv;
+	tl::Plane<t_real_glob> plane;
+
+	std::vector<typename tl::Powder<int, t_real_glob>::t_peak> vecPowderLines;
+	std::vector<t_real_glob> vecPowderLineWidths;
+
+	tl::Brillouin2D<t_real_glob> bz;
+	tl::Brillouin3D<t_real_glob> bz3;
+	std::vector<ublas::vector<t_real_glob>> vecBZ3VertsUnproj, vecBZ3Verts;
+	std::vector<ublas::vector<t_real_glob>> vecBZ3SymmPts;
+};
+
+
 class ScatteringTriangleScene;
 class ScatteringTriangle : public QGraphicsItem
 {
@@ -146,10 +215,15 @@ class ScatteringTriangle : public QGraphicsItem
 		ublas::matrix<t_real_glob> m_matPlane, m_matPlaneRlu, m_matPlane_inv;
 		tl::Plane<t_real_glob> m_plane;
 		std::vector<RecipPeak*> m_vecPeaks;
+		std::vector<RecipPeakDesc> m_vecPeakDescs;
 
 		std::vector<t_powderline> m_vecPowderLines;
 		std::vector<t_real_glob> m_vecPowderLineWidths;
-		tl::Kd<t_real_glob> m_kdLattice;
+		tl::Kd<t_real_glob> m_kdLattice;	// empty tree if no peaks are available
+
+		// bragg peak calculation in a worker thread
+		std::shared_ptr<const BraggPeaks> m_pBraggPeaks;
+		CancellableWorker<BraggPeaksResult> m_workerPeaks;
 
 		bool m_bShowBZ = 1;
 		tl::Brillouin2D<t_real_glob> m_bz;
@@ -166,6 +240,7 @@ class ScatteringTriangle : public QGraphicsItem
 	protected:
 		virtual QRectF boundingRect() const override;
 
+
 	public:
 		ScatteringTriangle(ScatteringTriangleScene& scene);
 		virtual ~ScatteringTriangle();
@@ -200,7 +275,9 @@ class ScatteringTriangle : public QGraphicsItem
 	public:
 		bool HasPeaks() const { return m_vecPeaks.size()!=0 && m_recip.IsInited(); }
 		void ClearPeaks();
+		// starts the peak calculation in the background, the scene emits peaksChanged when done
 		void CalcPeaks(const xtl::LatticeCommon<t_real_glob>& recipcommon, bool bIsPowder=0);
+		bool ApplyPeaks();
 
 		void SetPlaneDistTolerance(t_real_glob dTol) { m_dPlaneDistTolerance = dTol; }
 		void SetMaxPeaks(int iMax) { m_iMaxPeaks = iMax; }
@@ -215,7 +292,8 @@ class ScatteringTriangle : public QGraphicsItem
 		void SetEwaldSphereVisible(EwaldSphere iEw);
 
 		const std::vector<t_powderline>& GetPowder() const { return m_vecPowderLines; }
-		const tl::Kd<t_real_glob>& GetKdLattice() const { return m_kdLattice; }
+		const tl::Kd<t_real_glob>& GetKdLattice() const
+		{ return m_pBraggPeaks ? m_pBraggPeaks->kd : m_kdLattice; }
 
 		const tl::Brillouin3D<t_real_glob>& GetBZ3D() const { return m_bz3; }
 		const std::vector<ublas::vector<t_real_glob>>& GetBZ3DPlaneVerts(bool planeproj=0) const
@@ -320,6 +398,14 @@ class ScatteringTriangleScene : public QGraphicsScene
 
 		void nodeEvent(bool bStarted);
 
+		// emitted by the peak calculation thread
+		void peaksCalculated();
+		// new peaks have been applied to the scene
+		void peaksChanged();
+
+	protected slots:
+		void applyPeaks();
+
 	protected:
 		virtual void mousePressEvent(QGraphicsSceneMouseEvent *pEvt) override;
 		virtual void mouseReleaseEvent(QGraphicsSceneMouseEvent *pEvt) override;
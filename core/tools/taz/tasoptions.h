@@ -98,6 +98,18 @@ struct TriangleOptions
 			bChangedAngleKiVec0;
 	}
 
+	// take over the changed values of op
+	void merge(const TriangleOptions& op)
+	{
+		if(op.bChangedTheta) { dTheta = op.dTheta; bChangedTheta = true; }
+		if(op.bChangedTwoTheta) { dTwoTheta = op.dTwoTheta; bChangedTwoTheta = true; }
+		if(op.bChangedAnaTwoTheta) { dAnaTwoTheta = op.dAnaTwoTheta; bChangedAnaTwoTheta = true; }
+		if(op.bChangedMonoTwoTheta) { dMonoTwoTheta = op.dMonoTwoTheta; bChangedMonoTwoTheta = true; }
+		if(op.bChangedMonoD) { dMonoD = op.dMonoD; bChangedMonoD = true; }
+		if(op.bChangedAnaD) { dAnaD = op.dAnaD; bChangedAnaD = true; }
+		if(op.bChangedAngleKiVec0) { dAngleKiVec0 = op.dAngleKiVec0; bChangedAngleKiVec0 = true; }
+	}
+
 	void clear()
 	{
 		bChangedTheta = bChangedTwoTheta = bChangedAnaTwoTheta =
@@ -135,6 +147,33 @@ struct CrystalOptions
 			bChangedSampleName;
 	}
 
+	// take over the changed values of op
+	void merge(const CrystalOptions& op)
+	{
+		if(op.bChangedLattice)
+		{
+			for(int i = 0; i < 3; ++i) dLattice[i] = op.dLattice[i];
+			bChangedLattice = true;
+		}
+		if(op.bChangedLatticeAngles)
+		{
+			for(int i = 0; i < 3; ++i) dLatticeAngles[i] = op.dLatticeAngles[i];
+			bChangedLatticeAngles = true;
+		}
+		if(op.bChangedSpacegroup) { strSpacegroup = op.strSpacegroup; bChangedSpacegroup = true; }
+		if(op.bChangedPlane1)
+		{
+			for(int i = 0; i < 3; ++i) dPlane1[i] = op.dPlane1[i];
+			bChangedPlane1 = true;
+		}
+		if(op.bChangedPlane2)
+		{
+			for(int i = 0; i < 3; ++i) dPlane2[i] = op.dPlane2[i];
+			bChangedPlane2 = true;
+		}
+		if(op.bChangedSampleName) { strSampleName = op.strSampleName; bChangedSampleName = true; }
+	}
+
 	void clear()	// struct is no POD, cannot use memset
 	{
 		bChangedLattice = bChangedLatticeAngles =
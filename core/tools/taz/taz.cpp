@@ -213,6 +213,7 @@ TazDlg::TazDlg(QWidget* pParent, const std::string& strLogFile)
 
 	QObject::connect(&m_sceneReal, &TasLayoutScene::nodeEvent, this, &TazDlg::RealNodeEvent);
 	QObject::connect(&m_sceneRecip, &ScatteringTriangleScene::nodeEvent, this, &TazDlg::RecipNodeEvent);
+	QObject::connect(&m_sceneRecip, &ScatteringTriangleScene::peaksChanged, this, &TazDlg::RecipPeaksChanged);
 	QObject::connect(&m_sceneTof, &TofLayoutScene::nodeEvent, this, &TazDlg::TofNodeEvent);
 
 	// TAS
@@ -616,6 +617,11 @@ TazDlg::TazDlg(QWidget* pParent, const std::string& strLogFile)
 	QAction *pNetCache = new QAction("Network Cache...", this);
 	pMenuNet->addAction(pNetCache);
 
+	m_pNetRecord = new QAction("Record Message Stream...", this);
+	m_pNetRecord->setCheckable(true);
+	m_pNetRecord->setChecked(false);
+	pMenuNet->addAction(m_pNetRecord);
+
 	QAction *pNetRefresh = new QAction("Refresh", this);
 	pNetRefresh->setIcon(load_icon("res/icons/view-refresh.svg"));
 	pMenuNet->addSeparator();
@@ -883,6 +889,7 @@ TazDlg::TazDlg(QWidget* pParent, const std::string& strLogFile)
 	QObject::connect(pNetRefresh, &QAction::triggered, this, &TazDlg::NetRefresh);
 	QObject::connect(pNetCache, &QAction::triggered, this, &TazDlg::ShowNetCache);
 	QObject::connect(pNetScanMon, &QAction::triggered, this, &TazDlg::ShowNetScanMonitor);
+	QObject::connect(m_pNetRecord, &QAction::triggered, this, &TazDlg::NetRecord);
 #endif
 
 	if(pFormfactor)
@@ -1069,6 +1076,7 @@ void TazDlg::DeleteDialogs()
 	if(m_pScanMonDlg) { delete m_pScanMonDlg; m_pScanMonDlg = nullptr; }
 	if(m_pNetCacheDlg) { delete m_pNetCacheDlg; m_pNetCacheDlg = nullptr; }
 	if(m_pNetCache) { delete m_pNetCache; m_pNetCache = nullptr; }
+	if(m_pNetCoalescer) { delete m_pNetCoalescer; m_pNetCoalescer = nullptr; }
 #endif
 
 	if(m_pSgListDlg) { delete m_pSgListDlg; m_pSgListDlg = nullptr; }
@@ -35,6 +35,7 @@
 	#include "dialogs/ScanMonDlg.h"
 	#include "nicos.h"
 	#include "sics.h"
+	#include "net_coalesce.h"
 #endif
 
 #include <QMainWindow>
@@ -199,6 +200,8 @@ class TazDlg : public QMainWindow, Ui::TazDlg
 #if !defined NO_NET
 		SrvDlg *m_pSrvDlg = nullptr;
 		NetCache *m_pNetCache = nullptr;
+		NetCacheCoalescer *m_pNetCoalescer = nullptr;
+		QAction *m_pNetRecord = nullptr;
 		NetCacheDlg *m_pNetCacheDlg = nullptr;
 		ScanMonDlg *m_pScanMonDlg = nullptr;
 #endif
@@ -246,6 +249,7 @@ class TazDlg : public QMainWindow, Ui::TazDlg
 	protected slots:
 		void CalcPeaks();
 		void CalcPeaksRecip();
+		void RecipPeaksChanged();
 		void UpdateDs();
 
 		void SetCrystalType();
@@ -339,6 +343,7 @@ class TazDlg : public QMainWindow, Ui::TazDlg
 		void ShowConnectDlg();
 
 		void NetRefresh();
+		void NetRecord(bool bRecord);
 		void ShowNetCache();
 		void ShowNetScanMonitor();
 
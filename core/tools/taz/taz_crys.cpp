@@ -308,11 +308,9 @@ void TazDlg::CalcPeaks()
 		m_latticecommon = xtl::LatticeCommon<t_real_glob>();
 		if(m_latticecommon.Calc(lattice, recip, planeRLU, planeRealFrac, pSpaceGroup, &m_vecAtoms))
 		{
+			// the scattering triangle's peaks are calculated in the background,
+			// see RecipPeaksChanged()
 			m_sceneRecip.GetTriangle()->CalcPeaks(m_latticecommon, bPowder);
-			if(m_sceneRecip.getSnapq())
-				m_sceneRecip.GetTriangle()->SnapToNearestPeak(
-					m_sceneRecip.GetTriangle()->GetNodeGq());
-			m_sceneRecip.emitUpdate();
 
 			m_sceneProjRecip.GetLattice()->CalcPeaks(m_latticecommon, true);
 			m_sceneRealLattice.GetLattice()->CalcPeaks(m_latticecommon);
@@ -323,11 +321,6 @@ void TazDlg::CalcPeaks()
 			if(m_pReal3d)
 				m_pReal3d->CalcPeaks(m_sceneRealLattice.GetLattice()->GetWS3D(),
 					m_latticecommon);
-			if(m_pBZ3d)
-				m_pBZ3d->RenderBZ(m_sceneRecip.GetTriangle()->GetBZ3D(),
-					m_latticecommon,
-					&m_sceneRecip.GetTriangle()->GetBZ3DPlaneVerts(),
-					&m_sceneRecip.GetTriangle()->GetBZ3DSymmVerts());
 #endif
 		}
 		else
@@ -345,6 +338,29 @@ void TazDlg::CalcPeaks()
 }
 
 
+/**
+ * the scattering triangle's peaks have been calculated
+ */
+void TazDlg::RecipPeaksChanged()
+{
+	if(!m_sceneRecip.GetTriangle())
+		return;
+
+	if(m_sceneRecip.getSnapq())
+		m_sceneRecip.GetTriangle()->SnapToNearestPeak(
+			m_sceneRecip.GetTriangle()->GetNodeGq());
+	m_sceneRecip.emitUpdate();
+
+#ifndef NO_3D
+	if(m_pBZ3d)
+		m_pBZ3d->RenderBZ(m_sceneRecip.GetTriangle()->GetBZ3D(),
+			m_latticecommon,
+			&m_sceneRecip.GetTriangle()->GetBZ3DPlaneVerts(),
+			&m_sceneRecip.GetTriangle()->GetBZ3DSymmVerts());
+#endif
+}
+
+
 void TazDlg::VarsChanged(const CrystalOptions& crys, const TriangleOptions& triag)
 {
 	// update crystal
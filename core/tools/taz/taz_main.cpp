@@ -413,6 +413,7 @@ int main(int argc, char** argv)
 			qRegisterMetaType<CrystalOptions>("CrystalOptions");
 			qRegisterMetaType<std::string>("std::string");
 			qRegisterMetaType<CacheVal>("CacheVal");
+			qRegisterMetaType<NetCacheStats>("NetCacheStats");
 			qRegisterMetaType<QTextCursor>("QTextCursor");
 
 
@@ -27,9 +27,11 @@
  */
 
 #include "taz.h"
+#include "tlibs/string/string.h"
 
 #include <QStatusBar>
 #include <QMessageBox>
+#include <QFileDialog>
 
 #define DEFAULT_MSG_TIMEOUT 4000
 
@@ -74,7 +76,11 @@ void TazDlg::ConnectTo(ControlSystem control_sys,
 	}
 
 
-	QObject::connect(m_pNetCache, &NetCache::vars_changed, this, &TazDlg::VarsChanged);
+	// pass the instrument values on to the views in batches
+	unsigned int iUpdateInterval = m_settings.value("net/update_interval", 50).toUInt();
+	m_pNetCoalescer = new NetCacheCoalescer(m_pNetCache, iUpdateInterval);
+
+	QObject::connect(m_pNetCoalescer, &NetCacheCoalescer::vars_changed, this, &TazDlg::VarsChanged);
 	QObject::connect(m_pNetCache, &NetCache::connected, this, &TazDlg::Connected);
 	QObject::connect(m_pNetCache, &NetCache::disconnected, this, &TazDlg::Disconnected);
 
@@ -86,8 +92,10 @@ void TazDlg::ConnectTo(ControlSystem control_sys,
 	m_pNetCacheDlg->ClearAll();
 	m_pScanMonDlg->ClearPlot();
 
-	QObject::connect(m_pNetCache, &NetCache::updated_cache_value, m_pNetCacheDlg, &NetCacheDlg::UpdateValue);
-	QObject::connect(m_pNetCache, &NetCache::updated_cache_value, m_pScanMonDlg, &ScanMonDlg::UpdateValue);
+	QObject::connect(m_pNetCoalescer, &NetCacheCoalescer::cleared_cache, m_pNetCacheDlg, &NetCacheDlg::ClearAll);
+	QObject::connect(m_pNetCoalescer, &NetCacheCoalescer::updated_cache_value, m_pNetCacheDlg, &NetCacheDlg::UpdateValue);
+	QObject::connect(m_pNetCoalescer, &NetCacheCoalescer::updated_stats, m_pNetCacheDlg, &NetCacheDlg::UpdateStats);
+	QObject::connect(m_pNetCoalescer, &NetCacheCoalescer::updated_cache_value, m_pScanMonDlg, &ScanMonDlg::UpdateValue);
 
 
 	// no manual node movement
@@ -101,20 +109,27 @@ void TazDlg::ConnectTo(ControlSystem control_sys,
 
 void TazDlg::Disconnect()
 {
+	if(m_pNetRecord)
+		m_pNetRecord->setChecked(false);
+
 	if(m_pNetCache)
 	{
 		m_pNetCache->disconnect();
 
-		QObject::disconnect(m_pNetCache, &NetCache::vars_changed, this, &TazDlg::VarsChanged);
 		QObject::disconnect(m_pNetCache, &NetCache::connected, this, &TazDlg::Connected);
 		QObject::disconnect(m_pNetCache, &NetCache::disconnected, this, &TazDlg::Disconnected);
 
-		QObject::disconnect(m_pNetCache, &NetCache::updated_cache_value, m_pNetCacheDlg, &NetCacheDlg::UpdateValue);
-
 		delete m_pNetCache;
 		m_pNetCache = nullptr;
 	}
 
+	// delete after the net cache, which might still be sending updates
+	if(m_pNetCoalescer)
+	{
+		delete m_pNetCoalescer;
+		m_pNetCoalescer = nullptr;
+	}
+
 	// re-enable manual node movement
 	if(m_sceneReal.GetTasLayout()) m_sceneReal.GetTasLayout()->AllowMouseMove(1);
 	if(m_sceneTof.GetTofLayout()) m_sceneTof.GetTofLayout()->AllowMouseMove(1);
@@ -151,6 +166,55 @@ void TazDlg::NetRefresh()
 }
 
 
+/**
+ * record the raw messages from the instrument to a file,
+ * they can be played back using the netreplay tool in tools/misc
+ */
+void TazDlg::NetRecord(bool bRecord)
+{
+	if(!m_pNetCache)
+	{
+		if(bRecord)
+			QMessageBox::warning(this, "Warning", "Not connected to an instrument server.");
+		m_pNetRecord->setChecked(false);
+		return;
+	}
+
+	if(!bRecord)
+	{
+		m_pNetCache->StopRecording();
+		statusBar()->showMessage("Stopped recording the message stream.", DEFAULT_MSG_TIMEOUT);
+		return;
+	}
+
+	QFileDialog::Option fileopt = QFileDialog::Option(0);
+	if(!m_settings.value("main/native_dialogs", 1).toBool())
+		fileopt = QFileDialog::DontUseNativeDialog;
+
+	QString strDirLast = m_settings.value("main/last_dir_netrec", "~").toString();
+	QString strFile = QFileDialog::getSaveFileName(this,
+		"Record Message Stream", strDirLast, "Stream recordings (*.rec *.REC)", nullptr, fileopt);
+	if(strFile == "")
+	{
+		m_pNetRecord->setChecked(false);
+		return;
+	}
+	if(!strFile.endsWith(".rec", Qt::CaseInsensitive))
+		strFile += ".rec";
+
+	if(!m_pNetCache->StartRecording(strFile.toStdString(), windowTitle().toStdString()))
+	{
+		QMessageBox::critical(this, "Error", "Cannot record message stream to \"" + strFile + "\".");
+		m_pNetRecord->setChecked(false);
+		return;
+	}
+
+	std::string strDir = tl::get_dir(strFile.toStdString());
+	m_settings.setValue("main/last_dir_netrec", QString(strDir.c_str()));
+	statusBar()->showMessage("Recording the message stream to \"" + strFile + "\".", DEFAULT_MSG_TIMEOUT);
+}
+
+
 void TazDlg::Connected(const QString& strHost, const QString& strSrv)
 {
 	m_strCurFile = "";
@@ -33,5 +33,6 @@ void TazDlg::ConnectTo(int iSys, const QString& _strHost, const QString& _strPor
 void TazDlg::Disconnect() {}
 void TazDlg::ShowNetCache() {}
 void TazDlg::NetRefresh() {}
+void TazDlg::NetRecord(bool bRecord) {}
 void TazDlg::Connected(const QString& strHost, const QString& strSrv) {}
 void TazDlg::Disconnected() {}
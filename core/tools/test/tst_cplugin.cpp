@@ -0,0 +1,139 @@
+/**
+ * @author Tobias Weber <tweber@ill.fr>
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+// C-level plugin interface with the different calling strategies, compared with the module called directly
+// gcc -O2 -DNO_QT -I. -I../.. -o tst_cplugin tst_cplugin.cpp ../monteconvo/sqw_cplugin.cpp ../monteconvo/modules/simple_magnon.cpp ../monteconvo/sqwbase.cpp ../../tlibs/log/log.cpp ../../tlibs/string/eval.cpp -lstdc++ -std=c++14 -lm -lboost_system -lpthread
+
+#include <iostream>
+#include <random>
+#include <chrono>
+#include <thread>
+#include "tools/monteconvo/modules/simple_magnon.h"
+#include "tools/monteconvo/sqw_cplugin.h"
+#include "tools/monteconvo/sqw_plugin_adapter.h"
+
+using t_real = t_real_reso;
+using t_clock = std::chrono::steady_clock;
+
+
+static bool check(const char* pcName, SqwCPlugin& plugin, SqwCPluginStrategy strategy,
+	const SqwBase& ref, const std::vector<t_real>& vecH, const std::vector<t_real>& vecK,
+	const std::vector<t_real>& vecL, const std::vector<t_real>& vecE)
+{
+	const std::size_t iNum = vecH.size();
+	const std::size_t iNumThreads = 4;
+	std::vector<t_real> vecRef(iNum), vecS(iNum);
+	ref.sqw_batch(iNum, vecH.data(), vecK.data(), vecL.data(), vecE.data(), vecRef.data());
+
+	bool bOk = plugin.IsOk() && plugin.GetStrategy() == strategy;
+
+	// variables are passed through the interface
+	bOk = plugin.SetVarIfAvail("D", "5") && bOk;
+	bOk = !plugin.SetVarIfAvail("no_such_var", "1") && bOk;
+
+	// all threads evaluate their part of the points in chunks
+	auto tStart = t_clock::now();
+	std::vector<std::thread> vecThreads;
+	for(std::size_t iThread=0; iThread<iNumThreads; ++iThread)
+	{
+		vecThreads.emplace_back([&, iThread]()
+		{
+			const std::size_t iChunk = 256;
+			for(std::size_t i=iThread*iChunk; i<iNum; i+=iNumThreads*iChunk)
+			{
+				std::size_t iLen = std::min(iChunk, iNum-i);
+				plugin.sqw_batch(iLen, vecH.data()+i, vecK.data()+i, vecL.data()+i, vecE.data()+i, vecS.data()+i);
+			}
+		});
+	}
+	for(std::thread& thread : vecThreads)
+		thread.join();
+	auto tDur = t_clock::now() - tStart;
+
+	t_real dMaxDev = 0;
+	for(std::size_t i=0; i<iNum; ++i)
+		dMaxDev = std::max(dMaxDev, std::abs(vecS[i] - vecRef[i]));
+	bOk = (dMaxDev == t_real(0)) && bOk;
+
+	// dispersion and shallow copies
+	SqwDispBuf buf;
+	bOk = (plugin.fill_disp(1.1, 0., 0., buf) == 2) && bOk;
+	SqwBase *pCopy = plugin.shallow_copy();
+	bOk = ((*pCopy)(vecH[0], vecK[0], vecL[0], vecE[0]) == vecRef[0]) && bOk;
+	delete pCopy;
+
+	std::cout << pcName << ": " << std::chrono::duration<t_real>(tDur).count()/t_real(iNum)*1e9
+		<< " ns/point, max. deviation " << dMaxDev << ": " << (bOk ? "OK" : "FAILED") << std::endl;
+	return bOk;
+}
+
+
+int main()
+{
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<t_real> distQ(0.8, 1.2), distE(-5., 5.);
+
+	const std::size_t iNum = 1000000;
+	std::vector<t_real> vecH(iNum), vecK(iNum), vecL(iNum), vecE(iNum);
+	for(std::size_t i=0; i<iNum; ++i)
+	{
+		vecH[i] = distQ(rng); vecK[i] = distQ(rng) - 1.;
+		vecL[i] = distQ(rng) - 1.; vecE[i] = distE(rng);
+	}
+
+	SqwMagnon ref("");
+	ref.SetVarIfAvail("D", "5");
+
+	takin_sqw_interface iface = SqwPluginAdapter<SqwMagnon>::make_plugin(
+		"magnon", "Magnon", "", TAKIN_SQW_CAP_THREADSAFE);
+
+	std::string strErr;
+	bool bOk = SqwCPlugin::CheckPlugin(&iface, strErr);
+
+	SqwCPlugin shared(&iface, "");
+	bOk = check("shared", shared, SqwCPluginStrategy::SHARED, ref, vecH, vecK, vecL, vecE) && bOk;
+
+	iface.caps &= ~TAKIN_SQW_CAP_THREADSAFE;
+	SqwCPlugin perthread(&iface, "");
+	bOk = check("per-thread", perthread, SqwCPluginStrategy::PER_THREAD, ref, vecH, vecK, vecL, vecE) && bOk;
+
+	// failing clones fall back to serialised calls on the shared instance
+	takin_sqw_interface ifaceNoClone = iface;
+	ifaceNoClone.clone = [](const void*) -> void* { return nullptr; };
+	SqwCPlugin noclone(&ifaceNoClone, "");
+	bOk = check("per-thread, no clones", noclone, SqwCPluginStrategy::PER_THREAD, ref, vecH, vecK, vecL, vecE) && bOk;
+
+	iface.caps &= ~(TAKIN_SQW_CAP_CLONE | TAKIN_SQW_CAP_BATCH);
+	SqwCPlugin serialised(&iface, "");
+	bOk = check("serialised", serialised, SqwCPluginStrategy::SERIALISED, ref, vecH, vecK, vecL, vecE) && bOk;
+
+	// incompatible interface versions are rejected
+	iface.abi_version = TAKIN_SQW_ABI_VERSION + 1;
+	bOk = !SqwCPlugin::CheckPlugin(&iface, strErr) && bOk;
+
+	std::cout << (bOk ? "OK" : "FAILED") << std::endl;
+	return bOk ? 0 : -1;
+}
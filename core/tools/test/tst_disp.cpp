@@ -0,0 +1,94 @@
+/**
+ * @author Tobias Weber <tweber@ill.fr>
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+// per-neutron cost of SqwMagnon using the vector-returning disp() and the buffer-based disp_into()
+// gcc -O2 -DNO_QT -I. -I../.. -o tst_disp tst_disp.cpp ../monteconvo/modules/simple_magnon.cpp ../monteconvo/sqwbase.cpp ../../tlibs/log/log.cpp ../../tlibs/string/eval.cpp -lstdc++ -std=c++14 -lm -lboost_system -lpthread
+
+#include <iostream>
+#include <random>
+#include <chrono>
+#include "tools/monteconvo/modules/simple_magnon.h"
+#include "tlibs/math/math.h"
+#include "tlibs/phys/neutrons.h"
+
+using t_real = t_real_reso;
+using t_clock = std::chrono::steady_clock;
+
+
+/**
+ * S(Q,E) as it was evaluated before, via the allocating disp()
+ */
+static t_real sqw_vecs(const SqwMagnon& mod, t_real dh, t_real dk, t_real dl, t_real dE,
+	t_real dT, t_real dHWHM, t_real dS0)
+{
+	std::vector<t_real> vecE0, vecW;
+	std::tie(vecE0, vecW) = mod.disp(dh, dk, dl);
+
+	t_real dS = 0;
+	for(std::size_t i=0; i<vecE0.size(); ++i)
+		dS += std::abs(tl::DHO_model<t_real>(dE, dT, vecE0[i], dHWHM, vecW[i], 0.));
+	return dS * dS0;
+}
+
+
+int main()
+{
+	SqwMagnon mod("");
+	mod.SetVarIfAvail("D", "5");
+	mod.SetVarIfAvail("T", "100");
+
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<t_real> distQ(0.8, 1.2), distE(-2., 2.);
+
+	const std::size_t iNumNeutrons = 2000000;
+	std::vector<t_real> vecH(iNumNeutrons), vecK(iNumNeutrons), vecL(iNumNeutrons), vecE(iNumNeutrons);
+	for(std::size_t i=0; i<iNumNeutrons; ++i)
+	{
+		vecH[i] = distQ(rng); vecK[i] = distQ(rng) - 1.;
+		vecL[i] = distQ(rng) - 1.; vecE[i] = distE(rng);
+	}
+
+	auto tStart = t_clock::now();
+	t_real dSumOld = 0;
+	for(std::size_t i=0; i<iNumNeutrons; ++i)
+		dSumOld += sqw_vecs(mod, vecH[i], vecK[i], vecL[i], vecE[i], 100., 0.1, 1.);
+	auto tOld = t_clock::now() - tStart;
+
+	tStart = t_clock::now();
+	t_real dSumNew = 0;
+	for(std::size_t i=0; i<iNumNeutrons; ++i)
+		dSumNew += mod(vecH[i], vecK[i], vecL[i], vecE[i]);
+	auto tNew = t_clock::now() - tStart;
+
+	const t_real dOld = std::chrono::duration<t_real>(tOld).count() / t_real(iNumNeutrons) * 1e9;
+	const t_real dNew = std::chrono::duration<t_real>(tNew).count() / t_real(iNumNeutrons) * 1e9;
+	bool bOk = tl::float_equal<t_real>(dSumOld, dSumNew, 1e-8*std::abs(dSumOld));
+
+	std::cout << "disp(): " << dOld << " ns/neutron, disp_into(): " << dNew << " ns/neutron, "
+		<< "sums: " << dSumOld << ", " << dSumNew << ": "
+		<< (bOk ? "OK" : "FAILED") << std::endl;
+	return bOk ? 0 : -1;
+}
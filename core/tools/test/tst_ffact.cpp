@@ -0,0 +1,102 @@
+/**
+ * @author Tobias Weber <tweber@ill.fr>
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+// gcc -O2 -DNO_QT -I. -I../.. -o tst_ffact tst_ffact.cpp ../../tlibs/log/log.cpp -lstdc++ -std=c++14 -lm -lboost_system -lpthread
+
+#include <iostream>
+#include <random>
+#include <chrono>
+#include "libs/formfactors/formfact.h"
+
+using t_real = double;
+using t_clock = std::chrono::steady_clock;
+
+
+/**
+ * compare the tabulated and the exact function at random |Q|
+ */
+static bool check(const char* pcName, const std::function<t_real(t_real)>& func, t_real dTol)
+{
+	auto tStart = t_clock::now();
+	xtl::FormfactTable<t_real> tab(func, 25., dTol);
+	auto tTab = t_clock::now() - tStart;
+
+	std::mt19937 rng(123);
+	std::uniform_real_distribution<t_real> dist(0., 30.);
+	std::vector<t_real> vecQ(1000000);
+	for(t_real& dQ : vecQ)
+		dQ = dist(rng);
+
+	std::vector<t_real> vecExact(vecQ.size()), vecTab(vecQ.size());
+
+	tStart = t_clock::now();
+	for(std::size_t i=0; i<vecQ.size(); ++i)
+		vecExact[i] = func(vecQ[i]);
+	auto tExact = t_clock::now() - tStart;
+
+	tStart = t_clock::now();
+	tab(vecQ.data(), vecTab.data(), vecQ.size());
+	auto tInterp = t_clock::now() - tStart;
+
+	t_real dMaxErr = 0;
+	for(std::size_t i=0; i<vecQ.size(); ++i)
+		dMaxErr = std::max(dMaxErr, std::abs(vecExact[i] - vecTab[i]));
+
+	const t_real dTolAbs = dTol * std::max(t_real(1), std::abs(func(0.)));
+	// the bound is checked at the quarter points of the intervals
+	bool bOk = dMaxErr <= 1.5*dTolAbs;
+
+	std::cout << pcName << ": " << tab.GetNumNodes() << " nodes, "
+		<< "max. error " << dMaxErr << " (checked: " << tab.GetMaxError() << "), "
+		<< "tabulation " << std::chrono::duration<t_real>(tTab).count() << " s, "
+		<< "exact " << std::chrono::duration<t_real>(tExact).count() << " s, "
+		<< "table " << std::chrono::duration<t_real>(tInterp).count() << " s: "
+		<< (bOk ? "OK" : "FAILED") << std::endl;
+	return bOk;
+}
+
+
+int main()
+{
+	// Fe, x-ray
+	const std::vector<t_real> a = { 11.7695, 7.3573, 3.5222, 2.3045 };
+	const std::vector<t_real> b = { 4.7611, 0.3072, 15.3535, 76.8805 };
+	const t_real c = 1.0369;
+
+	// Fe3+, magnetic
+	const std::vector<t_real> A0 = { 0.3972, 0.6295, -0.0314, 0.0044 };
+	const std::vector<t_real> a0 = { 13.2442, 4.9034, 0.3496 };
+	const std::vector<t_real> A2 = { 1.6490, 1.9064, 0.5206, 0.0028 };
+	const std::vector<t_real> a2 = { 16.5593, 6.1325, 2.2134 };
+
+	bool bOk = true;
+	bOk = check("x-ray", [&](t_real Q) { return tl::formfact<t_real, std::vector>(Q, a, b, c); }, 1e-6) && bOk;
+	bOk = check("j0", [&](t_real Q) { return tl::j0_avg<t_real, std::vector>(Q, A0, a0); }, 1e-6) && bOk;
+	bOk = check("j2", [&](t_real Q) { return tl::j2_avg<t_real, std::vector>(Q, A2, a2); }, 1e-6) && bOk;
+	bOk = check("j0, fine", [&](t_real Q) { return tl::j0_avg<t_real, std::vector>(Q, A0, a0); }, 1e-10) && bOk;
+
+	return bOk ? 0 : -1;
+}
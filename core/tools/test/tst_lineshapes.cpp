@@ -0,0 +1,164 @@
+/**
+ * @author Tobias Weber <tweber@ill.fr>
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+// batch line shapes and batch S(Q,E) evaluation compared with the per-point versions
+// gcc -O2 -DNO_QT -I. -I../.. -o tst_lineshapes tst_lineshapes.cpp ../monteconvo/modules/simple_magnon.cpp ../monteconvo/modules/simple_phonon.cpp ../monteconvo/sqwbase.cpp ../../tlibs/log/log.cpp ../../tlibs/string/eval.cpp -lstdc++ -std=c++14 -lm -lboost_system -lboost_filesystem -lboost_iostreams -lpthread
+
+#include <iostream>
+#include <fstream>
+#include <random>
+#include <chrono>
+#include "tools/monteconvo/modules/simple_magnon.h"
+#include "tools/monteconvo/modules/simple_phonon.h"
+#include "tlibs/math/lineshapes.h"
+#include "tlibs/phys/neutrons.h"
+
+using t_real = t_real_reso;
+using t_clock = std::chrono::steady_clock;
+
+
+static bool check(const char* pcName, const std::vector<t_real>& vec1, const std::vector<t_real>& vec2)
+{
+	t_real dMaxDev = 0, dMax = 0;
+	for(std::size_t i=0; i<vec1.size(); ++i)
+	{
+		dMaxDev = std::max(dMaxDev, std::abs(vec1[i] - vec2[i]));
+		dMax = std::max(dMax, std::abs(vec1[i]));
+	}
+
+	bool bOk = dMaxDev <= 1e-10*dMax;
+	std::cout << pcName << ": max. deviation " << dMaxDev << " (max. value " << dMax << "): "
+		<< (bOk ? "OK" : "FAILED") << std::endl;
+	return bOk;
+}
+
+
+/**
+ * compares operator() with sqw_batch() for a module
+ */
+static bool check_sqw(const char* pcName, const SqwBase& sqw,
+	const std::vector<t_real>& vecH, const std::vector<t_real>& vecK,
+	const std::vector<t_real>& vecL, const std::vector<t_real>& vecE)
+{
+	const std::size_t iNum = vecH.size();
+	std::vector<t_real> vecSingle(iNum), vecBatch(iNum);
+
+	auto tStart = t_clock::now();
+	for(std::size_t i=0; i<iNum; ++i)
+		vecSingle[i] = sqw(vecH[i], vecK[i], vecL[i], vecE[i]);
+	auto tSingle = t_clock::now() - tStart;
+
+	tStart = t_clock::now();
+	sqw.sqw_batch(iNum, vecH.data(), vecK.data(), vecL.data(), vecE.data(), vecBatch.data());
+	auto tBatch = t_clock::now() - tStart;
+
+	std::cout << pcName << ": " << std::chrono::duration<t_real>(tSingle).count()/t_real(iNum)*1e9
+		<< " ns/point single, " << std::chrono::duration<t_real>(tBatch).count()/t_real(iNum)*1e9
+		<< " ns/point batch" << std::endl;
+	return check(pcName, vecSingle, vecBatch);
+}
+
+
+int main()
+{
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<t_real> distQ(0.8, 1.2), distE(-5., 5.);
+
+	const std::size_t iNum = 1000000;
+	std::vector<t_real> vecH(iNum), vecK(iNum), vecL(iNum), vecE(iNum);
+	for(std::size_t i=0; i<iNum; ++i)
+	{
+		vecH[i] = distQ(rng); vecK[i] = distQ(rng) - 1.;
+		vecL[i] = distQ(rng) - 1.; vecE[i] = distE(rng);
+	}
+
+	bool bOk = true;
+
+
+	// line shapes
+	{
+		std::vector<t_real> vecSingle(iNum), vecBatch(iNum);
+
+		for(std::size_t i=0; i<iNum; ++i)
+			vecSingle[i] = tl::gauss_model<t_real>(vecE[i], 0.5, 0.7, 2., 0.);
+		tl::gauss_model_batch<t_real>(iNum, vecE.data(), 0.5, 0.7, 2., vecBatch.data());
+		bOk = check("gauss", vecSingle, vecBatch) && bOk;
+
+		for(std::size_t i=0; i<iNum; ++i)
+			vecSingle[i] = tl::lorentz_model_amp<t_real>(vecE[i], 0.5, vecH[i], 2., 0.);
+		tl::lorentz_model_amp_batch<t_real>(iNum, vecE.data(), 0.5, vecH.data(), 2., vecBatch.data());
+		bOk = check("lorentz", vecSingle, vecBatch) && bOk;
+
+		for(std::size_t i=0; i<iNum; ++i)
+			vecSingle[i] = tl::bose_cutoff<t_real>(vecE[i], 50., 0.1);
+		tl::bose_cutoff_batch<t_real>(iNum, vecE.data(), 50., 0.1, vecBatch.data());
+		bOk = check("bose", vecSingle, vecBatch) && bOk;
+
+		for(std::size_t i=0; i<iNum; ++i)
+			vecSingle[i] = std::abs(tl::DHO_model<t_real>(vecE[i], 50., 2.*vecH[i], 0.2, 3., 0.));
+		std::vector<t_real> vecE0(iNum);
+		for(std::size_t i=0; i<iNum; ++i)
+			vecE0[i] = 2.*vecH[i];
+		tl::DHO_model_batch<t_real>(iNum, vecE.data(), 50., vecE0.data(), 0.2, 3., vecBatch.data());
+		bOk = check("DHO", vecSingle, vecBatch) && bOk;
+	}
+
+
+	// modules
+	{
+		SqwMagnon magnon("");
+		magnon.SetVarIfAvail("D", "5");
+		magnon.SetVarIfAvail("inc_amp", "0.5");
+		bOk = check_sqw("magnon", magnon, vecH, vecK, vecL, vecE) && bOk;
+		magnon.SetVarIfAvail("disp", "1");
+		bOk = check_sqw("antiferromagnon", magnon, vecH, vecK, vecL, vecE) && bOk;
+
+		SqwPhononSingleBranch phonon1("");
+		phonon1.SetVarIfAvail("inc_amp", "0.5");
+		bOk = check_sqw("single-branch phonon", phonon1, vecH, vecK, vecL, vecE) && bOk;
+
+		const char* pcCfg = "/tmp/tst_lineshapes_phonon.cfg";
+		std::ofstream(pcCfg) << "num_qs = 50\nnum_arc = 4\n";
+		SqwPhonon phonon(pcCfg);
+		phonon.SetVarIfAvail("TA1_S0", "2");
+		phonon.SetVarIfAvail("LA_E_HWHM", "0.3");
+		bOk = check_sqw("phonon", phonon, vecH, vecK, vecL, vecE) && bOk;
+
+		// partly outside of the dispersion grid, where the incoherent part also vanishes
+		std::vector<t_real> vecHOut(vecH), vecEOut(vecE);
+		for(std::size_t i=0; i<iNum; i+=2)
+		{
+			vecHOut[i] += 20.;
+			vecEOut[i] *= 0.1;
+		}
+		phonon.SetVarIfAvail("inc_amp", "0.5");
+		phonon.SetVarIfAvail("inc_sig", "0.2");
+		bOk = check_sqw("phonon outside grid", phonon, vecHOut, vecK, vecL, vecEOut) && bOk;
+	}
+
+	std::cout << (bOk ? "OK" : "FAILED") << std::endl;
+	return bOk ? 0 : -1;
+}
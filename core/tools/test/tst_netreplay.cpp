@@ -0,0 +1,159 @@
+/**
+ * @author Tobias Weber <tweber@ill.fr>
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+
+
+// recording of a message stream and its accelerated playback to a client
+// gcc -O2 -I../.. -o tst_netreplay tst_netreplay.cpp ../../tlibs/net/tcp.cpp ../../tlibs/log/log.cpp -lstdc++ -std=c++14 -lm -lboost_system -lboost_filesystem -lpthread
+
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <boost/filesystem.hpp>
+#include "tlibs/net/tcp_replay.h"
+
+using t_clock = std::chrono::steady_clock;
+
+
+int main()
+{
+	const std::size_t iNumMsgs = 2000;
+	const double dDuration = 1.;	// [s]
+	const double dSpeed = 4.;
+	const unsigned short iPort = 14870;
+
+	std::string strFile = (boost::filesystem::temp_directory_path() /
+		boost::filesystem::unique_path("tst_netreplay_%%%%%%.rec")).string();
+
+
+	// record messages in the nicos cache format
+	std::vector<std::string> vecSent;
+	{
+		tl::TcpTxtRecorder<> rec;
+		if(!rec.start(strFile, "test stream"))
+			return -1;
+
+		for(std::size_t iMsg=0; iMsg<iNumMsgs; ++iMsg)
+		{
+			std::string strMsg = tl::var_to_str(1e9 + iMsg) + "@nicos/mth/value=" + tl::var_to_str(iMsg % 50);
+			rec.record(strMsg);
+			vecSent.push_back(strMsg);
+		}
+
+		std::cout << "Recorded " << rec.get_num_msgs() << " messages." << std::endl;
+	}
+
+
+	tl::TcpTxtReplay<> server;
+	if(!server.load(strFile))
+		return -1;
+	boost::filesystem::remove(strFile);
+
+	// replace the time stamps to give a defined duration
+	std::vector<tl::TcpTxtReplay<>::t_msg> vecMsgs = server.get_messages();
+	if(vecMsgs.size() != iNumMsgs)
+	{
+		std::cerr << "Loaded " << vecMsgs.size() << " messages, expected " << iNumMsgs << "." << std::endl;
+		return -1;
+	}
+	for(std::size_t iMsg=0; iMsg<iNumMsgs; ++iMsg)
+		vecMsgs[iMsg].first = dDuration * double(iMsg) / double(iNumMsgs-1);
+	server.set_messages(vecMsgs);
+	server.set_speed(dSpeed);
+
+	if(!server.start_server(iPort))
+		return -1;
+
+
+	// receive the played back messages
+	std::mutex mtx;
+	std::vector<std::string> vecRecv;
+	t_clock::time_point tFirst, tLast;
+
+	tl::TcpTxtClient<> client;
+	client.add_receiver([&](const std::string& strMsg)
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		if(vecRecv.size() == 0)
+			tFirst = t_clock::now();
+		tLast = t_clock::now();
+		vecRecv.push_back(strMsg);
+	});
+
+	if(!client.connect("127.0.0.1", tl::var_to_str(iPort)))
+		return -1;
+
+	server.wait_playback();
+	for(int iWait=0; iWait<100; ++iWait)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			if(vecRecv.size() >= iNumMsgs)
+				break;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+
+	client.disconnect();
+	server.disconnect();
+
+
+	bool bOk = (vecRecv == vecSent);
+	double dTime = std::chrono::duration<double>(tLast - tFirst).count();
+	std::cout << "Received " << vecRecv.size() << " of " << iNumMsgs << " messages in "
+		<< dTime << " s, expected " << dDuration/dSpeed << " s." << std::endl;
+
+	if(std::abs(dTime - dDuration/dSpeed) > 0.1)
+		bOk = false;
+
+
+	// a looping playback of an empty recording has to end immediately
+	{
+		tl::TcpTxtReplay<> serverEmpty;
+		serverEmpty.set_loop(true);
+		if(!serverEmpty.start_server(iPort+1))
+			return -1;
+
+		tl::TcpTxtClient<> clientEmpty;
+		if(!clientEmpty.connect("127.0.0.1", tl::var_to_str(iPort+1)))
+			return -1;
+
+		t_clock::time_point tStart = t_clock::now();
+		serverEmpty.wait_playback();
+		double dTimeEmpty = std::chrono::duration<double>(t_clock::now() - tStart).count();
+
+		clientEmpty.disconnect();
+		serverEmpty.disconnect();
+
+		std::cout << "Empty looping playback ended after " << dTimeEmpty << " s." << std::endl;
+		if(dTimeEmpty > 1. || serverEmpty.get_num_sent() != 0)
+			bOk = false;
+	}
+
+	std::cout << (bOk ? "OK" : "FAILED") << std::endl;
+	return bOk ? 0 : -1;
+}
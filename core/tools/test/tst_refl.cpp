@@ -24,51 +24,79 @@
  * ----------------------------------------------------------------------------
  */
 
-// gcc -DNO_QT -I. -I../.. -o tst_refl tst_refl.cpp ../../libs/spacegroups/spacegroup.cpp ../../libs/spacegroups/crystalsys.cpp ../../tlibs/log/log.cpp ../../libs/globals.cpp -lstdc++ -std=c++11 -lm -lboost_iostreams -lboost_filesystem -lboost_system
+// gcc -O2 -DNO_QT -I. -I../.. -o tst_refl tst_refl.cpp ../../libs/spacegroups/spacegroup.cpp ../../libs/spacegroups/crystalsys.cpp ../../tlibs/log/log.cpp ../../libs/globals.cpp -lstdc++ -std=c++11 -lm -lboost_iostreams -lboost_filesystem -lboost_system
 
 #include <iostream>
+#include <chrono>
 #include "libs/spacegroups/spacegroup.h"
 
 using t_real = double;
+using t_mat = xtl::SpaceGroup<t_real>::t_mat;
+using t_vec = xtl::SpaceGroup<t_real>::t_vec;
 using t_mapSpaceGroups = xtl::SpaceGroups<t_real>::t_mapSpaceGroups;
+using t_clock = std::chrono::steady_clock;
 
 
-void check_allowed_refls()
+/**
+ * compare the precompiled reflection conditions with the matrix-based ones
+ */
+bool check_allowed_refls()
 {
 	std::shared_ptr<const xtl::SpaceGroups<t_real>> sgs = xtl::SpaceGroups<t_real>::GetInstance();
 
 	const int HKL_MAX = 10;
 	unsigned int iSG = 0;
+	t_real dTimeOld = 0, dTimeNew = 0, dTimeBatch = 0;
 
 	const t_mapSpaceGroups *pSGs = sgs->get_space_groups();
 	for(const t_mapSpaceGroups::value_type& sg : *pSGs)
 	{
 		++iSG;
-		//if(iSG < 200) continue;
 
 		const std::string& strName = sg.second.GetName();
 		std::cout << "Checking (" << iSG << ") " << strName << " ... ";
 
+		std::vector<unsigned char> vecOld, vecNew;
+
+		auto tStart = t_clock::now();
+		for(int i=-HKL_MAX; i<=HKL_MAX; ++i)
+		for(int j=-HKL_MAX; j<=HKL_MAX; ++j)
+		for(int k=-HKL_MAX; k<=HKL_MAX; ++k)
+			vecOld.push_back(xtl::is_reflection_allowed<std::vector, t_mat, t_vec>
+				(i,j,k, sg.second.GetTrafos()).first);
+
+		auto tOld = t_clock::now();
 		for(int i=-HKL_MAX; i<=HKL_MAX; ++i)
 		for(int j=-HKL_MAX; j<=HKL_MAX; ++j)
 		for(int k=-HKL_MAX; k<=HKL_MAX; ++k)
+			vecNew.push_back(sg.second.HasReflection(i,j,k));
+
+		auto tNew = t_clock::now();
+		std::vector<unsigned char> vecBatch = sg.second.HasReflections(
+			-HKL_MAX, HKL_MAX, -HKL_MAX, HKL_MAX, -HKL_MAX, HKL_MAX);
+		auto tBatch = t_clock::now();
+
+		dTimeOld += std::chrono::duration<t_real>(tOld - tStart).count();
+		dTimeNew += std::chrono::duration<t_real>(tNew - tOld).count();
+		dTimeBatch += std::chrono::duration<t_real>(tBatch - tNew).count();
+
+		if(vecOld != vecNew || vecOld != vecBatch)
 		{
-			//std::cout << "(" << i << j << k << "): " << 
-			//	std::boolalpha << sg.second.HasReflection(i,j,k) << std::endl;
-
-			if(sg.second.HasReflection(i,j,k) != sg.second.HasReflection2(i,j,k))
-			{
-				std::cout << "Failed at " << i << " " << j << " " << k << std::endl;
-				return;
-			}
+			std::cout << "Failed" << std::endl;
+			return false;
 		}
 
 		std::cout << "OK" << std::endl;
 	}
+
+	std::cout << "\nMatrix-based check: " << dTimeOld << " s"
+		<< "\nPrecompiled check: " << dTimeNew << " s"
+		<< "\nPrecompiled batch check: " << dTimeBatch << " s" << std::endl;
+	return true;
 }
 
+
 int main()
 {
-	check_allowed_refls();
-	return 0;
+	return check_allowed_refls() ? 0 : -1;
 }
@@ -0,0 +1,255 @@
+/**
+ * @author Tobias Weber <tweber@ill.fr>
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+
+// cached dispersion and S(Q,E) compared with the module, and reloading of the saved table
+// gcc -O2 -DNO_QT -I. -I../.. -o tst_sqwcache tst_sqwcache.cpp ../monteconvo/sqwcache.cpp ../monteconvo/modules/simple_magnon.cpp ../monteconvo/sqwbase.cpp ../../tlibs/log/log.cpp ../../tlibs/string/eval.cpp ../../tlibs/math/rand.cpp -lstdc++ -std=c++14 -lm -lboost_system -lboost_filesystem -lpthread
+
+#include <iostream>
+#include <fstream>
+#include <random>
+#include <chrono>
+#include <ctime>
+#include <cstdlib>
+#include <boost/filesystem.hpp>
+#include "tools/monteconvo/modules/simple_magnon.h"
+#include "tools/monteconvo/sqwcache.h"
+
+using t_real = t_real_reso;
+using t_clock = std::chrono::steady_clock;
+
+
+/**
+ * maximum deviation of the cached dispersion from the module's
+ */
+static t_real max_dev(const SqwBase& sqw, const SqwCache& cache, std::size_t iNum)
+{
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<t_real> distQ(0.9, 1.1);
+
+	t_real dMaxDev = 0.;
+	SqwDispBuf bufMod, bufCache;
+
+	for(std::size_t i=0; i<iNum; ++i)
+	{
+		t_real dh = distQ(rng), dk = distQ(rng) - 1., dl = distQ(rng) - 1.;
+
+		std::size_t iNumMod = sqw.fill_disp(dh, dk, dl, bufMod);
+		std::size_t iNumCache = cache.fill_disp(dh, dk, dl, bufCache);
+		if(iNumMod != iNumCache)
+			return -1.;
+
+		for(std::size_t iBranch=0; iBranch<iNumMod; ++iBranch)
+			dMaxDev = std::max(dMaxDev, std::abs(bufMod.E(iBranch) - bufCache.E(iBranch)));
+	}
+
+	return dMaxDev;
+}
+
+
+/**
+ * maximum deviation of the cached S(Q,E) from the module's, relative to the largest S(Q,E)
+ */
+static t_real max_dev_sqw(const SqwBase& sqw, const SqwCache& cache, std::size_t iNum)
+{
+	std::mt19937 rng(5678);
+	std::uniform_real_distribution<t_real> distQ(0.9, 1.1), distE(-1., 1.);
+
+	t_real dMaxDev = 0., dMaxS = 0.;
+	for(std::size_t i=0; i<iNum; ++i)
+	{
+		t_real dh = distQ(rng), dk = distQ(rng) - 1., dl = distQ(rng) - 1., dE = distE(rng);
+
+		t_real dSMod = sqw(dh, dk, dl, dE);
+		t_real dSCache = cache(dh, dk, dl, dE);
+		dMaxDev = std::max(dMaxDev, std::abs(dSMod - dSCache));
+		dMaxS = std::max(dMaxS, std::abs(dSMod));
+	}
+
+	return dMaxS > 0. ? dMaxDev / dMaxS : -1.;
+}
+
+
+/**
+ * a module without dispersion
+ */
+struct SqwElastic : public SqwBase
+{
+	SqwElastic() { SqwBase::m_bOk = 1; }
+
+	virtual std::tuple<std::vector<t_real>, std::vector<t_real>>
+		disp(t_real, t_real, t_real) const override { return {}; }
+	virtual t_real operator()(t_real, t_real, t_real, t_real dE) const override
+		{ return std::abs(dE) < 0.1 ? 1. : 0.; }
+
+	virtual std::vector<t_var> GetVars() const override { return {}; }
+	virtual void SetVars(const std::vector<t_var>&) override {}
+	virtual SqwBase* shallow_copy() const override { return new SqwElastic(); }
+};
+
+
+int main()
+{
+	const std::string strDir = (boost::filesystem::temp_directory_path() / "tst_sqwcache").string();
+	boost::filesystem::remove_all(strDir);
+
+	const std::size_t iNum = 100000;
+	bool bOk = true;
+
+	auto pMagnon = std::make_shared<SqwMagnon>("");
+	pMagnon->SetVarIfAvail("D", "5");
+	pMagnon->SetVarIfAvail("disp", "0");
+
+	{
+		SqwCache cache(pMagnon, "magnon", "", strDir);
+		bOk = cache.IsOk() && bOk;
+
+		auto tStart = t_clock::now();
+		t_real dDev = max_dev(*pMagnon, cache, iNum);
+		auto tDur = t_clock::now() - tStart;
+
+		// quadratic dispersion, 0.01 rlu grid
+		bOk = (dDev >= 0. && dDev < 1e-2) && bOk;
+		std::cout << "calculated: " << cache.GetTable()->GetNumTiles() << " tiles, "
+			<< std::chrono::duration<t_real>(tDur).count() << " s, max. deviation "
+			<< dDev << " meV" << std::endl;
+
+		// the module's own line shape is used
+		t_real dDevS = max_dev_sqw(*pMagnon, cache, iNum);
+		bOk = (dDevS >= 0. && dDevS < 1e-2) && bOk;
+		std::cout << "S(Q, E): max. relative deviation " << dDevS << std::endl;
+	}
+
+	{
+		// module with its default variables
+		auto pMagnonDef = std::make_shared<SqwMagnon>("");
+		SqwCache cache(pMagnonDef, "magnon", "", strDir);
+
+		for(t_real dE : { 0.5, 2. })
+		{
+			t_real dSMod = (*pMagnonDef)(1.05, 0., 0., dE);
+			t_real dSCache = cache(1.05, 0., 0., dE);
+			bOk = (std::abs(dSMod - dSCache) < 1e-2*dSMod) && bOk;
+			std::cout << "S(1.05 0 0, " << dE << " meV): module " << dSMod
+				<< ", cache " << dSCache << std::endl;
+		}
+	}
+
+	{
+		// modules without dispersion are not cached
+		SqwCache cache(std::make_shared<SqwElastic>(), "elastic", "", strDir);
+		bOk = !cache.IsOk() && bOk;
+	}
+
+	{
+		// the table is saved when the last module using it is destroyed
+		SqwCache cache(pMagnon, "magnon", "", strDir);
+		std::size_t iNumTiles = cache.GetTable()->GetNumTiles();
+		bOk = (iNumTiles > 0) && bOk;
+
+		auto tStart = t_clock::now();
+		t_real dDev = max_dev(*pMagnon, cache, iNum);
+		auto tDur = t_clock::now() - tStart;
+
+		bOk = (dDev >= 0. && dDev < 1e-2) && bOk;
+		bOk = (cache.GetTable()->GetNumTiles() == iNumTiles) && bOk;
+		std::cout << "loaded: " << iNumTiles << " tiles, "
+			<< std::chrono::duration<t_real>(tDur).count() << " s, max. deviation "
+			<< dDev << " meV" << std::endl;
+
+		// changing a variable of the module selects another table
+		auto pTable = cache.GetTable();
+		cache.SetVarIfAvail("D", "6");
+		bOk = (cache.GetTable() != pTable && cache.GetTable()->GetNumTiles() == 0) && bOk;
+		bOk = (max_dev(*pMagnon, cache, 1000) < 1e-2) && bOk;
+
+		// but the step does
+		pTable = cache.GetTable();
+		cache.SetVarIfAvail("cache_step", "0.02");
+		bOk = (cache.GetTable() != pTable) && bOk;
+	}
+
+	{
+		// a changed configuration file selects another table
+		const std::string strCfg = (boost::filesystem::path(strDir) / "magnon.cfg").string();
+		std::ofstream(strCfg) << "# 1\n";
+		SqwCache cache1(pMagnon, "magnon", strCfg, strDir);
+		std::ofstream(strCfg) << "# 2\n";
+		SqwCache cache2(pMagnon, "magnon", strCfg, strDir);
+		bOk = (cache1.GetTable() != cache2.GetTable()) && bOk;
+	}
+
+	{
+		// the least recently used tables are removed if the directory gets too large
+		namespace fs = boost::filesystem;
+		const fs::path pathEvict = fs::path(strDir) / "evict";
+		fs::create_directories(pathEvict);
+		setenv("TAKIN_SQW_CACHE_SIZE", "1", 1);
+
+		const fs::path pathOld = pathEvict / "sqwcache_old.dat";
+		const fs::path pathNewer = pathEvict / "sqwcache_newer.dat";
+		for(const fs::path& path : { pathOld, pathNewer })
+			std::ofstream(path.string()) << std::string(600*1024, ' ');
+		fs::last_write_time(pathOld, std::time(nullptr) - 100);
+		fs::last_write_time(pathNewer, std::time(nullptr) - 10);
+
+		{
+			SqwCacheTable table("evict", (pathEvict / "sqwcache_evict.dat").string(), 0.01);
+			table.GetTile(*pMagnon, 0, 0, 0);
+			table.Save();
+		}
+
+		bOk = !fs::exists(pathOld) && fs::exists(pathNewer) && fs::exists(pathEvict / "sqwcache_evict.dat") && bOk;
+		unsetenv("TAKIN_SQW_CACHE_SIZE");
+	}
+
+	{
+		// damaged offsets are rejected when loading
+		const std::string strFile = (boost::filesystem::path(strDir) / "damaged.dat").string();
+		{
+			SqwCacheTable table("damaged", strFile, 0.01);
+			table.GetTile(*pMagnon, 0, 0, 0);
+			table.Save();
+		}
+
+		{
+			// overwrite the offset of the second grid point,
+			// header: magic, sizes, key and step; tile: key and number of branches
+			std::fstream fstr(strFile, std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+			fstr.seekp(8 + 2*4 + 8 + 8 + sizeof(t_real) + 8 + 8 + 8 + 4);
+			std::uint32_t iOffs = 0xffff;
+			fstr.write(reinterpret_cast<const char*>(&iOffs), sizeof(iOffs));
+		}
+
+		SqwCacheTable table("damaged", strFile, 0.01);
+		bOk = !table.Load() && (table.GetNumTiles() == 0) && bOk;
+	}
+
+	boost::filesystem::remove_all(strDir);
+
+	std::cout << (bOk ? "OK" : "FAILED") << std::endl;
+	return bOk ? 0 : -1;
+}
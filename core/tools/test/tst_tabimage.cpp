@@ -0,0 +1,112 @@
+/**
+ * @author Tobias Weber <tweber@ill.fr>
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+// gcc -O2 -DNO_QT -I. -I../.. -o tst_tabimage tst_tabimage.cpp ../../tlibs/log/log.cpp ../../libs/globals.cpp -lstdc++ -std=c++14 -lm -lboost_iostreams -lboost_filesystem -lboost_system
+// ./tst_tabimage res/data/sgroups.xml.gz
+
+#include <iostream>
+#include <chrono>
+#include "libs/tabimage.h"
+
+using t_clock = std::chrono::steady_clock;
+using t_xml = tl::Prop<std::string, 0>;
+using t_img = tl::PropBin<std::string, 0>;
+
+
+/**
+ * compare all values of the xml tree with the ones in the image
+ */
+static bool compare(const t_xml::t_prop& node, const std::string& strPath,
+	const t_xml& xml, const t_img& img, std::size_t& iNumChecked)
+{
+	for(const auto& child : node)
+	{
+		std::string strChild = strPath + "/" + child.first;
+
+		bool bOkXml = 0, bOkImg = 0;
+		std::string strXml = xml.Query<std::string>(strChild, nullptr, &bOkXml);
+		std::string strImg = img.Query<std::string>(strChild, nullptr, &bOkImg);
+
+		if(bOkXml != bOkImg || strXml != strImg
+			|| xml.Exists(strChild) != img.Exists(strChild))
+		{
+			std::cerr << "Mismatch for key \"" << strChild << "\": \""
+				<< strXml << "\" != \"" << strImg << "\"." << std::endl;
+			return false;
+		}
+
+		++iNumChecked;
+		if(!compare(child.second, strChild, xml, img, iNumChecked))
+			return false;
+	}
+
+	return true;
+}
+
+
+int main(int argc, char** argv)
+{
+	if(argc < 2)
+	{
+		std::cerr << "Usage: " << argv[0] << " <table.xml.gz>" << std::endl;
+		return -1;
+	}
+
+	const std::string strTab = argv[1];
+	const std::string strImg = get_table_image_name(strTab);
+
+	if(!save_table_image(strTab))
+	{
+		std::cerr << "Cannot create table image." << std::endl;
+		return -1;
+	}
+
+	auto tStart = t_clock::now();
+	t_xml xml;
+	if(!xml.Load(strTab.c_str(), tl::PropType::XML))
+		return -1;
+
+	auto tXml = t_clock::now();
+	t_img img;
+	std::uint64_t iSrcSize = 0, iSrcHash = 0;
+	if(!img.Load(strImg) || !tl::get_propbin_source_id(strTab, iSrcSize, iSrcHash)
+		|| img.GetSourceSize() != iSrcSize || img.GetSourceHash() != iSrcHash)
+	{
+		std::cerr << "Cannot load table image." << std::endl;
+		return -1;
+	}
+	auto tImg = t_clock::now();
+
+	std::size_t iNumChecked = 0;
+	if(!compare(xml.GetProp(), "", xml, img, iNumChecked))
+		return -1;
+
+	std::cout << "Checked " << iNumChecked << " keys, " << img.GetNumEntries() << " entries in image."
+		<< "\nXML loading: " << std::chrono::duration<double>(tXml - tStart).count() << " s"
+		<< "\nImage loading: " << std::chrono::duration<double>(tImg - tXml).count() << " s"
+		<< std::endl;
+	return 0;
+}
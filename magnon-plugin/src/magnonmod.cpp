@@ -78,6 +78,13 @@ MagnonMod::~MagnonMod()
 
 std::tuple<std::vector<t_real>, std::vector<t_real>>
 	MagnonMod::disp(t_real h, t_real k, t_real l) const
+{
+	return disp_vecs(h, k, l);
+}
+
+
+std::size_t MagnonMod::disp_into(t_real h, t_real k, t_real l,
+	t_real *Es, t_real *Ws, std::size_t max_branches) const
 {
 #ifdef MAGNONMOD_ALLOW_QSIGNS
 	if(m_Qsigns.size() == 3)
@@ -91,26 +98,44 @@ std::tuple<std::vector<t_real>, std::vector<t_real>>
 	// calculate dispersion relation
 	auto modes = m_dyn.CalcEnergies(h, k, l, false);
 
-	std::vector<t_real> energies;
-	std::vector<t_real> weights;
-	energies.reserve(modes.size());
-	weights.reserve(modes.size());
-
-	for(const auto& mode : modes)
+	for(std::size_t idx = 0; idx < std::min(modes.size(), max_branches); ++idx)
 	{
-		energies.push_back(mode.E);
+		const auto& mode = modes[idx];
+		Es[idx] = mode.E;
 
 		if(m_channel >= 0 && m_channel < 3)
-			weights.push_back(std::abs(mode.S_perp(m_channel, m_channel).real()));
+			Ws[idx] = std::abs(mode.S_perp(m_channel, m_channel).real());
 		else
-			weights.push_back(mode.weight);
+			Ws[idx] = mode.weight;
 	}
 
-	return std::make_tuple(energies, weights);
+	return modes.size();
+}
+
+
+/**
+ * the hamiltonian has dimension 2*sites, so there are as many modes
+ */
+std::size_t MagnonMod::GetDispBranchCount() const
+{
+	return 2 * m_dyn.GetMagneticSitesCount();
 }
 
 
 t_real MagnonMod::operator()(t_real h, t_real k, t_real l, t_real E) const
+{
+	SqwDispBuf buf;
+	const std::size_t num_branches = fill_disp(h, k, l, buf);
+
+	return line_shape(h, k, l, E, buf.E(), buf.W(), num_branches);
+}
+
+
+/**
+ * S(Q,E) for the given magnon energies and weights
+ */
+t_real MagnonMod::line_shape(t_real /*h*/, t_real /*k*/, t_real /*l*/, t_real E,
+	const t_real *Es, const t_real *Ws, std::size_t num_branches) const
 {
 	// bose factor
 	t_real bose = 1.;
@@ -120,9 +145,6 @@ t_real MagnonMod::operator()(t_real h, t_real k, t_real l, t_real E) const
 		bose = tl::bose_cutoff(E, m_T, m_dyn.GetBoseCutoffEnergy());
 	}
 
-	std::vector<t_real> Es, Ws;
-	std::tie(Es, Ws) = disp(h, k, l);
-
 	// incoherent peak
 	t_real incoh = 0.;
 	if(!tl::float_equal(m_incoh_amp, t_real(0)))
@@ -131,7 +153,7 @@ t_real MagnonMod::operator()(t_real h, t_real k, t_real l, t_real E) const
 
 	// magnon peaks
 	t_real S = 0.;
-	for(std::size_t iE = 0; iE < Es.size(); ++iE)
+	for(std::size_t iE = 0; iE < num_branches; ++iE)
 	{
 		if(!tl::float_equal(Ws[iE], t_real(0)))
 			S += tl::gauss_model(E, Es[iE], m_sigma, Ws[iE], t_real(0));
@@ -67,7 +67,8 @@ cp -rv data/demos 		${INSTDIR}/
 # resources
 mkdir ${INSTDIR}/res
 cp -rv res/* ${INSTDIR}/res/
-gunzip -v ${INSTDIR}/res/data/*
+# the table images refer to the decompressed contents and stay valid
+gunzip -v ${INSTDIR}/res/data/*.gz
 
 
 
@@ -39,6 +39,7 @@
 #include <H5Cpp.h>
 
 #include <type_traits>
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <vector>
@@ -296,6 +297,99 @@ bool get_h5_matrix(H5::H5File& file, const std::string& path, std::vector<std::v
 	return true;
 }
 
+/**
+ * get the native hdf5 type matching T
+ */
+template<class T>
+H5::PredType get_h5_type()
+{
+	if(std::is_same<T, float>::value)
+		return H5::PredType::NATIVE_FLOAT;
+	else if(std::is_floating_point<T>::value)
+		return H5::PredType::NATIVE_DOUBLE;
+	else if(std::is_same<T, unsigned int>::value)
+		return H5::PredType::NATIVE_UINT;
+	return H5::PredType::NATIVE_INT;
+}
+
+
+/**
+ * reads single rows of a 2d dataset via hyperslab selections,
+ * without loading the full matrix
+ */
+template<class T>
+class H5MatrixReader
+{
+protected:
+	H5::DataSet m_dset;
+	hsize_t m_dims[2] = { 0, 0 };
+	bool m_bOk = false;
+
+public:
+	bool Open(H5::H5File& file, const std::string& path)
+	{
+		m_bOk = false;
+		if(!file.nameExists(path))
+			return false;
+
+		m_dset = file.openDataSet(path);
+		H5::DataSpace dspace = m_dset.getSpace();
+
+		if(dspace.getSimpleExtentNdims() != 2)
+			return false;
+		dspace.getSimpleExtentDims(m_dims, 0);
+		dspace.close();
+
+		m_bOk = true;
+		return true;
+	}
+
+	void Close()
+	{
+		if(m_bOk)
+			m_dset.close();
+		m_bOk = false;
+	}
+
+	bool IsOk() const { return m_bOk; }
+	hsize_t GetRows() const { return m_dims[0]; }
+	hsize_t GetCols() const { return m_dims[1]; }
+
+	/**
+	 * reads a row directly into vals,
+	 * transferring at most iChunk elements at a time (0: whole row)
+	 */
+	bool ReadRow(hsize_t row, std::vector<T>& vals, hsize_t iChunk = 0) const
+	{
+		if(!m_bOk || row >= m_dims[0])
+			return false;
+
+		const hsize_t iLen = m_dims[1];
+		if(iChunk == 0 || iChunk > iLen)
+			iChunk = iLen;
+
+		vals.resize(iLen);
+		if(iLen == 0)
+			return true;
+
+		H5::DataSpace filespace = m_dset.getSpace();
+		for(hsize_t offs=0; offs<iLen; offs+=iChunk)
+		{
+			const hsize_t iCnt = std::min(iChunk, iLen - offs);
+			const hsize_t start[2] = { row, offs };
+			const hsize_t count[2] = { 1, iCnt };
+			filespace.selectHyperslab(H5S_SELECT_SET, count, start);
+
+			H5::DataSpace memspace(1, &iCnt);
+			m_dset.read(vals.data() + offs, get_h5_type<T>(), memspace, filespace);
+			memspace.close();
+		}
+		filespace.close();
+
+		return true;
+	}
+};
+
 }
 
 #endif
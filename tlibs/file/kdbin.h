@@ -0,0 +1,486 @@
+/**
+ * binary, memory-mappable k-d tree files
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2 or GPLv3
+ *
+ * ----------------------------------------------------------------------------
+ * tlibs -- a physical-mathematical C++ template library
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2015-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef __TLIBS_KDBIN_H__
+#define __TLIBS_KDBIN_H__
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include "../math/kd.h"
+#include "../log/log.h"
+
+
+namespace tl {
+
+
+/**
+ * file layout (native byte order):
+ *   header (64 bytes)
+ *   parameter block ("key\tvalue\n" lines, padded to 8 bytes)
+ *   bounding box: iDim minimum values, iDim maximum values
+ *   nodes in pre-order: KdBinNode followed by iRowLen values each
+ */
+struct KdBinHeader
+{
+	char magic[8];
+	std::uint32_t iVersion;
+	std::uint32_t iRealSize;	// sizeof(T)
+	std::uint32_t iDim;		// dimension of the tree
+	std::uint32_t iRowLen;		// number of values per point, >= iDim
+	std::uint64_t iNumNodes;
+	std::uint64_t iParamsLen;
+	std::uint64_t iOffsMinMax;
+	std::uint64_t iOffsNodes;
+	std::uint64_t iReserved;
+};
+
+struct KdBinNode
+{
+	std::uint32_t iAxis;
+	std::uint32_t iLeft;
+	std::uint32_t iRight;
+	std::uint32_t iReserved;
+};
+
+static_assert(sizeof(KdBinHeader) == 64, "Unexpected k-d file header size.");
+static_assert(sizeof(KdBinNode) == 16, "Unexpected k-d file node size.");
+
+static constexpr const char KDBIN_MAGIC[8] = { 'T', 'L', 'K', 'D', 'B', 'I', 'N', '\0' };
+static constexpr std::uint32_t KDBIN_VERSION = 1;
+static constexpr std::uint32_t KDBIN_NONE = 0xffffffff;
+
+
+/**
+ * k-d tree stored in one contiguous block,
+ * either owned or mapped read-only from a file
+ */
+template<class T=double>
+class KdFlat
+{
+public:
+	using t_map = std::unordered_map<std::string, std::string>;
+
+protected:
+	std::unique_ptr<boost::iostreams::mapped_file_source> m_file;
+	std::vector<std::uint64_t> m_buf;	// 8-byte aligned storage
+
+	const char *m_pData = nullptr;
+	std::size_t m_iSize = 0;
+
+	const KdBinHeader *m_pHdr = nullptr;
+	const T *m_pMin = nullptr, *m_pMax = nullptr;
+	const char *m_pNodes = nullptr;
+	std::size_t m_iNodeSize = 0;
+
+	t_map m_mapParams;
+
+protected:
+	static std::size_t pad8(std::size_t iLen) { return (iLen + 7) & ~std::size_t(7); }
+
+	static std::size_t count_nodes(const KdNode<T>* pNode)
+	{
+		if(!pNode) return 0;
+		return 1 + count_nodes(pNode->pLeft) + count_nodes(pNode->pRight);
+	}
+
+	static std::uint32_t flatten(const KdNode<T>* pNode, char* pNodes, std::size_t iNodeSize,
+		std::uint32_t iRowLen, std::uint32_t& iNextIdx)
+	{
+		const std::uint32_t iIdx = iNextIdx++;
+
+		KdBinNode* pBin = reinterpret_cast<KdBinNode*>(pNodes + iIdx*iNodeSize);
+		T* pVals = reinterpret_cast<T*>(pBin + 1);
+
+		pBin->iAxis = pNode->iAxis;
+		pBin->iReserved = 0;
+		for(std::uint32_t i=0; i<iRowLen; ++i)
+			pVals[i] = i < pNode->vecMid.size() ? pNode->vecMid[i] : T(0);
+
+		pBin->iLeft = pNode->pLeft ? flatten(pNode->pLeft, pNodes, iNodeSize, iRowLen, iNextIdx) : KDBIN_NONE;
+		pBin->iRight = pNode->pRight ? flatten(pNode->pRight, pNodes, iNodeSize, iRowLen, iNextIdx) : KDBIN_NONE;
+
+		return iIdx;
+	}
+
+	const KdBinNode* GetNode(std::uint32_t iIdx) const
+	{
+		return reinterpret_cast<const KdBinNode*>(m_pNodes + iIdx*m_iNodeSize);
+	}
+
+	static const T* GetValues(const KdBinNode* pNode)
+	{
+		return reinterpret_cast<const T*>(pNode + 1);
+	}
+
+	T get_radius_sq(const T* vec0, const T* vec1) const
+	{
+		T tRad = T(0);
+		for(std::uint32_t i=0; i<m_pHdr->iDim; ++i)
+			tRad += (vec0[i]-vec1[i])*(vec0[i]-vec1[i]);
+		return tRad;
+	}
+
+	/**
+	 * same search as in Kd::get_best_match, but on node indices
+	 */
+	void get_best_match(std::uint32_t iNode, const T* vec,
+		const KdBinNode** ppBestNode, T* pRad) const
+	{
+		const KdBinNode* pNode = GetNode(iNode);
+		const T* pMid = GetValues(pNode);
+
+		T tRad = get_radius_sq(pMid, vec);
+		if(tRad <= *pRad)
+		{
+			*pRad = tRad;
+			*ppBestNode = pNode;
+		}
+
+		T tDistVecCut = vec[pNode->iAxis] - pMid[pNode->iAxis];
+		T tDistVecCutSq = tDistVecCut*tDistVecCut;
+
+		if(tDistVecCutSq <= *pRad)						// intersects cut line?
+		{
+			if(pNode->iLeft != KDBIN_NONE)
+				get_best_match(pNode->iLeft, vec, ppBestNode, pRad);
+			if(tDistVecCutSq <= *pRad && pNode->iRight != KDBIN_NONE)	// still intersects cut line?
+				get_best_match(pNode->iRight, vec, ppBestNode, pRad);
+		}
+		else
+		{
+			if(tDistVecCut <= 0.)
+			{
+				if(pNode->iLeft != KDBIN_NONE)
+					get_best_match(pNode->iLeft, vec, ppBestNode, pRad);
+			}
+			else
+			{
+				if(pNode->iRight != KDBIN_NONE)
+					get_best_match(pNode->iRight, vec, ppBestNode, pRad);
+			}
+		}
+	}
+
+	/**
+	 * checks the header and sets up the pointers into the data block
+	 */
+	bool Setup()
+	{
+		m_pHdr = nullptr;
+		m_mapParams.clear();
+
+		if(m_iSize < sizeof(KdBinHeader))
+		{
+			log_err("k-d file is too small.");
+			return false;
+		}
+
+		const KdBinHeader *pHdr = reinterpret_cast<const KdBinHeader*>(m_pData);
+		if(std::memcmp(pHdr->magic, KDBIN_MAGIC, sizeof(KDBIN_MAGIC)) != 0)
+		{
+			log_err("Invalid k-d file magic.");
+			return false;
+		}
+		if(pHdr->iVersion != KDBIN_VERSION)
+		{
+			log_err("Unsupported k-d file version ", pHdr->iVersion, ".");
+			return false;
+		}
+		if(pHdr->iRealSize != sizeof(T))
+		{
+			log_err("k-d file uses ", pHdr->iRealSize, "-byte reals, expected ", sizeof(T), ".");
+			return false;
+		}
+		if(pHdr->iDim == 0 || pHdr->iRowLen < pHdr->iDim)
+		{
+			log_err("Invalid k-d file dimensions.");
+			return false;
+		}
+
+		const std::size_t iNodeSize = sizeof(KdBinNode) + pHdr->iRowLen*sizeof(T);
+		if(pHdr->iNumNodes > m_iSize / iNodeSize || pHdr->iNumNodes >= KDBIN_NONE ||
+			pHdr->iOffsMinMax > m_iSize || pHdr->iOffsNodes > m_iSize || pHdr->iParamsLen > m_iSize ||
+			pHdr->iOffsMinMax % 8 != 0 || pHdr->iOffsNodes % 8 != 0)
+		{
+			log_err("Invalid k-d file layout.");
+			return false;
+		}
+		if(pHdr->iOffsMinMax + 2*pHdr->iDim*sizeof(T) > m_iSize ||
+			pHdr->iOffsNodes + pHdr->iNumNodes*iNodeSize > m_iSize ||
+			sizeof(KdBinHeader) + pHdr->iParamsLen > m_iSize)
+		{
+			log_err("k-d file is truncated.");
+			return false;
+		}
+
+		// the nodes are stored in pre-order, so children come after their parent;
+		// this also rules out cycles in a damaged file
+		const char *pNodes = m_pData + pHdr->iOffsNodes;
+		for(std::uint64_t iNode=0; iNode<pHdr->iNumNodes; ++iNode)
+		{
+			const KdBinNode* pNode = reinterpret_cast<const KdBinNode*>(pNodes + iNode*iNodeSize);
+
+			if(pNode->iAxis >= pHdr->iDim ||
+				(pNode->iLeft != KDBIN_NONE && (pNode->iLeft <= iNode || pNode->iLeft >= pHdr->iNumNodes)) ||
+				(pNode->iRight != KDBIN_NONE && (pNode->iRight <= iNode || pNode->iRight >= pHdr->iNumNodes)))
+			{
+				log_err("Invalid node ", iNode, " in k-d file.");
+				return false;
+			}
+		}
+
+		// parameter block
+		std::istringstream istrParams(std::string(m_pData + sizeof(KdBinHeader), pHdr->iParamsLen));
+		std::string strLine;
+		while(std::getline(istrParams, strLine))
+		{
+			std::size_t iTab = strLine.find('\t');
+			if(iTab == std::string::npos)
+				continue;
+			m_mapParams[strLine.substr(0, iTab)] = strLine.substr(iTab+1);
+		}
+
+		m_pHdr = pHdr;
+		m_iNodeSize = iNodeSize;
+		m_pMin = reinterpret_cast<const T*>(m_pData + pHdr->iOffsMinMax);
+		m_pMax = m_pMin + pHdr->iDim;
+		m_pNodes = m_pData + pHdr->iOffsNodes;
+
+		return true;
+	}
+
+public:
+	KdFlat() = default;
+	~KdFlat() { Unload(); }
+
+	// internal pointers refer to the own buffer
+	KdFlat(const KdFlat<T>&) = delete;
+	const KdFlat<T>& operator=(const KdFlat<T>&) = delete;
+
+	void Unload()
+	{
+		if(m_file)
+		{
+			m_file->close();
+			m_file.reset();
+		}
+
+		m_buf.clear();
+		m_buf.shrink_to_fit();
+
+		m_pData = nullptr;
+		m_iSize = 0;
+		m_pHdr = nullptr;
+		m_pMin = m_pMax = nullptr;
+		m_pNodes = nullptr;
+		m_mapParams.clear();
+	}
+
+	/**
+	 * serialises a pointer-based k-d tree into the flat layout
+	 * iRowLen = 0: take the number of values from the root node
+	 */
+	bool FromTree(const Kd<T>& kd, const t_map* pParams = nullptr, std::uint32_t iRowLen = 0)
+	{
+		Unload();
+
+		const KdNode<T>* pRoot = kd.GetRootNode();
+		const std::uint32_t iDim = kd.GetDim();
+		if(!pRoot || iDim == 0)
+			return false;
+		if(iRowLen == 0)
+			iRowLen = std::uint32_t(pRoot->vecMid.size());
+		if(iRowLen < iDim)
+			return false;
+
+		std::ostringstream ostrParams;
+		if(pParams)
+		{
+			for(const auto& pair : *pParams)
+				ostrParams << pair.first << "\t" << pair.second << "\n";
+		}
+		const std::string strParams = ostrParams.str();
+
+		const std::size_t iNumNodes = count_nodes(pRoot);
+		const std::size_t iNodeSize = sizeof(KdBinNode) + iRowLen*sizeof(T);
+
+		KdBinHeader hdr;
+		std::memset(&hdr, 0, sizeof(hdr));
+		std::memcpy(hdr.magic, KDBIN_MAGIC, sizeof(KDBIN_MAGIC));
+		hdr.iVersion = KDBIN_VERSION;
+		hdr.iRealSize = sizeof(T);
+		hdr.iDim = iDim;
+		hdr.iRowLen = iRowLen;
+		hdr.iNumNodes = iNumNodes;
+		hdr.iParamsLen = strParams.length();
+		hdr.iOffsMinMax = sizeof(KdBinHeader) + pad8(strParams.length());
+		hdr.iOffsNodes = pad8(hdr.iOffsMinMax + 2*iDim*sizeof(T));
+
+		const std::size_t iSize = hdr.iOffsNodes + iNumNodes*iNodeSize;
+		m_buf.resize((iSize + 7) / 8, 0);
+		char *pData = reinterpret_cast<char*>(m_buf.data());
+
+		std::memcpy(pData, &hdr, sizeof(hdr));
+		std::memcpy(pData + sizeof(hdr), strParams.data(), strParams.length());
+
+		T *pMinMax = reinterpret_cast<T*>(pData + hdr.iOffsMinMax);
+		for(std::uint32_t i=0; i<iDim; ++i)
+		{
+			pMinMax[i] = kd.GetMin()[i];
+			pMinMax[iDim + i] = kd.GetMax()[i];
+		}
+
+		std::uint32_t iNextIdx = 0;
+		flatten(pRoot, pData + hdr.iOffsNodes, iNodeSize, iRowLen, iNextIdx);
+
+		m_pData = pData;
+		m_iSize = iSize;
+		return Setup();
+	}
+
+	/**
+	 * loads a k-d file, either by mapping it (shared read-only
+	 * between processes via the page cache) or by reading it
+	 */
+	bool Load(const std::string& strFile, bool bMap = true)
+	{
+		Unload();
+
+		try
+		{
+			if(bMap)
+			{
+				m_file.reset(new boost::iostreams::mapped_file_source(strFile));
+				if(!m_file->is_open())
+				{
+					Unload();
+					return false;
+				}
+
+				m_pData = m_file->data();
+				m_iSize = m_file->size();
+			}
+			else
+			{
+				std::ifstream ifstr(strFile, std::ios_base::binary | std::ios_base::ate);
+				if(!ifstr)
+					return false;
+
+				m_iSize = std::size_t(ifstr.tellg());
+				m_buf.resize((m_iSize + 7) / 8, 0);
+				ifstr.seekg(0, std::ios_base::beg);
+				ifstr.read(reinterpret_cast<char*>(m_buf.data()), m_iSize);
+				m_pData = reinterpret_cast<const char*>(m_buf.data());
+			}
+		}
+		catch(const std::exception& ex)
+		{
+			log_err("Cannot load k-d file \"", strFile, "\": ", ex.what());
+			Unload();
+			return false;
+		}
+
+		if(!Setup())
+		{
+			Unload();
+			return false;
+		}
+
+		return true;
+	}
+
+	bool Save(const std::string& strFile) const
+	{
+		if(!m_pHdr)
+			return false;
+
+		std::ofstream ofstr(strFile, std::ios_base::binary);
+		if(!ofstr)
+			return false;
+
+		ofstr.write(m_pData, m_iSize);
+		return bool(ofstr);
+	}
+
+	static bool IsKdBinFile(const std::string& strFile)
+	{
+		std::ifstream ifstr(strFile, std::ios_base::binary);
+		char magic[sizeof(KDBIN_MAGIC)];
+		if(!ifstr.read(magic, sizeof(magic)))
+			return false;
+		return std::memcmp(magic, KDBIN_MAGIC, sizeof(KDBIN_MAGIC)) == 0;
+	}
+
+
+	/**
+	 * @return pointer to the GetRowLen() values of the nearest node
+	 */
+	const T* GetNearestNode(const T* vec) const
+	{
+		if(!m_pHdr || m_pHdr->iNumNodes == 0)
+			return nullptr;
+
+		const KdBinNode *pBestNode = nullptr;
+		T tRad = get_radius_sq(GetValues(GetNode(0)), vec);
+		get_best_match(0, vec, &pBestNode, &tRad);
+
+		if(pBestNode)
+			return GetValues(pBestNode);
+		return nullptr;
+	}
+
+	bool IsPointInGrid(const T* vec) const
+	{
+		if(!m_pHdr)
+			return false;
+
+		for(std::uint32_t i=0; i<m_pHdr->iDim; ++i)
+			if(vec[i] < m_pMin[i] || vec[i] > m_pMax[i])
+				return false;
+		return true;
+	}
+
+	bool IsOk() const { return m_pHdr != nullptr; }
+	bool IsMapped() const { return m_file != nullptr; }
+	unsigned int GetDim() const { return m_pHdr ? m_pHdr->iDim : 0; }
+	unsigned int GetRowLen() const { return m_pHdr ? m_pHdr->iRowLen : 0; }
+	std::size_t GetNodeCount() const { return m_pHdr ? m_pHdr->iNumNodes : 0; }
+	const t_map& GetParams() const { return m_mapParams; }
+};
+
+}
+#endif
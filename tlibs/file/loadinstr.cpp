@@ -32,7 +32,8 @@
 
 namespace tl
 {
-	template FileInstrBase<double>* FileInstrBase<double>::LoadInstr(const char* pcFile);
+	template FileInstrBase<double>* FileInstrBase<double>::LoadInstr(const char* pcFile,
+		const FileInstrBase<double>::t_vecColNames* pColHint);
 
 	template class FilePsi<double>;
 	template class FileFrm<double>;
@@ -44,7 +45,8 @@ namespace tl
 #endif
 
 
-	template FileInstrBase<float>* FileInstrBase<float>::LoadInstr(const char* pcFile);
+	template FileInstrBase<float>* FileInstrBase<float>::LoadInstr(const char* pcFile,
+		const FileInstrBase<float>::t_vecColNames* pColHint);
 
 	template class FilePsi<float>;
 	template class FileFrm<float>;
@@ -32,7 +32,9 @@
 #include <unordered_map>
 #include <map>
 #include <vector>
+#include <list>
 #include <array>
+#include <memory>
 #include <iostream>
 #include "../string/string.h"
 #include "loaddat.h"
@@ -122,7 +124,12 @@ class FileInstrBase
 		virtual bool MatchColumn(const std::string& strRegex,
 			std::string& strColName, bool bSortByCounts=0, bool bFilterEmpty=1) const;
 
-		static FileInstrBase<t_real>* LoadInstr(const char* pcFile);
+		// hint for formats supporting partial reads: only load the given columns
+		// up-front and fetch all others on first access
+		virtual void SetColumnHint(const t_vecColNames&) {}
+
+		static FileInstrBase<t_real>* LoadInstr(const char* pcFile,
+			const t_vecColNames* pColHint = nullptr);
 };
 
 
@@ -584,6 +591,10 @@ class FileRaw : public FileInstrBase<_t_real>
 
 
 #ifdef USE_HDF5
+}
+namespace H5 { class H5File; }
+namespace tl {
+
 /**
  * hdf5 data files
  */
@@ -602,6 +613,22 @@ class FileH5 : public FileInstrBase<_t_real>
 		t_vecColNames m_vecCols;
 		t_mapParams m_params;
 
+		// lazy column loading
+		bool m_bLazy = false;
+		t_vecColNames m_vecColHint;
+		std::shared_ptr<H5::H5File> m_h5file;
+		std::string m_strDataPath;
+		std::vector<std::ptrdiff_t> m_vecColRow;	// dataset row of each column, -1: none
+		std::vector<bool> m_vecColLoaded;
+		std::vector<bool> m_vecColStats;	// "var_" parameters added
+		std::size_t m_iReadChunk = 1 << 16;	// elements per hyperslab transfer
+
+		// columns handed out by GetCol() or GetData() are pinned, the
+		// others are kept up to the cache limit in bytes (0: no limit)
+		std::vector<bool> m_vecColPinned;
+		std::list<std::size_t> m_lstColLRU;
+		std::size_t m_iCacheLimit = std::size_t(64) << 20;
+
 		std::string m_title, m_username, m_localname, m_timestamp;
 		int m_scannumber = 0;
 		std::string m_scancommand, m_palcommand;
@@ -632,6 +659,14 @@ class FileH5 : public FileInstrBase<_t_real>
 
 		std::size_t m_numPolChannels = 0;
 
+	protected:
+		bool LoadCol(std::size_t iIdx);
+		void PinCol(std::size_t iIdx);
+		void EvictCols(std::size_t iKeep);
+		t_real AddColStats(std::size_t iIdx);
+		void AddMissingStats();
+		t_vecVals& FindCol(const std::string& strName, std::size_t *pIdx);
+
 	public:
 		FileH5() = default;
 		virtual ~FileH5() = default;
@@ -639,6 +674,13 @@ class FileH5 : public FileInstrBase<_t_real>
 	public:
 		virtual bool Load(const char* pcFile) override;
 
+		// lazy mode: only the hinted and the scanned columns are read by Load()
+		virtual void SetColumnHint(const t_vecColNames& cols) override;
+		void SetLazyLoad(bool b) { m_bLazy = b; }
+
+		void SetReadChunk(std::size_t iElems) { m_iReadChunk = iElems; }
+		void SetCacheLimit(std::size_t iBytes);
+
 		virtual std::array<t_real, 3> GetSampleLattice() const override;
 		virtual std::array<t_real, 3> GetSampleAngles() const override;
 		virtual std::array<t_real, 2> GetMonoAnaD() const override;
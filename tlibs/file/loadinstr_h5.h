@@ -58,12 +58,19 @@ bool FileH5<t_real>::Load(const char* pcFile)
 
 	try
 	{
-		H5::H5File h5file = H5::H5File(pcFile, H5F_ACC_RDONLY);
+		std::shared_ptr<H5::H5File> ptrFile = std::make_shared<H5::H5File>(pcFile, H5F_ACC_RDONLY);
+		H5::H5File& h5file = *ptrFile;
 
 		m_data.clear();
 		m_vecCols.clear();
 		m_params.clear();
 		m_scanned_vars.clear();
+		m_vecColRow.clear();
+		m_vecColLoaded.clear();
+		m_vecColStats.clear();
+		m_vecColPinned.clear();
+		m_lstColLRU.clear();
+		m_h5file.reset();
 
 		std::vector<std::string> entries;
 		if(!get_h5_entries(h5file, "/", entries) || entries.size() == 0)
@@ -77,8 +84,10 @@ bool FileH5<t_real>::Load(const char* pcFile)
 
 		const std::string& entry = entries[0];
 
-		// get data matrix
-		if(!get_h5_matrix(h5file, entry + "/data_scan/scanned_variables/data", m_data))
+		// get data matrix dimensions, the rows are read individually below
+		m_strDataPath = entry + "/data_scan/scanned_variables/data";
+		H5MatrixReader<t_real> reader;
+		if(!reader.Open(h5file, m_strDataPath))
 		{
 			log_err("Cannot load count data.");
 			return false;
@@ -99,24 +108,61 @@ bool FileH5<t_real>::Load(const char* pcFile)
 			return false;
 		}
 
+		// columns without names are not accessible
+		const std::size_t iNumCols = std::min<std::size_t>(m_vecCols.size(), reader.GetRows());
+		if(m_vecCols.size() != reader.GetRows())
+		{
+			log_warn("Data has ", reader.GetRows(), " columns, but ", m_vecCols.size(), " names are given.");
+			m_vecCols.resize(iNumCols);
+		}
+
+		m_data.resize(iNumCols);
+		m_vecColRow.resize(iNumCols);
+		m_vecColLoaded.resize(iNumCols, false);
+		m_vecColStats.resize(iNumCols, false);
+		m_vecColPinned.resize(iNumCols, false);
+		for(std::size_t idx=0; idx<iNumCols; ++idx)
+			m_vecColRow[idx] = std::ptrdiff_t(idx);
+
+		// read all columns, or in lazy mode only the scanned and the requested ones
+		for(std::size_t idx=0; idx<iNumCols; ++idx)
+		{
+			bool bRead = !m_bLazy || (idx < scanned.size() && scanned[idx]);
+			for(const std::string& strHint : m_vecColHint)
+			{
+				if(bRead)
+					break;
+				bRead = (str_to_lower(strHint) == str_to_lower(m_vecCols[idx]));
+			}
+
+			if(!bRead)
+				continue;
+
+			if(!reader.ReadRow(hsize_t(m_vecColRow[idx]), m_data[idx], m_iReadChunk))
+			{
+				log_err("Cannot load data column \"", m_vecCols[idx], "\".");
+				return false;
+			}
+
+			m_vecColLoaded[idx] = true;
+			if(m_bLazy)
+				m_lstColLRU.push_back(idx);
+		}
+
+		// only columns with a scan flag get statistics
+		for(std::size_t idx=scanned.size(); idx<iNumCols; ++idx)
+			m_vecColStats[idx] = true;
+
 		std::vector<t_real> scanned_stddevs;
 		for(std::size_t idx = 0; idx<std::min(m_vecCols.size(), scanned.size()); ++idx)
 		{
 			const std::string& col_name = m_vecCols[idx];
-			const t_vecVals& col_vec = GetCol(col_name);
 
-			// add variable to parameter map
+			// add variable to parameter map, in lazy mode the unread columns
+			// follow when they are loaded or when all parameters are requested
 			t_real dStd = t_real(0);
-			if(col_vec.size())
-			{
-				t_real dMean = mean_value(col_vec);
-				dStd = std_dev(col_vec);
-
-				std::string col_val = var_to_str(dMean, prec);
-				if(!float_equal(dStd, t_real(0), eps))
-					col_val += " +- " + var_to_str(dStd, prec);
-				m_params.emplace(std::make_pair("var_" + col_name, col_val));
-			}
+			if(m_vecColLoaded[idx])
+				dStd = AddColStats(idx);
 
 			if(scanned[idx])
 			{
@@ -128,10 +174,17 @@ bool FileH5<t_real>::Load(const char* pcFile)
 		// add index column
 		m_vecCols.insert(m_vecCols.begin(), "Point_Index");
 		t_vecVals vals_idx;
-		vals_idx.reserve(GetScanCount());
-		for(std::size_t idx=0; idx<GetScanCount(); ++idx)
+		vals_idx.reserve(reader.GetCols());
+		for(std::size_t idx=0; idx<reader.GetCols(); ++idx)
 			vals_idx.push_back(idx);
 		m_data.emplace(m_data.begin(), std::move(vals_idx));
+		m_vecColRow.insert(m_vecColRow.begin(), -1);
+		m_vecColLoaded.insert(m_vecColLoaded.begin(), true);
+		m_vecColStats.insert(m_vecColStats.begin(), true);
+		m_vecColPinned.insert(m_vecColPinned.begin(), true);
+		for(std::size_t& idx : m_lstColLRU)
+			++idx;
+		reader.Close();
 
 		// if Q, E coordinates are among the scan variables, move them to the front
 		auto iterQL = std::find(m_scanned_vars.begin(), m_scanned_vars.end(), "QL");
@@ -327,7 +380,11 @@ bool FileH5<t_real>::Load(const char* pcFile)
 				" scan steps, but file reports ", scan_steps*pal_steps, ".");
 		}
 
-		h5file.close();
+		// keep the file open for columns which are loaded on access
+		if(m_bLazy)
+			m_h5file = ptrFile;
+		else
+			h5file.close();
 
 		// add parameters to metadata map
 		m_params.emplace(std::make_pair("exp_title", m_title));
@@ -397,16 +454,160 @@ bool FileH5<t_real>::Load(const char* pcFile)
 
 
 template<class t_real>
-const typename FileInstrBase<t_real>::t_vecVals&
-FileH5<t_real>::GetCol(const std::string& strName, std::size_t *pIdx) const
+void FileH5<t_real>::SetColumnHint(const t_vecColNames& cols)
+{
+	m_bLazy = true;
+	m_vecColHint = cols;
+}
+
+
+template<class t_real>
+void FileH5<t_real>::SetCacheLimit(std::size_t iBytes)
+{
+	m_iCacheLimit = iBytes;
+	EvictCols(m_vecColLoaded.size());
+}
+
+
+/**
+ * add the mean value and deviation of a loaded data column to the parameter map
+ * @return deviation
+ */
+template<class t_real>
+t_real FileH5<t_real>::AddColStats(std::size_t iIdx)
 {
-	return const_cast<FileH5*>(this)->GetCol(strName, pIdx);
+	const t_real eps = 1e-6;
+	const int prec = 6;
+
+	const t_vecVals& col_vec = m_data[iIdx];
+	const std::string& strName = m_vecCols[iIdx];
+	m_vecColStats[iIdx] = true;
+
+	if(!col_vec.size())
+		return t_real(0);
+
+	t_real dMean = mean_value(col_vec);
+	t_real dStd = std_dev(col_vec);
+
+	std::string col_val = var_to_str(dMean, prec);
+	if(!float_equal(dStd, t_real(0), eps))
+		col_val += " +- " + var_to_str(dStd, prec);
+	m_params.emplace(std::make_pair("var_" + strName, col_val));
+	return dStd;
+}
+
+
+/**
+ * in lazy mode, add the statistics of the columns which have not been read yet
+ */
+template<class t_real>
+void FileH5<t_real>::AddMissingStats()
+{
+	for(std::size_t idx=0; idx<m_vecColStats.size(); ++idx)
+	{
+		if(m_vecColStats[idx])
+			continue;
+
+		if(m_vecColLoaded[idx])
+			AddColStats(idx);
+		else
+			LoadCol(idx);
+	}
+}
+
+
+/**
+ * read a column which has not been loaded yet
+ */
+template<class t_real>
+bool FileH5<t_real>::LoadCol(std::size_t iIdx)
+{
+	if(m_vecColLoaded[iIdx])
+		return true;
+	if(!m_h5file || m_vecColRow[iIdx] < 0)
+		return false;
+
+	try
+	{
+		H5MatrixReader<t_real> reader;
+		if(!reader.Open(*m_h5file, m_strDataPath) ||
+			!reader.ReadRow(hsize_t(m_vecColRow[iIdx]), m_data[iIdx], m_iReadChunk))
+		{
+			log_err("Cannot load data column \"", m_vecCols[iIdx], "\".");
+			return false;
+		}
+	}
+	catch(const H5::Exception& ex)
+	{
+		log_err(ex.getDetailMsg());
+		return false;
+	}
+
+	m_vecColLoaded[iIdx] = true;
+	if(!m_vecColStats[iIdx])
+		AddColStats(iIdx);
+
+	if(!m_vecColPinned[iIdx])
+	{
+		m_lstColLRU.push_back(iIdx);
+		EvictCols(iIdx);
+	}
+
+	return true;
+}
+
+
+/**
+ * the column is handed out to a caller and is never evicted
+ */
+template<class t_real>
+void FileH5<t_real>::PinCol(std::size_t iIdx)
+{
+	if(m_vecColPinned[iIdx])
+		return;
+
+	m_vecColPinned[iIdx] = true;
+	auto iterLRU = std::find(m_lstColLRU.begin(), m_lstColLRU.end(), iIdx);
+	if(iterLRU != m_lstColLRU.end())
+		m_lstColLRU.erase(iterLRU);
+}
+
+
+/**
+ * drop the least recently loaded unpinned columns until the cache limit is met,
+ * they can only be read again while the file is kept open in lazy mode
+ */
+template<class t_real>
+void FileH5<t_real>::EvictCols(std::size_t iKeep)
+{
+	if(!m_iCacheLimit || !m_h5file)
+		return;
+
+	std::size_t iBytes = 0;
+	for(std::size_t idx : m_lstColLRU)
+		iBytes += m_data[idx].size() * sizeof(t_real);
+
+	for(auto iter = m_lstColLRU.begin(); iter != m_lstColLRU.end() && iBytes > m_iCacheLimit;)
+	{
+		std::size_t idx = *iter;
+		if(idx == iKeep)
+		{
+			++iter;
+			continue;
+		}
+
+		iBytes -= m_data[idx].size() * sizeof(t_real);
+		m_data[idx].clear();
+		m_data[idx].shrink_to_fit();
+		m_vecColLoaded[idx] = false;
+		iter = m_lstColLRU.erase(iter);
+	}
 }
 
 
 template<class t_real>
 typename FileInstrBase<t_real>::t_vecVals&
-FileH5<t_real>::GetCol(const std::string& strName, std::size_t *pIdx)
+FileH5<t_real>::FindCol(const std::string& strName, std::size_t *pIdx)
 {
 	static std::vector<t_real> vecNull;
 
@@ -415,6 +616,15 @@ FileH5<t_real>::GetCol(const std::string& strName, std::size_t *pIdx)
 		if(str_to_lower(m_vecCols[i]) == str_to_lower(strName))
 		{
 			if(pIdx) *pIdx = i;
+
+			// returned columns are pinned, so that references
+			// handed out to callers remain valid
+			if(i < m_vecColLoaded.size())
+			{
+				PinCol(i);
+				LoadCol(i);
+			}
+
 			return m_data[i];
 		}
 	}
@@ -427,18 +637,43 @@ FileH5<t_real>::GetCol(const std::string& strName, std::size_t *pIdx)
 }
 
 
+template<class t_real>
+const typename FileInstrBase<t_real>::t_vecVals&
+FileH5<t_real>::GetCol(const std::string& strName, std::size_t *pIdx) const
+{
+	return const_cast<FileH5*>(this)->FindCol(strName, pIdx);
+}
+
+
+template<class t_real>
+typename FileInstrBase<t_real>::t_vecVals&
+FileH5<t_real>::GetCol(const std::string& strName, std::size_t *pIdx)
+{
+	return FindCol(strName, pIdx);
+}
+
+
 template<class t_real>
 const typename FileInstrBase<t_real>::t_vecDat&
 FileH5<t_real>::GetData() const
 {
-	return m_data;
+	return const_cast<FileH5*>(this)->GetData();
 }
 
 
+/**
+ * the full data matrix is requested, load all columns
+ */
 template<class t_real>
 typename FileInstrBase<t_real>::t_vecDat&
 FileH5<t_real>::GetData()
 {
+	for(std::size_t i=0; i<m_vecColLoaded.size(); ++i)
+	{
+		PinCol(i);
+		LoadCol(i);
+	}
+
 	return m_data;
 }
 
@@ -455,6 +690,8 @@ template<class t_real>
 const typename FileInstrBase<t_real>::t_mapParams&
 FileH5<t_real>::GetAllParams() const
 {
+	// the statistics of unread columns are only computed on request
+	const_cast<FileH5*>(this)->AddMissingStats();
 	return m_params;
 }
 
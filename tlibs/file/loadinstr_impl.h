@@ -92,7 +92,8 @@ void FileInstrBase<t_real>::RenameDuplicateCols()
 
 // automatically choose correct instrument
 template<class t_real>
-FileInstrBase<t_real>* FileInstrBase<t_real>::LoadInstr(const char* pcFile)
+FileInstrBase<t_real>* FileInstrBase<t_real>::LoadInstr(const char* pcFile,
+	const t_vecColNames* pColHint)
 {
 	FileInstrBase<t_real>* pDat = nullptr;
 
@@ -186,6 +187,9 @@ FileInstrBase<t_real>* FileInstrBase<t_real>::LoadInstr(const char* pcFile)
 		}
 	}
 
+	if(pDat && pColHint)
+		pDat->SetColumnHint(*pColHint);
+
 	if(pDat && !pDat->Load(pcFile))
 	{
 		delete pDat;
@@ -0,0 +1,496 @@
+/**
+ * binary, memory-mappable images of property trees
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2 or GPLv3
+ *
+ * ----------------------------------------------------------------------------
+ * tlibs -- a physical-mathematical C++ template library
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2015-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef __TLIBS_PROPBIN_H__
+#define __TLIBS_PROPBIN_H__
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <algorithm>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/optional.hpp>
+
+#include "prop.h"
+#include "../string/string.h"
+#include "../log/log.h"
+
+
+namespace tl {
+
+
+/**
+ * file layout (native byte order):
+ *   header (64 bytes)
+ *   index: iNumEntries PropBinEntry structs, sorted by key
+ *   string block with all keys and values
+ *
+ * keys are the full node paths with '/' as separator,
+ * for case-insensitive trees they are stored in lower case.
+ */
+struct PropBinHeader
+{
+	char magic[8];
+	std::uint32_t iVersion;
+	std::uint32_t iFlags;
+	std::uint64_t iNumEntries;
+	std::uint64_t iOffsIndex;
+	std::uint64_t iOffsStrings;
+	std::uint64_t iStringsLen;
+	std::uint64_t iSourceSize;	// size of the decompressed source contents
+	std::uint64_t iSourceHash;	// fnv-1a hash of the decompressed source contents
+};
+
+struct PropBinEntry
+{
+	std::uint32_t iKeyOffs;
+	std::uint32_t iKeyLen;
+	std::uint32_t iValOffs;
+	std::uint32_t iValLen;
+};
+
+static_assert(sizeof(PropBinHeader) == 64, "Unexpected property image header size.");
+static_assert(sizeof(PropBinEntry) == 16, "Unexpected property image entry size.");
+
+static constexpr const char PROPBIN_MAGIC[8] = { 'T', 'L', 'P', 'R', 'O', 'P', 'B', '\0' };
+static constexpr std::uint32_t PROPBIN_VERSION = 2;
+static constexpr std::uint32_t PROPBIN_CASE_SENSITIVE = 1;
+
+
+/**
+ * size and fnv-1a hash of a file's contents; compressed files are
+ * decompressed first, so a .xml and a .xml.gz table give the same result
+ */
+inline bool get_propbin_source_id(const std::string& strFile,
+	std::uint64_t& iSize, std::uint64_t& iHash)
+{
+	iSize = 0;
+	iHash = 0xcbf29ce484222325ull;
+
+	std::ifstream ifstr(strFile, std::ios_base::binary);
+	if(!ifstr)
+		return false;
+
+#if !defined NO_IOSTR
+	std::shared_ptr<std::istream> ptrIstr = create_autodecomp_istream(ifstr);
+	if(!ptrIstr)
+		return false;
+	std::istream* pIstr = ptrIstr.get();
+#else
+	std::istream* pIstr = &ifstr;
+#endif
+
+	char buf[1 << 16];
+	while(true)
+	{
+		pIstr->read(buf, sizeof(buf));
+		const std::streamsize iRead = pIstr->gcount();
+		if(iRead <= 0)
+			break;
+
+		for(std::streamsize i=0; i<iRead; ++i)
+		{
+			iHash ^= std::uint64_t(static_cast<unsigned char>(buf[i]));
+			iHash *= 0x100000001b3ull;
+		}
+		iSize += std::uint64_t(iRead);
+	}
+
+	return !pIstr->bad();
+}
+
+
+/**
+ * read-only property tree stored in one contiguous block, either owned or
+ * mapped from a file; offers the query interface of tl::Prop
+ */
+template<class _t_str = std::string, bool bCaseSensitive=0>
+class PropBin
+{
+public:
+	using t_str = _t_str;
+	using t_ch = typename t_str::value_type;
+	static_assert(sizeof(t_ch) == 1, "Property images only support narrow strings.");
+
+protected:
+	std::unique_ptr<boost::iostreams::mapped_file_source> m_file;
+	std::vector<std::uint64_t> m_buf;	// 8-byte aligned storage
+
+	const char *m_pData = nullptr;
+	std::size_t m_iSize = 0;
+
+	const PropBinHeader *m_pHdr = nullptr;
+	const PropBinEntry *m_pIndex = nullptr;
+	const char *m_pStrings = nullptr;
+
+	t_ch m_chSep = '/';
+
+protected:
+	static std::size_t pad8(std::size_t iLen) { return (iLen + 7) & ~std::size_t(7); }
+
+	static t_str normalise_key(const t_str& _strKey, t_ch chSep)
+	{
+		t_str strKey = _strKey;
+		trim(strKey);
+		if(strKey.length() && strKey[0] == chSep)
+			strKey = strKey.substr(1);
+		if(chSep != '/')
+			std::replace(strKey.begin(), strKey.end(), chSep, t_ch('/'));
+		if(!bCaseSensitive)
+			strKey = str_to_lower<t_str>(strKey);
+		return strKey;
+	}
+
+	template<class t_prop>
+	static void flatten(const t_prop& prop, const t_str& strPath,
+		std::vector<std::pair<t_str, t_str>>& vecEntries)
+	{
+		for(const auto& node : prop)
+		{
+			t_str strKey = strPath.length() ? strPath + t_ch('/') + node.first : node.first;
+			if(!bCaseSensitive)
+				strKey = str_to_lower<t_str>(strKey);
+
+			vecEntries.emplace_back(std::make_pair(strKey, node.second.data()));
+			flatten(node.second, strKey, vecEntries);
+		}
+	}
+
+	t_str GetKey(const PropBinEntry& entry) const
+	{
+		return t_str(m_pStrings + entry.iKeyOffs, entry.iKeyLen);
+	}
+
+	/**
+	 * binary search in the sorted index
+	 */
+	const PropBinEntry* Find(const t_str& strKey) const
+	{
+		if(!m_pHdr)
+			return nullptr;
+
+		const PropBinEntry *pBegin = m_pIndex, *pEnd = m_pIndex + m_pHdr->iNumEntries;
+		const PropBinEntry *pEntry = std::lower_bound(pBegin, pEnd, strKey,
+			[this](const PropBinEntry& entry, const t_str& str) -> bool
+			{
+				return std::lexicographical_compare(
+					m_pStrings + entry.iKeyOffs, m_pStrings + entry.iKeyOffs + entry.iKeyLen,
+					str.begin(), str.end());
+			});
+
+		if(pEntry == pEnd || pEntry->iKeyLen != strKey.length() ||
+			std::memcmp(m_pStrings + pEntry->iKeyOffs, strKey.data(), strKey.length()) != 0)
+			return nullptr;
+		return pEntry;
+	}
+
+	/**
+	 * checks the header and sets up the pointers into the data block
+	 */
+	bool Setup()
+	{
+		m_pHdr = nullptr;
+
+		if(m_iSize < sizeof(PropBinHeader))
+		{
+			log_err("Property image is too small.");
+			return false;
+		}
+
+		const PropBinHeader *pHdr = reinterpret_cast<const PropBinHeader*>(m_pData);
+		if(std::memcmp(pHdr->magic, PROPBIN_MAGIC, sizeof(PROPBIN_MAGIC)) != 0)
+		{
+			log_err("Invalid property image magic.");
+			return false;
+		}
+		if(pHdr->iVersion != PROPBIN_VERSION)
+		{
+			log_err("Unsupported property image version ", pHdr->iVersion, ".");
+			return false;
+		}
+		if(bool(pHdr->iFlags & PROPBIN_CASE_SENSITIVE) != bCaseSensitive)
+		{
+			log_err("Property image has the wrong case sensitivity.");
+			return false;
+		}
+		if(pHdr->iOffsIndex + pHdr->iNumEntries*sizeof(PropBinEntry) > m_iSize ||
+			pHdr->iOffsStrings + pHdr->iStringsLen > m_iSize)
+		{
+			log_err("Property image is truncated.");
+			return false;
+		}
+
+		const PropBinEntry *pIndex = reinterpret_cast<const PropBinEntry*>(m_pData + pHdr->iOffsIndex);
+		for(std::uint64_t iEntry=0; iEntry<pHdr->iNumEntries; ++iEntry)
+		{
+			const PropBinEntry& entry = pIndex[iEntry];
+			if(std::uint64_t(entry.iKeyOffs) + entry.iKeyLen > pHdr->iStringsLen ||
+				std::uint64_t(entry.iValOffs) + entry.iValLen > pHdr->iStringsLen)
+			{
+				log_err("Invalid property image entry.");
+				return false;
+			}
+		}
+
+		m_pHdr = pHdr;
+		m_pIndex = pIndex;
+		m_pStrings = m_pData + pHdr->iOffsStrings;
+		return true;
+	}
+
+public:
+	PropBin(t_ch chSep = '/') : m_chSep(chSep) {}
+	~PropBin() { Unload(); }
+
+	// internal pointers refer to the own buffer
+	PropBin(const PropBin&) = delete;
+	const PropBin& operator=(const PropBin&) = delete;
+
+	void SetSeparator(t_ch ch) { m_chSep = ch; }
+
+	void Unload()
+	{
+		if(m_file)
+		{
+			m_file->close();
+			m_file.reset();
+		}
+
+		m_buf.clear();
+		m_buf.shrink_to_fit();
+
+		m_pData = nullptr;
+		m_iSize = 0;
+		m_pHdr = nullptr;
+		m_pIndex = nullptr;
+		m_pStrings = nullptr;
+	}
+
+	/**
+	 * serialises a property tree
+	 * @param iSourceSize, iSourceHash identify the file the tree was loaded from
+	 */
+	bool FromProp(const Prop<t_str, bCaseSensitive>& prop,
+		std::uint64_t iSourceSize = 0, std::uint64_t iSourceHash = 0)
+	{
+		Unload();
+
+		std::vector<std::pair<t_str, t_str>> vecEntries;
+		flatten(prop.GetProp(), t_str(), vecEntries);
+
+		// sort by key, for duplicate keys only the first one is reachable as in the tree
+		std::stable_sort(vecEntries.begin(), vecEntries.end(),
+			[](const std::pair<t_str, t_str>& pair1, const std::pair<t_str, t_str>& pair2) -> bool
+			{ return pair1.first < pair2.first; });
+		vecEntries.erase(std::unique(vecEntries.begin(), vecEntries.end(),
+			[](const std::pair<t_str, t_str>& pair1, const std::pair<t_str, t_str>& pair2) -> bool
+			{ return pair1.first == pair2.first; }), vecEntries.end());
+
+		std::size_t iStringsLen = 0;
+		for(const auto& pair : vecEntries)
+			iStringsLen += pair.first.length() + pair.second.length();
+		if(iStringsLen > std::size_t(0xffffffff))
+		{
+			log_err("Property tree is too large for an image.");
+			return false;
+		}
+
+		PropBinHeader hdr;
+		std::memset(&hdr, 0, sizeof(hdr));
+		std::memcpy(hdr.magic, PROPBIN_MAGIC, sizeof(PROPBIN_MAGIC));
+		hdr.iVersion = PROPBIN_VERSION;
+		hdr.iFlags = bCaseSensitive ? PROPBIN_CASE_SENSITIVE : 0;
+		hdr.iNumEntries = vecEntries.size();
+		hdr.iOffsIndex = sizeof(PropBinHeader);
+		hdr.iOffsStrings = hdr.iOffsIndex + vecEntries.size()*sizeof(PropBinEntry);
+		hdr.iStringsLen = iStringsLen;
+		hdr.iSourceSize = iSourceSize;
+		hdr.iSourceHash = iSourceHash;
+
+		const std::size_t iSize = pad8(hdr.iOffsStrings + iStringsLen);
+		m_buf.resize(iSize / 8, 0);
+		char *pData = reinterpret_cast<char*>(m_buf.data());
+		std::memcpy(pData, &hdr, sizeof(hdr));
+
+		PropBinEntry *pIndex = reinterpret_cast<PropBinEntry*>(pData + hdr.iOffsIndex);
+		char *pStrings = pData + hdr.iOffsStrings;
+		std::uint32_t iOffs = 0;
+		for(std::size_t iEntry=0; iEntry<vecEntries.size(); ++iEntry)
+		{
+			const t_str& strKey = vecEntries[iEntry].first;
+			const t_str& strVal = vecEntries[iEntry].second;
+
+			pIndex[iEntry].iKeyOffs = iOffs;
+			pIndex[iEntry].iKeyLen = std::uint32_t(strKey.length());
+			std::memcpy(pStrings + iOffs, strKey.data(), strKey.length());
+			iOffs += std::uint32_t(strKey.length());
+
+			pIndex[iEntry].iValOffs = iOffs;
+			pIndex[iEntry].iValLen = std::uint32_t(strVal.length());
+			std::memcpy(pStrings + iOffs, strVal.data(), strVal.length());
+			iOffs += std::uint32_t(strVal.length());
+		}
+
+		m_pData = pData;
+		m_iSize = iSize;
+		return Setup();
+	}
+
+	/**
+	 * loads an image, either by mapping it or by reading it
+	 */
+	bool Load(const std::string& strFile, bool bMap = true)
+	{
+		Unload();
+
+		try
+		{
+			if(bMap)
+			{
+				m_file.reset(new boost::iostreams::mapped_file_source(strFile));
+				if(!m_file->is_open())
+				{
+					Unload();
+					return false;
+				}
+
+				m_pData = m_file->data();
+				m_iSize = m_file->size();
+			}
+			else
+			{
+				std::ifstream ifstr(strFile, std::ios_base::binary | std::ios_base::ate);
+				if(!ifstr)
+					return false;
+
+				m_iSize = std::size_t(ifstr.tellg());
+				m_buf.resize((m_iSize + 7) / 8, 0);
+				ifstr.seekg(0, std::ios_base::beg);
+				ifstr.read(reinterpret_cast<char*>(m_buf.data()), m_iSize);
+				m_pData = reinterpret_cast<const char*>(m_buf.data());
+			}
+		}
+		catch(const std::exception& ex)
+		{
+			log_err("Cannot load property image \"", strFile, "\": ", ex.what());
+			Unload();
+			return false;
+		}
+
+		if(!Setup())
+		{
+			Unload();
+			return false;
+		}
+
+		return true;
+	}
+
+	bool Save(const std::string& strFile) const
+	{
+		if(!m_pHdr)
+			return false;
+
+		std::ofstream ofstr(strFile, std::ios_base::binary);
+		if(!ofstr)
+			return false;
+
+		ofstr.write(m_pData, m_iSize);
+		return bool(ofstr);
+	}
+
+	static bool IsPropBinFile(const std::string& strFile)
+	{
+		std::ifstream ifstr(strFile, std::ios_base::binary);
+		char magic[sizeof(PROPBIN_MAGIC)];
+		if(!ifstr.read(magic, sizeof(magic)))
+			return false;
+		return std::memcmp(magic, PROPBIN_MAGIC, sizeof(PROPBIN_MAGIC)) == 0;
+	}
+
+
+	template<typename T>
+	T Query(const t_str& strAddr, const T* pDef=nullptr, bool *pbOk=nullptr) const
+	{
+		const PropBinEntry *pEntry = Find(normalise_key(strAddr, m_chSep));
+		if(!pEntry)
+		{
+			if(pbOk) *pbOk = 0;
+			if(pDef) return *pDef;
+			return T();
+		}
+
+		t_str strVal(m_pStrings + pEntry->iValOffs, pEntry->iValLen);
+		T tOut = tl::str_to_var<T, t_str>(strVal);
+
+		// if T is a string type, trim it
+		if(std::is_same<t_str, T>::value)
+			trim(*reinterpret_cast<t_str*>(&tOut));
+
+		if(pbOk) *pbOk = 1;
+		return tOut;
+	}
+
+	template<typename T>
+	T Query(const t_str& strAddr, const T def, bool *pbOk=nullptr) const
+	{
+		return Query<T>(strAddr, &def, pbOk);
+	}
+
+	template<typename T>
+	boost::optional<T> QueryOpt(const t_str& strAddr) const
+	{
+		bool bOk = 0;
+		T tVal = Query<T>(strAddr, nullptr, &bOk);
+		return bOk ? boost::optional<T>(std::move(tVal)) : boost::optional<T>();
+	}
+
+	bool Exists(const t_str& strAddr) const
+	{
+		bool bOk = 0;
+		t_str strQuery = Query<t_str>(strAddr, nullptr, &bOk);
+		if(strQuery.length() == 0)
+			bOk = 0;
+
+		return bOk;
+	}
+
+
+	bool IsOk() const { return m_pHdr != nullptr; }
+	bool IsMapped() const { return m_file != nullptr; }
+	std::size_t GetNumEntries() const { return m_pHdr ? m_pHdr->iNumEntries : 0; }
+	std::uint64_t GetSourceSize() const { return m_pHdr ? m_pHdr->iSourceSize : 0; }
+	std::uint64_t GetSourceHash() const { return m_pHdr ? m_pHdr->iSourceHash : 0; }
+};
+
+}
+#endif
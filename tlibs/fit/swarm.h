@@ -31,11 +31,16 @@
 
 #include <vector>
 #include <functional>
+#include <memory>
+#include <random>
+#include <thread>
+#include <limits>
 
 #include "funcmod.h"
 #include "../math/linalg.h"
 #include "../math/math.h"
 #include "../math/rand.h"
+#include "../math/stat.h"
 #include "../log/log.h"
 
 
@@ -250,6 +255,243 @@ public:
 
 
 
+/**
+ * swarm minimisation, evaluating all particles of a generation concurrently
+ *
+ * Every worker thread has its own cost function, e.g. a chi^2 using a clone
+ * of the fit model, so that models with internal state can be used.
+ * The random numbers are drawn in the calling thread and the particles'
+ * and swarm's best positions are only updated after a whole generation
+ * has been evaluated, so the result does not depend on the number of threads.
+ */
+template<class t_real>
+class UnkindnessPar
+{
+public:
+	using t_params = std::vector<t_real>;
+	using t_func = std::function<t_real(const t_params&)>;
+
+protected:
+	struct RavenPar
+	{
+		t_params vecPos, vecBestPos, vecVel;
+		t_real dVal = std::numeric_limits<t_real>::max();
+		t_real dBestVal = std::numeric_limits<t_real>::max();
+	};
+
+	std::vector<RavenPar> m_vecRavens;
+	t_params m_vecBestPos;
+	t_real m_dBestVal = std::numeric_limits<t_real>::max();
+	bool m_bBestPos = 0;
+	bool m_bConverged = 0;
+
+	// one cost function per worker
+	std::vector<t_func> m_vecFuncs;
+
+	t_params m_vecMin, m_vecMax;
+	std::mt19937 m_rng{ get_randeng()() };
+
+	t_real m_dVelScale = 0.7;
+	t_real m_dPartScale = 1.4;
+	t_real m_dSwarmScale = 1.4;
+	t_real m_dEps = get_epsilon<t_real>();
+
+	std::size_t m_iMaxGenerations = 500;
+	std::size_t m_iMaxBestPosIters = 5;	// max. generations without improvement
+	std::size_t m_iNumEvals = 0;
+
+
+protected:
+	/**
+	 * evaluates the positions of all particles, each worker takes a fixed range
+	 */
+	void EvalAll()
+	{
+		const std::size_t iNumRavens = m_vecRavens.size();
+		const std::size_t iNumWorkers = std::min(m_vecFuncs.size(), iNumRavens);
+
+		auto eval_range = [this](const t_func& func, std::size_t iStart, std::size_t iEnd)
+		{
+			for(std::size_t i=iStart; i<iEnd; ++i)
+				m_vecRavens[i].dVal = func(m_vecRavens[i].vecPos);
+		};
+
+		if(iNumWorkers <= 1)
+		{
+			eval_range(m_vecFuncs[0], 0, iNumRavens);
+		}
+		else
+		{
+			std::vector<std::thread> vecThreads;
+			vecThreads.reserve(iNumWorkers);
+
+			for(std::size_t iWorker=0; iWorker<iNumWorkers; ++iWorker)
+			{
+				const std::size_t iStart = iWorker*iNumRavens / iNumWorkers;
+				const std::size_t iEnd = (iWorker+1)*iNumRavens / iNumWorkers;
+				vecThreads.emplace_back(eval_range, std::cref(m_vecFuncs[iWorker]), iStart, iEnd);
+			}
+
+			for(std::thread& th : vecThreads)
+				th.join();
+		}
+
+		m_iNumEvals += iNumRavens;
+	}
+
+
+	/**
+	 * synchronous update of the best positions, in particle order
+	 * @return true if the swarm's best position has improved
+	 */
+	bool UpdateBest()
+	{
+		bool bImproved = false;
+
+		for(RavenPar& raven : m_vecRavens)
+		{
+			if(raven.dVal < raven.dBestVal)
+			{
+				raven.dBestVal = raven.dVal;
+				raven.vecBestPos = raven.vecPos;
+			}
+
+			if(raven.dVal < m_dBestVal)
+			{
+				// only count improvements beyond the tolerance
+				if(!m_bBestPos || !float_equal<t_real>(raven.dVal, m_dBestVal, m_dEps))
+					bImproved = true;
+
+				m_dBestVal = raven.dVal;
+				m_vecBestPos = raven.vecPos;
+				m_bBestPos = true;
+			}
+		}
+
+		return bImproved;
+	}
+
+
+public:
+	// ------------------------------------------------------------------------
+	/**
+	 * cost functions for the workers, their number gives the number of threads
+	 */
+	void SetFuncs(const std::vector<t_func>& vecFuncs) { m_vecFuncs = vecFuncs; }
+
+	/**
+	 * a single, thread-safe cost function to be used by all workers
+	 */
+	void SetFunc(const t_func& func, unsigned int iNumThreads)
+	{
+		m_vecFuncs.assign(std::max(iNumThreads, 1u), func);
+	}
+
+	void SetSeed(unsigned int iSeed) { m_rng.seed(iSeed); }
+	void SetMaxGenerations(std::size_t iMax) { m_iMaxGenerations = iMax; }
+	void SetMaxBestIters(std::size_t iMaxIters) { m_iMaxBestPosIters = iMaxIters; }
+
+	void SetVelScale(t_real dSc) { m_dVelScale = dSc; }
+	void SetPartScale(t_real dSc) { m_dPartScale = dSc; }
+	void SetSwarmScale(t_real dSc) { m_dSwarmScale = dSc; }
+	void SetEpsilon(t_real dEps) { m_dEps = dEps; }
+
+	const t_params& GetBestPos() const { return m_vecBestPos; }
+	t_real GetBestVal() const { return m_dBestVal; }
+	bool IsBestPosValid() const { return m_bBestPos; }
+	bool IsConverged() const { return m_bConverged; }
+	std::size_t GetNumEvals() const { return m_iNumEvals; }
+	// ------------------------------------------------------------------------
+
+
+	/**
+	 * random initial positions and velocities within [vecMin, vecMax]
+	 */
+	void Init(std::size_t iNumRavens, const t_params& vecMin, const t_params& vecMax)
+	{
+		const std::size_t iDim = std::min(vecMin.size(), vecMax.size());
+		m_vecMin = vecMin;
+		m_vecMax = vecMax;
+
+		m_vecRavens.clear();
+		m_vecRavens.resize(iNumRavens);
+		m_vecBestPos.clear();
+		m_dBestVal = std::numeric_limits<t_real>::max();
+		m_bBestPos = 0;
+		m_bConverged = 0;
+		m_iNumEvals = 0;
+
+		std::uniform_real_distribution<t_real> dist01(0, 1);
+		for(RavenPar& raven : m_vecRavens)
+		{
+			raven.vecPos.resize(iDim);
+			raven.vecVel.resize(iDim);
+
+			for(std::size_t i=0; i<iDim; ++i)
+			{
+				const t_real dRange = vecMax[i] - vecMin[i];
+				raven.vecPos[i] = vecMin[i] + dist01(m_rng)*dRange;
+				raven.vecVel[i] = (t_real(2)*dist01(m_rng) - t_real(1))*dRange;
+			}
+
+			raven.vecBestPos = raven.vecPos;
+		}
+
+		if(m_vecFuncs.size() && iNumRavens)
+		{
+			EvalAll();
+			UpdateBest();
+		}
+	}
+
+
+	void Run()
+	{
+		if(!m_vecRavens.size() || !m_vecFuncs.size())
+		{
+			m_bBestPos = 0;
+			return;
+		}
+
+		const std::size_t iDim = m_vecBestPos.size();
+		std::uniform_real_distribution<t_real> dist01(0, 1);
+		std::size_t iLastBestPos = 0;
+
+		for(std::size_t iGen=0; iGen<m_iMaxGenerations; ++iGen)
+		{
+			// move the particles, drawing the random numbers serially
+			for(RavenPar& raven : m_vecRavens)
+			{
+				for(std::size_t i=0; i<iDim; ++i)
+				{
+					const t_real dPart = dist01(m_rng);
+					const t_real dSwarm = dist01(m_rng);
+
+					raven.vecVel[i] = m_dVelScale*raven.vecVel[i]
+						+ m_dPartScale*dPart*(raven.vecBestPos[i] - raven.vecPos[i])
+						+ m_dSwarmScale*dSwarm*(m_vecBestPos[i] - raven.vecPos[i]);
+					raven.vecPos[i] += raven.vecVel[i];
+				}
+			}
+
+			EvalAll();
+
+			// no new best position since a few generations?
+			if(UpdateBest())
+				iLastBestPos = 0;
+			else if(++iLastBestPos >= m_iMaxBestPosIters)
+			{
+				m_bConverged = 1;
+				return;
+			}
+		}
+
+		tl::log_warn("Maximum number of swarm generations reached.");
+	}
+};
+
+
+
 // -----------------------------------------------------------------------------
 template<typename t_real, std::size_t iNumArgs, typename t_func>
 bool swarmfit(t_func&& func,
@@ -261,7 +503,8 @@ bool swarmfit(t_func&& func,
 	std::vector<t_real>& vecVals,
 	std::vector<t_real>& vecErrs,
 
-	bool bDebug = 1)
+	bool bDebug = 1,
+	unsigned int iNumThreads = std::thread::hardware_concurrency())
 {
 	if(!vecX.size() || !vecY.size() || !vecYErr.size())
 	{
@@ -278,7 +521,7 @@ bool swarmfit(t_func&& func,
 
 	std::size_t iDatSize = std::min(vecY.size(), vecYErr.size());
 	std::size_t iNumRavens = 256*iParamSize;
-	std::size_t iMaxCalls = 128;
+	std::size_t iMaxCalls = 128;		// as in Unkindness, counted in generations
 	std::size_t iMaxBestIters = 4;
 
 	ublas::vector<t_real> vecMin(iParamSize), vecMax(iParamSize);
@@ -288,12 +531,30 @@ bool swarmfit(t_func&& func,
 		vecMax[iY] = vecVals[iY] + vecErrs[iY];
 	}
 
+	// one clone of the model per worker
 	FitterLamFuncModel<t_real, iNumArgs, t_func> mod(func);
-	tl::Unkindness<t_real, ublas::vector> unk;
-	unk.SetData(iDatSize, vecX.data(), vecY.data(), vecYErr.data());
-	unk.SetMaxCalls(iMaxCalls);
+	std::vector<std::shared_ptr<FitterFuncModel<t_real>>> vecMods;
+	std::vector<typename UnkindnessPar<t_real>::t_func> vecChi2;
+	for(unsigned int iThread=0; iThread<std::max(iNumThreads, 1u); ++iThread)
+	{
+		std::shared_ptr<FitterFuncModel<t_real>> pMod(mod.copy());
+		vecMods.push_back(pMod);
+
+		vecChi2.push_back([pMod, iDatSize, &vecX, &vecY, &vecYErr](const std::vector<t_real>& vecParams) -> t_real
+		{
+			pMod->SetParams(vecParams);
+			auto fkt = [&pMod](t_real x) -> t_real { return (*pMod)(x); };
+			return chi2<t_real, decltype(fkt), const t_real*>(
+				fkt, iDatSize, vecX.data(), vecY.data(), vecYErr.data());
+		});
+	}
+
+	tl::UnkindnessPar<t_real> unk;
+	unk.SetFuncs(vecChi2);
+	unk.SetMaxGenerations(iMaxCalls);
 	unk.SetMaxBestIters(iMaxBestIters);
-	unk.Init(iNumRavens, &mod, vecMin, vecMax);
+	unk.Init(iNumRavens, std::vector<t_real>(vecMin.begin(), vecMin.end()),
+		std::vector<t_real>(vecMax.begin(), vecMax.end()));
 	unk.Run();
 
 	const auto& vecBest = unk.GetBestPos();
@@ -322,12 +583,13 @@ bool swarmfit(t_func&& func,
 		for(std::size_t iParam=0; iParam<vecBest.size(); ++iParam)
 			ostrRes << vecParamNames[iParam] << " = " << vecVals[iParam] << ", ";
 
-		tl::log_debug("Swarm fit: valid = ", unk.IsBestPosValid(),
+		tl::log_debug("Swarm fit: valid = ", unk.IsConverged(),
 			", in_range = ", bInRange,
 			", result: ", ostrRes.str());
 	}
 
-	return unk.IsBestPosValid() /*&& bInRange*/;
+	// as in Unkindness, the result is invalid if the maximum number of generations was reached
+	return unk.IsConverged() /*&& bInRange*/;
 }
 // -----------------------------------------------------------------------------
 
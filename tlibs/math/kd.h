@@ -35,6 +35,7 @@
 #include <list>
 #include <algorithm>
 #include <iostream>
+#include <atomic>
 
 namespace tl {
 
@@ -80,10 +81,11 @@ class Kd
 {
 private:
 	static KdNode<T>* make_kd(std::list<std::vector<T>>& lstPoints,
-		int &iDim, unsigned int iLevel=0)
+		int &iDim, unsigned int iLevel=0, const std::atomic<bool>* pStop=nullptr)
 	{
 		const unsigned int iSize = lstPoints.size();
 		if(iSize == 0) return nullptr;
+		if(pStop && pStop->load()) return nullptr;
 
 		if(iDim < 0)
 			iDim = lstPoints.begin()->size();
@@ -109,8 +111,8 @@ private:
 		std::list<std::vector<T>> lstLeft(lstPoints.begin(), iterMid);
 		std::list<std::vector<T>> lstRight(std::next(iterMid), lstPoints.end());
 
-		pNode->pLeft = make_kd(lstLeft, iDim, iLevel+1);
-		pNode->pRight = make_kd(lstRight, iDim, iLevel+1);
+		pNode->pLeft = make_kd(lstLeft, iDim, iLevel+1, pStop);
+		pNode->pRight = make_kd(lstRight, iDim, iLevel+1, pStop);
 
 		if(pNode->pLeft) pNode->pLeft->pParent = pNode;
 		if(pNode->pRight) pNode->pRight->pParent = pNode;
@@ -186,7 +188,9 @@ public:
 	}
 
 	// alters lstPoints!
-	void Load(std::list<std::vector<T>>& lstPoints, int iDim=-1)
+	// if the optional pStop flag gets set, the tree is left empty
+	void Load(std::list<std::vector<T>>& lstPoints, int iDim=-1,
+		const std::atomic<bool>* pStop=nullptr)
 	{
 		Unload();
 
@@ -216,8 +220,11 @@ public:
 			}
 		}
 
-		m_pNode = make_kd(lstPoints, iDim);
+		m_pNode = make_kd(lstPoints, iDim, 0, pStop);
 		m_iDim = unsigned(iDim);
+
+		if(pStop && pStop->load())
+			Unload();
 	}
 
 	const std::vector<T>& GetNearestNode(const std::vector<T>& vec) const
@@ -248,6 +255,9 @@ public:
 	~Kd() { Unload(); }
 
 	const KdNode<T>* GetRootNode() const { return m_pNode; }
+	unsigned int GetDim() const { return m_iDim; }
+	const std::vector<T>& GetMin() const { return m_vecMin; }
+	const std::vector<T>& GetMax() const { return m_vecMax; }
 };
 
 }
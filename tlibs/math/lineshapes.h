@@ -0,0 +1,164 @@
+/**
+ * batch evaluation of line shapes
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date 2026
+ * @license GPLv2 or GPLv3
+ *
+ * ----------------------------------------------------------------------------
+ * tlibs -- a physical-mathematical C++ template library
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2015-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef __TLIBS_LINESHAPES_H__
+#define __TLIBS_LINESHAPES_H__
+
+#include "math.h"
+#include "../phys/units.h"
+
+#include <cstddef>
+#include <cmath>
+
+
+/**
+ * the loops below have no branches or aliasing and are marked as vectorisable,
+ * whether SIMD instructions are used for exp() depends on the compiler flags
+ */
+#if defined(_OPENMP)
+	#define TL_SIMD_LOOP _Pragma("omp simd")
+#elif defined(__clang__)
+	#define TL_SIMD_LOOP _Pragma("clang loop vectorize(enable)")
+#elif defined(__GNUC__)
+	#define TL_SIMD_LOOP _Pragma("GCC ivdep")
+#else
+	#define TL_SIMD_LOOP
+#endif
+
+
+namespace tl {
+
+
+/**
+ * batch arguments are either constants or arrays with one value per element
+ */
+template<class T> inline T batch_arg(T val, std::size_t) { return val; }
+template<class T> inline T batch_arg(const T* arr, std::size_t i) { return arr[i]; }
+template<class T> inline T batch_arg(T* arr, std::size_t i) { return arr[i]; }
+
+
+/**
+ * normalised gaussian, see gauss_model()
+ */
+template<class T, class t_x0, class t_sig, class t_amp>
+void gauss_model_batch(std::size_t N, const T* x, t_x0 x0, t_sig sigma, t_amp amp, T* out)
+{
+	const T norm = T(1) / std::sqrt(T(2)*get_pi<T>());
+
+	TL_SIMD_LOOP
+	for(std::size_t i=0; i<N; ++i)
+	{
+		const T sig = batch_arg(sigma, i);
+		const T arg = (x[i] - batch_arg(x0, i)) / sig;
+		out[i] = batch_arg(amp, i) * norm / sig * std::exp(T(-0.5) * arg*arg);
+	}
+}
+
+
+/**
+ * lorentzian, see lorentz_model_amp()
+ */
+template<class T, class t_x0, class t_hwhm, class t_amp>
+void lorentz_model_amp_batch(std::size_t N, const T* x, t_x0 x0, t_hwhm hwhm, t_amp amp, T* out)
+{
+	TL_SIMD_LOOP
+	for(std::size_t i=0; i<N; ++i)
+	{
+		const T hw = batch_arg(hwhm, i);
+		const T dx = x[i] - batch_arg(x0, i);
+		out[i] = batch_arg(amp, i) * hw*hw / (dx*dx + hw*hw);
+	}
+}
+
+
+/**
+ * bose factor for energies E in meV and temperature T in K, see bose()
+ */
+template<class T>
+void bose_batch(std::size_t N, const T* E, T temp, T* out)
+{
+	const T kBT = get_kB<T>() * get_one_kelvin<T>()/get_one_meV<T>() * temp;
+
+	TL_SIMD_LOOP
+	for(std::size_t i=0; i<N; ++i)
+	{
+		const T n = T(1) / (std::exp(std::abs(E[i])/kBT) - T(1));
+		out[i] = n + T(E[i] >= T(0));
+	}
+}
+
+
+/**
+ * bose factor with a lower cutoff energy, see bose_cutoff()
+ */
+template<class T>
+void bose_cutoff_batch(std::size_t N, const T* E, T temp, T E_cutoff, T* out)
+{
+	const T kBT = get_kB<T>() * get_one_kelvin<T>()/get_one_meV<T>() * temp;
+	E_cutoff = std::abs(E_cutoff);
+
+	TL_SIMD_LOOP
+	for(std::size_t i=0; i<N; ++i)
+	{
+		// energies below the cutoff are replaced by sign(E)*E_cutoff, with sign(0) = +1
+		const T absE = std::max(std::abs(E[i]), E_cutoff);
+
+		const T n = T(1) / (std::exp(absE/kBT) - T(1));
+		out[i] = n + T(E[i] >= T(0));
+	}
+}
+
+
+/**
+ * absolute value of the damped harmonic oscillator including the bose factor, see DHO_model()
+ */
+template<class T, class t_E0, class t_hwhm, class t_amp>
+void DHO_model_batch(std::size_t N, const T* E, T temp, t_E0 E0, t_hwhm hwhm, t_amp amp, T* out)
+{
+	const T kBT = get_kB<T>() * get_one_kelvin<T>()/get_one_meV<T>() * temp;
+	const T pi = get_pi<T>();
+
+	TL_SIMD_LOOP
+	for(std::size_t i=0; i<N; ++i)
+	{
+		const T e = E[i];
+		const T e0 = batch_arg(E0, i);
+		const T hw = batch_arg(hwhm, i);
+
+		const T bose = T(1) / (std::exp(std::abs(e)/kBT) - T(1)) + T(e >= T(0));
+		const T em = e - e0, ep = e + e0;
+		const T dho = hw/(em*em + hw*hw) - hw/(ep*ep + hw*hw);
+
+		out[i] = std::abs(bose * batch_arg(amp, i) / (e0*pi) * dho);
+	}
+}
+
+
+}
+
+#endif
@@ -40,6 +40,7 @@
 #include <string>
 #include <list>
 #include <thread>
+#include <mutex>
 
 
 namespace tl {
@@ -69,9 +70,16 @@ protected:
 	ip::tcp::socket *m_psock = nullptr;
 	std::thread* m_pthread = nullptr;
 
+	// the connection can be closed by the service thread and by the caller
+	std::mutex m_mtxSock;
+
 	t_str m_strCmdDelim = "\n";
 	lf::queue<const t_str*, lf::fixed_sized<false>> m_listWriteBuffer;
 
+	// number of queued or not yet completed writes
+	mutable std::mutex m_mtxWrite;
+	std::size_t m_iNumPendingWrites = 0;
+
 	static constexpr const std::size_t m_iReadBufLen = 512;
 	t_ch m_pcReadBuffer[m_iReadBufLen];
 	t_str m_strReadBuffer;
@@ -98,6 +106,7 @@ public:
 	bool is_connected();
 
 	void write(const t_str& str);
+	bool is_write_pending() const;
 	void wait();
 
 protected:
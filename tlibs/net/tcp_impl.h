@@ -161,22 +161,42 @@ bool TcpTxtClient<t_ch, t_str>::connect(const t_str& strHost, const t_str& strSe
 template<class t_ch, class t_str>
 void TcpTxtClient<t_ch, t_str>::disconnect(bool bAlwaysSendSignal)
 {
+	std::unique_lock<std::mutex> lock(m_mtxSock, std::defer_lock);
+
+	// the service thread must not wait for a caller which is joining it
+	const bool bServiceThread = m_pthread && m_pthread->get_id() == std::this_thread::get_id();
+	if(bServiceThread)
+	{
+		if(!lock.try_lock())
+			return;
+	}
+	else
+	{
+		lock.lock();
+	}
+
 	const bool bConnected = is_connected();
 	if(bConnected)
 	{
-		m_psock->shutdown(ip::tcp::socket::shutdown_send);
+		// the peer might already have closed the connection
+		sys::error_code err;
+		m_psock->shutdown(ip::tcp::socket::shutdown_send, err);
 		m_pservice->stop();
-		m_psock->close();
+		m_psock->close(err);
 	}
 
-	if(m_psock) { delete m_psock; m_psock = 0; }
-	if(m_pthread)
+	// the service thread only closes the connection, the rest is freed by the caller
+	if(!bServiceThread)
 	{
-		m_pthread->join();
-		delete m_pthread;
-		m_pthread = 0;
+		if(m_psock) { delete m_psock; m_psock = 0; }
+		if(m_pthread)
+		{
+			m_pthread->join();
+			delete m_pthread;
+			m_pthread = 0;
+		}
+		if(m_pservice) { delete m_pservice; m_pservice = 0; }
 	}
-	if(m_pservice) { delete m_pservice; m_pservice = 0; }
 
 	if(bConnected || bAlwaysSendSignal)
 	{
@@ -185,11 +205,13 @@ void TcpTxtClient<t_ch, t_str>::disconnect(bool bAlwaysSendSignal)
 	}
 
 	// clean up write buffer
+	std::lock_guard<std::mutex> lockWrite(m_mtxWrite);
 	const t_str* pstr = nullptr;
 	while(m_listWriteBuffer.pop(pstr))
 	{
 		if(pstr) { delete pstr; pstr = nullptr; }
 	}
+	m_iNumPendingWrites = 0;
 }
 
 
@@ -221,7 +243,11 @@ void TcpTxtClient<t_ch, t_str>::write(const t_str& str)
 			return;
 		}
 
-		m_listWriteBuffer.push(new t_str(str));
+		{
+			std::lock_guard<std::mutex> lock(m_mtxWrite);
+			m_listWriteBuffer.push(new t_str(str));
+			++m_iNumPendingWrites;
+		}
 #if BOOST_VERSION >= 108700
 		boost::asio::post(*m_pservice, [&](){ flush_write(); });
 #else
@@ -235,12 +261,23 @@ void TcpTxtClient<t_ch, t_str>::write(const t_str& str)
 }
 
 
+template<class t_ch, class t_str>
+bool TcpTxtClient<t_ch, t_str>::is_write_pending() const
+{
+	std::lock_guard<std::mutex> lock(m_mtxWrite);
+	return m_iNumPendingWrites != 0;
+}
+
+
 template<class t_ch, class t_str>
 void TcpTxtClient<t_ch, t_str>::flush_write()
 {
 	const t_str* pstr = nullptr;
-	if(m_listWriteBuffer.empty()) return;
-	if(!m_listWriteBuffer.pop(pstr)) return;
+	{
+		std::lock_guard<std::mutex> lock(m_mtxWrite);
+		if(m_listWriteBuffer.empty()) return;
+		if(!m_listWriteBuffer.pop(pstr)) return;
+	}
 	if(!pstr) return;
 
 	asio::async_write(*m_psock, asio::buffer(pstr->data(), pstr->length()),
@@ -248,6 +285,12 @@ void TcpTxtClient<t_ch, t_str>::flush_write()
 	{
 		if(pstr) delete pstr;
 
+		{
+			std::lock_guard<std::mutex> lock(m_mtxWrite);
+			if(m_iNumPendingWrites)
+				--m_iNumPendingWrites;
+		}
+
 		if(err)
 		{
 			disconnect();
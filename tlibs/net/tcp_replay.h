@@ -0,0 +1,394 @@
+/**
+ * recording and replay of tcp text streams
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date 2026
+ * @license GPLv2 or GPLv3
+ *
+ * ----------------------------------------------------------------------------
+ * tlibs -- a physical-mathematical C++ template library
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2015-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef __TL_TCP_REPLAY_H__
+#define __TL_TCP_REPLAY_H__
+
+#include "tcp.h"
+#include "../log/log.h"
+#include "../string/string.h"
+#include "../time/chrono.h"
+
+#include <fstream>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+
+
+namespace tl {
+
+
+/**
+ * writes the received messages of a tcp client to a file,
+ * one line per message: "<seconds since epoch>\t<message>"
+ */
+template<class t_ch=char, class t_str=std::basic_string<t_ch>>
+class TcpTxtRecorder
+{
+protected:
+	mutable std::mutex m_mtx;
+	std::basic_ofstream<t_ch> m_ofstr;
+	std::size_t m_iNumMsgs = 0;
+
+public:
+	TcpTxtRecorder() = default;
+	virtual ~TcpTxtRecorder() { stop(); }
+
+	TcpTxtRecorder(const TcpTxtRecorder&) = delete;
+	const TcpTxtRecorder& operator=(const TcpTxtRecorder&) = delete;
+
+	/**
+	 * starts writing to a new file, strComment is written to its header
+	 */
+	bool start(const std::string& strFile, const t_str& strComment = t_str())
+	{
+		std::lock_guard<std::mutex> lock(m_mtx);
+
+		if(m_ofstr.is_open())
+			m_ofstr.close();
+
+		m_ofstr.open(strFile);
+		if(!m_ofstr)
+		{
+			log_err("Cannot open stream recording file \"", strFile, "\".");
+			return false;
+		}
+
+		m_ofstr << std::fixed << std::setprecision(6);
+		m_ofstr << "# tcp text stream recording\n";
+		if(strComment.size())
+			m_ofstr << "# " << strComment << "\n";
+
+		m_iNumMsgs = 0;
+		return true;
+	}
+
+	void stop()
+	{
+		std::lock_guard<std::mutex> lock(m_mtx);
+
+		if(m_ofstr.is_open())
+		{
+			m_ofstr.flush();
+			m_ofstr.close();
+		}
+	}
+
+	bool is_recording() const
+	{
+		std::lock_guard<std::mutex> lock(m_mtx);
+		return m_ofstr.is_open();
+	}
+
+	std::size_t get_num_msgs() const
+	{
+		std::lock_guard<std::mutex> lock(m_mtx);
+		return m_iNumMsgs;
+	}
+
+	/**
+	 * write a message, does nothing if no recording is running
+	 */
+	void record(const t_str& strMsg)
+	{
+		const double dTime = epoch<double>();
+
+		std::lock_guard<std::mutex> lock(m_mtx);
+		if(!m_ofstr.is_open())
+			return;
+
+		m_ofstr << dTime << "\t" << strMsg << "\n";
+		++m_iNumMsgs;
+	}
+
+	/**
+	 * record all messages received by a client
+	 */
+	void attach(TcpTxtClient<t_ch, t_str>& client)
+	{
+		client.add_receiver([this](const t_str& strMsg) { record(strMsg); });
+	}
+};
+
+
+
+/**
+ * server playing back a stream recorded by TcpTxtRecorder to the connecting client
+ */
+template<class t_ch=char, class t_str=std::basic_string<t_ch>>
+class TcpTxtReplay : public TcpTxtServer<t_ch, t_str>
+{
+public:
+	// time stamp and message
+	using t_msg = std::pair<double, t_str>;
+	using t_clock = std::chrono::steady_clock;
+
+protected:
+	std::vector<t_msg> m_vecMsgs;
+
+	// playback speed, <= 0: as fast as possible
+	double m_dSpeed = 1.;
+	bool m_bLoop = false;
+
+	std::thread *m_pthPlay = nullptr;
+	std::mutex m_mtxPlay;
+	std::condition_variable m_cvPlay;
+	bool m_bStop = false, m_bPlaying = false, m_bStarted = false;
+
+	std::atomic<std::size_t> m_iNumSent{0};
+
+	// the connection can be closed by the service thread and by the caller
+	std::mutex m_mtxDisconn;
+
+	using t_sigPlaybackEnd = sig::signal<void(std::size_t iNumSent)>;
+	t_sigPlaybackEnd m_sigPlaybackEnd;
+
+protected:
+	/**
+	 * sleeps until the given time, returns false if the playback was stopped
+	 */
+	bool sleep_until(const t_clock::time_point& tp)
+	{
+		std::unique_lock<std::mutex> lock(m_mtxPlay);
+		return !m_cvPlay.wait_until(lock, tp, [this]() { return m_bStop; });
+	}
+
+	/**
+	 * the loop check also covers playbacks without sleeps (speed <= 0)
+	 */
+	bool is_stop_requested()
+	{
+		std::lock_guard<std::mutex> lock(m_mtxPlay);
+		return m_bStop;
+	}
+
+	void play()
+	{
+		const t_str& strDelim = this->m_strCmdDelim;
+		// an empty recording would make a looping playback spin
+		bool bStopped = m_vecMsgs.empty();
+
+		while(!bStopped)
+		{
+			if(!this->is_connected() || is_stop_requested())
+				break;
+
+			const t_clock::time_point tStart = t_clock::now();
+			const double dT0 = m_vecMsgs[0].first;
+
+			for(std::size_t iMsg=0; iMsg<m_vecMsgs.size();)
+			{
+				if(m_dSpeed > 0.)
+				{
+					auto tDue = tStart + std::chrono::duration_cast<t_clock::duration>(
+						std::chrono::duration<double>((m_vecMsgs[iMsg].first - dT0) / m_dSpeed));
+					if(!sleep_until(tDue))
+					{
+						bStopped = true;
+						break;
+					}
+				}
+
+				// send all messages which are due in one write
+				t_str strMsgs;
+				const t_clock::time_point tNow = t_clock::now();
+				std::size_t iNumMsgs = 0;
+				for(; iMsg<m_vecMsgs.size(); ++iMsg, ++iNumMsgs)
+				{
+					if(m_dSpeed > 0. && iNumMsgs)
+					{
+						auto tDue = tStart + std::chrono::duration_cast<t_clock::duration>(
+							std::chrono::duration<double>((m_vecMsgs[iMsg].first - dT0) / m_dSpeed));
+						if(tDue > tNow)
+							break;
+					}
+
+					strMsgs += m_vecMsgs[iMsg].second + strDelim;
+				}
+
+				if(!this->is_connected())
+				{
+					bStopped = true;
+					break;
+				}
+
+				this->write(strMsgs);
+				m_iNumSent += iNumMsgs;
+			}
+
+			if(!m_bLoop)
+				break;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mtxPlay);
+			m_bPlaying = false;
+		}
+		m_cvPlay.notify_all();
+
+		m_sigPlaybackEnd(m_iNumSent.load());
+	}
+
+	void start_playback()
+	{
+		stop_playback();
+
+		{
+			std::lock_guard<std::mutex> lock(m_mtxPlay);
+			m_bStop = false;
+			m_bPlaying = true;
+			m_bStarted = true;
+		}
+
+		m_iNumSent = 0;
+		m_pthPlay = new std::thread([this]() { play(); });
+	}
+
+	void stop_playback()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mtxPlay);
+			m_bStop = true;
+		}
+		m_cvPlay.notify_all();
+
+		if(m_pthPlay)
+		{
+			// might be called from the playback thread if the connection breaks
+			if(m_pthPlay->get_id() == std::this_thread::get_id())
+				m_pthPlay->detach();
+			else
+				m_pthPlay->join();
+
+			delete m_pthPlay;
+			m_pthPlay = nullptr;
+		}
+	}
+
+public:
+	TcpTxtReplay() : TcpTxtServer<t_ch, t_str>()
+	{
+		// start playing when a client connects
+		this->add_server_start([this](unsigned short) { start_playback(); });
+	}
+
+	virtual ~TcpTxtReplay()
+	{
+		disconnect();
+		m_sigPlaybackEnd.disconnect_all_slots();
+	}
+
+	virtual void disconnect(bool bAlwaysSendSignal = false) override
+	{
+		std::unique_lock<std::mutex> lock(m_mtxDisconn, std::defer_lock);
+
+		// the service thread must not wait for a caller which is joining it
+		if(this->m_pthread && this->m_pthread->get_id() == std::this_thread::get_id())
+		{
+			if(!lock.try_lock())
+				return;
+		}
+		else
+		{
+			lock.lock();
+		}
+
+		stop_playback();
+		TcpTxtServer<t_ch, t_str>::disconnect(bAlwaysSendSignal);
+	}
+
+	/**
+	 * loads a stream recorded by TcpTxtRecorder
+	 */
+	bool load(const std::string& strFile)
+	{
+		std::basic_ifstream<t_ch> ifstr(strFile);
+		if(!ifstr)
+		{
+			log_err("Cannot open stream recording file \"", strFile, "\".");
+			return false;
+		}
+
+		m_vecMsgs.clear();
+
+		t_str strLine;
+		while(std::getline(ifstr, strLine))
+		{
+			if(strLine.size() == 0 || strLine[0] == '#')
+				continue;
+
+			std::size_t iTab = strLine.find('\t');
+			if(iTab == t_str::npos)
+			{
+				log_warn("Invalid line in stream recording: \"", strLine, "\".");
+				continue;
+			}
+
+			double dTime = str_to_var<double, t_str>(strLine.substr(0, iTab));
+			m_vecMsgs.emplace_back(std::make_pair(dTime, strLine.substr(iTab+1)));
+		}
+
+		return true;
+	}
+
+	void set_messages(const std::vector<t_msg>& vecMsgs) { m_vecMsgs = vecMsgs; }
+	const std::vector<t_msg>& get_messages() const { return m_vecMsgs; }
+
+	// must be set before the client connects
+	void set_speed(double dSpeed) { m_dSpeed = dSpeed; }
+	void set_loop(bool bLoop) { m_bLoop = bLoop; }
+
+	std::size_t get_num_sent() const { return m_iNumSent.load(); }
+
+	/**
+	 * waits until a client has connected and the playback has finished
+	 */
+	void wait_playback()
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mtxPlay);
+			m_cvPlay.wait(lock, [this]() { return m_bStarted && !m_bPlaying; });
+		}
+
+		// let the remaining messages be written
+		while(this->is_connected() && this->is_write_pending())
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	void add_playback_end(const typename t_sigPlaybackEnd::slot_type& conn)
+	{
+		m_sigPlaybackEnd.connect(conn);
+	}
+};
+
+}
+
+#endif
@@ -34,7 +34,14 @@
 #include "../math/linalg_ops.h"
 #include "../math/rt.h"
 #include "lattice.h"
+#include "../helper/thread.h"
 #include <tuple>
+#include <array>
+#include <map>
+#include <unordered_map>
+#include <cstdint>
+#include <atomic>
+#include <algorithm>
 
 
 namespace tl{
@@ -388,6 +395,534 @@ std::complex<T> structfact(const t_cont<t_vec>& lstAtoms, const t_vec& vecG,
 }
 
 
+/**
+ * batch calculation of structure factors for many integer reflections
+ *
+ * The atoms are stored as a structure of arrays in fractional coordinates.
+ * Instead of evaluating sin and cos for every atom and reflection, the phase
+ * factors exp(2 pi i h x) are tabulated per Miller index and atom, so that
+ * every reflection only needs a few complex multiplications per atom.
+ * Symmetry-equivalent reflections and Friedel pairs are only calculated once.
+ *
+ * @see (Shirane 2002), p. 25, equ. 2.26
+ */
+template<class T = double>
+class StructFactBatch
+{
+public:
+	using t_cplx = std::complex<T>;
+	using t_hkl = std::array<int, 3>;
+
+protected:
+	// fractional atom positions
+	std::vector<T> m_vecX, m_vecY, m_vecZ;
+
+	// real and imaginary parts of the scattering lengths
+	std::vector<T> m_vecBRe, m_vecBIm;
+
+	// only real scattering lengths: F(-G) = F(G)^*
+	bool m_bFriedel = true;
+
+	// symmetry operations, x' = R x + t: transposed rotations and translations
+	std::vector<std::array<int, 9>> m_vecRotT;
+	std::vector<std::array<T, 3>> m_vecTrans;
+
+	unsigned int m_iNumThreads = 0;
+	std::size_t m_iChunkSize = 64;
+
+	// phase factor table for one direction: [index+iMax][atom]
+	struct PhaseTab
+	{
+		int iMax = 0;
+		std::vector<T> vecRe, vecIm;
+	};
+
+	// reflection -> unique reflection
+	struct SymRef
+	{
+		std::size_t iUnique = 0;
+		t_cplx cPhase = t_cplx(1, 0);
+		bool bConj = false;
+	};
+
+
+protected:
+	PhaseTab MakePhaseTab(const std::vector<T>& vecPos, int iMax) const
+	{
+		const std::size_t iNumAtoms = vecPos.size();
+
+		PhaseTab tab;
+		tab.iMax = iMax;
+		tab.vecRe.resize((2*iMax+1) * iNumAtoms);
+		tab.vecIm.resize((2*iMax+1) * iNumAtoms);
+
+		for(int h=-iMax; h<=iMax; ++h)
+		{
+			T *pRe = tab.vecRe.data() + (h+iMax)*iNumAtoms;
+			T *pIm = tab.vecIm.data() + (h+iMax)*iNumAtoms;
+
+			for(std::size_t iAtom=0; iAtom<iNumAtoms; ++iAtom)
+			{
+				const T dPhase = T(2)*get_pi<T>() * T(h) * vecPos[iAtom];
+				pRe[iAtom] = std::cos(dPhase);
+				pIm[iAtom] = std::sin(dPhase);
+			}
+		}
+
+		return tab;
+	}
+
+
+	/**
+	 * sum over the atoms using the phase tables
+	 */
+	t_cplx CalcFromTabs(const t_hkl& hkl,
+		const PhaseTab& tabX, const PhaseTab& tabY, const PhaseTab& tabZ) const
+	{
+		const std::size_t N = m_vecX.size();
+		const T *xr = tabX.vecRe.data() + (hkl[0]+tabX.iMax)*N;
+		const T *xi = tabX.vecIm.data() + (hkl[0]+tabX.iMax)*N;
+		const T *yr = tabY.vecRe.data() + (hkl[1]+tabY.iMax)*N;
+		const T *yi = tabY.vecIm.data() + (hkl[1]+tabY.iMax)*N;
+		const T *zr = tabZ.vecRe.data() + (hkl[2]+tabZ.iMax)*N;
+		const T *zi = tabZ.vecIm.data() + (hkl[2]+tabZ.iMax)*N;
+		const T *br = m_vecBRe.data();
+		const T *bi = m_vecBIm.data();
+
+		// independent partial sums, so that the loop can be vectorised
+		constexpr std::size_t LANES = 4;
+		T sumRe[LANES] = { 0, 0, 0, 0 };
+		T sumIm[LANES] = { 0, 0, 0, 0 };
+
+		auto term = [=](std::size_t j, T& re, T& im)
+		{
+			const T pr = xr[j]*yr[j] - xi[j]*yi[j];
+			const T pi = xr[j]*yi[j] + xi[j]*yr[j];
+			const T qr = pr*zr[j] - pi*zi[j];
+			const T qi = pr*zi[j] + pi*zr[j];
+			re += br[j]*qr - bi[j]*qi;
+			im += br[j]*qi + bi[j]*qr;
+		};
+
+		std::size_t j = 0;
+		for(; j+LANES <= N; j += LANES)
+			for(std::size_t iLane=0; iLane<LANES; ++iLane)
+				term(j+iLane, sumRe[iLane], sumIm[iLane]);
+		for(; j<N; ++j)
+			term(j, sumRe[0], sumIm[0]);
+
+		return t_cplx(sumRe[0]+sumRe[1]+sumRe[2]+sumRe[3],
+			sumIm[0]+sumIm[1]+sumIm[2]+sumIm[3]);
+	}
+
+
+	/**
+	 * find the representative of the reflection's symmetry orbit,
+	 * F(G) = exp(2 pi i G*t) F(R^T G)
+	 */
+	std::pair<t_hkl, SymRef> GetUnique(const t_hkl& hkl) const
+	{
+		t_hkl hklRep = hkl;
+		SymRef ref;
+
+		auto check = [&](const t_hkl& hklNew, std::size_t iOp, bool bConj)
+		{
+			if(!(hklRep < hklNew))
+				return;
+
+			hklRep = hklNew;
+			ref.bConj = bConj;
+			ref.cPhase = t_cplx(1, 0);
+
+			if(iOp < m_vecTrans.size())
+			{
+				const std::array<T, 3>& t = m_vecTrans[iOp];
+				const T dPhase = T(2)*get_pi<T>() *
+					(T(hkl[0])*t[0] + T(hkl[1])*t[1] + T(hkl[2])*t[2]);
+				ref.cPhase = std::polar(T(1), dPhase);
+			}
+		};
+
+		const std::size_t iNoOp = std::size_t(-1);
+		if(m_bFriedel)
+			check(t_hkl{{ -hkl[0], -hkl[1], -hkl[2] }}, iNoOp, true);
+
+		for(std::size_t iOp=0; iOp<m_vecRotT.size(); ++iOp)
+		{
+			const std::array<int, 9>& R = m_vecRotT[iOp];
+			t_hkl hklNew;
+			for(int i=0; i<3; ++i)
+				hklNew[i] = R[i*3+0]*hkl[0] + R[i*3+1]*hkl[1] + R[i*3+2]*hkl[2];
+
+			check(hklNew, iOp, false);
+			if(m_bFriedel)
+				check(t_hkl{{ -hklNew[0], -hklNew[1], -hklNew[2] }}, iOp, true);
+		}
+
+		return std::make_pair(hklRep, ref);
+	}
+
+
+	/**
+	 * is the atom set invariant under x' = R x + t?
+	 */
+	bool IsInvariant(const std::array<int, 9>& RT, const std::array<T, 3>& t, T eps) const
+	{
+		const std::size_t iNumAtoms = m_vecX.size();
+
+		// look-up grid for atom positions folded into the unit cell
+		const T dGrid = T(1024);
+		auto get_key = [dGrid](T x, T y, T z) -> std::int64_t
+		{
+			const std::int64_t iGrid = std::int64_t(dGrid);
+			auto fold = [dGrid, iGrid](T d) -> std::int64_t
+			{
+				std::int64_t i = std::int64_t(std::llround(d*dGrid)) % iGrid;
+				return i < 0 ? i + iGrid : i;
+			};
+			return (fold(x)*iGrid + fold(y))*iGrid + fold(z);
+		};
+
+		std::unordered_multimap<std::int64_t, std::size_t> mapPos;
+		for(std::size_t iAtom=0; iAtom<iNumAtoms; ++iAtom)
+			mapPos.emplace(get_key(m_vecX[iAtom], m_vecY[iAtom], m_vecZ[iAtom]), iAtom);
+
+		auto same_atom = [this, eps](std::size_t iAtom, T x, T y, T z, std::size_t iOther) -> bool
+		{
+			const T dx = x - m_vecX[iOther], dy = y - m_vecY[iOther], dz = z - m_vecZ[iOther];
+			return std::abs(dx - std::round(dx)) < eps &&
+				std::abs(dy - std::round(dy)) < eps &&
+				std::abs(dz - std::round(dz)) < eps &&
+				std::abs(m_vecBRe[iAtom] - m_vecBRe[iOther]) < eps &&
+				std::abs(m_vecBIm[iAtom] - m_vecBIm[iOther]) < eps;
+		};
+
+		for(std::size_t iAtom=0; iAtom<iNumAtoms; ++iAtom)
+		{
+			const T pos[3] = { m_vecX[iAtom], m_vecY[iAtom], m_vecZ[iAtom] };
+			T posNew[3];
+			for(int i=0; i<3; ++i)
+				posNew[i] = RT[0*3+i]*pos[0] + RT[1*3+i]*pos[1] + RT[2*3+i]*pos[2] + t[i];
+
+			bool bFound = false;
+			auto range = mapPos.equal_range(get_key(posNew[0], posNew[1], posNew[2]));
+			for(auto iter=range.first; iter!=range.second && !bFound; ++iter)
+				bFound = same_atom(iAtom, posNew[0], posNew[1], posNew[2], iter->second);
+
+			// position lies at a grid boundary: fall back to a full search
+			for(std::size_t iOther=0; iOther<iNumAtoms && !bFound; ++iOther)
+				bFound = same_atom(iAtom, posNew[0], posNew[1], posNew[2], iOther);
+
+			if(!bFound)
+				return false;
+		}
+
+		return true;
+	}
+
+
+public:
+	/**
+	 * @param vecAtomsFrac atom positions in fractional coordinates
+	 * @param vecB scattering lengths; if only one is given, it is used for all atoms
+	 */
+	template<class t_vec, template<class...> class t_cont = std::vector>
+	StructFactBatch(const t_cont<t_vec>& vecAtomsFrac, const t_cont<t_cplx>& vecB)
+	{
+		const std::size_t iNumAtoms = vecAtomsFrac.size();
+		m_vecX.reserve(iNumAtoms); m_vecY.reserve(iNumAtoms); m_vecZ.reserve(iNumAtoms);
+		m_vecBRe.reserve(iNumAtoms); m_vecBIm.reserve(iNumAtoms);
+
+		auto iterB = vecB.begin();
+		for(const t_vec& vecAtom : vecAtomsFrac)
+		{
+			m_vecX.push_back(vecAtom[0]);
+			m_vecY.push_back(vecAtom[1]);
+			m_vecZ.push_back(vecAtom[2]);
+
+			t_cplx b = T(1);
+			if(iterB != vecB.end())
+				b = *iterB;
+			m_vecBRe.push_back(b.real());
+			m_vecBIm.push_back(b.imag());
+
+			if(!float_equal<T>(b.imag(), T(0)))
+				m_bFriedel = false;
+
+			// if there is only one scattering length in the list, use it for all positions
+			if(iterB!=vecB.end() && std::next(iterB)!=vecB.end())
+				++iterB;
+		}
+	}
+
+	StructFactBatch() = default;
+	~StructFactBatch() = default;
+
+
+	/**
+	 * set the symmetry operations in fractional coordinates
+	 * (homogeneous 4x4 matrices, as used by generate_atoms)
+	 * @return false if the atom set is not invariant under the operations,
+	 *         in this case the symmetry is not used
+	 */
+	template<class t_mat, template<class...> class t_cont = std::vector>
+	bool SetSymOps(const t_cont<t_mat>& vecOps, T eps = T(1e-4))
+	{
+		m_vecRotT.clear();
+		m_vecTrans.clear();
+
+		std::vector<std::array<int, 9>> vecRotT;
+		std::vector<std::array<T, 3>> vecTrans;
+
+		for(const t_mat& mat : vecOps)
+		{
+			if(mat.size1() < 3 || mat.size2() < 3)
+				return false;
+
+			std::array<int, 9> RT;
+			std::array<T, 3> t{{ 0, 0, 0 }};
+			bool bIdentity = true;
+
+			for(int i=0; i<3; ++i)
+			{
+				for(int j=0; j<3; ++j)
+				{
+					const T d = mat(i, j);
+					const T dRound = std::round(d);
+					if(!float_equal<T>(d, dRound, eps))
+						return false;
+					RT[j*3+i] = int(dRound);
+
+					if(RT[j*3+i] != (i==j ? 1 : 0))
+						bIdentity = false;
+				}
+
+				if(mat.size2() > 3)
+					t[i] = mat(i, 3);
+			}
+
+			// pure translations do not relate different reflections
+			if(bIdentity)
+				continue;
+
+			if(!IsInvariant(RT, t, eps))
+			{
+				log_warn("Atom positions are not invariant under the symmetry operations,",
+					" not using symmetry for structure factors.");
+				return false;
+			}
+
+			vecRotT.push_back(RT);
+			vecTrans.push_back(t);
+		}
+
+		m_vecRotT = std::move(vecRotT);
+		m_vecTrans = std::move(vecTrans);
+		return true;
+	}
+
+
+	/**
+	 * number of threads for batch calculations (0: calculate in the calling thread)
+	 */
+	void SetNumThreads(unsigned int iNumThreads) { m_iNumThreads = iNumThreads; }
+
+	std::size_t GetNumAtoms() const { return m_vecX.size(); }
+
+
+	/**
+	 * structure factor of a single (possibly non-integer) reflection
+	 */
+	t_cplx Calc(T h, T k, T l) const
+	{
+		const std::size_t N = m_vecX.size();
+		T dRe = 0, dIm = 0;
+
+		for(std::size_t j=0; j<N; ++j)
+		{
+			const T dPhase = T(2)*get_pi<T>() * (h*m_vecX[j] + k*m_vecY[j] + l*m_vecZ[j]);
+			const T c = std::cos(dPhase), s = std::sin(dPhase);
+			dRe += m_vecBRe[j]*c - m_vecBIm[j]*s;
+			dIm += m_vecBRe[j]*s + m_vecBIm[j]*c;
+		}
+
+		return t_cplx(dRe, dIm);
+	}
+
+
+	/**
+	 * structure factors of many integer reflections
+	 * @param pStop optional flag to cancel the calculation, an empty vector is returned in this case
+	 */
+	std::vector<t_cplx> Calc(const std::vector<t_hkl>& vecHKL,
+		const std::atomic<bool>* pStop = nullptr) const
+	{
+		auto is_stopped = [pStop]() -> bool { return pStop && pStop->load(); };
+
+		// map the reflections to the unique ones
+		std::vector<t_hkl> vecUnique;
+		std::vector<SymRef> vecRefs;
+		vecRefs.reserve(vecHKL.size());
+		std::map<t_hkl, std::size_t> mapUnique;
+
+		int iMax[3] = { 0, 0, 0 };
+		for(const t_hkl& hkl : vecHKL)
+		{
+			if(vecRefs.size() % 4096 == 0 && is_stopped())
+				return std::vector<t_cplx>();
+
+			std::pair<t_hkl, SymRef> pairRep = GetUnique(hkl);
+
+			auto iter = mapUnique.find(pairRep.first);
+			if(iter == mapUnique.end())
+			{
+				iter = mapUnique.emplace(pairRep.first, vecUnique.size()).first;
+				vecUnique.push_back(pairRep.first);
+
+				for(int i=0; i<3; ++i)
+					iMax[i] = std::max(iMax[i], std::abs(pairRep.first[i]));
+			}
+
+			pairRep.second.iUnique = iter->second;
+			vecRefs.push_back(pairRep.second);
+		}
+
+
+		// calculate the unique reflections
+		const PhaseTab tabX = MakePhaseTab(m_vecX, iMax[0]);
+		const PhaseTab tabY = MakePhaseTab(m_vecY, iMax[1]);
+		const PhaseTab tabZ = MakePhaseTab(m_vecZ, iMax[2]);
+
+		std::vector<t_cplx> vecFUnique(vecUnique.size());
+		auto calc_chunk = [&](std::size_t iStart, std::size_t iEnd)
+		{
+			if(is_stopped())
+				return;
+
+			for(std::size_t i=iStart; i<iEnd; ++i)
+				vecFUnique[i] = CalcFromTabs(vecUnique[i], tabX, tabY, tabZ);
+		};
+
+		if(m_iNumThreads > 1 && vecUnique.size() > m_iChunkSize)
+		{
+			ThreadPool<void()> tp(m_iNumThreads);
+			for(std::size_t iStart=0; iStart<vecUnique.size(); iStart+=m_iChunkSize)
+			{
+				const std::size_t iEnd = std::min(iStart+m_iChunkSize, vecUnique.size());
+				tp.AddTask([&calc_chunk, iStart, iEnd]() { calc_chunk(iStart, iEnd); });
+			}
+
+			tp.Start();
+			for(auto& fut : tp.GetResults())
+				fut.get();
+		}
+		else
+		{
+			for(std::size_t iStart=0; iStart<vecUnique.size(); iStart+=m_iChunkSize)
+				calc_chunk(iStart, std::min(iStart+m_iChunkSize, vecUnique.size()));
+		}
+
+		if(is_stopped())
+			return std::vector<t_cplx>();
+
+
+		// expand to all requested reflections
+		std::vector<t_cplx> vecF;
+		vecF.reserve(vecHKL.size());
+		for(const SymRef& ref : vecRefs)
+		{
+			t_cplx F = vecFUnique[ref.iUnique];
+			if(ref.bConj)
+				F = std::conj(F);
+			vecF.push_back(ref.cPhase * F);
+		}
+
+		return vecF;
+	}
+};
+
+
+/**
+ * extracts the distinct integer rotation parts of symmetry operations
+ * in fractional coordinates (homogeneous 4x4 or 3x3 matrices)
+ * @param bTranspose return R^T, which acts on Miller indices
+ * @return row-major 3x3 rotations, empty if an operation has a non-integer rotation part
+ */
+template<class t_mat, class T = typename t_mat::value_type,
+	template<class...> class t_cont = std::vector>
+std::vector<std::array<int, 9>> get_symop_rotations(const t_cont<t_mat>& vecOps,
+	bool bTranspose = false, T eps = T(1e-4))
+{
+	std::vector<std::array<int, 9>> vecRots;
+
+	for(const t_mat& mat : vecOps)
+	{
+		if(mat.size1() < 3 || mat.size2() < 3)
+			return std::vector<std::array<int, 9>>();
+
+		std::array<int, 9> R;
+		for(int i=0; i<3; ++i)
+		{
+			for(int j=0; j<3; ++j)
+			{
+				const T d = mat(i, j);
+				const T dRound = std::round(d);
+				if(!float_equal<T>(d, dRound, eps))
+					return std::vector<std::array<int, 9>>();
+
+				if(bTranspose)
+					R[j*3+i] = int(dRound);
+				else
+					R[i*3+j] = int(dRound);
+			}
+		}
+
+		// operations only differing in their translations have the same rotation
+		if(std::find(vecRots.begin(), vecRots.end(), R) == vecRots.end())
+			vecRots.push_back(R);
+	}
+
+	return vecRots;
+}
+
+
+/**
+ * distinct images of a vector under the given integer rotations,
+ * e.g. the domain-equivalent directions
+ */
+template<class T = double>
+std::vector<std::array<T, 3>> get_equivalent_vecs(const std::vector<std::array<int, 9>>& vecRots,
+	const std::array<T, 3>& vec, T eps = T(1e-6))
+{
+	std::vector<std::array<T, 3>> vecEquiv;
+	vecEquiv.reserve(vecRots.size());
+
+	for(const std::array<int, 9>& R : vecRots)
+	{
+		std::array<T, 3> vecNew;
+		for(int i=0; i<3; ++i)
+			vecNew[i] = T(R[i*3+0])*vec[0] + T(R[i*3+1])*vec[1] + T(R[i*3+2])*vec[2];
+
+		bool bHasVec = false;
+		for(const std::array<T, 3>& vecOther : vecEquiv)
+		{
+			if(float_equal<T>(vecOther[0], vecNew[0], eps) &&
+				float_equal<T>(vecOther[1], vecNew[1], eps) &&
+				float_equal<T>(vecOther[2], vecNew[2], eps))
+			{
+				bHasVec = true;
+				break;
+			}
+		}
+
+		if(!bHasVec)
+			vecEquiv.push_back(vecNew);
+	}
+
+	return vecEquiv;
+}
+
+
 /**
  * Lorentz factor
  * @param twotheta Scattering angle in rad
@@ -37,6 +37,12 @@
 #include "../phys/nn.h"
 #include "../log/log.h"
 #include <vector>
+#include <array>
+#include <list>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <numeric>
 
 namespace tl {
 
@@ -102,6 +108,9 @@ class Brillouin3D
 		std::vector<std::vector<t_vec<T>>> m_vecPolys;
 		std::vector<Plane<T>> m_vecPlanes;
 
+		// neighbour vectors (relative to the central reflex) belonging to the planes
+		std::vector<t_vec<T>> m_vecPlaneNeighbours;
+
 		bool m_bValid = 1;
 		bool m_bHasCentralPeak = 0;
 
@@ -109,6 +118,284 @@ class Brillouin3D
 		std::size_t m_iMaxNN = 4;
 
 
+	protected:
+		using t_vec3 = std::array<T, 3>;
+
+		/**
+		 * face of a convex polyhedron with its vertices in order
+		 */
+		struct VoronoiFace
+		{
+			std::ptrdiff_t iNeighbour = -1;		// -1: face of the bounding box
+			std::vector<t_vec3> vecVerts;
+		};
+
+		/**
+		 * cell relative to the central reflex, cached for re-use
+		 */
+		struct VoronoiCell
+		{
+			std::vector<T> vecKey;
+			bool bValid = 0;
+			std::vector<t_vec<T>> vecVertices;
+			std::vector<std::vector<t_vec<T>>> vecPolys;
+			std::vector<t_vec<T>> vecNeighbours;
+		};
+
+		static T dot3(const t_vec3& vec1, const t_vec3& vec2)
+		{
+			return vec1[0]*vec2[0] + vec1[1]*vec2[1] + vec1[2]*vec2[2];
+		}
+
+		static t_vec3 lerp3(const t_vec3& vec1, const t_vec3& vec2, T t)
+		{
+			return t_vec3{{ vec1[0] + t*(vec2[0]-vec1[0]),
+				vec1[1] + t*(vec2[1]-vec1[1]), vec1[2] + t*(vec2[2]-vec1[2]) }};
+		}
+
+		static t_vec<T> to_vec(const t_vec3& vec)
+		{
+			return make_vec<t_vec<T>>({ vec[0], vec[1], vec[2] });
+		}
+
+		/**
+		 * clips the polyhedron by the half-space vec*vecNorm <= d
+		 * @return false if the plane does not cut the polyhedron
+		 */
+		static bool clip_polyhedron(std::vector<VoronoiFace>& vecFaces,
+			const t_vec3& vecNorm, T d, std::ptrdiff_t iNeighbour, T eps)
+		{
+			// is the plane cutting the polyhedron at all?
+			bool bCuts = 0;
+			for(const VoronoiFace& face : vecFaces)
+			{
+				for(const t_vec3& vec : face.vecVerts)
+				{
+					if(dot3(vec, vecNorm) - d > eps)
+					{
+						bCuts = 1;
+						break;
+					}
+				}
+				if(bCuts) break;
+			}
+			if(!bCuts)
+				return false;
+
+			std::vector<VoronoiFace> vecNewFaces;
+			vecNewFaces.reserve(vecFaces.size() + 1);
+			std::vector<t_vec3> vecCap;
+
+			// clip the faces' polygons (Sutherland-Hodgman)
+			for(VoronoiFace& face : vecFaces)
+			{
+				VoronoiFace newface;
+				newface.iNeighbour = face.iNeighbour;
+
+				const std::size_t N = face.vecVerts.size();
+				for(std::size_t iVert=0; iVert<N; ++iVert)
+				{
+					const t_vec3& vec1 = face.vecVerts[iVert];
+					const t_vec3& vec2 = face.vecVerts[(iVert+1) % N];
+					const T d1 = dot3(vec1, vecNorm) - d;
+					const T d2 = dot3(vec2, vecNorm) - d;
+
+					if(d1 <= eps)
+					{
+						newface.vecVerts.push_back(vec1);
+						if(d1 >= -eps)
+							vecCap.push_back(vec1);
+					}
+
+					// edge crossing the plane
+					if((d1 < -eps && d2 > eps) || (d1 > eps && d2 < -eps))
+					{
+						t_vec3 vecCut = lerp3(vec1, vec2, d1 / (d1 - d2));
+						newface.vecVerts.push_back(vecCut);
+						vecCap.push_back(vecCut);
+					}
+				}
+
+				if(newface.vecVerts.size() >= 3)
+					vecNewFaces.emplace_back(std::move(newface));
+			}
+
+			// remove duplicate cap vertices
+			std::vector<t_vec3> vecCapUnique;
+			for(const t_vec3& vec : vecCap)
+			{
+				bool bDuplicate = std::any_of(vecCapUnique.begin(), vecCapUnique.end(),
+					[&vec, eps](const t_vec3& vecOther) -> bool
+					{
+						return std::abs(vec[0]-vecOther[0]) <= eps &&
+							std::abs(vec[1]-vecOther[1]) <= eps &&
+							std::abs(vec[2]-vecOther[2]) <= eps;
+					});
+				if(!bDuplicate)
+					vecCapUnique.push_back(vec);
+			}
+
+			// new face on the clipping plane, sorted by angle around its centre
+			if(vecCapUnique.size() >= 3)
+			{
+				t_vec3 vecMid{{ 0, 0, 0 }};
+				for(const t_vec3& vec : vecCapUnique)
+					for(int i=0; i<3; ++i)
+						vecMid[i] += vec[i] / T(vecCapUnique.size());
+
+				t_vec3 vecDir0{{ vecCapUnique[0][0]-vecMid[0],
+					vecCapUnique[0][1]-vecMid[1], vecCapUnique[0][2]-vecMid[2] }};
+				t_vec3 vecDir1{{ vecNorm[1]*vecDir0[2] - vecNorm[2]*vecDir0[1],
+					vecNorm[2]*vecDir0[0] - vecNorm[0]*vecDir0[2],
+					vecNorm[0]*vecDir0[1] - vecNorm[1]*vecDir0[0] }};
+
+				auto get_angle = [&vecMid, &vecDir0, &vecDir1](const t_vec3& vec) -> T
+				{
+					t_vec3 vecRel{{ vec[0]-vecMid[0], vec[1]-vecMid[1], vec[2]-vecMid[2] }};
+					return std::atan2(dot3(vecRel, vecDir1), dot3(vecRel, vecDir0));
+				};
+
+				std::sort(vecCapUnique.begin(), vecCapUnique.end(),
+					[&get_angle](const t_vec3& vec1, const t_vec3& vec2) -> bool
+					{
+						return get_angle(vec1) < get_angle(vec2);
+					});
+
+				VoronoiFace cap;
+				cap.iNeighbour = iNeighbour;
+				cap.vecVerts = std::move(vecCapUnique);
+				vecNewFaces.emplace_back(std::move(cap));
+			}
+
+			vecFaces = std::move(vecNewFaces);
+			return true;
+		}
+
+		/**
+		 * Voronoi cell of the origin with respect to the given neighbours
+		 */
+		static VoronoiCell calc_voronoi_cell(const std::vector<t_vec<T>>& vecNeighbours, T eps,
+			const std::atomic<bool>* pStop = nullptr)
+		{
+			VoronoiCell cell;
+
+			// neighbours sorted by distance
+			std::vector<std::size_t> vecIdx(vecNeighbours.size());
+			std::iota(vecIdx.begin(), vecIdx.end(), 0);
+			std::vector<T> vecLen(vecNeighbours.size());
+			for(std::size_t iN=0; iN<vecNeighbours.size(); ++iN)
+				vecLen[iN] = veclen(vecNeighbours[iN]);
+			std::stable_sort(vecIdx.begin(), vecIdx.end(),
+				[&vecLen](std::size_t iN1, std::size_t iN2) -> bool
+				{
+					return vecLen[iN1] < vecLen[iN2];
+				});
+			if(!vecIdx.size())
+				return cell;
+
+			// start with a bounding box
+			const T L = T(2) * vecLen[vecIdx.back()];
+			std::vector<VoronoiFace> vecFaces;
+			for(int iAxis=0; iAxis<3; ++iAxis)
+			{
+				for(T sign : { T(-1), T(1) })
+				{
+					// the other two axes in right-handed order
+					int iAxis1 = (iAxis+1) % 3, iAxis2 = (iAxis+2) % 3;
+					if(sign < T(0)) std::swap(iAxis1, iAxis2);
+
+					VoronoiFace face;
+					for(const std::array<T, 2>& corner : { std::array<T, 2>{{-1,-1}},
+						std::array<T, 2>{{1,-1}}, std::array<T, 2>{{1,1}}, std::array<T, 2>{{-1,1}} })
+					{
+						t_vec3 vec;
+						vec[iAxis] = sign*L;
+						vec[iAxis1] = corner[0]*L;
+						vec[iAxis2] = corner[1]*L;
+						face.vecVerts.push_back(vec);
+					}
+					vecFaces.emplace_back(std::move(face));
+				}
+			}
+
+			// clip with the middle perpendicular planes, nearest neighbours first
+			T tMaxRadSq = T(3)*L*L;
+			for(std::size_t iN : vecIdx)
+			{
+				if(pStop && pStop->load())
+				{
+					cell.bValid = 0;
+					return cell;
+				}
+
+				const T tLen = vecLen[iN];
+				if(tLen <= eps)
+					continue;
+
+				// further neighbours cannot cut the cell anymore
+				if(T(0.5)*tLen > std::sqrt(tMaxRadSq) + eps)
+					break;
+
+				const t_vec<T>& vecN = vecNeighbours[iN];
+				t_vec3 vecNorm{{ vecN[0]/tLen, vecN[1]/tLen, vecN[2]/tLen }};
+				if(!clip_polyhedron(vecFaces, vecNorm, T(0.5)*tLen, std::ptrdiff_t(iN), eps))
+					continue;
+
+				tMaxRadSq = T(0);
+				for(const VoronoiFace& face : vecFaces)
+					for(const t_vec3& vec : face.vecVerts)
+						tMaxRadSq = std::max(tMaxRadSq, dot3(vec, vec));
+			}
+
+			// faces of the bounding box remaining: not enough neighbours for a closed cell
+			cell.bValid = std::none_of(vecFaces.begin(), vecFaces.end(),
+				[](const VoronoiFace& face) -> bool { return face.iNeighbour < 0; });
+			if(!cell.bValid)
+				log_warn("Brillouin zone is not closed, more neighbours are needed.");
+
+			for(const VoronoiFace& face : vecFaces)
+			{
+				if(face.iNeighbour < 0)
+					continue;
+
+				std::vector<t_vec<T>> vecPoly;
+				vecPoly.reserve(face.vecVerts.size());
+				for(const t_vec3& vec : face.vecVerts)
+				{
+					t_vec<T> vecVert = to_vec(vec);
+					set_eps_0(vecVert);
+					vecPoly.emplace_back(std::move(vecVert));
+
+					// unique vertices
+					bool bDuplicate = std::any_of(cell.vecVertices.begin(), cell.vecVertices.end(),
+						[&vecPoly, eps](const t_vec<T>& vecOther) -> bool
+						{
+							return vec_equal(vecPoly.back(), vecOther, eps);
+						});
+					if(!bDuplicate)
+						cell.vecVertices.push_back(vecPoly.back());
+				}
+
+				cell.vecPolys.emplace_back(std::move(vecPoly));
+				cell.vecNeighbours.push_back(vecNeighbours[face.iNeighbour]);
+			}
+
+			return cell;
+		}
+
+		/**
+		 * cache of the most recently calculated cells
+		 */
+		static std::list<VoronoiCell>& get_cell_cache(std::mutex** ppMtx)
+		{
+			static std::mutex mtx;
+			static std::list<VoronoiCell> lstCells;
+
+			*ppMtx = &mtx;
+			return lstCells;
+		}
+
+
 	public:
 		Brillouin3D() = default;
 		~Brillouin3D() = default;
@@ -134,6 +421,7 @@ class Brillouin3D
 			m_vecVertices.clear();
 			m_vecPolys.clear();
 			m_vecPlanes.clear();
+			m_vecPlaneNeighbours.clear();
 			m_bValid = 0;
 			m_bHasCentralPeak = 0;
 		}
@@ -163,9 +451,182 @@ class Brillouin3D
 
 
 		/**
-		 * calculates the brillouin zone
+		 * calculates the brillouin zone as the Voronoi cell of the central reflex,
+		 * using the nearest neighbours first and skipping the ones too far away to contribute
+		 * @param pStop optional cancellation flag, the zone stays invalid if it is set
+		 */
+		void CalcBZ(unsigned int /*iThreads*/ = 4, const std::atomic<bool>* pStop = nullptr)
+		{
+			if(!m_bHasCentralPeak) return;
+
+			static constexpr std::size_t MAX_CACHED = 16;
+
+			// the cell only depends on the neighbours relative to the central reflex
+			std::vector<t_vec<T>> vecRelNeighbours;
+			vecRelNeighbours.reserve(m_vecNeighbours.size());
+
+			std::vector<T> vecKey;
+			vecKey.reserve(m_vecNeighbours.size()*3 + 1);
+			vecKey.push_back(m_eps);
+
+			for(const t_vec<T>& vecN : m_vecNeighbours)
+			{
+				vecRelNeighbours.emplace_back(vecN - m_vecCentralReflex);
+				vecKey.insert(vecKey.end(), vecRelNeighbours.back().begin(), vecRelNeighbours.back().end());
+			}
+
+			VoronoiCell cell;
+			bool bCached = 0;
+			{
+				std::mutex *pMtx = nullptr;
+				std::list<VoronoiCell>& lstCells = get_cell_cache(&pMtx);
+				std::lock_guard<std::mutex> lock(*pMtx);
+
+				auto iter = std::find_if(lstCells.begin(), lstCells.end(),
+					[&vecKey](const VoronoiCell& cell) -> bool { return cell.vecKey == vecKey; });
+				if(iter != lstCells.end())
+				{
+					cell = *iter;
+					lstCells.splice(lstCells.begin(), lstCells, iter);
+					bCached = 1;
+				}
+			}
+
+			if(!bCached)
+			{
+				cell = calc_voronoi_cell(vecRelNeighbours, m_eps, pStop);
+				if(pStop && pStop->load())
+				{
+					m_bValid = 0;
+					return;
+				}
+
+				// sort the vertices in the polygons
+				for(std::size_t iPoly=0; iPoly<cell.vecPolys.size(); ++iPoly)
+					sort_poly_verts_norm<t_vec<T>, std::vector, T>(cell.vecPolys[iPoly], cell.vecNeighbours[iPoly]);
+
+				cell.vecKey = std::move(vecKey);
+
+				std::mutex *pMtx = nullptr;
+				std::list<VoronoiCell>& lstCells = get_cell_cache(&pMtx);
+				std::lock_guard<std::mutex> lock(*pMtx);
+
+				lstCells.push_front(cell);
+				if(lstCells.size() > MAX_CACHED)
+					lstCells.pop_back();
+			}
+
+			// move the cell to the central reflex
+			m_vecVertices.clear();
+			m_vecPolys.clear();
+			m_vecPlanes.clear();
+			m_vecPlaneNeighbours.clear();
+
+			for(const t_vec<T>& vecVert : cell.vecVertices)
+				m_vecVertices.emplace_back(vecVert + m_vecCentralReflex);
+
+			for(std::size_t iPoly=0; iPoly<cell.vecPolys.size(); ++iPoly)
+			{
+				std::vector<t_vec<T>> vecPoly;
+				vecPoly.reserve(cell.vecPolys[iPoly].size());
+				for(const t_vec<T>& vecVert : cell.vecPolys[iPoly])
+					vecPoly.emplace_back(vecVert + m_vecCentralReflex);
+				m_vecPolys.emplace_back(std::move(vecPoly));
+
+				// middle perpendicular plane, normal pointing outside
+				const t_vec<T>& vecN = cell.vecNeighbours[iPoly];
+				m_vecPlanes.emplace_back(Plane<T>(m_vecCentralReflex + T(0.5)*vecN, vecN));
+				m_vecPlaneNeighbours.push_back(vecN);
+			}
+
+			m_bValid = cell.bValid;
+		}
+
+
+		/**
+		 * folds the given points back into the brillouin zone, i.e. subtracts the
+		 * lattice vectors of the nearest reflex
+		 * @param pvecG optionally receives the subtracted lattice vectors
+		 */
+		std::vector<t_vec<T>> FoldIntoBZ(const std::vector<t_vec<T>>& vecQ,
+			std::vector<t_vec<T>>* pvecG = nullptr, unsigned int iThreads = 4) const
+		{
+			std::vector<t_vec<T>> vecFolded(vecQ.size());
+			if(pvecG)
+				pvecG->resize(vecQ.size());
+
+			const std::size_t iNumNeighbours = m_vecPlaneNeighbours.size();
+			std::vector<T> vecLenSq(iNumNeighbours);
+			for(std::size_t iN=0; iN<iNumNeighbours; ++iN)
+				vecLenSq[iN] = inner(m_vecPlaneNeighbours[iN], m_vecPlaneNeighbours[iN]);
+
+			auto fold_range = [&](std::size_t iStart, std::size_t iEnd)
+			{
+				for(std::size_t iQ=iStart; iQ<iEnd; ++iQ)
+				{
+					t_vec<T> vecq = vecQ[iQ] - m_vecCentralReflex;
+					t_vec<T> vecG = zero_v<t_vec<T>>(3);
+
+					// subtract the neighbour whose plane is violated the most
+					// until the point lies inside all planes
+					for(std::size_t iIter=0; iIter<256 && iNumNeighbours; ++iIter)
+					{
+						T tBest = T(0);
+						std::size_t iBest = 0;
+
+						for(std::size_t iN=0; iN<iNumNeighbours; ++iN)
+						{
+							// number of multiples of the neighbour vector to subtract
+							T tMult = inner(vecq, m_vecPlaneNeighbours[iN]) / vecLenSq[iN];
+							if(tMult > tBest)
+							{
+								tBest = tMult;
+								iBest = iN;
+							}
+						}
+
+						if(tBest <= T(0.5) + m_eps)
+							break;
+
+						T tNum = std::max(T(1), std::floor(tBest + T(0.5)));
+						vecq -= tNum * m_vecPlaneNeighbours[iBest];
+						vecG += tNum * m_vecPlaneNeighbours[iBest];
+					}
+
+					vecFolded[iQ] = vecq + m_vecCentralReflex;
+					if(pvecG)
+						(*pvecG)[iQ] = vecG;
+				}
+			};
+
+			iThreads = std::max<unsigned int>(1, iThreads);
+			if(iThreads == 1 || vecQ.size() < 1024)
+			{
+				fold_range(0, vecQ.size());
+			}
+			else
+			{
+				ThreadPool<void()> tp(iThreads);
+				const std::size_t iChunk = (vecQ.size() + iThreads - 1) / iThreads;
+				for(std::size_t iStart=0; iStart<vecQ.size(); iStart+=iChunk)
+				{
+					std::size_t iEnd = std::min(iStart + iChunk, vecQ.size());
+					tp.AddTask([&fold_range, iStart, iEnd]() { fold_range(iStart, iEnd); });
+				}
+
+				tp.Start();
+				for(auto& fut : tp.GetResults())
+					fut.get();
+			}
+
+			return vecFolded;
+		}
+
+
+		/**
+		 * calculates the brillouin zone using the intersections of all middle perpendicular planes
 		 */
-		void CalcBZ(unsigned int iThreads = 4)
+		void CalcBZGeneric(unsigned int iThreads = 4)
 		{
 			//tl::log_debug("Calculating BZ with ", iThreads, " threads.");
 			if(!m_bHasCentralPeak) return;
@@ -35,6 +35,9 @@
 #include <cmath>
 #include <complex>
 #include <cassert>
+#include <array>
+#include <functional>
+#include <algorithm>
 
 #include "../math/linalg.h"
 #include "../math/rand.h"
@@ -274,6 +277,344 @@ t_vec<std::complex<T>> structfact_mag(const t_cont<t_vec<T>>& lstAtoms,
 }
 
 
+/**
+ * batch calculation of magnetic structure factors and intensities for many Q
+ *
+ * The atoms are stored as a structure of arrays: fractional positions and
+ * the (complex) spin components in the orthonormal frame of the reciprocal
+ * basis, already multiplied by the g factors and the prefactor of structfact_mag.
+ * The magnetic form factors only depend on |Q| and are evaluated once per atom
+ * species, not per atom. As S_perp is linear in S, the perpendicular projection
+ * is done once on the summed structure factor instead of for every atom.
+ *
+ * Domain averaging: a domain generated by x' = R x + t has I'(G) = I(R^T G),
+ * so the intensities are averaged over the symmetry-equivalent reflections.
+ *
+ * @see (Shirane 2002), p. 40, equ. 2.81
+ */
+template<class T = double>
+class MagStructFactBatch
+{
+public:
+	using t_cplx = std::complex<T>;
+	using t_vec3 = std::array<T, 3>;
+	using t_cvec3 = std::array<t_cplx, 3>;
+	using t_ffact = std::function<T(T)>;
+
+protected:
+	// fractional atom positions
+	std::vector<T> m_vecX, m_vecY, m_vecZ;
+
+	// real and imaginary parts of the spin components, including g/2 and the prefactor
+	std::vector<T> m_vecSxRe, m_vecSxIm, m_vecSyRe, m_vecSyIm, m_vecSzRe, m_vecSzIm;
+
+	// atom species, index into the form factor list
+	std::vector<std::size_t> m_vecSpecies;
+	std::vector<t_ffact> m_vecFormfacts;
+	std::size_t m_iNumSpecies = 0;
+
+	// reciprocal basis, Q = B*G
+	std::array<T, 9> m_matB{{ 1,0,0, 0,1,0, 0,0,1 }};
+
+	// transposed rotations of the symmetry operations, for the domains
+	std::vector<std::array<int, 9>> m_vecRotT;
+
+	unsigned int m_iNumThreads = 0;
+	std::size_t m_iChunkSize = 64;
+
+
+protected:
+	t_vec3 GetQ(const t_vec3& G) const
+	{
+		t_vec3 Q;
+		for(int i=0; i<3; ++i)
+			Q[i] = m_matB[i*3+0]*G[0] + m_matB[i*3+1]*G[1] + m_matB[i*3+2]*G[2];
+		return Q;
+	}
+
+
+	/**
+	 * form factors of all species at |Q|
+	 */
+	void GetFormfacts(T dQ, std::vector<T>& vecFF) const
+	{
+		vecFF.resize(m_iNumSpecies);
+		for(std::size_t iSpecies=0; iSpecies<m_iNumSpecies; ++iSpecies)
+		{
+			if(iSpecies < m_vecFormfacts.size() && m_vecFormfacts[iSpecies])
+				vecFF[iSpecies] = m_vecFormfacts[iSpecies](dQ);
+			else
+				vecFF[iSpecies] = T(1);
+		}
+	}
+
+
+	/**
+	 * sum over the atoms for given form factor values
+	 */
+	t_cvec3 CalcFm(const t_vec3& G, const std::vector<T>& vecFF) const
+	{
+		const std::size_t N = m_vecX.size();
+		const T dTwoPi = T(2)*get_pi<T>();
+
+		T sum[6] = { 0, 0, 0, 0, 0, 0 };
+		for(std::size_t j=0; j<N; ++j)
+		{
+			const T dPhase = dTwoPi * (G[0]*m_vecX[j] + G[1]*m_vecY[j] + G[2]*m_vecZ[j]);
+			const T f = vecFF[m_vecSpecies[j]];
+			const T c = f*std::cos(dPhase), s = f*std::sin(dPhase);
+
+			sum[0] += m_vecSxRe[j]*c - m_vecSxIm[j]*s;
+			sum[1] += m_vecSxRe[j]*s + m_vecSxIm[j]*c;
+			sum[2] += m_vecSyRe[j]*c - m_vecSyIm[j]*s;
+			sum[3] += m_vecSyRe[j]*s + m_vecSyIm[j]*c;
+			sum[4] += m_vecSzRe[j]*c - m_vecSzIm[j]*s;
+			sum[5] += m_vecSzRe[j]*s + m_vecSzIm[j]*c;
+		}
+
+		return t_cvec3{{ t_cplx(sum[0], sum[1]), t_cplx(sum[2], sum[3]), t_cplx(sum[4], sum[5]) }};
+	}
+
+
+	/**
+	 * part of Fm perpendicular to Q
+	 */
+	static t_cvec3 GetPerp(const t_cvec3& Fm, const t_vec3& Q)
+	{
+		const T dLen = std::sqrt(Q[0]*Q[0] + Q[1]*Q[1] + Q[2]*Q[2]);
+		if(float_equal<T>(dLen, T(0)))
+			return Fm;
+
+		const t_vec3 Qn{{ Q[0]/dLen, Q[1]/dLen, Q[2]/dLen }};
+		const t_cplx cProj = Qn[0]*Fm[0] + Qn[1]*Fm[1] + Qn[2]*Fm[2];
+
+		return t_cvec3{{ Fm[0] - cProj*Qn[0], Fm[1] - cProj*Qn[1], Fm[2] - cProj*Qn[2] }};
+	}
+
+
+	static T GetIntensity(const t_cvec3& Fm)
+	{
+		return std::norm(Fm[0]) + std::norm(Fm[1]) + std::norm(Fm[2]);
+	}
+
+
+	/**
+	 * runs fkt(i, vecFF) for all indices, in chunks distributed over the threads
+	 */
+	template<class t_func>
+	void RunChunked(std::size_t iNum, t_func&& fkt) const
+	{
+		auto calc_chunk = [this, &fkt](std::size_t iStart, std::size_t iEnd)
+		{
+			// per-thread form factor buffer
+			std::vector<T> vecFF;
+			vecFF.reserve(m_iNumSpecies);
+
+			for(std::size_t i=iStart; i<iEnd; ++i)
+				fkt(i, vecFF);
+		};
+
+		if(m_iNumThreads > 1 && iNum > m_iChunkSize)
+		{
+			ThreadPool<void()> tp(m_iNumThreads);
+			for(std::size_t iStart=0; iStart<iNum; iStart+=m_iChunkSize)
+			{
+				const std::size_t iEnd = std::min(iStart+m_iChunkSize, iNum);
+				tp.AddTask([&calc_chunk, iStart, iEnd]() { calc_chunk(iStart, iEnd); });
+			}
+
+			tp.Start();
+			for(auto& fut : tp.GetResults())
+				fut.get();
+		}
+		else
+		{
+			calc_chunk(0, iNum);
+		}
+	}
+
+
+public:
+	/**
+	 * @param vecAtomsFrac atom positions in fractional coordinates
+	 * @param vecSpins spins in the orthonormal frame of the reciprocal basis,
+	 *        real or complex; if only one is given, it is used for all atoms
+	 * @param vecSpecies species index per atom (for the form factors), default: 0
+	 * @param vecg g factors, 2 if none given; if only one is given, it is used for all atoms
+	 */
+	template<class t_vec, class t_vec_spin, template<class...> class t_cont = std::vector>
+	MagStructFactBatch(const t_cont<t_vec>& vecAtomsFrac, const t_cont<t_vec_spin>& vecSpins,
+		const t_cont<std::size_t>& vecSpecies = t_cont<std::size_t>(),
+		const t_cont<T>& vecg = t_cont<T>())
+	{
+		// same prefactor as in structfact_mag, in fm
+		const T cFact = get_r_e<T>() *
+			(-get_mu_n<T>()/get_mu_N<T>()) * T(0.5)
+			/ (get_one_meter<T>() * T(1e-15));
+
+		const std::size_t iNumAtoms = vecAtomsFrac.size();
+		for(std::vector<T>* pvec : { &m_vecX, &m_vecY, &m_vecZ, &m_vecSxRe, &m_vecSxIm,
+			&m_vecSyRe, &m_vecSyIm, &m_vecSzRe, &m_vecSzIm })
+			pvec->reserve(iNumAtoms);
+		m_vecSpecies.reserve(iNumAtoms);
+
+		auto iterSpin = vecSpins.begin();
+		auto iterSpecies = vecSpecies.begin();
+		auto iterg = vecg.begin();
+
+		for(const t_vec& vecAtom : vecAtomsFrac)
+		{
+			m_vecX.push_back(vecAtom[0]);
+			m_vecY.push_back(vecAtom[1]);
+			m_vecZ.push_back(vecAtom[2]);
+
+			const T g = (iterg != vecg.end() ? *iterg : T(2));
+			t_cplx S[3] = { 0, 0, 0 };
+			if(iterSpin != vecSpins.end())
+				for(int i=0; i<3; ++i)
+					S[i] = t_cplx((*iterSpin)[i]) * cFact * g;
+
+			m_vecSxRe.push_back(S[0].real()); m_vecSxIm.push_back(S[0].imag());
+			m_vecSyRe.push_back(S[1].real()); m_vecSyIm.push_back(S[1].imag());
+			m_vecSzRe.push_back(S[2].real()); m_vecSzIm.push_back(S[2].imag());
+
+			const std::size_t iSpecies = (iterSpecies != vecSpecies.end() ? *iterSpecies : 0);
+			m_vecSpecies.push_back(iSpecies);
+			m_iNumSpecies = std::max(m_iNumSpecies, iSpecies+1);
+
+			if(iterSpin!=vecSpins.end() && std::next(iterSpin)!=vecSpins.end())
+				++iterSpin;
+			if(iterSpecies!=vecSpecies.end())
+				++iterSpecies;
+			if(iterg!=vecg.end() && std::next(iterg)!=vecg.end())
+				++iterg;
+		}
+	}
+
+	MagStructFactBatch() = default;
+	~MagStructFactBatch() = default;
+
+
+	/**
+	 * reciprocal basis (column vectors), Q = B*G
+	 */
+	template<class t_mat>
+	void SetRecipBasis(const t_mat& matB)
+	{
+		for(int i=0; i<3; ++i)
+			for(int j=0; j<3; ++j)
+				m_matB[i*3+j] = matB(i, j);
+	}
+
+
+	/**
+	 * magnetic form factors per species as functions of |Q|
+	 */
+	void SetFormfacts(const std::vector<t_ffact>& vecFormfacts)
+	{
+		m_vecFormfacts = vecFormfacts;
+	}
+
+
+	/**
+	 * symmetry operations of the paramagnetic group in fractional coordinates,
+	 * their rotation parts generate the domains
+	 */
+	template<class t_mat, template<class...> class t_cont = std::vector>
+	bool SetSymOps(const t_cont<t_mat>& vecOps, T eps = T(1e-4))
+	{
+		m_vecRotT = get_symop_rotations<t_mat, T, t_cont>(vecOps, true, eps);
+		return vecOps.size() == 0 || m_vecRotT.size() != 0;
+	}
+
+
+	/**
+	 * number of threads for batch calculations (0: calculate in the calling thread)
+	 */
+	void SetNumThreads(unsigned int iNumThreads) { m_iNumThreads = iNumThreads; }
+
+	std::size_t GetNumAtoms() const { return m_vecX.size(); }
+	std::size_t GetNumDomains() const { return std::max<std::size_t>(m_vecRotT.size(), 1); }
+
+
+	/**
+	 * magnetic structure factors perpendicular to Q, for a single domain
+	 * @param vecG reflections in rlu
+	 */
+	std::vector<t_cvec3> CalcFmPerp(const std::vector<t_vec3>& vecG) const
+	{
+		std::vector<t_cvec3> vecFm(vecG.size());
+
+		RunChunked(vecG.size(), [this, &vecG, &vecFm](std::size_t iG, std::vector<T>& vecFF)
+		{
+			const t_vec3 Q = GetQ(vecG[iG]);
+			GetFormfacts(std::sqrt(Q[0]*Q[0] + Q[1]*Q[1] + Q[2]*Q[2]), vecFF);
+			vecFm[iG] = GetPerp(CalcFm(vecG[iG], vecFF), Q);
+		});
+
+		return vecFm;
+	}
+
+
+	/**
+	 * magnetic intensities |Fm_perp|^2
+	 * @param vecG reflections in rlu
+	 * @param bDomainAvg average over the domains given by the symmetry operations
+	 */
+	std::vector<T> CalcIntensities(const std::vector<t_vec3>& vecG, bool bDomainAvg = true) const
+	{
+		std::vector<T> vecI(vecG.size());
+		const bool bDomains = bDomainAvg && m_vecRotT.size() > 0;
+
+		RunChunked(vecG.size(), [this, &vecG, &vecI, bDomains](std::size_t iG, std::vector<T>& vecFF)
+		{
+			const t_vec3& G = vecG[iG];
+			const t_vec3 Q = GetQ(G);
+
+			// equivalent reflections have the same |Q|
+			GetFormfacts(std::sqrt(Q[0]*Q[0] + Q[1]*Q[1] + Q[2]*Q[2]), vecFF);
+
+			if(!bDomains)
+			{
+				vecI[iG] = GetIntensity(GetPerp(CalcFm(G, vecFF), Q));
+				return;
+			}
+
+			// distinct domains, weighted by the number of operations mapping onto them
+			std::vector<std::pair<t_vec3, std::size_t>> vecEquiv;
+			vecEquiv.reserve(m_vecRotT.size());
+			for(const std::array<int, 9>& R : m_vecRotT)
+			{
+				t_vec3 GNew;
+				for(int i=0; i<3; ++i)
+					GNew[i] = T(R[i*3+0])*G[0] + T(R[i*3+1])*G[1] + T(R[i*3+2])*G[2];
+
+				auto iter = std::find_if(vecEquiv.begin(), vecEquiv.end(),
+					[&GNew](const std::pair<t_vec3, std::size_t>& pair) -> bool
+				{
+					return float_equal<T>(pair.first[0], GNew[0], T(1e-6)) &&
+						float_equal<T>(pair.first[1], GNew[1], T(1e-6)) &&
+						float_equal<T>(pair.first[2], GNew[2], T(1e-6));
+				});
+
+				if(iter == vecEquiv.end())
+					vecEquiv.emplace_back(GNew, 1);
+				else
+					++iter->second;
+			}
+
+			T dSum = 0;
+			for(const std::pair<t_vec3, std::size_t>& pair : vecEquiv)
+				dSum += T(pair.second) * GetIntensity(GetPerp(CalcFm(pair.first, vecFF), GetQ(pair.first)));
+
+			vecI[iG] = dSum / T(m_vecRotT.size());
+		});
+
+		return vecI;
+	}
+};
+
+
 
 
 // ----------------------------------------------------------------------------
@@ -30,8 +30,11 @@
 #define __POWDER_H__
 
 #include <tuple>
+#include <array>
 #include <vector>
+#include <cmath>
 #include <algorithm>
+#include <functional>
 #include <unordered_set>
 #include <initializer_list>
 #include "lattice.h"
@@ -247,6 +250,255 @@ class Powder
 
 
 
+/**
+ * symmetry-unique powder reflection
+ */
+template<class t_real = double>
+struct PowderReflex
+{
+	// representative of the symmetry orbit
+	int h = 0, k = 0, l = 0;
+
+	// equivalent reflections within the hkl range
+	std::vector<std::array<int, 3>> vecEquiv;
+
+	// number of equivalent reflections in the whole orbit
+	std::size_t iMult = 1;
+
+	// length of the reciprocal lattice vector (1/A) and scattering angle (rad)
+	t_real dG = 0;
+	t_real dTwoTheta = 0;
+};
+
+
+/**
+ * enumerates the symmetry-unique reflections of a powder and their multiplicities,
+ * the equivalent reflections are generated by the point group and the Friedel inversion
+ */
+template<class t_real = double>
+class PowderPattern
+{
+	public:
+		using t_hkl = std::array<int, 3>;
+		using t_reflex = PowderReflex<t_real>;
+		using t_func_allowed = std::function<bool(int, int, int)>;
+
+	protected:
+		// reciprocal basis vectors (including 2pi)
+		ublas::vector<t_real> m_vecAstar, m_vecBstar, m_vecCstar;
+
+		// distinct rotations acting on hkl: h' = R^T h
+		std::vector<std::array<int, 9>> m_vecRotT;
+
+		// reflection conditions, e.g. from the space group
+		t_func_allowed m_funcAllowed;
+
+		// wavelength in A, angles are not calculated if <= 0
+		t_real m_dLam = 0;
+
+	public:
+		PowderPattern() = default;
+		~PowderPattern() = default;
+
+
+		void SetRecipLattice(const Lattice<t_real>& recip)
+		{
+			m_vecAstar = recip.GetVec(0);
+			m_vecBstar = recip.GetVec(1);
+			m_vecCstar = recip.GetVec(2);
+		}
+
+		void SetWavelength(t_real dLam) { m_dLam = dLam; }
+		void SetReflectionCondition(const t_func_allowed& func) { m_funcAllowed = func; }
+
+
+		/**
+		 * set the symmetry operations in fractional coordinates
+		 * (3x3 or homogeneous 4x4 matrices, only the rotational part is used)
+		 */
+		template<class t_mat, template<class...> class t_cont = std::vector>
+		bool SetSymOps(const t_cont<t_mat>& vecOps, t_real eps = t_real(1e-4))
+		{
+			m_vecRotT.clear();
+
+			for(const t_mat& mat : vecOps)
+			{
+				if(mat.size1() < 3 || mat.size2() < 3)
+				{
+					m_vecRotT.clear();
+					return false;
+				}
+
+				std::array<int, 9> RT;
+				for(int i=0; i<3; ++i)
+				{
+					for(int j=0; j<3; ++j)
+					{
+						const t_real d = mat(j, i);
+						const t_real dRound = std::round(d);
+						if(!float_equal<t_real>(d, dRound, eps))
+						{
+							m_vecRotT.clear();
+							return false;
+						}
+						RT[i*3+j] = int(dRound);
+					}
+				}
+
+				// centring translations repeat the same rotations
+				if(std::find(m_vecRotT.begin(), m_vecRotT.end(), RT) == m_vecRotT.end())
+					m_vecRotT.push_back(RT);
+			}
+
+			return true;
+		}
+
+
+		/**
+		 * all reflections symmetry-equivalent to hkl, sorted and including hkl itself
+		 */
+		std::vector<t_hkl> GetOrbit(const t_hkl& hkl) const
+		{
+			std::vector<t_hkl> vecOrbit;
+			vecOrbit.reserve(2*m_vecRotT.size() + 2);
+			vecOrbit.push_back(hkl);
+			vecOrbit.push_back(t_hkl{{ -hkl[0], -hkl[1], -hkl[2] }});
+
+			for(const std::array<int, 9>& R : m_vecRotT)
+			{
+				t_hkl hklNew;
+				for(int i=0; i<3; ++i)
+					hklNew[i] = R[i*3+0]*hkl[0] + R[i*3+1]*hkl[1] + R[i*3+2]*hkl[2];
+
+				vecOrbit.push_back(hklNew);
+				vecOrbit.push_back(t_hkl{{ -hklNew[0], -hklNew[1], -hklNew[2] }});
+			}
+
+			std::sort(vecOrbit.begin(), vecOrbit.end());
+			vecOrbit.erase(std::unique(vecOrbit.begin(), vecOrbit.end()), vecOrbit.end());
+			return vecOrbit;
+		}
+
+
+		/**
+		 * symmetry-unique reflections with -iOrder <= h,k,l <= iOrder, sorted by G;
+		 * reflections out of reach of the wavelength are skipped
+		 */
+		std::vector<t_reflex> CalcReflexes(int iOrder) const
+		{
+			std::vector<t_reflex> vecReflexes;
+			if(m_vecAstar.size() != 3)
+				return vecReflexes;
+
+			auto in_range = [iOrder](const t_hkl& hkl) -> bool
+			{
+				return std::abs(hkl[0]) <= iOrder && std::abs(hkl[1]) <= iOrder &&
+					std::abs(hkl[2]) <= iOrder;
+			};
+
+			// reflections already covered by the orbit of a representative
+			const std::size_t iSide = std::size_t(2*iOrder + 1);
+			std::vector<bool> vecVisited(iSide*iSide*iSide, false);
+			auto get_idx = [iOrder, iSide](const t_hkl& hkl) -> std::size_t
+			{
+				return (std::size_t(hkl[0]+iOrder)*iSide + std::size_t(hkl[1]+iOrder))*iSide
+					+ std::size_t(hkl[2]+iOrder);
+			};
+
+			// iterating in descending order, the first unvisited member of an orbit
+			// is its largest member within the range, which represents the orbit
+			for(int ih=iOrder; ih>=-iOrder; --ih)
+			for(int ik=iOrder; ik>=-iOrder; --ik)
+			for(int il=iOrder; il>=-iOrder; --il)
+			{
+				const t_hkl hkl{{ ih, ik, il }};
+				if(vecVisited[get_idx(hkl)])
+					continue;
+				if(ih==0 && ik==0 && il==0)
+					continue;
+				if(m_funcAllowed && !m_funcAllowed(ih, ik, il))
+					continue;
+
+				std::vector<t_hkl> vecOrbit = GetOrbit(hkl);
+				for(const t_hkl& hklEquiv : vecOrbit)
+					if(in_range(hklEquiv))
+						vecVisited[get_idx(hklEquiv)] = true;
+
+				t_reflex refl;
+				refl.h = ih; refl.k = ik; refl.l = il;
+				refl.iMult = vecOrbit.size();
+				refl.dG = veclen(t_real(ih)*m_vecAstar + t_real(ik)*m_vecBstar + t_real(il)*m_vecCstar);
+				if(is_nan_or_inf<t_real>(refl.dG))
+					continue;
+
+				if(m_dLam > t_real(0))
+				{
+					// Bragg's law, 2theta = 2 asin(G lam / (4 pi))
+					const t_real dS = refl.dG * m_dLam / (t_real(4)*get_pi<t_real>());
+					if(std::abs(dS) > t_real(1))
+						continue;
+					refl.dTwoTheta = t_real(2) * std::asin(dS);
+				}
+
+				for(auto iter=vecOrbit.rbegin(); iter!=vecOrbit.rend(); ++iter)
+					if(in_range(*iter))
+						refl.vecEquiv.push_back(*iter);
+
+				vecReflexes.emplace_back(std::move(refl));
+			}
+
+			std::stable_sort(vecReflexes.begin(), vecReflexes.end(),
+				[](const t_reflex& refl1, const t_reflex& refl2) -> bool
+				{ return refl1.dG < refl2.dG; });
+			return vecReflexes;
+		}
+};
+
+
+/**
+ * synthesises a powder profile of gaussian lines on the grid x_i = dMin + i*(dMax-dMin)/iNumPts,
+ * each line only contributes to the points within dWindow standard deviations of its centre
+ * @param vecPos, vecInt line positions and integrated intensities
+ * @param vecProf output profile, its memory is reused for repeated evaluations
+ */
+template<class t_real = double, template<class...> class t_cont = std::vector>
+void powder_profile(const t_cont<t_real>& vecPos, const t_cont<t_real>& vecInt,
+	t_real dSigma, t_real dMin, t_real dMax, std::size_t iNumPts,
+	std::vector<t_real>& vecProf, t_real dWindow = t_real(8))
+{
+	vecProf.assign(iNumPts, t_real(0));
+	if(iNumPts == 0 || dSigma <= t_real(0) || dMax <= dMin)
+		return;
+
+	const t_real dStep = (dMax - dMin) / t_real(iNumPts);
+	const t_real dNorm = t_real(1) / (std::sqrt(t_real(2)*get_pi<t_real>()) * dSigma);
+	const t_real dHalfWidth = dWindow * dSigma;
+
+	auto iterInt = vecInt.begin();
+	for(auto iterPos = vecPos.begin(); iterPos != vecPos.end() && iterInt != vecInt.end();
+		++iterPos, ++iterInt)
+	{
+		const t_real dPos = *iterPos;
+		const t_real dAmp = *iterInt * dNorm;
+
+		t_real dFirst = std::ceil((dPos - dHalfWidth - dMin) / dStep);
+		t_real dLast = std::floor((dPos + dHalfWidth - dMin) / dStep);
+		if(dLast < t_real(0) || dFirst >= t_real(iNumPts))
+			continue;
+
+		const std::size_t iFirst = dFirst < t_real(0) ? 0 : std::size_t(dFirst);
+		const std::size_t iLast = std::min(iNumPts-1, std::size_t(dLast));
+
+		for(std::size_t iPt=iFirst; iPt<=iLast; ++iPt)
+		{
+			const t_real dX = (dMin + dStep*t_real(iPt) - dPos) / dSigma;
+			vecProf[iPt] += dAmp * std::exp(t_real(-0.5) * dX*dX);
+		}
+	}
+}
+
+
+
 /**
  * corrects mono & sample axes using known powder lines
  * @desc see (Shirane 2002), p. 87
@@ -0,0 +1,1689 @@
+/**
+ * Script interpreter
+ * Bytecode compiler and register VM
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2 or GPLv3
+ *
+ * ----------------------------------------------------------------------------
+ * tlibs -- a physical-mathematical C++ template library
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2015-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "bytecode.h"
+#include "node.h"
+#include "info.h"
+#include "calls.h"
+#include "log/log.h"
+#include "math/math.h"
+
+#include <unordered_map>
+#include <unordered_set>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+
+extern void uminus_inplace(Symbol* pSym, ParseInfo& info, RuntimeInfo& runinfo);
+
+
+// system functions which inspect the local symbol table of their caller
+static const std::unordered_set<t_string> g_setScopeFkts =
+{
+	T_STR"has_var", T_STR"register_var", T_STR"cur_iter",
+};
+
+static const std::uint32_t BC_NOREG = 0xffffffff;
+
+
+static std::vector<Node*> bc_flatten(const Node* pNode, NodeType ntype)
+{
+	if(!pNode)
+		return std::vector<Node*>();
+	if(pNode->GetType() != ntype)
+		return std::vector<Node*>{ const_cast<Node*>(pNode) };
+
+	const NodeBinaryOp *pOp = (const NodeBinaryOp*)pNode;
+	if(ntype == NODE_STMTS && pOp->GetNodesFlat().size())
+		return pOp->GetNodesFlat();
+	return pOp->flatten(ntype);
+}
+
+static BcOp bc_binop(NodeType ntype)
+{
+	switch(ntype)
+	{
+		case NODE_PLUS: return BC_ADD;
+		case NODE_MINUS: return BC_SUB;
+		case NODE_MULT: return BC_MUL;
+		case NODE_DIV: return BC_DIV;
+		case NODE_MOD: return BC_MOD;
+		case NODE_POW: return BC_POW;
+		case NODE_LOG_EQ: return BC_EQ;
+		case NODE_LOG_NEQ: return BC_NEQ;
+		case NODE_LOG_LESS: return BC_LESS;
+		case NODE_LOG_GREATER: return BC_GREATER;
+		case NODE_LOG_LEQ: return BC_LEQ;
+		case NODE_LOG_GEQ: return BC_GEQ;
+		case NODE_LOG_AND: return BC_AND;
+		case NODE_LOG_OR: return BC_OR;
+		default: return BC_NOP;
+	}
+}
+
+static NodeType bc_nodetype(BcOp op)
+{
+	switch(op)
+	{
+		case BC_ADD: return NODE_PLUS;
+		case BC_SUB: return NODE_MINUS;
+		case BC_MUL: return NODE_MULT;
+		case BC_DIV: return NODE_DIV;
+		case BC_MOD: return NODE_MOD;
+		case BC_POW: return NODE_POW;
+		case BC_EQ: return NODE_LOG_EQ;
+		case BC_NEQ: return NODE_LOG_NEQ;
+		case BC_LESS: return NODE_LOG_LESS;
+		case BC_GREATER: return NODE_LOG_GREATER;
+		case BC_LEQ: return NODE_LOG_LEQ;
+		case BC_GEQ: return NODE_LOG_GEQ;
+		case BC_AND: return NODE_LOG_AND;
+		case BC_OR: return NODE_LOG_OR;
+		default: return NODE_INVALID;
+	}
+}
+
+static const char* bc_opname(BcOp op)
+{
+	static const char* pcNames[] =
+	{
+		"nop", "move", "drop", "loadg", "storel", "storeg",
+		"add", "sub", "mul", "div", "mod", "pow",
+		"eq", "neq", "less", "greater", "leq", "geq", "and", "or",
+		"neg", "not", "jmp", "jmpf", "jand", "jor",
+		"call", "newarr", "index", "chkcont", "storex", "ret",
+	};
+
+	return pcNames[op];
+}
+
+
+
+// --------------------------------------------------------------------------------
+// compiler
+
+class BcCompiler
+{
+protected:
+	BcProgram& m_prog;
+	bool m_bOk = 1;
+
+	std::unordered_map<t_string, std::uint32_t> m_mapSlots;
+	std::unordered_set<t_string> m_setGlobalAssigns;
+	std::unordered_map<t_string, std::uint32_t> m_mapNames;
+
+	// constant pool
+	std::unordered_map<const Node*, std::uint32_t> m_mapConstNodes;
+	std::unordered_map<t_int, std::uint32_t> m_mapIntConsts;
+	std::unordered_map<std::uint64_t, std::uint32_t> m_mapRealConsts;
+	std::unordered_map<t_string, std::uint32_t> m_mapStrConsts;
+
+	std::uint32_t m_iConstBase = 0, m_iTmpBase = 0;
+	std::uint32_t m_iTop = 0, m_iMaxTop = 0;
+
+	unsigned int m_iLoopDepth = 0;
+	struct Loop
+	{
+		std::vector<std::size_t> vecBreaks, vecConts;
+	};
+	std::vector<Loop> m_vecLoops;
+
+	const Node *m_pCurNode = nullptr;
+
+protected:
+	void add_slot(const t_string& strName)
+	{
+		if(m_mapSlots.find(strName) != m_mapSlots.end())
+			return;
+
+		m_mapSlots[strName] = m_prog.m_vecNames.size();
+		m_prog.m_vecNames.push_back(strName);
+	}
+
+	std::uint32_t name_idx(const t_string& strName)
+	{
+		auto iter = m_mapNames.find(strName);
+		if(iter != m_mapNames.end())
+			return iter->second;
+
+		std::uint32_t iIdx = m_prog.m_vecNames.size();
+		m_prog.m_vecNames.push_back(strName);
+		m_mapNames[strName] = iIdx;
+		return iIdx;
+	}
+
+	template<class t_key>
+	void add_const(const Node* pNode, std::unordered_map<t_key, std::uint32_t>& map,
+		const t_key& key, const BcValue& val)
+	{
+		auto iter = map.find(key);
+		if(iter == map.end())
+		{
+			iter = map.insert(std::make_pair(key, std::uint32_t(m_prog.m_vecConsts.size()))).first;
+			m_prog.m_vecConsts.push_back(val);
+		}
+		m_mapConstNodes[pNode] = iter->second;
+	}
+
+	/**
+	 * checks if all nodes of the function are supported and collects
+	 * local variables and constants
+	 */
+	bool scan(const Node* pNode)
+	{
+		if(!pNode) return 1;
+
+		switch(pNode->GetType())
+		{
+			case NODE_INT:
+			{
+				BcValue val;
+				val.ty = BCVAL_INT;
+				val.iVal = const_cast<NodeInt*>((const NodeInt*)pNode)->GetSym()->GetVal();
+				add_const(pNode, m_mapIntConsts, val.iVal, val);
+				return 1;
+			}
+			case NODE_DOUBLE:
+			{
+				BcValue val;
+				val.ty = BCVAL_REAL;
+				val.dVal = const_cast<NodeReal*>((const NodeReal*)pNode)->GetSym()->GetVal();
+				std::uint64_t iBits = 0;
+				std::memcpy(&iBits, &val.dVal, std::min(sizeof(iBits), sizeof(val.dVal)));
+				add_const(pNode, m_mapRealConsts, iBits, val);
+				return 1;
+			}
+			case NODE_STRING:
+			{
+				BcValue val;
+				val.ty = BCVAL_SYM;
+				val.pSym = const_cast<NodeString*>((const NodeString*)pNode)->GetSym();
+				add_const(pNode, m_mapStrConsts, ((SymbolString*)val.pSym)->GetVal(), val);
+				return 1;
+			}
+
+			case NODE_IDENT:
+				return 1;
+
+			case NODE_ASSIGN:
+			{
+				const NodeBinaryOp *pOp = (const NodeBinaryOp*)pNode;
+				const Node *pLeft = pOp->GetLeft();
+				if(!pLeft || !pOp->GetRight())
+					return 0;
+
+				// array or map element
+				if(pLeft->GetType() == NODE_ARRAY_ACCESS)
+					return scan(pLeft) && scan(pOp->GetRight());
+				if(pLeft->GetType() != NODE_IDENT)
+					return 0;
+
+				const t_string& strIdent = ((const NodeIdent*)pLeft)->GetIdent();
+				if(pOp->IsGlobal())
+					m_setGlobalAssigns.insert(strIdent);
+				else
+					add_slot(strIdent);
+
+				return scan(pOp->GetRight());
+			}
+
+			case NODE_PLUS: case NODE_MINUS: case NODE_MULT: case NODE_DIV:
+			case NODE_MOD: case NODE_POW:
+			case NODE_LOG_EQ: case NODE_LOG_NEQ: case NODE_LOG_LESS:
+			case NODE_LOG_GREATER: case NODE_LOG_LEQ: case NODE_LOG_GEQ:
+			case NODE_LOG_AND: case NODE_LOG_OR:
+			{
+				const NodeBinaryOp *pOp = (const NodeBinaryOp*)pNode;
+				if(!pOp->GetLeft() || !pOp->GetRight())
+					return 0;
+				return scan(pOp->GetLeft()) && scan(pOp->GetRight());
+			}
+
+			case NODE_UMINUS:
+			case NODE_LOG_NOT:
+			{
+				const NodeUnaryOp *pOp = dynamic_cast<const NodeUnaryOp*>(pNode);
+				if(!pOp || !pOp->GetChild())
+					return 0;
+				return scan(pOp->GetChild());
+			}
+
+			case NODE_STMTS:
+			{
+				if(!dynamic_cast<const NodeBinaryOp*>(pNode))
+					return 0;
+				for(const Node *pStmt : bc_flatten(pNode, NODE_STMTS))
+					if(!scan(pStmt))
+						return 0;
+				return 1;
+			}
+
+			case NODE_CALL:
+			{
+				const NodeCall *pCall = (const NodeCall*)pNode;
+				const Node *pIdent = pCall->GetIdent();
+				if(!pIdent || pIdent->GetType() != NODE_IDENT)
+					return 0;
+				if(g_setScopeFkts.find(((const NodeIdent*)pIdent)->GetIdent()) != g_setScopeFkts.end())
+					return 0;
+
+				for(const Node *pArg : bc_flatten(pCall->GetArgs(), NODE_ARGS))
+				{
+					if(pArg->GetType() == NODE_UNPACK || !scan(pArg))
+						return 0;
+				}
+				return 1;
+			}
+
+			case NODE_ARRAY:
+			{
+				for(const Node *pElem : bc_flatten(((const NodeArray*)pNode)->GetArr(), NODE_ARGS))
+				{
+					const NodeType ty = pElem->GetType();
+					if(ty == NODE_RANGE || ty == NODE_UNPACK || ty == NODE_PAIR || !scan(pElem))
+						return 0;
+				}
+				return 1;
+			}
+
+			case NODE_ARRAY_ACCESS:
+			{
+				const NodeArrayAccess *pAcc = (const NodeArrayAccess*)pNode;
+				if(!pAcc->GetIdent())
+					return 0;
+
+				std::vector<Node*> vecIdx = bc_flatten(pAcc->GetExpr(), NODE_ARGS);
+				if(vecIdx.size() != 1 || vecIdx[0]->GetType() == NODE_RANGE)
+					return 0;
+				return scan(pAcc->GetIdent()) && scan(vecIdx[0]);
+			}
+
+			case NODE_IF:
+			{
+				const NodeIf *pIf = (const NodeIf*)pNode;
+				if(!pIf->GetExpr())
+					return 0;
+				return scan(pIf->GetExpr()) && scan(pIf->GetIf()) && scan(pIf->GetElse());
+			}
+
+			case NODE_WHILE:
+			{
+				const NodeWhile *pWhile = (const NodeWhile*)pNode;
+				if(!pWhile->GetExpr() || !pWhile->GetStmt())
+					return 0;
+
+				++m_iLoopDepth;
+				bool bOk = scan(pWhile->GetExpr()) && scan(pWhile->GetStmt());
+				--m_iLoopDepth;
+				return bOk;
+			}
+
+			case NODE_FOR:
+			{
+				const NodeFor *pFor = (const NodeFor*)pNode;
+				if(!pFor->GetExprCond() || !pFor->GetStmt())
+					return 0;
+
+				++m_iLoopDepth;
+				bool bOk = scan(pFor->GetExprInit()) && scan(pFor->GetExprCond())
+					&& scan(pFor->GetExprEnd()) && scan(pFor->GetStmt());
+				--m_iLoopDepth;
+				return bOk;
+			}
+
+			case NODE_RETURN:
+				return scan(((const NodeReturn*)pNode)->GetExpr());
+
+			case NODE_BREAK:
+			case NODE_CONTINUE:
+				return m_iLoopDepth > 0;
+
+			default:
+				return 0;
+		}
+	}
+
+
+	std::size_t emit(BcOp op, std::uint32_t a=0, std::uint32_t b=0, std::uint32_t c=0)
+	{
+		BcInstr instr;
+		instr.op = op;
+		instr.a = a;
+		instr.b = b;
+		instr.c = c;
+
+		m_prog.m_vecCode.push_back(instr);
+		m_prog.m_vecCodeNodes.push_back(m_pCurNode);
+		return m_prog.m_vecCode.size() - 1;
+	}
+
+	std::uint32_t here() const { return std::uint32_t(m_prog.m_vecCode.size()); }
+
+	std::uint32_t alloc_tmp()
+	{
+		std::uint32_t iReg = m_iTop++;
+		m_iMaxTop = std::max(m_iMaxTop, m_iTop);
+		return iReg;
+	}
+
+	std::uint32_t to_dst(std::uint32_t iReg, std::uint32_t iDst)
+	{
+		if(iDst == BC_NOREG || iDst == iReg)
+			return iReg;
+		emit(BC_MOVE, iDst, iReg);
+		return iDst;
+	}
+
+	// result register for an instruction whose operands have been released
+	std::uint32_t dst_or_tmp(std::uint32_t iDst)
+	{
+		return iDst == BC_NOREG ? alloc_tmp() : iDst;
+	}
+
+	/**
+	 * emits code for an expression, returns the register holding the result
+	 */
+	std::uint32_t expr(const Node* pNode, std::uint32_t iDst)
+	{
+		const Node *pOldNode = m_pCurNode;
+		if(pNode->GetLine())
+			m_pCurNode = pNode;
+
+		std::uint32_t iRes = expr_node(pNode, iDst);
+
+		m_pCurNode = pOldNode;
+		return iRes;
+	}
+
+	std::uint32_t expr_node(const Node* pNode, std::uint32_t iDst)
+	{
+		const std::uint32_t iTop = m_iTop;
+
+		switch(pNode->GetType())
+		{
+			case NODE_INT:
+			case NODE_DOUBLE:
+			case NODE_STRING:
+				return to_dst(m_iConstBase + m_mapConstNodes[pNode], iDst);
+
+			case NODE_IDENT:
+			{
+				const t_string& strIdent = ((const NodeIdent*)pNode)->GetIdent();
+				auto iterSlot = m_mapSlots.find(strIdent);
+				if(iterSlot != m_mapSlots.end())
+					return to_dst(iterSlot->second, iDst);
+
+				std::uint32_t iRes = dst_or_tmp(iDst);
+				emit(BC_LOADG, iRes, name_idx(strIdent));
+				return iRes;
+			}
+
+			case NODE_ASSIGN:
+			{
+				const NodeBinaryOp *pOp = (const NodeBinaryOp*)pNode;
+
+				if(pOp->GetLeft()->GetType() == NODE_ARRAY_ACCESS)
+				{
+					// the right-hand side is evaluated first, see NodeBinaryOp::eval_assign
+					const NodeArrayAccess *pAcc = (const NodeArrayAccess*)pOp->GetLeft();
+					std::uint32_t iVal = alloc_tmp();
+					expr(pOp->GetRight(), iVal);
+					std::uint32_t iCont = expr(pAcc->GetIdent(), BC_NOREG);
+					std::uint32_t iIdx = expr(bc_flatten(pAcc->GetExpr(), NODE_ARGS)[0], BC_NOREG);
+					emit(BC_STOREX, iCont, iIdx, iVal);
+
+					m_iTop = iTop+1;
+					iVal = to_dst(iVal, iDst);
+					if(iDst != BC_NOREG)
+						m_iTop = iTop;
+					return iVal;
+				}
+
+				const t_string& strIdent = ((const NodeIdent*)pOp->GetLeft())->GetIdent();
+
+				if(pOp->IsGlobal())
+				{
+					std::uint32_t iVal = expr(pOp->GetRight(), BC_NOREG);
+					emit(BC_STOREG, name_idx(strIdent), iVal);
+					return to_dst(iVal, iDst);
+				}
+
+				std::uint32_t iSlot = m_mapSlots[strIdent];
+				std::uint32_t iVal = expr(pOp->GetRight(), BC_NOREG);
+				emit(BC_STOREL, iSlot, iVal);
+				m_iTop = iTop;
+				return to_dst(iSlot, iDst);
+			}
+
+			case NODE_LOG_AND:
+			case NODE_LOG_OR:
+			{
+				const NodeBinaryOp *pOp = (const NodeBinaryOp*)pNode;
+				const bool bAnd = (pNode->GetType() == NODE_LOG_AND);
+
+				std::uint32_t iRes = dst_or_tmp(iDst);
+				std::uint32_t iLeft = expr(pOp->GetLeft(), BC_NOREG);
+				std::size_t iJmp = emit(bAnd ? BC_JAND : BC_JOR, iRes, iLeft);
+				std::uint32_t iRight = expr(pOp->GetRight(), BC_NOREG);
+				emit(bAnd ? BC_AND : BC_OR, iRes, iLeft, iRight);
+				m_prog.m_vecCode[iJmp].c = here();
+
+				m_iTop = (iDst == BC_NOREG ? iTop+1 : iTop);
+				return iRes;
+			}
+
+			case NODE_PLUS: case NODE_MINUS: case NODE_MULT: case NODE_DIV:
+			case NODE_MOD: case NODE_POW:
+			case NODE_LOG_EQ: case NODE_LOG_NEQ: case NODE_LOG_LESS:
+			case NODE_LOG_GREATER: case NODE_LOG_LEQ: case NODE_LOG_GEQ:
+			{
+				const NodeBinaryOp *pOp = (const NodeBinaryOp*)pNode;
+				std::uint32_t iLeft = expr(pOp->GetLeft(), BC_NOREG);
+				std::uint32_t iRight = expr(pOp->GetRight(), BC_NOREG);
+				m_iTop = iTop;
+
+				std::uint32_t iRes = dst_or_tmp(iDst);
+				emit(bc_binop(pNode->GetType()), iRes, iLeft, iRight);
+				return iRes;
+			}
+
+			case NODE_UMINUS:
+			case NODE_LOG_NOT:
+			{
+				const NodeUnaryOp *pOp = (const NodeUnaryOp*)pNode;
+				std::uint32_t iVal = expr(pOp->GetChild(), BC_NOREG);
+				m_iTop = iTop;
+
+				std::uint32_t iRes = dst_or_tmp(iDst);
+				emit(pNode->GetType()==NODE_UMINUS ? BC_NEG : BC_NOT, iRes, iVal);
+				return iRes;
+			}
+
+			case NODE_CALL:
+			{
+				const NodeCall *pCall = (const NodeCall*)pNode;
+				std::vector<Node*> vecArgs = bc_flatten(pCall->GetArgs(), NODE_ARGS);
+
+				// arguments are evaluated into consecutive registers
+				std::uint32_t iBase = m_iTop;
+				for(std::size_t iArg=0; iArg<vecArgs.size(); ++iArg)
+					alloc_tmp();
+				for(std::size_t iArg=0; iArg<vecArgs.size(); ++iArg)
+					expr(vecArgs[iArg], iBase + iArg);
+				m_iTop = iTop;
+
+				BcCallInfo callinfo;
+				callinfo.strFkt = ((const NodeIdent*)pCall->GetIdent())->GetIdent();
+				callinfo.iFirstArg = iBase;
+				callinfo.iNumArgs = vecArgs.size();
+				callinfo.pNode = pCall;
+				m_prog.m_vecCalls.emplace_back(std::move(callinfo));
+
+				std::uint32_t iRes = dst_or_tmp(iDst);
+				emit(BC_CALL, iRes, m_prog.m_vecCalls.size()-1);
+				return iRes;
+			}
+
+			case NODE_ARRAY:
+			{
+				std::vector<Node*> vecElems = bc_flatten(((const NodeArray*)pNode)->GetArr(), NODE_ARGS);
+
+				std::uint32_t iBase = m_iTop;
+				for(std::size_t iElem=0; iElem<vecElems.size(); ++iElem)
+					alloc_tmp();
+				for(std::size_t iElem=0; iElem<vecElems.size(); ++iElem)
+					expr(vecElems[iElem], iBase + iElem);
+				m_iTop = iTop;
+
+				std::uint32_t iRes = dst_or_tmp(iDst);
+				emit(BC_NEWARR, iRes, iBase, vecElems.size());
+				return iRes;
+			}
+
+			case NODE_ARRAY_ACCESS:
+			{
+				const NodeArrayAccess *pAcc = (const NodeArrayAccess*)pNode;
+				std::uint32_t iCont = expr(pAcc->GetIdent(), BC_NOREG);
+
+				// a missing container has to fail before the index is evaluated,
+				// the check is only needed if the index is not a slot or constant
+				std::size_t iChk = emit(BC_CHKCONT, iCont);
+				std::uint32_t iIdx = expr(bc_flatten(pAcc->GetExpr(), NODE_ARGS)[0], BC_NOREG);
+				if(here() == iChk+1)
+				{
+					m_prog.m_vecCode.pop_back();
+					m_prog.m_vecCodeNodes.pop_back();
+				}
+				m_iTop = iTop;
+
+				std::uint32_t iRes = dst_or_tmp(iDst);
+				emit(BC_INDEX, iRes, iCont, iIdx);
+				return iRes;
+			}
+
+			default:
+				m_bOk = 0;
+				return dst_or_tmp(iDst);
+		}
+	}
+
+	void expr_stmt(const Node* pNode)
+	{
+		const std::uint32_t iTop = m_iTop;
+
+		std::uint32_t iRes = expr(pNode, BC_NOREG);
+		if(iRes >= m_iTmpBase)
+			emit(BC_DROP, iRes);
+
+		m_iTop = iTop;
+	}
+
+	std::uint32_t cond(const Node* pNode)
+	{
+		const std::uint32_t iTop = m_iTop;
+		std::uint32_t iRes = expr(pNode, BC_NOREG);
+		m_iTop = iTop;
+		return iRes;
+	}
+
+	void stmt(const Node* pNode)
+	{
+		if(!pNode) return;
+
+		const Node *pOldNode = m_pCurNode;
+		if(pNode->GetLine())
+			m_pCurNode = pNode;
+
+		switch(pNode->GetType())
+		{
+			case NODE_STMTS:
+			{
+				for(const Node *pStmt : bc_flatten(pNode, NODE_STMTS))
+					stmt(pStmt);
+				break;
+			}
+
+			case NODE_IF:
+			{
+				const NodeIf *pIf = (const NodeIf*)pNode;
+				std::size_t iJmpElse = emit(BC_JMPF, cond(pIf->GetExpr()));
+				stmt(pIf->GetIf());
+
+				if(pIf->GetElse())
+				{
+					std::size_t iJmpEnd = emit(BC_JMP);
+					m_prog.m_vecCode[iJmpElse].b = here();
+					stmt(pIf->GetElse());
+					m_prog.m_vecCode[iJmpEnd].a = here();
+				}
+				else
+				{
+					m_prog.m_vecCode[iJmpElse].b = here();
+				}
+				break;
+			}
+
+			case NODE_WHILE:
+			{
+				const NodeWhile *pWhile = (const NodeWhile*)pNode;
+
+				std::uint32_t iCond = here();
+				std::size_t iJmpEnd = emit(BC_JMPF, cond(pWhile->GetExpr()));
+
+				m_vecLoops.emplace_back();
+				stmt(pWhile->GetStmt());
+				emit(BC_JMP, iCond);
+				end_loop(iCond, iJmpEnd);
+				break;
+			}
+
+			case NODE_FOR:
+			{
+				const NodeFor *pFor = (const NodeFor*)pNode;
+				if(pFor->GetExprInit())
+					expr_stmt(pFor->GetExprInit());
+
+				std::uint32_t iCond = here();
+				std::size_t iJmpEnd = emit(BC_JMPF, cond(pFor->GetExprCond()));
+
+				m_vecLoops.emplace_back();
+				stmt(pFor->GetStmt());
+
+				std::uint32_t iNext = here();
+				if(pFor->GetExprEnd())
+					expr_stmt(pFor->GetExprEnd());
+				emit(BC_JMP, iCond);
+				end_loop(iNext, iJmpEnd);
+				break;
+			}
+
+			case NODE_RETURN:
+			{
+				const Node *pExpr = ((const NodeReturn*)pNode)->GetExpr();
+				if(pExpr)
+					emit(BC_RET, cond(pExpr), 1);
+				else
+					emit(BC_RET, 0, 0);
+				break;
+			}
+
+			case NODE_BREAK:
+				m_vecLoops.back().vecBreaks.push_back(emit(BC_JMP));
+				break;
+
+			case NODE_CONTINUE:
+				m_vecLoops.back().vecConts.push_back(emit(BC_JMP));
+				break;
+
+			default:
+				expr_stmt(pNode);
+				break;
+		}
+
+		m_pCurNode = pOldNode;
+	}
+
+	void end_loop(std::uint32_t iContinue, std::size_t iJmpEnd)
+	{
+		std::uint32_t iEnd = here();
+		m_prog.m_vecCode[iJmpEnd].b = iEnd;
+
+		for(std::size_t iJmp : m_vecLoops.back().vecBreaks)
+			m_prog.m_vecCode[iJmp].a = iEnd;
+		for(std::size_t iJmp : m_vecLoops.back().vecConts)
+			m_prog.m_vecCode[iJmp].a = iContinue;
+
+		m_vecLoops.pop_back();
+	}
+
+public:
+	BcCompiler(BcProgram& prog) : m_prog(prog) {}
+
+	bool compile(const NodeFunction *pFunc)
+	{
+		m_prog.m_pFunc = pFunc;
+		m_pCurNode = pFunc;
+
+		for(const Node *pArg : pFunc->GetArgVec())
+		{
+			if(!pArg || pArg->GetType() != NODE_IDENT)
+				return 0;
+
+			const t_string& strArg = ((const NodeIdent*)pArg)->GetIdent();
+			if(m_mapSlots.find(strArg) != m_mapSlots.end())
+				return 0;
+			add_slot(strArg);
+		}
+		m_prog.m_iNumParams = m_mapSlots.size();
+
+		if(!scan(pFunc->GetStmts()))
+			return 0;
+
+		// a name has to be either local or global throughout the function
+		for(const t_string& strGlob : m_setGlobalAssigns)
+			if(m_mapSlots.find(strGlob) != m_mapSlots.end())
+				return 0;
+
+		m_prog.m_iNumSlots = m_mapSlots.size();
+		m_iConstBase = m_prog.m_iNumSlots;
+		m_iTmpBase = m_iConstBase + m_prog.m_vecConsts.size();
+		m_iTop = m_iMaxTop = m_iTmpBase;
+
+		stmt(pFunc->GetStmts());
+		m_pCurNode = pFunc;
+		emit(BC_RET, 0, 0);
+
+		m_prog.m_iNumRegs = m_iMaxTop;
+		return m_bOk;
+	}
+};
+
+
+std::shared_ptr<BcProgram> bc_compile(const NodeFunction *pFunc)
+{
+	std::shared_ptr<BcProgram> pProg = std::make_shared<BcProgram>();
+
+	BcCompiler comp(*pProg);
+	if(!comp.compile(pFunc))
+	{
+		tl::log_debug("Function \"", pFunc->GetName(),
+			"\" cannot be compiled, evaluating its syntax tree.");
+		return nullptr;
+	}
+
+	tl::log_debug("Compiled function \"", pFunc->GetName(), "\" to ",
+		pProg->GetCodeSize(), " instructions using ",
+		pProg->GetNumRegs(), " registers.");
+	return pProg;
+}
+
+
+void BcProgram::print(std::ostream& ostr) const
+{
+	ostr << "function " << m_pFunc->GetName() << ": "
+		<< m_iNumParams << " params, " << m_iNumSlots << " slots, "
+		<< m_vecConsts.size() << " constants, " << m_iNumRegs << " registers\n";
+
+	for(std::size_t iInstr=0; iInstr<m_vecCode.size(); ++iInstr)
+	{
+		const BcInstr& instr = m_vecCode[iInstr];
+		ostr << std::setw(5) << iInstr << "  " << std::left << std::setw(8)
+			<< bc_opname(instr.op) << std::right
+			<< instr.a << ", " << instr.b << ", " << instr.c;
+
+		if(instr.op == BC_LOADG || instr.op == BC_STOREG)
+			ostr << "\t; " << m_vecNames[instr.op==BC_LOADG ? instr.b : instr.a];
+		else if(instr.op == BC_STOREL)
+			ostr << "\t; " << m_vecNames[instr.a];
+		else if(instr.op == BC_CALL)
+			ostr << "\t; " << m_vecCalls[instr.b].strFkt;
+		ostr << "\n";
+	}
+}
+
+
+
+// --------------------------------------------------------------------------------
+// vm
+
+namespace {
+
+/**
+ * boxes unboxed scalars for the generic symbol operations
+ */
+struct BcBox
+{
+	SymbolInt symInt;
+	SymbolReal symReal;
+
+	const Symbol* get(const BcValue& val)
+	{
+		switch(val.ty)
+		{
+			case BCVAL_INT: symInt.SetVal(val.iVal); return &symInt;
+			case BCVAL_REAL: symReal.SetVal(val.dVal); return &symReal;
+			case BCVAL_SYM: return val.pSym;
+			default: return nullptr;
+		}
+	}
+};
+
+
+}	// namespace
+
+
+/**
+ * registers of one function invocation
+ */
+class BcFrame
+{
+public:
+	const BcProgram& m_prog;
+	ParseInfo& m_info;
+	RuntimeInfo& m_runinfo;
+
+	std::vector<BcValue> m_vecRegs;
+
+	// empty table for calls, some system functions need a local scope
+	std::unique_ptr<SymbolTable> m_ptrTable;
+
+public:
+	BcFrame(const BcProgram& prog, ParseInfo& info, RuntimeInfo& runinfo, std::uint32_t iNumRegs)
+		: m_prog(prog), m_info(info), m_runinfo(runinfo), m_vecRegs(iNumRegs)
+	{}
+
+	~BcFrame()
+	{
+		for(BcValue& val : m_vecRegs)
+			release(val);
+	}
+
+	SymbolTable* table()
+	{
+		if(!m_ptrTable)
+			m_ptrTable.reset(new SymbolTable());
+		return m_ptrTable.get();
+	}
+
+	void free_sym(Symbol* pSym, BcOwner own)
+	{
+		if(own == BCOWN_TMP || own == BCOWN_SLOT || is_tmp_sym(pSym))
+			delete pSym;
+		else if(own == BCOWN_EXT)
+			safe_delete(pSym, table(), &m_info);
+	}
+
+	void release(BcValue& val)
+	{
+		if(val.ty == BCVAL_SYM && val.own != BCOWN_NONE)
+			free_sym(val.pSym, val.own);
+
+		val.ty = BCVAL_NIL;
+		val.own = BCOWN_NONE;
+	}
+
+	// releases a temporary operand after use
+	void consume(std::uint32_t iReg)
+	{
+		BcValue& val = m_vecRegs[iReg];
+		if(val.ty == BCVAL_SYM && (val.own == BCOWN_TMP || val.own == BCOWN_EXT))
+			release(val);
+	}
+
+	void set(std::uint32_t iReg, const BcValue& valNew)
+	{
+		BcValue& val = m_vecRegs[iReg];
+		if(val.ty == BCVAL_SYM && val.own != BCOWN_NONE &&
+			!(valNew.ty == BCVAL_SYM && valNew.pSym == val.pSym))
+			release(val);
+		val = valNew;
+	}
+
+	// converts a symbol into a register value, scalars are unboxed
+	BcValue from_sym(Symbol* pSym, BcOwner own)
+	{
+		BcValue val;
+		if(!pSym)
+			return val;
+
+		if(pSym->GetType() == SYMBOL_INT)
+		{
+			val.ty = BCVAL_INT;
+			val.bLval = !pSym->IsRval();
+			val.iVal = ((SymbolInt*)pSym)->GetVal();
+			if(own != BCOWN_NONE)
+				free_sym(pSym, own);
+		}
+		else if(pSym->GetType() == SYMBOL_DOUBLE)
+		{
+			val.ty = BCVAL_REAL;
+			val.bLval = !pSym->IsRval();
+			val.dVal = ((SymbolReal*)pSym)->GetVal();
+			if(own != BCOWN_NONE)
+				free_sym(pSym, own);
+		}
+		else
+		{
+			val.ty = BCVAL_SYM;
+			val.own = own;
+			val.pSym = pSym;
+		}
+
+		return val;
+	}
+
+	BcValue load_global(const t_string& strName, const Node* pNode)
+	{
+		Symbol *pSym = m_info.GetGlobalSymbol(strName, &m_runinfo);
+
+		if(!pSym)
+		{
+			tl::log_err(linenr(pNode), "Symbol \"", strName, "\" not in symbol table.");
+			return BcValue();
+		}
+
+		m_info.SetGlobalIdent(pSym, strName);
+		return from_sym(pSym, BCOWN_NONE);
+	}
+
+	// reads an operand, unset local slots refer to global symbols
+	BcValue get(std::uint32_t iReg, const Node* pNode)
+	{
+		const BcValue& val = m_vecRegs[iReg];
+		if(val.ty == BCVAL_NIL && iReg < m_prog.m_iNumSlots)
+			return load_global(m_prog.m_vecNames[iReg], pNode);
+		return val;
+	}
+
+	/**
+	 * returns an operand as a symbol owned by the caller,
+	 * temporaries are adopted, everything else is copied
+	 */
+	Symbol* take(std::uint32_t iReg, const Node* pNode)
+	{
+		BcValue& val = m_vecRegs[iReg];
+		if(val.ty == BCVAL_SYM && (val.own == BCOWN_TMP || val.own == BCOWN_EXT)
+			&& is_tmp_sym(val.pSym))
+		{
+			// keep a borrowed reference in the register
+			val.own = BCOWN_NONE;
+			return val.pSym;
+		}
+
+		BcValue valGet = get(iReg, pNode);
+		Symbol *pSym = nullptr;
+		switch(valGet.ty)
+		{
+			case BCVAL_INT: pSym = new SymbolInt(valGet.iVal); break;
+			case BCVAL_REAL: pSym = new SymbolReal(valGet.dVal); break;
+			case BCVAL_SYM: pSym = valGet.pSym->clone(); break;
+			default: break;
+		}
+
+		consume(iReg);
+		return pSym;
+	}
+
+	/**
+	 * looks up an array or map element, missing elements are created
+	 * as in NodeArrayAccess::eval
+	 */
+	Symbol* element(Symbol* pCont, const BcValue& valIdx, const Node* pNode)
+	{
+		if(pCont->GetType() == SYMBOL_ARRAY)
+		{
+			if(valIdx.ty != BCVAL_INT)
+				error(pNode, "Array index has to be of integer type.");
+
+			SymbolArray *pArr = (SymbolArray*)pCont;
+			std::vector<Symbol*>& vecArr = pArr->GetArr();
+
+			t_int iIdx = valIdx.iVal;
+			if(iIdx < 0)
+				iIdx = vecArr.size() + iIdx;
+			if(iIdx < 0)
+				error(pNode, "Invalid array index.");
+
+			// index too high -> fill up with zeroes
+			while(iIdx >= t_int(vecArr.size()))
+			{
+				SymbolReal *pNewSym = new SymbolReal(0.);
+				pNewSym->SetConst(1);
+				vecArr.push_back(pNewSym);
+			}
+
+			pArr->UpdateIndex(iIdx);
+			return vecArr[iIdx];
+		}
+
+		BcBox boxKey;
+		const Symbol *pKey = boxKey.get(valIdx);
+		if(!pKey)
+			error(pNode, "Map key is invalid.");
+
+		SymbolMap *pMap = (SymbolMap*)pCont;
+		SymbolMapKey key = SymbolMapKey(pKey);
+		SymbolMap::t_map::iterator iterMap = pMap->GetMap().find(key);
+
+		// key not yet in map -> insert it
+		if(iterMap == pMap->GetMap().end())
+		{
+			SymbolString *pNewSym = new SymbolString();
+			pNewSym->SetConst(1);
+			iterMap = pMap->GetMap().insert(SymbolMap::t_map::value_type(key, pNewSym)).first;
+		}
+
+		pMap->UpdateIndex(key);
+		return iterMap->second;
+	}
+
+	t_string linenr(const Node* pNode) const
+	{
+		return pNode ? pNode->linenr(m_runinfo) : m_prog.m_pFunc->linenr(m_runinfo);
+	}
+
+	[[noreturn]] void error(const Node* pNode, const char* pcMsg) const
+	{
+		std::ostringstream ostrErr;
+		ostrErr << linenr(pNode) << pcMsg << std::endl;
+		throw tl::Err(ostrErr.str(), 0);
+	}
+};
+
+
+namespace {
+
+inline bool bc_is_true(const BcValue& val)
+{
+	switch(val.ty)
+	{
+		case BCVAL_INT: return val.iVal != 0;
+		case BCVAL_REAL: return val.dVal != 0.;
+		case BCVAL_SYM: return val.pSym->IsNotZero();
+		default: return 0;
+	}
+}
+
+inline t_int bc_int_val(const BcValue& val)
+{
+	switch(val.ty)
+	{
+		case BCVAL_INT: return val.iVal;
+		case BCVAL_REAL: return t_int(val.dVal);
+		case BCVAL_SYM: return val.pSym->GetValInt();
+		default: return 0;
+	}
+}
+
+
+/**
+ * arithmetic and logical operations on unboxed scalars,
+ * mirrors the type rules of Node::Op
+ */
+inline bool bc_scalar_op(BcOp op, const BcValue& valL, const BcValue& valR, BcValue& valRes)
+{
+	if(valL.ty == BCVAL_INT && valR.ty == BCVAL_INT)
+	{
+		const t_int iL = valL.iVal, iR = valR.iVal;
+		valRes.ty = BCVAL_INT;
+
+		switch(op)
+		{
+			case BC_ADD: valRes.iVal = iL + iR; break;
+			case BC_SUB: valRes.iVal = iL - iR; break;
+			case BC_MUL: valRes.iVal = iL * iR; break;
+			case BC_DIV: valRes.iVal = iL / iR; break;
+			case BC_MOD: valRes.iVal = iL % iR; break;
+			case BC_POW: valRes.iVal = t_int(std::pow(iL, iR)); break;
+			case BC_EQ: valRes.iVal = (iL == iR); break;
+			case BC_NEQ: valRes.iVal = (iL != iR); break;
+			case BC_LESS: valRes.iVal = (iL < iR); break;
+			case BC_GREATER: valRes.iVal = (iL > iR); break;
+			case BC_LEQ: valRes.iVal = (iL <= iR); break;
+			case BC_GEQ: valRes.iVal = (iL >= iR); break;
+			case BC_AND: valRes.iVal = (iL && iR); break;
+			case BC_OR: valRes.iVal = (iL || iR); break;
+			default: return 0;
+		}
+		return 1;
+	}
+
+	if((valL.ty == BCVAL_INT || valL.ty == BCVAL_REAL) &&
+		(valR.ty == BCVAL_INT || valR.ty == BCVAL_REAL))
+	{
+		const t_real dL = (valL.ty == BCVAL_INT ? t_real(valL.iVal) : valL.dVal);
+		const t_real dR = (valR.ty == BCVAL_INT ? t_real(valR.iVal) : valR.dVal);
+
+		valRes.ty = BCVAL_REAL;
+		switch(op)
+		{
+			case BC_ADD: valRes.dVal = dL + dR; return 1;
+			case BC_SUB: valRes.dVal = dL - dR; return 1;
+			case BC_MUL: valRes.dVal = dL * dR; return 1;
+			case BC_DIV: valRes.dVal = dL / dR; return 1;
+			case BC_MOD: valRes.dVal = std::fmod(dL, dR); return 1;
+			case BC_POW: valRes.dVal = std::pow(dL, dR); return 1;
+			default: break;
+		}
+
+		valRes.ty = BCVAL_INT;
+		switch(op)
+		{
+			case BC_EQ: valRes.iVal = tl::float_equal(dL, dR); break;
+			case BC_NEQ: valRes.iVal = !tl::float_equal(dL, dR); break;
+			case BC_LESS: valRes.iVal = (dL < dR); break;
+			case BC_GREATER: valRes.iVal = (dL > dR); break;
+			case BC_LEQ: valRes.iVal = (dL <= dR); break;
+			case BC_GEQ: valRes.iVal = (dL >= dR); break;
+			case BC_AND: valRes.iVal = (dL && dR); break;
+			case BC_OR: valRes.iVal = (dL || dR); break;
+			default: return 0;
+		}
+		return 1;
+	}
+
+	return 0;
+}
+
+
+// keeps the boxed arguments of a call alive until it returns
+struct BcCallArgs
+{
+	SymbolArray arrArgs;
+	std::vector<bool> vecCreated;
+
+	BcCallArgs(std::size_t iNum) : vecCreated(iNum, false)
+	{
+		arrArgs.SetDontDel(1);
+		arrArgs.GetArr().reserve(iNum);
+	}
+
+	~BcCallArgs()
+	{
+		for(std::size_t iArg=0; iArg<vecCreated.size(); ++iArg)
+			if(vecCreated[iArg])
+				delete arrArgs.GetArr()[iArg];
+		arrArgs.GetArr().clear();
+	}
+};
+
+}	// namespace
+
+
+Symbol* BcProgram::run(ParseInfo &info, RuntimeInfo& runinfo, SymbolTable *pTableSup) const
+{
+	if(runinfo.IsExecDisabled()) return 0;
+
+	const t_string& strName = m_pFunc->GetName();
+	BcFrame frame(*this, info, runinfo, m_iNumRegs);
+	std::vector<BcValue>& regs = frame.m_vecRegs;
+
+	std::copy(m_vecConsts.begin(), m_vecConsts.end(), regs.begin() + m_iNumSlots);
+
+
+	// arguments, see NodeFunction::eval
+	SymbolArray* pArgs = 0;
+	if(pTableSup)
+		pArgs = (SymbolArray*)pTableSup->GetSymbol(T_STR"<args>");
+
+	if(pArgs)
+	{
+		const std::vector<Symbol*>& vecArgSyms = pArgs->GetArr();
+		const std::vector<Node*>& vecParams = m_pFunc->GetArgVec();
+
+		if(m_iNumParams != vecArgSyms.size())
+		{
+			tl::log_warn(m_pFunc->linenr(runinfo), "Function \"",
+					strName, "\"", " takes ",
+					m_iNumParams, " arguments, but ",
+					vecArgSyms.size(), " given.");
+		}
+
+		for(std::uint32_t iArg=0; iArg<m_iNumParams; ++iArg)
+		{
+			const NodeIdent* pIdent = (NodeIdent*)vecParams[iArg];
+			const Node* pDefArg = pIdent->GetDefArg();
+
+			Symbol *pSymbol = 0;
+			if(iArg < vecArgSyms.size())
+				pSymbol = vecArgSyms[iArg];
+			if(pSymbol==0 && pDefArg)
+			{
+				pSymbol = pDefArg->eval(info, runinfo, pTableSup);
+
+				if(iArg < vecArgSyms.size() && pSymbol)
+					tl::log_warn(m_pFunc->linenr(runinfo),
+						"Given argument \"", pIdent->GetIdent(),
+						"\" for function \"",
+						strName, "\" not valid. ",
+						"Using default argument.");
+			}
+			if(pSymbol==0)
+			{
+				tl::log_err(m_pFunc->linenr(runinfo), "Argument \"",
+					pIdent->GetIdent(), "\" for function \"",
+					strName, "\" not given. Ignoring.");
+				continue;
+			}
+
+			BcValue& valSlot = regs[iArg];
+			if(pSymbol->GetType() == SYMBOL_INT || pSymbol->GetType() == SYMBOL_DOUBLE)
+			{
+				valSlot = frame.from_sym(pSymbol, BCOWN_EXT);
+				valSlot.bLval = 1;
+				continue;
+			}
+
+			Symbol* pSymToInsert;
+			if(clone_if_needed(pSymbol, pSymToInsert))
+				safe_delete(pSymbol, frame.table(), &info);
+			pSymToInsert->SetRval(0);
+			pSymToInsert->SetConst(1);
+			pSymToInsert->SetIdent(pIdent->GetIdent());
+
+			valSlot.ty = BCVAL_SYM;
+			valSlot.own = BCOWN_SLOT;
+			valSlot.pSym = pSymToInsert;
+		}
+	}
+
+
+	const BcInstr *pCode = m_vecCode.data();
+	const std::size_t iCodeSize = m_vecCode.size();
+
+	for(std::size_t iPC=0; iPC<iCodeSize;)
+	{
+		const BcInstr& instr = pCode[iPC];
+		const Node *pNode = m_vecCodeNodes[iPC];
+		++iPC;
+
+		switch(instr.op)
+		{
+			case BC_NOP:
+				break;
+
+			case BC_MOVE:
+			{
+				BcValue val = frame.get(instr.b, pNode);
+
+				// the destination takes over temporaries
+				BcValue& valSrc = regs[instr.b];
+				if(valSrc.ty == BCVAL_SYM && (valSrc.own == BCOWN_TMP || valSrc.own == BCOWN_EXT))
+					valSrc.own = BCOWN_NONE;
+				else if(val.own == BCOWN_SLOT)
+					val.own = BCOWN_NONE;
+
+				frame.set(instr.a, val);
+				break;
+			}
+
+			case BC_DROP:
+				frame.consume(instr.a);
+				break;
+
+			case BC_LOADG:
+				frame.set(instr.a, frame.load_global(m_vecNames[instr.b], pNode));
+				break;
+
+			case BC_STOREL:
+			{
+				const t_string& strIdent = m_vecNames[instr.a];
+				BcValue val = frame.get(instr.b, pNode);
+				if(val.ty == BCVAL_NIL)
+				{
+					tl::log_err(frame.linenr(pNode), "Invalid rhs expression in assignment.");
+					break;
+				}
+
+				BcValue& valSlot = regs[instr.a];
+
+				// first assignment to a name which only exists globally
+				if(valSlot.ty == BCVAL_NIL && info.pGlobalSyms)
+				{
+					if(info.GetGlobalSymbol(strIdent, &runinfo))
+					{
+						tl::log_warn(frame.linenr(pNode), "Overwriting global symbol \"", strIdent, "\".");
+						info.InsertGlobalSymbol(strIdent, frame.take(instr.b, pNode));
+						break;
+					}
+				}
+
+				if(val.ty == BCVAL_INT || val.ty == BCVAL_REAL)
+				{
+					frame.release(valSlot);
+					valSlot = val;
+					valSlot.own = BCOWN_NONE;
+					valSlot.bLval = 1;
+					break;
+				}
+
+				if(valSlot.ty == BCVAL_SYM && valSlot.pSym == val.pSym)
+					break;
+
+				Symbol *pSym = frame.take(instr.b, pNode);
+				pSym->SetRval(0);
+				pSym->SetConst(1);
+				pSym->SetIdent(strIdent);
+
+				frame.release(valSlot);
+				valSlot.ty = BCVAL_SYM;
+				valSlot.own = BCOWN_SLOT;
+				valSlot.pSym = pSym;
+				break;
+			}
+
+			case BC_STOREG:
+			{
+				Symbol *pSym = frame.take(instr.b, pNode);
+				if(!pSym)
+				{
+					tl::log_err(frame.linenr(pNode), "Invalid rhs expression in assignment.");
+					break;
+				}
+
+				if(info.pGlobalSyms)
+					info.InsertGlobalSymbol(m_vecNames[instr.a], pSym);
+				else
+					delete pSym;
+				break;
+			}
+
+			case BC_ADD: case BC_SUB: case BC_MUL: case BC_DIV: case BC_MOD: case BC_POW:
+			case BC_EQ: case BC_NEQ: case BC_LESS: case BC_GREATER: case BC_LEQ: case BC_GEQ:
+			case BC_AND: case BC_OR:
+			{
+				BcValue valL = frame.get(instr.b, pNode);
+				BcValue valR = frame.get(instr.c, pNode);
+				BcValue valRes;
+
+				if(!bc_scalar_op(instr.op, valL, valR, valRes))
+				{
+					BcBox boxL, boxR;
+					Symbol *pRes = Node::Op(boxL.get(valL), boxR.get(valR),
+						bc_nodetype(instr.op), false);
+					valRes = frame.from_sym(pRes, BCOWN_TMP);
+				}
+
+				frame.consume(instr.b);
+				frame.consume(instr.c);
+				frame.set(instr.a, valRes);
+				break;
+			}
+
+			case BC_NEG:
+			{
+				BcValue val = frame.get(instr.b, pNode);
+				BcValue valRes;
+
+				if(val.ty == BCVAL_INT)
+				{
+					valRes.ty = BCVAL_INT;
+					valRes.iVal = -val.iVal;
+				}
+				else if(val.ty == BCVAL_REAL)
+				{
+					valRes.ty = BCVAL_REAL;
+					valRes.dVal = -val.dVal;
+				}
+				else if(val.ty == BCVAL_SYM)
+				{
+					Symbol *pSym = frame.take(instr.b, pNode);
+					uminus_inplace(pSym, info, runinfo);
+					valRes = frame.from_sym(pSym, BCOWN_TMP);
+				}
+
+				frame.consume(instr.b);
+				frame.set(instr.a, valRes);
+				break;
+			}
+
+			case BC_NOT:
+			{
+				BcValue val = frame.get(instr.b, pNode);
+				BcValue valRes;
+				valRes.ty = BCVAL_INT;
+
+				if(val.ty == BCVAL_INT)
+					valRes.iVal = !val.iVal;
+				else if(val.ty == BCVAL_REAL)
+					valRes.iVal = !val.dVal;
+				else
+					valRes.iVal = 0;
+
+				frame.consume(instr.b);
+				frame.set(instr.a, valRes);
+				break;
+			}
+
+			case BC_JMP:
+				iPC = instr.a;
+				break;
+
+			case BC_JMPF:
+			{
+				bool bTrue = bc_is_true(frame.get(instr.a, pNode));
+				frame.consume(instr.a);
+				if(!bTrue)
+					iPC = instr.b;
+				break;
+			}
+
+			case BC_JAND:
+			case BC_JOR:
+			{
+				// short-circuit evaluation as in NodeBinaryOp::eval
+				const t_int iShort = (instr.op == BC_JAND ? 0 : 1);
+				if(bc_int_val(frame.get(instr.b, pNode)) == iShort)
+				{
+					frame.consume(instr.b);
+
+					BcValue valRes;
+					valRes.ty = BCVAL_INT;
+					valRes.iVal = iShort;
+					frame.set(instr.a, valRes);
+					iPC = instr.c;
+				}
+				break;
+			}
+
+			case BC_CALL:
+			{
+				const BcCallInfo& call = m_vecCalls[instr.b];
+				runinfo.pCurCaller = call.pNode;
+
+				BcCallArgs args(call.iNumArgs);
+				std::vector<Symbol*>& vecArgs = args.arrArgs.GetArr();
+
+				for(std::uint32_t iArg=0; iArg<call.iNumArgs; ++iArg)
+				{
+					BcValue val = frame.get(call.iFirstArg + iArg, pNode);
+					Symbol *pSym = nullptr;
+
+					switch(val.ty)
+					{
+						case BCVAL_INT: pSym = new SymbolInt(val.iVal); args.vecCreated[iArg] = 1; break;
+						case BCVAL_REAL: pSym = new SymbolReal(val.dVal); args.vecCreated[iArg] = 1; break;
+						case BCVAL_SYM: pSym = val.pSym; break;
+						default: break;
+					}
+
+					// boxed variables are no temporaries
+					if(args.vecCreated[iArg] && val.bLval)
+						pSym->SetRval(0);
+
+					vecArgs.push_back(pSym);
+				}
+
+				NodeFunction *pFkt = info.GetFunction(call.strFkt);
+				Symbol *pRet = call.pNode->call(info, runinfo, frame.table(), pFkt, args.arrArgs);
+				runinfo.pCurFunction = m_pFunc;
+
+				BcValue valRes;
+				bool bRetIsArg = 0;
+				for(std::uint32_t iArg=0; iArg<call.iNumArgs && pRet; ++iArg)
+				{
+					if(vecArgs[iArg] != pRet)
+						continue;
+
+					// function handed back one of its arguments
+					bRetIsArg = 1;
+					if(args.vecCreated[iArg])
+					{
+						args.vecCreated[iArg] = 0;
+						valRes = frame.from_sym(pRet, BCOWN_TMP);
+					}
+					else
+					{
+						valRes = frame.from_sym(pRet->clone(), BCOWN_TMP);
+					}
+					break;
+				}
+
+				if(!bRetIsArg)
+					valRes = frame.from_sym(pRet, BCOWN_EXT);
+
+				for(std::uint32_t iArg=0; iArg<call.iNumArgs; ++iArg)
+					frame.consume(call.iFirstArg + iArg);
+
+				frame.set(instr.a, valRes);
+				break;
+			}
+
+			case BC_NEWARR:
+			{
+				SymbolArray *pArr = new SymbolArray();
+				pArr->GetArr().reserve(instr.c);
+
+				for(std::uint32_t iElem=0; iElem<instr.c; ++iElem)
+				{
+					pArr->GetArr().push_back(frame.take(instr.b + iElem, pNode));
+					frame.consume(instr.b + iElem);
+				}
+				pArr->UpdateIndices();
+
+				BcValue valRes;
+				valRes.ty = BCVAL_SYM;
+				valRes.own = BCOWN_TMP;
+				valRes.pSym = pArr;
+				frame.set(instr.a, valRes);
+				break;
+			}
+
+			case BC_INDEX:
+			{
+				// stop at a missing container before looking up the index, like the tree walker
+				BcValue valCont = frame.get(instr.b, pNode);
+				if(valCont.ty == BCVAL_NIL)
+					frame.error(pNode, "Symbol for array not found.");
+
+				BcValue valIdx = frame.get(instr.c, pNode);
+
+				// elements of temporary containers have to be copied out
+				const bool bTmpCont = (valCont.ty == BCVAL_SYM &&
+					(valCont.own == BCOWN_TMP || valCont.own == BCOWN_EXT));
+				Symbol *pElem = nullptr;
+				BcValue valRes;
+
+				if(valCont.ty == BCVAL_SYM && (valCont.pSym->GetType() == SYMBOL_ARRAY ||
+					valCont.pSym->GetType() == SYMBOL_MAP))
+				{
+					pElem = frame.element(valCont.pSym, valIdx, pNode);
+				}
+				else if(valCont.ty == BCVAL_SYM && valCont.pSym->GetType() == SYMBOL_STRING)
+				{
+					if(valIdx.ty != BCVAL_INT)
+						frame.error(pNode, "String index has to be of integer type.");
+
+					const t_string& strVal = ((SymbolString*)valCont.pSym)->GetVal();
+					const t_int iStrLen = strVal.length();
+
+					t_int iIdx = valIdx.iVal;
+					if(iIdx < 0)
+						iIdx = iStrLen + iIdx;
+					if(iIdx < 0 || iIdx >= iStrLen)
+						frame.error(pNode, "String index out of bounds.");
+
+					valRes.ty = BCVAL_SYM;
+					valRes.own = BCOWN_TMP;
+					valRes.pSym = new SymbolString(t_string(1, strVal[iIdx]));
+				}
+				else
+				{
+					std::ostringstream ostrErr;
+					ostrErr << frame.linenr(pNode) << "Symbol \""
+						<< (valCont.ty == BCVAL_SYM ? valCont.pSym->GetIdent() : T_STR"<tmp_sym>")
+						<< "\" is neither an array nor a map." << std::endl;
+					throw tl::Err(ostrErr.str(), 0);
+				}
+
+				if(pElem)
+				{
+					const bool bUnboxed = (pElem->GetType() == SYMBOL_INT ||
+						pElem->GetType() == SYMBOL_DOUBLE);
+					if(bTmpCont && !bUnboxed)
+						valRes = frame.from_sym(pElem->clone(), BCOWN_TMP);
+					else
+						valRes = frame.from_sym(pElem, BCOWN_NONE);
+				}
+
+				frame.consume(instr.c);
+				frame.consume(instr.b);
+				frame.set(instr.a, valRes);
+				break;
+			}
+
+			case BC_CHKCONT:
+				if(frame.get(instr.a, pNode).ty == BCVAL_NIL)
+					frame.error(pNode, "Symbol for array not found.");
+				break;
+
+			case BC_STOREX:
+			{
+				BcValue valCont = frame.get(instr.a, pNode);
+				BcValue valIdx = frame.get(instr.b, pNode);
+
+				if(valCont.ty == BCVAL_NIL)
+					frame.error(pNode, "Symbol for array not found.");
+				if(valCont.ty != BCVAL_SYM || (valCont.pSym->GetType() != SYMBOL_ARRAY &&
+					valCont.pSym->GetType() != SYMBOL_MAP))
+					frame.error(pNode, "Trying to access array/map member with no associated array/map.");
+
+				Symbol *pElem = frame.element(valCont.pSym, valIdx, pNode);
+				Symbol *pSym = frame.take(instr.c, pNode);
+				if(!pSym)
+				{
+					tl::log_err(frame.linenr(pNode), "Invalid rhs expression in assignment.");
+					frame.consume(instr.b);
+					frame.consume(instr.a);
+					break;
+				}
+				pSym->SetRval(0);
+
+				// replace the element, see NodeBinaryOp::eval_assign
+				if(pElem->GetType() == pSym->GetType())
+				{
+					pElem->assign(pSym);
+					delete pSym;
+					pSym = pElem;
+				}
+				else if(pElem->GetArrPtr())
+				{
+					SymbolArray* pArr = pElem->GetArrPtr();
+					t_int iArrIdx = pElem->GetArrIdx();
+
+					pArr->GetArr()[iArrIdx] = pSym;
+					pSym->SetArrPtr(pArr);
+					pSym->SetArrIdx(iArrIdx);
+
+					pElem->SetArrPtr(0);
+					safe_delete(pElem, frame.table(), &info);
+				}
+				else
+				{
+					SymbolMap* pMap = pElem->GetMapPtr();
+					const SymbolMapKey& key = pElem->GetMapKey();
+
+					pSym->SetMapPtr(pMap);
+					pSym->SetMapKey(key);
+					pMap->GetMap()[key] = pSym;
+
+					pElem->SetMapPtr(0);
+					safe_delete(pElem, frame.table(), &info);
+				}
+
+				// elements of temporary containers do not outlive them
+				if(valCont.own == BCOWN_TMP || valCont.own == BCOWN_EXT)
+					frame.set(instr.c, frame.from_sym(pSym->clone(), BCOWN_TMP));
+				else
+					frame.set(instr.c, frame.from_sym(pSym, BCOWN_NONE));
+				frame.consume(instr.b);
+				frame.consume(instr.a);
+				break;
+			}
+
+			case BC_RET:
+			{
+				if(!instr.b)
+					return nullptr;
+
+				Symbol *pRet = frame.take(instr.a, pNode);
+				// return values are stored in the callee's table, see NodeReturn::eval
+				if(pRet)
+				{
+					pRet->SetRval(0);
+					pRet->SetConst(0);
+				}
+				return pRet;
+			}
+		}
+	}
+
+	return nullptr;
+}
@@ -0,0 +1,185 @@
+/**
+ * Script interpreter
+ * Bytecode compiler and register VM
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2 or GPLv3
+ *
+ * ----------------------------------------------------------------------------
+ * tlibs -- a physical-mathematical C++ template library
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2015-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef __SCRIPT_BYTECODE__
+#define __SCRIPT_BYTECODE__
+
+#include "types.h"
+#include "symbol.h"
+
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <ostream>
+
+struct ParseInfo;
+struct RuntimeInfo;
+
+class Node;
+class NodeFunction;
+class NodeCall;
+
+
+/**
+ * opcodes, operands a, b, c are register indices unless noted otherwise
+ */
+enum BcOp : std::uint8_t
+{
+	BC_NOP,
+
+	BC_MOVE,		// a = b
+	BC_DROP,		// release temporary a
+	BC_LOADG,		// a = global symbol named b
+	BC_STOREL,		// local slot a = b
+	BC_STOREG,		// global symbol named a = b
+
+	BC_ADD,			// a = b op c
+	BC_SUB,
+	BC_MUL,
+	BC_DIV,
+	BC_MOD,
+	BC_POW,
+
+	BC_EQ,			// a = b op c, logical
+	BC_NEQ,
+	BC_LESS,
+	BC_GREATER,
+	BC_LEQ,
+	BC_GEQ,
+	BC_AND,
+	BC_OR,
+
+	BC_NEG,			// a = -b
+	BC_NOT,			// a = !b
+
+	BC_JMP,			// jump to a
+	BC_JMPF,		// jump to b if a is false
+	BC_JAND,		// a = 0 and jump to c if b is 0
+	BC_JOR,			// a = 1 and jump to c if b is 1
+
+	BC_CALL,		// a = call described by call info b
+	BC_NEWARR,		// a = [b, ..., b+c-1]
+	BC_INDEX,		// a = b[c]
+	BC_CHKCONT,		// fail if container a is not set
+	BC_STOREX,		// a[b] = c, c then refers to the stored element
+
+	BC_RET,			// return a if b is set, else return nothing
+};
+
+
+struct BcInstr
+{
+	BcOp op = BC_NOP;
+	std::uint32_t a = 0, b = 0, c = 0;
+};
+
+
+enum BcValType : std::uint8_t
+{
+	BCVAL_NIL,		// unset local or invalid symbol
+	BCVAL_INT,
+	BCVAL_REAL,
+	BCVAL_SYM,		// any other symbol type
+};
+
+enum BcOwner : std::uint8_t
+{
+	BCOWN_NONE,		// borrowed from a symbol table, constant or slot
+	BCOWN_TMP,		// temporary created by the vm
+	BCOWN_EXT,		// temporary returned by a function call
+	BCOWN_SLOT,		// value of a local slot
+};
+
+
+/**
+ * register contents, scalars are kept unboxed
+ */
+struct BcValue
+{
+	BcValType ty = BCVAL_NIL;
+	BcOwner own = BCOWN_NONE;
+	bool bLval = 0;		// unboxed scalar stems from a variable
+
+	union
+	{
+		t_int iVal;
+		t_real dVal;
+		Symbol *pSym;
+	};
+
+	BcValue() : dVal(0.) {}
+};
+
+
+struct BcCallInfo
+{
+	t_string strFkt;
+	std::uint32_t iFirstArg = 0;
+	std::uint32_t iNumArgs = 0;
+	const NodeCall *pNode = nullptr;
+};
+
+
+/**
+ * compiled function
+ * register layout: local slots (parameters first), constants, temporaries
+ */
+class BcProgram
+{
+	friend class BcCompiler;
+	friend class BcFrame;
+
+protected:
+	const NodeFunction *m_pFunc = nullptr;
+
+	std::vector<BcInstr> m_vecCode;
+	std::vector<const Node*> m_vecCodeNodes;	// originating node for error messages
+
+	std::vector<BcValue> m_vecConsts;
+	std::vector<t_string> m_vecNames;		// slot names, then global names
+	std::vector<BcCallInfo> m_vecCalls;
+
+	std::uint32_t m_iNumParams = 0;
+	std::uint32_t m_iNumSlots = 0;
+	std::uint32_t m_iNumRegs = 0;
+
+public:
+	Symbol* run(ParseInfo &info, RuntimeInfo& runinfo, SymbolTable *pTableSup) const;
+
+	std::size_t GetCodeSize() const { return m_vecCode.size(); }
+	std::uint32_t GetNumRegs() const { return m_iNumRegs; }
+
+	void print(std::ostream& ostr) const;
+};
+
+
+// returns null if the function uses constructs the compiler does not handle
+extern std::shared_ptr<BcProgram> bc_compile(const NodeFunction *pFunc);
+
+#endif
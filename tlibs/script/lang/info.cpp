@@ -28,18 +28,27 @@
 
 #include "info.h"
 
+#include <boost/asio/thread_pool.hpp>
+
 ParseInfo::ParseInfo()
 {
 	pmapModules = new t_mods();
 	pGlobalSyms = new SymbolTable();
 	phandles = new HandleManager();
 	pmutexGlobal = new std::mutex();
-	pmutexGlobalSyms = new std::mutex();
+	pmutexGlobalSyms = new std::shared_timed_mutex();
 	pmutexTraceback = new std::mutex();
 }
 
 ParseInfo::~ParseInfo()
 {
+	if(pThreadPool)
+	{
+		pThreadPool->join();
+		delete pThreadPool;
+		pThreadPool = 0;
+	}
+
 	//if(phandles) { delete phandles; phandles=0; }
 	if(pGlobalSyms) { delete pGlobalSyms; pGlobalSyms=0; }
 	if(pmutexGlobal) { delete pmutexGlobal; pmutexGlobal=0; }
@@ -85,3 +94,106 @@ void ParseInfo::PopTraceback()
 
 	pStck->pop_front();
 }
+
+
+/**
+ * looks up a global symbol, the lookup is cached in the given runtime info
+ * until the global symbol table changes
+ */
+Symbol* ParseInfo::GetGlobalSymbol(const t_string& strName, RuntimeInfo* pRuninfo)
+{
+	if(!pGlobalSyms) return 0;
+
+	if(pRuninfo)
+	{
+		const std::size_t iVersion = iGlobalSymsVersion.load(std::memory_order_acquire);
+		if(pRuninfo->iGlobalSymsVersion != iVersion)
+		{
+			pRuninfo->mapGlobalSymsCache.clear();
+			pRuninfo->iGlobalSymsVersion = iVersion;
+		}
+
+		auto iter = pRuninfo->mapGlobalSymsCache.find(strName);
+		if(iter != pRuninfo->mapGlobalSymsCache.end())
+			return iter->second;
+	}
+
+	Symbol *pSym = 0;
+	{
+		std::shared_lock<std::shared_timed_mutex> lck(*pmutexGlobalSyms);
+		pSym = pGlobalSyms->GetSymbol(strName);
+	}
+
+	// also cache misses, most identifiers are local
+	if(pRuninfo)
+		pRuninfo->mapGlobalSymsCache[strName] = pSym;
+	return pSym;
+}
+
+void ParseInfo::InsertGlobalSymbol(const t_string& strName, Symbol* pSym)
+{
+	if(!pGlobalSyms) return;
+
+	std::lock_guard<std::shared_timed_mutex> lck(*pmutexGlobalSyms);
+	if(pSym)
+		pSym->SetIdent(strName);
+	pGlobalSyms->InsertSymbol(strName, pSym);
+	iGlobalSymsVersion.fetch_add(1, std::memory_order_release);
+}
+
+/**
+ * global symbols are shared between threads, only write their name if it changes
+ */
+void ParseInfo::SetGlobalIdent(Symbol* pSym, const t_string& strName)
+{
+	{
+		std::shared_lock<std::shared_timed_mutex> lck(*pmutexGlobalSyms);
+		if(pSym->GetIdent() == strName)
+			return;
+	}
+
+	std::lock_guard<std::shared_timed_mutex> lck(*pmutexGlobalSyms);
+	pSym->SetIdent(strName);
+}
+
+bool ParseInfo::IsGlobalSymbol(const Symbol* pSym) const
+{
+	if(!pGlobalSyms) return 0;
+
+	std::shared_lock<std::shared_timed_mutex> lck(*pmutexGlobalSyms);
+	return pGlobalSyms->IsPtrInMap(pSym);
+}
+
+boost::asio::thread_pool* ParseInfo::GetThreadPool()
+{
+	std::call_once(flagThreadPool, [this]()
+	{
+		unsigned int iNumThreads = std::thread::hardware_concurrency();
+		if(iNumThreads == 0)
+			iNumThreads = 1;
+		iThreadPoolSize = iNumThreads;
+		pThreadPool = new boost::asio::thread_pool(iNumThreads);
+	});
+
+	return pThreadPool;
+}
+
+bool ParseInfo::ReserveThreadPool(unsigned int iNum)
+{
+	GetThreadPool();
+
+	unsigned int iUsed = iThreadPoolUsed.load();
+	do
+	{
+		if(iUsed + iNum > iThreadPoolSize)
+			return false;
+	}
+	while(!iThreadPoolUsed.compare_exchange_weak(iUsed, iUsed + iNum));
+
+	return true;
+}
+
+void ParseInfo::ReleaseThreadPool(unsigned int iNum)
+{
+	iThreadPoolUsed -= iNum;
+}
@@ -35,6 +35,11 @@
 #include "types.h"
 #include "lexer.h"
 
+#include <atomic>
+#include <shared_mutex>
+
+namespace boost { namespace asio { class thread_pool; } }
+
 
 // stuff that can change during execution
 struct RuntimeInfo
@@ -57,6 +62,10 @@ struct RuntimeInfo
 	// implicitely return last symbol in function
 	bool bImplicitRet = 0;
 
+	// global symbols looked up by this thread, see ParseInfo::GetGlobalSymbol
+	std::unordered_map<t_string, Symbol*> mapGlobalSymsCache;
+	std::size_t iGlobalSymsVersion = 0;
+
 
 	bool IsExecDisabled() const
 	{
@@ -85,9 +94,11 @@ struct ParseInfo
 	typedef std::vector<NodeFunction*> t_funcs;
 	t_funcs vecFuncs;
 
-	// global symbol table
+	// global symbol table, only use it via the functions below
 	SymbolTable *pGlobalSyms = nullptr;
-	std::mutex *pmutexGlobalSyms = nullptr;
+	std::shared_timed_mutex *pmutexGlobalSyms = nullptr;
+	// incremented on every change to the global symbol table
+	std::atomic<std::size_t> iGlobalSymsVersion{1};
 
 	HandleManager *phandles = nullptr;
 
@@ -96,7 +107,19 @@ struct ParseInfo
 	std::mutex *pmutexGlobal = nullptr;
 
 
+	// worker threads for nthread(), created on first use
+	boost::asio::thread_pool *pThreadPool = nullptr;
+	std::once_flag flagThreadPool;
+	unsigned int iThreadPoolSize = 0;
+	std::atomic<unsigned int> iThreadPoolUsed{0};
+
+
 	bool bEnableDebug = 0;
+
+	// compile functions to bytecode instead of evaluating the syntax tree
+	bool bUseBytecode = 1;
+	// print the disassembled bytecode of compiled functions
+	bool bShowBytecode = 0;
 	std::mutex *pmutexTraceback = nullptr;
 	typedef std::deque<std::string> t_oneTraceback;
 	typedef std::unordered_map<std::thread::id, t_oneTraceback> t_stckTraceback;
@@ -111,6 +134,17 @@ struct ParseInfo
 	~ParseInfo();
 
 	NodeFunction* GetFunction(const t_string& strName);
+
+	Symbol* GetGlobalSymbol(const t_string& strName, RuntimeInfo* pRuninfo=nullptr);
+	void InsertGlobalSymbol(const t_string& strName, Symbol* pSym);
+	void SetGlobalIdent(Symbol* pSym, const t_string& strName);
+	bool IsGlobalSymbol(const Symbol* pSym) const;
+
+	boost::asio::thread_pool* GetThreadPool();
+
+	// reserve workers of the pool which are not yet busy, all or nothing
+	bool ReserveThreadPool(unsigned int iNum);
+	void ReleaseThreadPool(unsigned int iNum);
 };
 
 
@@ -68,6 +68,8 @@ static inline void usage(const char* pcProg)
 	-i, --interactive     Interactive mode.
 	-t, --timing          Show timing information.
 	-s, --symbols         Show symbol tables.
+	-n, --no-bytecode     Evaluate the syntax tree instead of compiled functions.
+	-b, --disasm          Show the bytecode of compiled functions.
 	-d[0-4]               Verbosity (0=none, 1=errors, 2=warnings, 3=infos, 4=debug).
 	)RAW";
 
@@ -177,6 +179,8 @@ static inline int script_main(int argc, char** argv)
 
 	bool bShowSymbols = 0;
 	bool bInteractive = 0;
+	bool bNoBytecode = 0;
+	bool bShowBytecode = 0;
 	unsigned int uiDebugLevel = 3;
 #ifndef NDEBUG
 	uiDebugLevel = 4;
@@ -195,6 +199,10 @@ static inline int script_main(int argc, char** argv)
 			bShowSymbols = 1;
 		else if(strArg=="-i" || strArg == "--interactive")
 			bInteractive = 1;
+		else if(strArg=="-n" || strArg == "--no-bytecode")
+			bNoBytecode = 1;
+		else if(strArg=="-b" || strArg == "--disasm")
+			bShowBytecode = 1;
 		else if(strArg=="-h" || strArg == "--help")
 			{ usage(argv[0]); return 0; }
 
@@ -238,6 +246,8 @@ static inline int script_main(int argc, char** argv)
 	RuntimeInfo runinfo;
 
 	info.bEnableDebug = (uiDebugLevel>=4);
+	info.bUseBytecode = !bNoBytecode;
+	info.bShowBytecode = bShowBytecode;
 
 
 	// lexing
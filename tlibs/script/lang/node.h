@@ -39,6 +39,7 @@
 #include <unordered_map>
 #include <map>
 #include <mutex>
+#include <memory>
 
 #include "symbol.h"
 #include "handles.h"
@@ -50,6 +51,7 @@ struct RuntimeInfo;
 class Node;
 class NodeFunction;
 class NodeCall;
+class BcProgram;
 
 enum /*class*/ NodeType : unsigned int
 {
@@ -249,6 +251,10 @@ public:
 	virtual Symbol* eval(ParseInfo &info, RuntimeInfo& runinfo, SymbolTable *pSym=0) const override;
 	virtual Node* clone() const override;
 
+	// call the user or system function with already evaluated arguments
+	Symbol* call(ParseInfo &info, RuntimeInfo& runinfo, SymbolTable *pSym,
+		NodeFunction *pFkt, SymbolArray& arrArgs) const;
+
 	Node* GetIdent() const { return m_pIdent; }
 	Node* GetArgs() const { return m_pArgs; }
 
@@ -663,6 +669,7 @@ public:
 	const std::vector<Node*>& GetNodesFlat() const { return m_vecNodesFlat; }
 
 	void SetGlobal(bool bGlob) { m_bGlobal = bGlob; }
+	bool IsGlobal() const { return m_bGlobal; }
 	void SetOwnsLeft(bool bOwns) { m_bOwnsLeft = bOwns; }
 
 	virtual Node* optimize() override;
@@ -679,6 +686,10 @@ protected:
 	// script file this function resides in
 	t_string m_strScrFile;
 
+	// bytecode, compiled on first call; null if the function is not compilable
+	mutable std::once_flag m_flagCompiled;
+	mutable std::shared_ptr<BcProgram> m_pBytecode;
+
 public:
 	NodeFunction(Node* pLeft, Node* pMiddle, Node* pRight);
 
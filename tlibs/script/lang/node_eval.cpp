@@ -30,6 +30,7 @@
 #include "node.h"
 #include "info.h"
 #include "calls.h"
+#include "bytecode.h"
 #include "log/log.h"
 
 Symbol* NodeReturn::eval(ParseInfo &info, RuntimeInfo& runinfo, SymbolTable *pSym) const
@@ -93,12 +94,7 @@ Symbol* NodeIdent::eval(ParseInfo &info, RuntimeInfo& runinfo, SymbolTable *pSym
 		pSymbol = pSym->GetSymbol(m_strIdent);
 
 	// global symbol
-	Symbol *pSymbolGlob = 0;
-	if(info.pGlobalSyms)
-	{
-		std::lock_guard<std::mutex> _lck(*info.pmutexGlobalSyms);
-		pSymbolGlob = info.pGlobalSyms->GetSymbol(m_strIdent);
-	}
+	Symbol *pSymbolGlob = info.GetGlobalSymbol(m_strIdent, &runinfo);
 
 	if(pSymbol && pSymbolGlob)
 	{
@@ -120,12 +116,9 @@ Symbol* NodeIdent::eval(ParseInfo &info, RuntimeInfo& runinfo, SymbolTable *pSym
 
 
 	if(pSymbol == pSymbolGlob)
-		info.pmutexGlobalSyms->lock();
-
-	pSymbol->SetIdent(m_strIdent);
-
-	if(pSymbol == pSymbolGlob)
-		info.pmutexGlobalSyms->unlock();
+		info.SetGlobalIdent(pSymbol, m_strIdent);
+	else
+		pSymbol->SetIdent(m_strIdent);
 	return pSymbol;
 }
 
@@ -144,11 +137,8 @@ Symbol* NodeCall::eval(ParseInfo &info, RuntimeInfo& runinfo, SymbolTable *pSym)
 	//G_COUT << "call to " << strFkt << " with " << m_vecArgs.size() << " arguments." << std::endl;
 
 
-	bool bCallUserFkt = 0;
 	// user-defined function
-	NodeFunction *pFkt = info.GetFunction(strFkt);;
-	if(pFkt)
-		bCallUserFkt = 1;
+	NodeFunction *pFkt = info.GetFunction(strFkt);
 
 	/*if(!bCallUserFkt)
 	{
@@ -246,9 +236,22 @@ Symbol* NodeCall::eval(ParseInfo &info, RuntimeInfo& runinfo, SymbolTable *pSym)
 		}
 	}
 
+	Symbol* pFktRet = call(info, runinfo, pSym, pFkt, arrArgs);
+
+	for(Symbol *pArgSym : vecArgSyms)
+		safe_delete(pArgSym, pSym, &info);
+	return pFktRet;
+}
+
+Symbol* NodeCall::call(ParseInfo &info, RuntimeInfo& runinfo, SymbolTable *pSym,
+	NodeFunction *pFkt, SymbolArray& arrArgs) const
+{
+	const t_string& strFkt = ((NodeIdent*)m_pIdent)->GetIdent();
+	std::vector<Symbol*> &vecArgSyms = arrArgs.GetArr();
+
 	arrArgs.UpdateIndices(false);
 	Symbol* pFktRet = 0;
-	if(bCallUserFkt)	// call user-defined function
+	if(pFkt)	// call user-defined function
 	{
 		//pFkt->SetArgSyms(&vecArgSyms);
 		pSym->InsertSymbol(T_STR"<args>", &arrArgs);
@@ -278,9 +281,6 @@ Symbol* NodeCall::eval(ParseInfo &info, RuntimeInfo& runinfo, SymbolTable *pSym)
 	}
 
 	arrArgs.ClearIndices();
-
-	for(Symbol *pArgSym : vecArgSyms)
-		safe_delete(pArgSym, pSym, &info);
 	return pFktRet;
 }
 
@@ -816,7 +816,7 @@ Symbol* NodeArrayAccess::eval(ParseInfo &info, RuntimeInfo& runinfo, SymbolTable
 	return pSymbol;
 }
 
-static void uminus_inplace(Symbol* pSym, ParseInfo& info, RuntimeInfo& runinfo)
+void uminus_inplace(Symbol* pSym, ParseInfo& info, RuntimeInfo& runinfo)
 {
 	if(!pSym) return;
 
@@ -937,12 +937,7 @@ Symbol* NodeBinaryOp::eval_assign(ParseInfo &info, RuntimeInfo& runinfo, SymbolT
 		const t_string& strIdent = ((NodeIdent*)pLeft)->GetIdent();
 		//tl::log_debug("Assigning ", strIdent, " = ", pSymbol);
 
-		Symbol* pSymGlob = 0;
-		if(info.pGlobalSyms)
-		{
-			std::lock_guard<std::mutex> _lck(*info.pmutexGlobalSyms);
-			pSymGlob = info.pGlobalSyms->GetSymbol(strIdent);
-		}
+		Symbol* pSymGlob = info.GetGlobalSymbol(strIdent, &runinfo);
 
 		Symbol* pSymLoc = 0;
 		if(!*pbGlob && pSym)
@@ -957,16 +952,13 @@ Symbol* NodeBinaryOp::eval_assign(ParseInfo &info, RuntimeInfo& runinfo, SymbolT
 		if(pSymGlob && !pSymLoc && !*pbGlob && info.pGlobalSyms)
 		{
 			tl::log_warn(linenr(runinfo), "Overwriting global symbol \"", strIdent, "\".");
-
-			std::lock_guard<std::mutex> _lck(*info.pmutexGlobalSyms);
-			info.pGlobalSyms->InsertSymbol(strIdent, pSymbol);
+			info.InsertGlobalSymbol(strIdent, pSymbol);
 		}
 		else
 		{
 			if(*pbGlob && info.pGlobalSyms)
 			{
-				std::lock_guard<std::mutex> _lck(*info.pmutexGlobalSyms);
-				info.pGlobalSyms->InsertSymbol(strIdent, pSymbol);
+				info.InsertGlobalSymbol(strIdent, pSymbol);
 			}
 			else if(pSym)
 			{
@@ -1293,6 +1285,41 @@ Symbol* NodeFunction::eval(ParseInfo &info, RuntimeInfo& runinfo, SymbolTable* p
 	if(runinfo.pLocalSymsOverride && strName == runinfo.strExecFkt)
 		bOverrideSymTab = 1;
 
+	// run the compiled function if possible
+	if(info.bUseBytecode && !bOverrideSymTab && !runinfo.bImplicitRet)
+	{
+		std::call_once(m_flagCompiled, [this, &info]()
+		{
+			m_pBytecode = bc_compile(this);
+
+			if(m_pBytecode && info.bShowBytecode)
+			{
+				std::ostringstream ostrCode;
+				m_pBytecode->print(ostrCode);
+				tl::log_info(ostrCode.str());
+			}
+		});
+
+		if(m_pBytecode)
+		{
+			if(info.bEnableDebug)
+			{
+				std::string strTrace = "call: " + GetName() + ", "
+							+ std::to_string(m_vecArgs.size()) + " args";
+				info.PushTraceback(std::move(strTrace));
+			}
+
+			Symbol *pRet = m_pBytecode->run(info, runinfo, pTableSup);
+
+			if(info.bEnableDebug)
+			{
+				info.PopTraceback();
+			}
+
+			return pRet;
+		}
+	}
+
 	std::unique_ptr<SymbolTable> ptrLocalSym(bOverrideSymTab ? 0 : new SymbolTable);
 	SymbolTable *pLocalSym = ptrLocalSym.get();
 
@@ -902,11 +902,6 @@ void safe_delete(Symbol *&pSym, const SymbolTable* pSymTab, ParseInfo* pParseInf
 {
 	if(!pSym) return;
 
-	const SymbolTable* pSymTabGlob = 0;
-	if(pParseInfo)
-		pSymTabGlob = pParseInfo->pGlobalSyms;
-
-
 	// don't delete constants
 	if(pSym->IsConst())
 		return;
@@ -920,11 +915,8 @@ void safe_delete(Symbol *&pSym, const SymbolTable* pSymTab, ParseInfo* pParseInf
 	bool bIsInGlobTable = 0;
 
 	if(pSymTab) bIsInTable = pSymTab->IsPtrInMap(pSym);
-	if(pSymTabGlob)
-	{
-		std::lock_guard<std::mutex> _lck(*pParseInfo->pmutexGlobalSyms);
-		bIsInGlobTable = pSymTabGlob->IsPtrInMap(pSym);
-	}
+	if(!bIsInTable && pParseInfo)
+		bIsInGlobTable = pParseInfo->IsGlobalSymbol(pSym);
 
 	if(!bIsInTable && !bIsInGlobTable)
 	{
@@ -426,13 +426,9 @@ static Symbol* fkt_has_var(const std::vector<Symbol*>& vecSyms,
 	if(pSymTab->GetSymbol(strVar))
 		bHasVar = 1;
 
-	{
-		// check global variables
-		std::lock_guard<std::mutex> _lck(*info.pmutexGlobalSyms);
-
-		if(info.pGlobalSyms->GetSymbol(strVar))
-			bHasVar = 1;
-	}
+	// check global variables
+	if(info.GetGlobalSymbol(strVar, &runinfo))
+		bHasVar = 1;
 
 	return new SymbolInt(bHasVar);
 }
@@ -453,8 +449,7 @@ static Symbol* fkt_register_var(const std::vector<Symbol*>& vecSyms,
 
 		if(bUseGlobal)
 		{
-			std::lock_guard<std::mutex> _lck(*info.pmutexGlobalSyms);
-			info.pGlobalSyms->InsertSymbol(strVar, pVar);
+			info.InsertGlobalSymbol(strVar, pVar);
 		}
 		else
 		{
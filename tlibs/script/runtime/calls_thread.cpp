@@ -34,6 +34,9 @@
 #include "lang/calls.h"
 #include <thread>
 #include <future>
+#include <memory>
+#include <boost/asio/thread_pool.hpp>
+#include <boost/asio/post.hpp>
 //#include <wait.h>
 #include <cstdlib>
 
@@ -152,6 +155,23 @@ static void thread_proc(NodeFunction* pFunc, ParseInfo* pinfo, std::vector<Symbo
 	safe_delete(pRet, 0, pinfo);
 }
 
+// is the current thread a worker of the nthread pool?
+static thread_local bool g_bInThreadPool = 0;
+
+static Symbol* pool_proc(NodeFunction* pFunc, ParseInfo* pinfo, std::vector<Symbol*>* pvecSyms)
+{
+	// give back the reservation even if the thread proc throws
+	struct PoolRelease
+	{
+		ParseInfo* pinfo;
+		~PoolRelease() { pinfo->ReleaseThreadPool(1); }
+	} release{pinfo};
+
+	g_bInThreadPool = 1;
+	thread_proc(pFunc, pinfo, pvecSyms);
+	return 0;
+}
+
 static Symbol* fkt_thread_task(const std::vector<Symbol*>& vecSyms,
 	ParseInfo& info, RuntimeInfo &runinfo, 
 	SymbolTable* pSymTab, bool bTask=0)
@@ -512,7 +532,14 @@ static Symbol* fkt_nthread(const std::vector<Symbol*>& vecSyms,
 
 
 
-	std::vector<std::thread*> vecThreads;
+	// run the chunks on the pool if there's a free worker for each of them,
+	// otherwise they might wait for each other and never be started;
+	// nested nthread calls from pool workers always get their own threads
+	boost::asio::thread_pool *pPool = nullptr;
+	if(!g_bInThreadPool && info.ReserveThreadPool(iNumThreads))
+		pPool = info.GetThreadPool();
+
+	std::vector<Handle*> vecThreads;
 	vecThreads.reserve(iNumThreads);
 
 	for(iCurTh=0; iCurTh<iNumThreads; ++iCurTh)
@@ -525,8 +552,20 @@ static Symbol* fkt_nthread(const std::vector<Symbol*>& vecSyms,
 		for(unsigned int iSym=3; iSym<vecSyms.size(); ++iSym)
 			vecThreadSyms->push_back(vecSyms[iSym]->clone());
 
-		std::thread *pth = new std::thread(::thread_proc, pFunc, &info, vecThreadSyms);
-		vecThreads.push_back(pth);
+		if(pPool)
+		{
+			auto pTask = std::make_shared<std::packaged_task<Symbol*()>>(
+				std::bind(::pool_proc, pFunc, &info, vecThreadSyms));
+			std::future<Symbol*> *pFuture = new std::future<Symbol*>(pTask->get_future());
+			boost::asio::post(*pPool, [pTask]() { (*pTask)(); });
+
+			vecThreads.push_back(new HandleTask(pFuture, 1));
+		}
+		else
+		{
+			std::thread *pth = new std::thread(::thread_proc, pFunc, &info, vecThreadSyms);
+			vecThreads.push_back(new HandleThread(pth));
+		}
 	}
 
 	/*
@@ -543,8 +582,7 @@ static Symbol* fkt_nthread(const std::vector<Symbol*>& vecSyms,
 
 	for(iCurTh=0; iCurTh<iNumThreads; ++iCurTh)
 	{
-		std::thread* pCurThread = vecThreads[iCurTh];
-		t_int iHandle = info.phandles->AddHandle(new HandleThread(pCurThread));
+		t_int iHandle = info.phandles->AddHandle(vecThreads[iCurTh]);
 		SymbolInt *pSymThreadHandle = new SymbolInt(iHandle);
 
 		pArrThreads->GetArr().push_back(pSymThreadHandle);
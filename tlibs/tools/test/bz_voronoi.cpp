@@ -0,0 +1,170 @@
+/**
+ * tlibs test file
+ * @author Tobias Weber <tobias.weber@tum.de>
+ * @license GPLv2 or GPLv3
+ *
+ * ----------------------------------------------------------------------------
+ * tlibs -- a physical-mathematical C++ template library
+ * Copyright (C) 2017-2021  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2015-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+// test for the voronoi construction of the brillouin zone: compare with the generic method
+// g++ -O2 -DNO_LAPACK -o bz_voronoi bz_voronoi.cpp ../../log/log.cpp -I../.. -std=c++14 -lboost_system -lpthread
+
+#include <iostream>
+#include <random>
+#include <chrono>
+#include "../../phys/bz.h"
+#include "../../phys/lattice.h"
+
+using T = double;
+using t_vec = tl::Brillouin3D<T>::t_vec<T>;
+using t_clock = std::chrono::steady_clock;
+
+
+static void add_reflexes(tl::Brillouin3D<T>& bz, const tl::Lattice<T>& recip, int iMaxNN)
+{
+	bz.SetEpsilon(1e-6);
+	bz.SetMaxNN(4);
+
+	t_vec vecCent = tl::make_vec<t_vec>({ 0., 0., 0. });
+	bz.SetCentralReflex(vecCent, &vecCent);
+
+	for(int h=-iMaxNN; h<=iMaxNN; ++h)
+	for(int k=-iMaxNN; k<=iMaxNN; ++k)
+	for(int l=-iMaxNN; l<=iMaxNN; ++l)
+	{
+		if(h==0 && k==0 && l==0)
+			continue;
+
+		t_vec vecHKL = tl::make_vec<t_vec>({ T(h), T(k), T(l) });
+		bz.AddReflex(recip.GetPos(h, k, l), &vecHKL);
+	}
+}
+
+
+static bool same_vertices(const std::vector<t_vec>& verts1, const std::vector<t_vec>& verts2, T eps)
+{
+	if(verts1.size() != verts2.size())
+		return false;
+
+	for(const t_vec& vert1 : verts1)
+	{
+		if(std::none_of(verts2.begin(), verts2.end(),
+			[&vert1, eps](const t_vec& vert2) -> bool { return tl::vec_equal(vert1, vert2, eps); }))
+			return false;
+	}
+
+	return true;
+}
+
+
+int main()
+{
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<T> distLen(2., 12.);
+	std::uniform_real_distribution<T> distAngle(70., 115.);
+
+	T tTimeGeneric = 0., tTimeVoronoi = 0., tTimeCached = 0., tTimeLarge = 0.;
+	int iNumCompared = 0;
+
+	for(int iLatt=0; iLatt<20; ++iLatt)
+	{
+		tl::Lattice<T> lattice(distLen(rng), distLen(rng), distLen(rng),
+			tl::d2r(distAngle(rng)), tl::d2r(distAngle(rng)), tl::d2r(distAngle(rng)));
+		tl::Lattice<T> recip = lattice.GetRecip();
+
+		// compare using the same set of nearest neighbours
+		tl::Brillouin3D<T> bzGeneric, bzVoronoi, bzCached;
+		add_reflexes(bzGeneric, recip, 1);
+		add_reflexes(bzVoronoi, recip, 1);
+		add_reflexes(bzCached, recip, 1);
+		// use all neighbours, the shell reduction can miss faces for oblique lattices
+		bzGeneric.SetMaxNN(100);
+
+		auto tStart = t_clock::now();
+		bzGeneric.CalcBZGeneric(1);
+		auto tGeneric = t_clock::now();
+		bzVoronoi.CalcBZ();
+		auto tVoronoi = t_clock::now();
+		bzCached.CalcBZ();
+		auto tCached = t_clock::now();
+
+		tTimeGeneric += std::chrono::duration<T>(tGeneric - tStart).count();
+		tTimeVoronoi += std::chrono::duration<T>(tVoronoi - tGeneric).count();
+		tTimeCached += std::chrono::duration<T>(tCached - tVoronoi).count();
+
+		// skip lattices for which the nearest neighbours do not suffice
+		if(!bzVoronoi.IsValid())
+			continue;
+
+		if(!same_vertices(bzGeneric.GetVertices(), bzVoronoi.GetVertices(), 1e-6)
+			|| bzGeneric.GetPolys().size() != bzVoronoi.GetPolys().size()
+			|| !same_vertices(bzVoronoi.GetVertices(), bzCached.GetVertices(), 1e-12))
+		{
+			std::cerr << "Mismatch for lattice " << iLatt << ": "
+				<< bzGeneric.GetVertices().size() << " vs. " << bzVoronoi.GetVertices().size()
+				<< " vertices." << std::endl;
+			return -1;
+		}
+		++iNumCompared;
+
+		// more neighbours for the folding test, those too far away are skipped
+		tl::Brillouin3D<T> bzLarge;
+		add_reflexes(bzLarge, recip, 3);
+		auto tLarge = t_clock::now();
+		bzLarge.CalcBZ();
+		tTimeLarge += std::chrono::duration<T>(t_clock::now() - tLarge).count();
+
+		// folded points have to lie inside the zone and differ from the original ones by a lattice vector
+		std::uniform_real_distribution<T> distQ(-5., 5.);
+		std::vector<t_vec> vecQ;
+		for(int iQ=0; iQ<10000; ++iQ)
+			vecQ.emplace_back(tl::make_vec<t_vec>({ distQ(rng), distQ(rng), distQ(rng) }));
+
+		std::vector<t_vec> vecG;
+		std::vector<t_vec> vecFolded = bzLarge.FoldIntoBZ(vecQ, &vecG);
+		const std::vector<tl::Plane<T>> vecPlanes = bzLarge.GetPlanes();
+		for(std::size_t iQ=0; iQ<vecQ.size(); ++iQ)
+		{
+			t_vec vecHKL = recip.GetHKL(vecG[iQ]);
+			bool bLatticeVec = true;
+			for(T hkl : vecHKL)
+				bLatticeVec = bLatticeVec && tl::float_equal(hkl, std::round(hkl), 1e-6);
+
+			bool bInside = std::all_of(vecPlanes.begin(), vecPlanes.end(),
+				[&vecFolded, iQ](const tl::Plane<T>& plane) -> bool
+				{ return plane.GetDist(vecFolded[iQ]) <= 1e-6; });
+
+			if(!bLatticeVec || !bInside || !tl::vec_equal<t_vec>(vecFolded[iQ] + vecG[iQ], vecQ[iQ], 1e-6))
+			{
+				std::cerr << "Folding failed for lattice " << iLatt << ", Q = " << vecQ[iQ] << std::endl;
+				return -1;
+			}
+		}
+	}
+
+	std::cout << "All " << iNumCompared << " Brillouin zones match."
+		<< "\nGeneric method: " << tTimeGeneric << " s"
+		<< "\nVoronoi method: " << tTimeVoronoi << " s"
+		<< "\nCached: " << tTimeCached << " s"
+		<< "\nVoronoi method, 342 neighbours: " << tTimeLarge << " s" << std::endl;
+	return 0;
+}
@@ -0,0 +1,82 @@
+/**
+ * tlibs test file
+ * @author Tobias Weber <tobias.weber@tum.de>
+ * @license GPLv2 or GPLv3
+ *
+ * ----------------------------------------------------------------------------
+ * tlibs -- a physical-mathematical C++ template library
+ * Copyright (C) 2017-2021  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2015-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+// test for binary k-d files: compare mapped tree with pointer-based tree
+// g++ -O2 -o kdbin kdbin.cpp ../../log/log.cpp -I../.. -std=c++14 -lboost_iostreams -lboost_system
+
+#include <iostream>
+#include <vector>
+#include <list>
+#include <random>
+#include "../../math/kd.h"
+#include "../../file/kdbin.h"
+
+int main()
+{
+	using T = double;
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<T> dist(-1., 1.);
+
+	std::list<std::vector<T>> lst;
+	for(int i=0; i<10000; ++i)
+		lst.push_back({dist(rng), dist(rng), dist(rng), dist(rng), T(i)});
+
+	tl::Kd<T> kd;
+	kd.Load(lst, 4);
+
+	tl::KdFlat<T>::t_map params{{"type", "test"}};
+	tl::KdFlat<T> kdflat;
+	if(!kdflat.FromTree(kd, &params) || !kdflat.Save("/tmp/tst.kdbin"))
+	{
+		std::cerr << "Cannot write k-d file." << std::endl;
+		return -1;
+	}
+
+	tl::KdFlat<T> kdmap;
+	if(!kdmap.Load("/tmp/tst.kdbin"))
+	{
+		std::cerr << "Cannot map k-d file." << std::endl;
+		return -1;
+	}
+
+	std::cout << "Nodes: " << kdmap.GetNodeCount() << ", type: "
+		<< kdmap.GetParams().at("type") << std::endl;
+
+	std::size_t iMismatches = 0;
+	for(int i=0; i<10000; ++i)
+	{
+		std::vector<T> vec{dist(rng), dist(rng), dist(rng), dist(rng)};
+		const std::vector<T>& vecNode = kd.GetNearestNode(vec);
+		const T* pNode = kdmap.GetNearestNode(vec.data());
+
+		if(!pNode || pNode[4] != vecNode[4])
+			++iMismatches;
+	}
+
+	std::cout << "Mismatches: " << iMismatches << std::endl;
+	return iMismatches == 0 ? 0 : -1;
+}
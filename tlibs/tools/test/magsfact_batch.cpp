@@ -0,0 +1,205 @@
+/**
+ * tlibs test file
+ * @author Tobias Weber <tobias.weber@tum.de>
+ * @license GPLv2 or GPLv3
+ *
+ * ----------------------------------------------------------------------------
+ * tlibs -- a physical-mathematical C++ template library
+ * Copyright (C) 2017-2021  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2015-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+// test for batch magnetic structure factors: compare with structfact_mag and explicit domains
+// g++ -O2 -o magsfact_batch magsfact_batch.cpp ../../log/log.cpp -I../.. -std=c++14 -lboost_system -lpthread
+
+#include <iostream>
+#include <random>
+#include <chrono>
+#include "../../phys/mag.h"
+#include "../../phys/lattice.h"
+#include "../../log/log.h"
+
+using T = double;
+using t_vec = tl::ublas::vector<T>;
+using t_mat = tl::ublas::matrix<T>;
+using t_cplx = std::complex<T>;
+using t_batch = tl::MagStructFactBatch<T>;
+
+
+static t_mat make_op(const std::vector<T>& rot, const std::vector<T>& trans)
+{
+	t_mat mat = tl::unit_m<t_mat>(4);
+	for(int i=0; i<3; ++i)
+	{
+		for(int j=0; j<3; ++j)
+			mat(i,j) = rot[i*3+j];
+		mat(i,3) = trans[i];
+	}
+	return mat;
+}
+
+
+// |Fm_perp|^2 using structfact_mag, Q and positions in A^-1 and A
+static T intensity_direct(const std::vector<t_vec>& vecPosFrac, const std::vector<t_vec>& vecSpins,
+	const std::vector<std::size_t>& vecSpecies, const std::vector<t_batch::t_ffact>& vecFF,
+	const t_mat& matA, const t_mat& matB, const t_vec& vecG)
+{
+	t_vec vecQ = tl::prod_mv(matB, vecG);
+	T dQ = tl::veclen(vecQ);
+
+	std::vector<t_vec> vecPos;
+	std::vector<t_cplx> vecF;
+	for(std::size_t iAtom=0; iAtom<vecPosFrac.size(); ++iAtom)
+	{
+		vecPos.push_back(tl::prod_mv(matA, vecPosFrac[iAtom]));
+		vecF.push_back(vecFF[vecSpecies[iAtom]](dQ));
+	}
+
+	t_vec vecQ3 = vecQ;
+	tl::ublas::vector<t_cplx> Fm = tl::structfact_mag<T, t_cplx, tl::ublas::vector, std::vector>(
+		vecPos, vecSpins, vecQ3, vecF);
+
+	T dI = 0;
+	for(int i=0; i<3; ++i)
+		dI += std::norm(Fm[i]);
+	return dI;
+}
+
+
+int main()
+{
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<T> dist(-1., 1.);
+
+	// tetragonal cell with point group 4/m
+	tl::Lattice<T> latt(4., 4., 6., tl::d2r(90.), tl::d2r(90.), tl::d2r(90.));
+	const t_mat matA = latt.GetBaseMatrixCov();
+	const t_mat matB = latt.GetRecip().GetBaseMatrixCov();
+
+	std::vector<t_mat> vecOps;
+	const std::vector<T> vecRot4 = { 0,-1,0, 1,0,0, 0,0,1 };
+	for(int iInv=0; iInv<2; ++iInv)
+	{
+		t_mat matRot = tl::unit_m<t_mat>(3);
+		for(int iRot=0; iRot<4; ++iRot)
+		{
+			std::vector<T> vecRot(9);
+			for(int i=0; i<9; ++i)
+				vecRot[i] = (iInv ? -1. : 1.) * matRot(i/3, i%3);
+			vecOps.push_back(make_op(vecRot, { 0., 0., 0.5*iRot }));
+
+			t_mat mat4(3,3);
+			for(int i=0; i<9; ++i) mat4(i/3, i%3) = vecRot4[i];
+			matRot = tl::prod_mm(mat4, matRot);
+		}
+	}
+
+	// random magnetic atoms of two species with different form factors
+	const std::size_t iNumAtoms = 40;
+	std::vector<t_vec> vecPos, vecSpins;
+	std::vector<std::size_t> vecSpecies;
+	for(std::size_t iAtom=0; iAtom<iNumAtoms; ++iAtom)
+	{
+		vecPos.push_back(tl::make_vec<t_vec>({ 0.5+0.5*dist(rng), 0.5+0.5*dist(rng), 0.5+0.5*dist(rng) }));
+		vecSpins.push_back(tl::make_vec<t_vec>({ dist(rng), dist(rng), dist(rng) }));
+		vecSpecies.push_back(iAtom % 2);
+	}
+
+	std::vector<t_batch::t_ffact> vecFF = {
+		[](T Q) -> T { return std::exp(-0.05*Q*Q); },
+		[](T Q) -> T { return 0.5 + 0.5*std::exp(-0.1*Q*Q); },
+	};
+
+	t_batch batch(vecPos, vecSpins, vecSpecies);
+	batch.SetRecipBasis(matB);
+	batch.SetFormfacts(vecFF);
+	batch.SetNumThreads(4);
+	if(!batch.SetSymOps(vecOps))
+	{
+		std::cerr << "Invalid symmetry operations." << std::endl;
+		return -1;
+	}
+	std::cout << batch.GetNumDomains() << " domain operations." << std::endl;
+
+	std::vector<t_batch::t_vec3> vecG;
+	for(int h=-4; h<=4; ++h)
+		for(int k=-4; k<=4; ++k)
+			for(int l=-4; l<=4; ++l)
+				vecG.push_back(t_batch::t_vec3{{ h+0.25, T(k), l-0.5 }});
+
+
+	// single domain
+	auto tStart = std::chrono::steady_clock::now();
+	std::vector<T> vecI = batch.CalcIntensities(vecG, false);
+	auto tBatch = std::chrono::steady_clock::now() - tStart;
+
+	tStart = std::chrono::steady_clock::now();
+	T dMaxDev = 0, dMaxI = 0;
+	for(std::size_t iG=0; iG<vecG.size(); ++iG)
+	{
+		t_vec G = tl::make_vec<t_vec>({ vecG[iG][0], vecG[iG][1], vecG[iG][2] });
+		T dI = intensity_direct(vecPos, vecSpins, vecSpecies, vecFF, matA, matB, G);
+		dMaxDev = std::max(dMaxDev, std::abs(dI - vecI[iG]));
+		dMaxI = std::max(dMaxI, dI);
+	}
+	auto tDirect = std::chrono::steady_clock::now() - tStart;
+
+	std::cout << "single domain: max. deviation " << dMaxDev << " (max. intensity " << dMaxI << "), "
+		<< std::chrono::duration<T>(tDirect).count() << " s direct, "
+		<< std::chrono::duration<T>(tBatch).count() << " s batch." << std::endl;
+	bool bOk = dMaxDev < 1e-9*dMaxI;
+
+
+	// domain average vs. explicitly generated domains: x' = R x + t, S' = det(R) R_cart S
+	std::vector<T> vecIAvg = batch.CalcIntensities(vecG, true);
+	const t_mat matAinv = tl::transpose(matB) / (T(2)*tl::get_pi<T>());
+
+	std::vector<T> vecIExpl(vecG.size(), 0.);
+	for(const t_mat& matOp : vecOps)
+	{
+		t_mat matR = tl::submatrix_wnd<t_mat>(matOp, 3, 3, 0, 0);
+		t_vec vecT = tl::make_vec<t_vec>({ matOp(0,3), matOp(1,3), matOp(2,3) });
+		t_mat matRCart = tl::prod_mm(matA, tl::prod_mm(matR, matAinv));
+		T dDet = tl::determinant(matR);
+
+		std::vector<t_vec> vecPosDom, vecSpinsDom;
+		for(std::size_t iAtom=0; iAtom<iNumAtoms; ++iAtom)
+		{
+			vecPosDom.push_back(tl::prod_mv(matR, vecPos[iAtom]) + vecT);
+			vecSpinsDom.push_back(dDet * tl::prod_mv(matRCart, vecSpins[iAtom]));
+		}
+
+		for(std::size_t iG=0; iG<vecG.size(); ++iG)
+		{
+			t_vec G = tl::make_vec<t_vec>({ vecG[iG][0], vecG[iG][1], vecG[iG][2] });
+			vecIExpl[iG] += intensity_direct(vecPosDom, vecSpinsDom, vecSpecies, vecFF, matA, matB, G)
+				/ T(vecOps.size());
+		}
+	}
+
+	dMaxDev = 0;
+	for(std::size_t iG=0; iG<vecG.size(); ++iG)
+		dMaxDev = std::max(dMaxDev, std::abs(vecIExpl[iG] - vecIAvg[iG]));
+	std::cout << "domain average: max. deviation " << dMaxDev << std::endl;
+	bOk = bOk && dMaxDev < 1e-9*dMaxI;
+
+
+	std::cout << (bOk ? "OK" : "FAILED") << std::endl;
+	return bOk ? 0 : -1;
+}
@@ -0,0 +1,203 @@
+/**
+ * tlibs test file
+ * @author Tobias Weber <tobias.weber@tum.de>
+ * @license GPLv2 or GPLv3
+ *
+ * ----------------------------------------------------------------------------
+ * tlibs -- a physical-mathematical C++ template library
+ * Copyright (C) 2017-2021  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2015-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+// test for the powder engine: compare with brute-force multiplicities and profiles
+// g++ -O2 -o powder_pattern powder_pattern.cpp ../../log/log.cpp -I../.. -std=c++14 -lboost_system -lMinuit2 -lpthread
+
+#include <iostream>
+#include <map>
+#include <chrono>
+#include "../../phys/powder.h"
+#include "../../math/math.h"
+#include "../../log/log.h"
+
+using T = double;
+using t_mat = tl::ublas::matrix<T>;
+
+
+// point group m-3m: all signed permutations
+static std::vector<t_mat> get_cubic_ops()
+{
+	std::vector<t_mat> vecOps;
+	int perm[] = { 0, 1, 2 };
+	do
+	{
+		for(int iSign=0; iSign<8; ++iSign)
+		{
+			t_mat mat = tl::zero_m<t_mat>(4, 4);
+			mat(3,3) = 1;
+			for(int i=0; i<3; ++i)
+				mat(i, perm[i]) = (iSign & (1<<i)) ? -1 : 1;
+			vecOps.push_back(mat);
+		}
+	}
+	while(std::next_permutation(perm, perm+3));
+
+	return vecOps;
+}
+
+
+// point group 6/mmm in hexagonal axes, generated by 6z, 2 along a and -1
+static std::vector<t_mat> get_hex_ops()
+{
+	t_mat mat6 = tl::unit_m<t_mat>(4), mat2 = tl::unit_m<t_mat>(4);
+	mat6(0,0) = 1; mat6(0,1) = -1; mat6(1,0) = 1; mat6(1,1) = 0;
+	mat2(0,0) = 1; mat2(0,1) = -1; mat2(1,0) = 0; mat2(1,1) = -1; mat2(2,2) = -1;
+
+	std::vector<t_mat> vecOps;
+	t_mat mat6n = tl::unit_m<t_mat>(4);
+	for(int i6=0; i6<6; ++i6)
+	{
+		vecOps.push_back(mat6n);
+		vecOps.push_back(tl::ublas::prod(mat2, mat6n));
+		mat6n = tl::ublas::prod(mat6, mat6n);
+	}
+	return vecOps;
+}
+
+
+static bool test(const char* pcName, const tl::Lattice<T>& latt,
+	const std::vector<t_mat>& vecOps, int iOrder)
+{
+	tl::Lattice<T> recip = latt.GetRecip();
+	const T dLam = 0.95;
+
+	tl::PowderPattern<T> engine;
+	engine.SetRecipLattice(recip);
+	engine.SetWavelength(dLam);
+	engine.SetSymOps(vecOps);
+
+	auto tStart = std::chrono::steady_clock::now();
+	std::vector<tl::PowderReflex<T>> vecRefl = engine.CalcReflexes(iOrder);
+	auto tEngine = std::chrono::steady_clock::now();
+
+	// brute force: all reflections within the range, grouped by G
+	std::map<std::string, std::size_t> mapMult;
+	for(int h=-iOrder; h<=iOrder; ++h)
+	for(int k=-iOrder; k<=iOrder; ++k)
+	for(int l=-iOrder; l<=iOrder; ++l)
+	{
+		if(h==0 && k==0 && l==0) continue;
+		const T dG = tl::veclen(recip.GetPos(h, k, l));
+		if(dG*dLam/(4.*tl::get_pi<T>()) > 1.) continue;
+		++mapMult[tl::var_to_str(dG, 6)];
+	}
+
+	// summed multiplicities of all orbits with the same G
+	std::map<std::string, std::size_t> mapMultEngine, mapMultEngineRange;
+	bool bOk = true;
+	for(const tl::PowderReflex<T>& refl : vecRefl)
+	{
+		const std::string strG = tl::var_to_str(refl.dG, 6);
+		mapMultEngine[strG] += refl.iMult;
+		mapMultEngineRange[strG] += refl.vecEquiv.size();
+
+		if(refl.vecEquiv.size() > refl.iMult || refl.vecEquiv.front() != std::array<int,3>{{ refl.h, refl.k, refl.l }})
+			bOk = false;
+	}
+
+	if(mapMultEngineRange != mapMult)
+	{
+		std::cerr << pcName << ": mismatch in the reflections within the range." << std::endl;
+		bOk = false;
+	}
+
+	// full orbits: only differ from the range for reflections at its border
+	for(const auto& pair : mapMultEngine)
+		if(pair.second < mapMult[pair.first])
+			bOk = false;
+
+	std::cout << pcName << ": " << vecRefl.size() << " unique reflections, "
+		<< mapMult.size() << " distinct lines, engine: "
+		<< std::chrono::duration<double>(tEngine - tStart).count() << " s." << std::endl;
+
+	for(std::size_t i=0; i<std::min<std::size_t>(4, vecRefl.size()); ++i)
+	{
+		std::cout << "\t(" << vecRefl[i].h << " " << vecRefl[i].k << " " << vecRefl[i].l << ")"
+			<< ", G = " << vecRefl[i].dG
+			<< ", 2theta = " << tl::r2d(vecRefl[i].dTwoTheta)
+			<< ", mult = " << vecRefl[i].iMult << std::endl;
+	}
+
+
+	// profile: windowed accumulation vs. summing all lines at all points
+	std::vector<T> vecPos, vecInt;
+	for(const tl::PowderReflex<T>& refl : vecRefl)
+	{
+		vecPos.push_back(tl::r2d(refl.dTwoTheta));
+		vecInt.push_back(T(refl.iMult));
+	}
+
+	const std::size_t N = 2048;
+	const T dSig = 0.25, dMin = 0., dMax = 180.;
+
+	std::vector<T> vecProf;
+	tStart = std::chrono::steady_clock::now();
+	tl::powder_profile(vecPos, vecInt, dSig, dMin, dMax, N, vecProf);
+	auto tWindow = std::chrono::steady_clock::now();
+
+	T dMaxDiff = 0.;
+	for(std::size_t iPt=0; iPt<N; ++iPt)
+	{
+		const T dTT = dMin + (dMax - dMin)/T(N)*T(iPt);
+		T dInt = 0.;
+		for(std::size_t iLine=0; iLine<vecPos.size(); ++iLine)
+			dInt += tl::gauss_model<T>(dTT, vecPos[iLine], dSig, vecInt[iLine], 0.);
+		dMaxDiff = std::max(dMaxDiff, std::abs(dInt - vecProf[iPt]));
+	}
+	auto tFull = std::chrono::steady_clock::now();
+
+	std::cout << "\tprofile: max. deviation " << dMaxDiff << ", windowed: "
+		<< std::chrono::duration<double>(tWindow - tStart).count() << " s, full: "
+		<< std::chrono::duration<double>(tFull - tWindow).count() << " s." << std::endl;
+
+	if(dMaxDiff > 1e-9)
+		bOk = false;
+
+	return bOk;
+}
+
+
+int main()
+{
+	bool bOk = true;
+
+	// cubic, multiplicities: (111): 8, (200): 6, (220): 12, (311): 24
+	bOk = test("cubic", tl::Lattice<T>(5., 5., 5., tl::d2r(90.), tl::d2r(90.), tl::d2r(90.)),
+		get_cubic_ops(), 8) && bOk;
+
+	// hexagonal, multiplicities: (100): 6, (001): 2, (101): 12
+	bOk = test("hexagonal", tl::Lattice<T>(4., 4., 6., tl::d2r(90.), tl::d2r(90.), tl::d2r(120.)),
+		get_hex_ops(), 8) && bOk;
+
+	// triclinic, only Friedel pairs
+	bOk = test("triclinic", tl::Lattice<T>(4., 5., 6., tl::d2r(80.), tl::d2r(95.), tl::d2r(110.)),
+		std::vector<t_mat>{ tl::unit_m<t_mat>(4) }, 6) && bOk;
+
+	std::cout << (bOk ? "OK" : "FAILED") << std::endl;
+	return bOk ? 0 : -1;
+}
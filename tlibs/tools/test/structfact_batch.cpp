@@ -0,0 +1,150 @@
+/**
+ * tlibs test file
+ * @author Tobias Weber <tobias.weber@tum.de>
+ * @license GPLv2 or GPLv3
+ *
+ * ----------------------------------------------------------------------------
+ * tlibs -- a physical-mathematical C++ template library
+ * Copyright (C) 2017-2021  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2015-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+// test for batch structure factors: compare with direct summation
+// g++ -O2 -o structfact_batch structfact_batch.cpp ../../log/log.cpp -I../.. -std=c++14 -lboost_system -lpthread
+
+#include <iostream>
+#include <random>
+#include <chrono>
+#include "../../phys/atoms.h"
+#include "../../log/log.h"
+
+using T = double;
+using t_vec = tl::ublas::vector<T>;
+using t_mat = tl::ublas::matrix<T>;
+using t_cplx = std::complex<T>;
+
+
+static t_mat make_op(const std::vector<T>& rot, const std::vector<T>& trans)
+{
+	t_mat mat = tl::unit_m<t_mat>(4);
+	for(int i=0; i<3; ++i)
+	{
+		for(int j=0; j<3; ++j)
+			mat(i,j) = rot[i*3+j];
+		mat(i,3) = trans[i];
+	}
+	return mat;
+}
+
+
+static bool test(const char* pcName, const std::vector<t_mat>& vecOps,
+	bool bComplexB, std::mt19937& rng)
+{
+	std::uniform_real_distribution<T> dist(0., 1.);
+
+	// generate all atoms in the unit cell
+	std::vector<t_vec> vecAtoms, vecAtomsPhase;
+	std::vector<t_cplx> vecB;
+	for(int iAtom=0; iAtom<20; ++iAtom)
+	{
+		t_vec vecPos = tl::make_vec<t_vec>({ dist(rng), dist(rng), dist(rng), 1. });
+		t_cplx b(dist(rng), bComplexB ? dist(rng) : 0.);
+
+		for(const t_mat& op : vecOps)
+		{
+			t_vec vecNew = tl::mult<t_mat, t_vec>(op, vecPos);
+			vecNew.resize(3, true);
+			vecAtoms.push_back(vecNew);
+			vecAtomsPhase.push_back(vecNew * T(2)*tl::get_pi<T>());
+			vecB.push_back(b);
+		}
+	}
+
+	std::vector<std::array<int, 3>> vecHKL;
+	const int iMax = 8;
+	for(int h=-iMax; h<=iMax; ++h)
+	for(int k=-iMax; k<=iMax; ++k)
+	for(int l=-iMax; l<=iMax; ++l)
+		vecHKL.push_back({{ h, k, l }});
+
+	tl::StructFactBatch<T> sf(vecAtoms, vecB);
+	if(!sf.SetSymOps(vecOps))
+	{
+		std::cerr << pcName << ": symmetry operations rejected." << std::endl;
+		return false;
+	}
+	sf.SetNumThreads(4);
+
+	auto tStart = std::chrono::steady_clock::now();
+	std::vector<t_cplx> vecF = sf.Calc(vecHKL);
+	auto tBatch = std::chrono::steady_clock::now();
+
+	T dMaxDiff = 0;
+	for(std::size_t i=0; i<vecHKL.size(); ++i)
+	{
+		t_vec vecG = tl::make_vec<t_vec>({ T(vecHKL[i][0]), T(vecHKL[i][1]), T(vecHKL[i][2]) });
+		t_cplx F = tl::structfact<T, t_cplx, t_vec, std::vector>(vecAtomsPhase, vecG, vecB);
+		dMaxDiff = std::max(dMaxDiff, std::abs(F - vecF[i]));
+
+		t_cplx Fsingle = sf.Calc(vecG[0], vecG[1], vecG[2]);
+		dMaxDiff = std::max(dMaxDiff, std::abs(F - Fsingle));
+	}
+	auto tDirect = std::chrono::steady_clock::now();
+
+	std::cout << pcName << ": " << vecHKL.size() << " reflections, "
+		<< sf.GetNumAtoms() << " atoms, max. deviation: " << dMaxDiff
+		<< ", batch: " << std::chrono::duration<T>(tBatch-tStart).count() << " s"
+		<< ", direct: " << std::chrono::duration<T>(tDirect-tBatch).count() << " s"
+		<< std::endl;
+
+	return dMaxDiff < 1e-8;
+}
+
+
+int main()
+{
+	std::mt19937 rng(1234);
+
+	// P 2_1/m
+	std::vector<t_mat> vecP21m =
+	{
+		make_op({ 1,0,0, 0,1,0, 0,0,1 }, { 0,0,0 }),
+		make_op({ -1,0,0, 0,-1,0, 0,0,1 }, { 0,0,0.5 }),
+		make_op({ -1,0,0, 0,-1,0, 0,0,-1 }, { 0,0,0 }),
+		make_op({ 1,0,0, 0,1,0, 0,0,-1 }, { 0,0,0.5 }),
+	};
+
+	// P 4_2
+	std::vector<t_mat> vecP42 =
+	{
+		make_op({ 1,0,0, 0,1,0, 0,0,1 }, { 0,0,0 }),
+		make_op({ 0,-1,0, 1,0,0, 0,0,1 }, { 0,0,0.5 }),
+		make_op({ -1,0,0, 0,-1,0, 0,0,1 }, { 0,0,0 }),
+		make_op({ 0,1,0, -1,0,0, 0,0,1 }, { 0,0,0.5 }),
+	};
+
+	bool bOk = true;
+	bOk = test("P 2_1/m, real b", vecP21m, false, rng) && bOk;
+	bOk = test("P 2_1/m, complex b", vecP21m, true, rng) && bOk;
+	bOk = test("P 4_2, real b", vecP42, false, rng) && bOk;
+	bOk = test("P 4_2, complex b", vecP42, true, rng) && bOk;
+
+	std::cout << (bOk ? "OK" : "FAILED") << std::endl;
+	return bOk ? 0 : -1;
+}
@@ -0,0 +1,101 @@
+/**
+ * Swarm fitting algorithms
+ *
+ * @author Tobias Weber <tobias.weber@tum.de>
+ * @date Feb-17
+ * @license GPLv2 or GPLv3
+ *
+ * gcc -o swarm swarm.cpp ../math/rand.cpp ../log/log.cpp -lstdc++ -lm -lpthread
+ *
+ * ----------------------------------------------------------------------------
+ * tlibs -- a physical-mathematical C++ template library
+ * Copyright (C) 2017-2021  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2015-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+// test for the parallel swarm: same result for any number of threads
+// g++ -O2 -o swarm_par swarm_par.cpp ../../math/rand.cpp ../../log/log.cpp -I../.. -std=c++14 -lboost_system -lpthread
+
+#include <iostream>
+#include "../../fit/swarm.h"
+
+using t_real = double;
+
+
+int main()
+{
+	std::vector<t_real> vecX, vecY, vecYErr;
+	for(t_real x=-5.; x<=5.; x+=0.25)
+	{
+		vecX.push_back(x);
+		vecY.push_back(3.*std::exp(-0.5*(x-0.7)*(x-0.7)/(1.2*1.2)) + 0.5);
+		vecYErr.push_back(0.1);
+	}
+
+	auto func = [](t_real x, t_real amp, t_real x0, t_real sig, t_real offs) -> t_real
+	{ return amp*std::exp(-0.5*(x-x0)*(x-x0)/(sig*sig)) + offs; };
+	tl::FitterLamFuncModel<t_real, 5, decltype(func)> mod(func);
+
+	std::vector<t_real> vecBest1;
+	bool bOk = true;
+
+	for(unsigned int iThreads : { 1u, 4u })
+	{
+		// one model clone per worker
+		std::vector<std::shared_ptr<tl::FitterFuncModel<t_real>>> vecMods;
+		std::vector<tl::UnkindnessPar<t_real>::t_func> vecFuncs;
+		for(unsigned int iThread=0; iThread<iThreads; ++iThread)
+		{
+			std::shared_ptr<tl::FitterFuncModel<t_real>> pMod(mod.copy());
+			vecMods.push_back(pMod);
+			vecFuncs.push_back([pMod, &vecX, &vecY, &vecYErr](const std::vector<t_real>& vecParams) -> t_real
+			{
+				pMod->SetParams(vecParams);
+				auto fkt = [&pMod](t_real x) -> t_real { return (*pMod)(x); };
+				return tl::chi2<t_real, decltype(fkt), const t_real*>(
+					fkt, vecX.size(), vecX.data(), vecY.data(), vecYErr.data());
+			});
+		}
+
+		tl::UnkindnessPar<t_real> unk;
+		unk.SetSeed(1234);
+		unk.SetFuncs(vecFuncs);
+		unk.SetMaxGenerations(200);
+		unk.SetMaxBestIters(20);
+		unk.Init(256, { 0., -3., 0.1, -1. }, { 5., 3., 3., 1. });
+		unk.Run();
+
+		const std::vector<t_real>& vecBest = unk.GetBestPos();
+		std::cout << iThreads << " thread(s): chi2 = " << unk.GetBestVal()
+			<< ", evaluations: " << unk.GetNumEvals()
+			<< ", converged: " << unk.IsConverged() << ", params:";
+		for(t_real d : vecBest)
+			std::cout << " " << d;
+		std::cout << std::endl;
+
+		if(vecBest1.size() == 0)
+			vecBest1 = vecBest;
+		else
+			bOk = bOk && (vecBest1 == vecBest);
+	}
+
+	bOk = bOk && std::abs(vecBest1[0]-3.) < 0.1 && std::abs(vecBest1[1]-0.7) < 0.1;
+	std::cout << (bOk ? "OK" : "FAILED") << std::endl;
+	return bOk ? 0 : -1;
+}